@@ -7,15 +7,38 @@
  * terminal UI.
  *
  * Build: mkdir build && cd build && cmake .. && make
- * Run:   ./rc_emulator [-o recording.bin]
+ * Run:   ./rc_emulator [-o recording.rcap]
+ *        ./rc_emulator -H [options] (-O file|- | -u path|@name | -t) [-o recording.rcap]
+ *
+ * -o records every generated frame as a timestamped capture
+ * (rc_monitor_capture.h), one chunk per tick (per write with -H).
+ *
+ * -H is a headless load generator for soak tests and parser benchmarks: no
+ * UI, synthesized input at any rate up to unthrottled, optional noise,
+ * truncated frames, bit flips, interleaved non-RC frames and arbitrary
+ * chunk splits (see usage()).
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* posix_openpt, cfmakeraw */
+#endif
+
 #include <ncurses.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
 #include <unistd.h>
 #include "rc_monitor.h"
+#include "rc_monitor_capture.h"
 
 /* --- Constants --- */
 
@@ -72,7 +95,7 @@ typedef struct {
 
 static rc_state_t g_parsed;
 static uint32_t   g_seq;
-static FILE      *g_rec_fp;
+static rcm_capture_writer_t *g_rec;
 
 /* --- Helpers --- */
 
@@ -357,7 +380,7 @@ static void draw_ui(const emu_state_t *e, const rc_state_t *p) {
     mvprintw(ROW_TITLE, 1, "DJI RC Emulator");
     attroff(A_BOLD);
     mvprintw(ROW_TITLE, 45, "20 Hz | Seq: %u", g_seq);
-    if (g_rec_fp)
+    if (g_rec)
         mvprintw(ROW_TITLE, 65, "[REC]");
 
     /* Stick boxes */
@@ -418,32 +441,437 @@ static void draw_ui(const emu_state_t *e, const rc_state_t *p) {
     refresh();
 }
 
+/* --- Headless load generator --- */
+
+/*
+ * -H skips the UI and synthesizes input as fast as asked: every tick sweeps
+ * the axes through triangle waves, presses random buttons and emits one RC
+ * push through build_payload() and rcm_build_packet(), optionally wrapped in
+ * faults. The resulting byte stream is cut into arbitrary chunks and written
+ * to a file, stdout, a pty or a Unix socket client.
+ */
+
+#define HL_NOISE_MAX   32
+#define HL_OTHER_MAX   60
+#define HL_PENDING     (1u << 17)
+#define HL_FLAT_CHUNK  65536    /* write size when unthrottled without -c */
+
+typedef struct {
+    double   rate;              /* RC frames per second, 0 = unthrottled */
+    uint64_t frames;            /* 0 = until interrupted or the peer goes away */
+    uint64_t seed;
+    double   p_noise, p_trunc, p_flip, p_other;
+    size_t   chunk_min, chunk_max;  /* 0: one write per tick */
+    const char *out_path;       /* "-" = stdout */
+    const char *sock;
+    bool     pty;
+    bool     verify;
+} hl_config_t;
+
+typedef struct {
+    uint64_t ticks, bytes, writes;
+    uint64_t noise, truncated, flipped, other;
+    uint64_t intact;            /* RC pushes sent undamaged */
+} hl_counts_t;
+
+static volatile sig_atomic_t g_stop;
+static uint64_t g_decoded;
+
+static void hl_on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void hl_count_cb(const rc_state_t *state, void *ud) {
+    (void)state; (void)ud;
+    g_decoded++;
+}
+
+/* xorshift64*: reproducible for a given -s seed */
+static uint64_t hl_rand(uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1Dull;
+}
+
+static bool hl_chance(uint64_t *s, double p) {
+    return p > 0 && (double)(hl_rand(s) >> 11) * (1.0 / 9007199254740992.0) < p;
+}
+
+static size_t hl_range(uint64_t *s, size_t lo, size_t hi) {
+    return lo + (size_t)(hl_rand(s) % (hi - lo + 1));
+}
+
+static uint64_t hl_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Triangle wave over [-amp, amp] with the given period in ticks */
+static int hl_triangle(uint64_t t, unsigned period, int amp) {
+    unsigned ph = (unsigned)(t % period);
+    int v = (int)((4 * (uint64_t)amp * ph) / period);
+    if (v > 2 * amp) v = 4 * amp - v;
+    return v - amp;
+}
+
+static void hl_synth(emu_state_t *e, uint64_t t, uint64_t *rng) {
+    uint64_t r = hl_rand(rng);
+    memset(e, 0, sizeof(*e));
+    e->stick_left_h  = hl_triangle(t, 200, STICK_MAX);
+    e->stick_left_v  = hl_triangle(t, 310, STICK_MAX);
+    e->stick_right_h = hl_triangle(t, 450, STICK_MAX);
+    e->stick_right_v = hl_triangle(t, 570, STICK_MAX);
+    e->left_wheel    = hl_triangle(t, 800, WHEEL_MAX);
+    e->right_wheel   = hl_triangle(t, 1000, WHEEL_MAX);
+    if ((r & 0xF) == 0)
+        e->right_wheel_delta = (int)((r >> 4) % 63) - 31;
+
+    /* Each momentary input is down on roughly one tick in 16 */
+    bool *btn[] = { &e->pause, &e->gohome, &e->shutter, &e->record,
+                    &e->custom1, &e->custom2, &e->custom3,
+                    &e->five_d_up, &e->five_d_down, &e->five_d_left,
+                    &e->five_d_right, &e->five_d_center };
+    r >>= 16;
+    for (size_t i = 0; i < sizeof(btn) / sizeof(btn[0]); i++, r >>= 4)
+        *btn[i] = (r & 0xF) == 0;
+    static const rc_flight_mode_t modes[] = { RC_MODE_SPORT, RC_MODE_NORMAL, RC_MODE_TRIPOD };
+    e->flight_mode = modes[(t / 500) % 3];
+}
+
+/*
+ * A non-RC frame (FC telemetry-like, cmd_set 0x03) with a random payload
+ * whose first bytes cannot be mistaken for the v2/v3 RC push pair.
+ */
+static int hl_other_frame(uint8_t *out, size_t size, uint16_t seq, uint64_t *rng) {
+    uint8_t payload[HL_OTHER_MAX];
+    size_t len = hl_range(rng, 1, HL_OTHER_MAX);
+    for (size_t i = 0; i < len; i++)
+        payload[i] = (uint8_t)hl_rand(rng);
+    payload[0] &= 0x7F;
+    if (payload[0] == DUML_CMD_SET_RC) payload[0] = 0;
+    if (len > 1 && payload[1] == DUML_CMD_SET_RC) payload[1] = 0;
+    return rcm_build_packet(out, size, DUML_DEV_FC, 0, DUML_DEV_APP, 0, seq,
+                            DUML_PACK_REQUEST, DUML_ACK_NO_ACK, 0,
+                            0x03, 0x43, payload, len);
+}
+
+static int hl_listen_unix(const char *path) {
+    struct sockaddr_un addr;
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(addr.sun_path)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, len);
+    socklen_t alen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len + 1);
+#ifdef __linux__
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0';    /* abstract namespace */
+        alen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len);
+    } else
+#endif
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (const struct sockaddr *)&addr, alen) != 0 || listen(fd, 1) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    fprintf(stderr, "waiting for a client on %s\n", path);
+    int client = accept(fd, NULL, NULL);
+    int err = errno;
+    close(fd);
+    if (path[0] != '@') unlink(path);
+    errno = err;
+    return client;
+}
+
+static int hl_open_pty(void) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+    struct termios tio;
+    const char *slave;
+    if (grantpt(fd) != 0 || unlockpt(fd) != 0 || !(slave = ptsname(fd)) ||
+        tcgetattr(fd, &tio) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    cfmakeraw(&tio); /* no line discipline: bytes pass through untouched */
+    tcsetattr(fd, TCSANOW, &tio);
+    printf("%s\n", slave);
+    fflush(stdout);
+    return fd;
+}
+
+/* @return 0, or -1 with errno set (EPIPE etc. when the peer went away) */
+static int hl_write(int fd, const uint8_t *data, size_t len, hl_counts_t *n,
+                    rcm_parser_t *check) {
+    if (g_rec)
+        rcm_capture_write(g_rec, 0, RCM_CAPTURE_SRC_EMULATOR, RCM_CAPTURE_IN, data, len);
+    if (check)
+        rcm_feed(check, data, len);
+    n->writes++;
+    n->bytes += len;
+    while (len > 0) {
+        ssize_t w = write(fd, data, len);
+        if (w < 0) {
+            if (errno == EINTR && !g_stop) continue;
+            return -1;
+        }
+        data += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+static int run_headless(const hl_config_t *cfg) {
+    int fd;
+    if (cfg->sock)
+        fd = hl_listen_unix(cfg->sock);
+    else if (cfg->pty)
+        fd = hl_open_pty();
+    else if (strcmp(cfg->out_path, "-") == 0)
+        fd = STDOUT_FILENO;
+    else
+        fd = open(cfg->out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(cfg->sock ? cfg->sock : cfg->pty ? "pty" : cfg->out_path);
+        return 1;
+    }
+
+    rcm_parser_t *check = NULL;
+    if (cfg->verify && !(check = rcm_create(hl_count_cb, NULL))) {
+        fprintf(stderr, "rcm_create failed\n");
+        return 1;
+    }
+
+    uint8_t *pending = malloc(HL_PENDING);
+    if (!pending) {
+        perror("malloc");
+        rcm_destroy(check);
+        return 1;
+    }
+    size_t plen = 0;
+    size_t cmin = cfg->chunk_min, cmax = cfg->chunk_max;
+    if (cmin == 0 && cfg->rate == 0)
+        cmin = cmax = HL_FLAT_CHUNK;
+    uint64_t rng = cfg->seed ? cfg->seed : 1;
+    size_t next = cmin ? hl_range(&rng, cmin, cmax) : 0;
+
+    hl_counts_t n = { 0 };
+    uint64_t period = cfg->rate > 0 ? (uint64_t)(1e9 / cfg->rate) : 0;
+    uint64_t start = hl_now_ns();
+    int rc = 0;
+
+    while (!g_stop && (cfg->frames == 0 || n.ticks < cfg->frames)) {
+        if (period) {
+            /* Sleep only when ahead of schedule, so high rates catch up */
+            uint64_t due = start + n.ticks * period, now = hl_now_ns();
+            if (due > now) {
+                struct timespec ts = { .tv_sec  = (time_t)((due - now) / 1000000000ull),
+                                       .tv_nsec = (long)((due - now) % 1000000000ull) };
+                nanosleep(&ts, NULL);
+            }
+        }
+
+        uint8_t *p = pending + plen;
+        if (hl_chance(&rng, cfg->p_noise)) {
+            size_t k = hl_range(&rng, 1, HL_NOISE_MAX);
+            for (size_t i = 0; i < k; i++)
+                p[i] = (uint8_t)hl_rand(&rng);
+            p += k;
+            n.noise++;
+        }
+        if (hl_chance(&rng, cfg->p_other)) {
+            int olen = hl_other_frame(p, 128, (uint16_t)(g_seq++ & 0xFFFF), &rng);
+            if (olen > 0) p += olen;
+            n.other++;
+        }
+
+        emu_state_t emu;
+        uint8_t payload[RC_PUSH_PAYLOAD_LEN];
+        hl_synth(&emu, n.ticks, &rng);
+        build_payload(&emu, payload);
+        int flen = rcm_build_packet(p, 64, DUML_DEV_RC, 0, DUML_DEV_APP, 0,
+                                    (uint16_t)(g_seq++ & 0xFFFF),
+                                    DUML_PACK_REQUEST, DUML_ACK_NO_ACK, 0,
+                                    DUML_CMD_SET_RC, DUML_CMD_RC_PUSH,
+                                    payload, RC_PUSH_PAYLOAD_LEN);
+        if (flen <= 0) {
+            fprintf(stderr, "rcm_build_packet failed\n");
+            rc = 1;
+            break;
+        }
+        if (hl_chance(&rng, cfg->p_trunc)) {
+            flen = (int)hl_range(&rng, 1, (size_t)flen - 1);
+            n.truncated++;
+        } else if (hl_chance(&rng, cfg->p_flip)) {
+            size_t bit = hl_range(&rng, 0, (size_t)flen * 8 - 1);
+            p[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            n.flipped++;
+        } else {
+            n.intact++;
+        }
+        p += flen;
+        plen = (size_t)(p - pending);
+        n.ticks++;
+
+        /* Emit the stream in chunk-sized writes, unrelated to frame edges */
+        size_t off = 0;
+        if (!next) {
+            next = plen;
+        }
+        while (plen - off >= next) {
+            if (hl_write(fd, pending + off, next, &n, check) != 0) {
+                rc = -1;
+                break;
+            }
+            off += next;
+            next = cmin ? hl_range(&rng, cmin, cmax) : 0;
+            if (!next) break;
+        }
+        if (rc) break;
+        memmove(pending, pending + off, plen - off);
+        plen -= off;
+    }
+    if (rc == 0 && plen > 0 && hl_write(fd, pending, plen, &n, check) != 0)
+        rc = -1;
+    if (rc < 0) {
+        if (errno == EPIPE || errno == ECONNRESET || errno == EIO || errno == EINTR) {
+            rc = 0; /* peer went away or interrupted */
+        } else {
+            perror("write");
+            rc = 1;
+        }
+    }
+
+    double secs = (double)(hl_now_ns() - start) / 1e9;
+    fprintf(stderr,
+            "%llu frames (%llu intact, %llu truncated, %llu bit-flipped), "
+            "%llu non-RC, %llu noise bursts\n"
+            "%llu bytes in %llu writes, %.3f s, %.0f frames/s, %.1f MB/s\n",
+            (unsigned long long)n.ticks, (unsigned long long)n.intact,
+            (unsigned long long)n.truncated, (unsigned long long)n.flipped,
+            (unsigned long long)n.other, (unsigned long long)n.noise,
+            (unsigned long long)n.bytes, (unsigned long long)n.writes, secs,
+            secs > 0 ? (double)n.ticks / secs : 0.0,
+            secs > 0 ? (double)n.bytes / secs / 1e6 : 0.0);
+    if (check) {
+        fprintf(stderr, "verify: %llu of %llu intact pushes decoded\n",
+                (unsigned long long)g_decoded, (unsigned long long)n.intact);
+        if (g_decoded != n.intact && rc == 0) rc = 2;
+        rcm_destroy(check);
+    }
+
+    free(pending);
+    if (cfg->pty) {
+        /* Closing the master discards unread output: wait for the reader
+         * to close the slave first */
+        struct pollfd pfd = { .fd = fd, .events = 0 };
+        while (!g_stop && poll(&pfd, 1, -1) < 0 && errno == EINTR)
+            ;
+    }
+    if (fd != STDOUT_FILENO) close(fd);
+    return rc;
+}
+
 /* --- Main --- */
 
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [-o recording.rcap]\n"
+            "       %s -H [-r rate] [-n frames] [-s seed] [-N p] [-T p] [-B p] [-I p]\n"
+            "          [-c min[:max]] [-V] (-O file|- | -u path|@name | -t) [-o recording.rcap]\n"
+            "  -H  headless load generator, no UI\n"
+            "  -r  RC frames per second (default 50, 0 = unthrottled)\n"
+            "  -n  stop after this many frames (default: until interrupted)\n"
+            "  -s  random seed (default 1)\n"
+            "  -N  probability of 1-%d noise bytes before a frame\n"
+            "  -T  probability of truncating an RC frame\n"
+            "  -B  probability of flipping one bit of an RC frame\n"
+            "  -I  probability of a non-RC frame before an RC frame\n"
+            "  -c  write the stream in chunks of min..max bytes (default: one write\n"
+            "      per frame, %u bytes when unthrottled)\n"
+            "  -V  also feed the output to a parser and check every intact push decodes\n"
+            "  -O  write to a file, - for stdout\n"
+            "  -u  listen on a Unix socket (@name: abstract) and serve one client\n"
+            "  -t  create a pty and print its slave path\n",
+            argv0, argv0, HL_NOISE_MAX, HL_FLAT_CHUNK);
+}
+
 int main(int argc, char *argv[]) {
     const char *rec_path = NULL;
+    hl_config_t hl = { .rate = 50, .seed = 1 };
+    bool headless = false;
     int opt;
-    while ((opt = getopt(argc, argv, "o:")) != -1) {
-        if (opt == 'o')
-            rec_path = optarg;
-        else {
-            fprintf(stderr, "Usage: %s [-o recording.bin]\n", argv[0]);
-            return 1;
+    while ((opt = getopt(argc, argv, "o:Hr:n:s:N:T:B:I:c:VO:u:t")) != -1) {
+        char *end;
+        switch (opt) {
+        case 'o': rec_path = optarg; break;
+        case 'H': headless = true; break;
+        case 'r': hl.rate = strtod(optarg, NULL); break;
+        case 'n': hl.frames = strtoull(optarg, NULL, 0); break;
+        case 's': hl.seed = strtoull(optarg, NULL, 0); break;
+        case 'N': hl.p_noise = strtod(optarg, NULL); break;
+        case 'T': hl.p_trunc = strtod(optarg, NULL); break;
+        case 'B': hl.p_flip = strtod(optarg, NULL); break;
+        case 'I': hl.p_other = strtod(optarg, NULL); break;
+        case 'c':
+            hl.chunk_min = hl.chunk_max = (size_t)strtoul(optarg, &end, 0);
+            if (*end == ':')
+                hl.chunk_max = (size_t)strtoul(end + 1, NULL, 0);
+            break;
+        case 'V': hl.verify = true; break;
+        case 'O': hl.out_path = optarg; break;
+        case 'u': hl.sock = optarg; break;
+        case 't': hl.pty = true; break;
+        default: usage(argv[0]); return 1;
         }
     }
+    int outputs = (hl.out_path != NULL) + (hl.sock != NULL) + hl.pty;
+    if (optind != argc || (headless ? outputs != 1 : outputs != 0) || hl.rate < 0 ||
+        hl.chunk_max < hl.chunk_min || hl.chunk_max > HL_FLAT_CHUNK) {
+        usage(argv[0]);
+        return 1;
+    }
 
     if (rec_path) {
-        g_rec_fp = fopen(rec_path, "wb");
-        if (!g_rec_fp) {
-            perror("fopen");
+        g_rec = rcm_capture_open(rec_path, 0);
+        if (!g_rec) {
+            perror("rcm_capture_open");
             return 1;
         }
     }
 
+    if (headless) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = hl_on_signal;  /* no SA_RESTART: interrupt sleeps and writes */
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        signal(SIGPIPE, SIG_IGN);
+        int rc = run_headless(&hl);
+        if (g_rec && rcm_capture_close(g_rec) != 0) {
+            fprintf(stderr, "warning: %s may be incomplete\n", rec_path);
+            if (rc == 0) rc = 1;
+        }
+        return rc;
+    }
+
     rcm_parser_t *parser = rcm_create(emulator_cb, NULL);
     if (!parser) {
         fprintf(stderr, "rcm_create failed\n");
-        if (g_rec_fp) fclose(g_rec_fp);
+        if (g_rec) rcm_capture_close(g_rec);
         return 1;
     }
 
@@ -500,8 +928,9 @@ int main(int argc, char *argv[]) {
 
         if (flen > 0) {
             rcm_feed(parser, frame, (size_t)flen);
-            if (g_rec_fp)
-                fwrite(frame, 1, (size_t)flen, g_rec_fp);
+            if (g_rec)
+                rcm_capture_write(g_rec, 0, RCM_CAPTURE_SRC_EMULATOR,
+                                  RCM_CAPTURE_IN, frame, (size_t)flen);
         }
 
         g_seq++;
@@ -518,8 +947,8 @@ done:
     endwin();
 
     rcm_destroy(parser);
-    if (g_rec_fp)
-        fclose(g_rec_fp);
+    if (g_rec && rcm_capture_close(g_rec) != 0)
+        fprintf(stderr, "warning: %s may be incomplete\n", rec_path);
 
     return 0;
 }
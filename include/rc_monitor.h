@@ -29,6 +29,8 @@ extern "C" {
 #define DUML_FOOTER_LEN       2
 #define DUML_MIN_FRAME_LEN    13    /* SOF(1)+LenVer(2)+CRC8(1)+Sender(1)+Receiver(1)+Seq(2)+CmdType(1)+CmdSet(1)+CmdId(1)+CRC16(2) */
 #define DUML_MAX_FRAME_LEN    1400
+#define DUML_CRC8_SEED        0x77    /* header CRC8, reflected poly 0x8C */
+#define DUML_CRC16_SEED       0x3692  /* frame CRC16, reflected poly 0x8408 */
 
 #define RC_PUSH_PAYLOAD_LEN   17
 
@@ -109,6 +111,65 @@ typedef struct {
     int8_t  right_wheel_delta; /* incremental, signed, from 5-bit field */
 } rc_state_t;
 
+/* --- Packed RC State --- */
+
+/*
+ * Compact 16-byte form of rc_state_t for histories, mailboxes and bulk
+ * transfers: buttons, 5D joystick and flight mode share one flags word and
+ * the axes are kept as int16. Use the accessors below rather than the bit
+ * layout directly.
+ */
+typedef struct {
+    uint16_t flags;              /* RCM_PK_* button bits + flight mode */
+    int16_t  stick_right_h;
+    int16_t  stick_right_v;
+    int16_t  stick_left_h;
+    int16_t  stick_left_v;
+    int16_t  left_wheel;
+    int16_t  right_wheel;
+    int8_t   right_wheel_delta;
+    uint8_t  reserved;           /* always 0 */
+} rcm_packed_state_t;
+
+#ifdef __cplusplus
+static_assert(sizeof(rcm_packed_state_t) == 16, "rcm_packed_state_t must be 16 bytes");
+#else
+_Static_assert(sizeof(rcm_packed_state_t) == 16, "rcm_packed_state_t must be 16 bytes");
+#endif
+
+/* Bits of rcm_packed_state_t.flags */
+#define RCM_PK_PAUSE           (1u << 0)
+#define RCM_PK_GOHOME          (1u << 1)
+#define RCM_PK_SHUTTER         (1u << 2)
+#define RCM_PK_RECORD          (1u << 3)
+#define RCM_PK_CUSTOM1         (1u << 4)
+#define RCM_PK_CUSTOM2         (1u << 5)
+#define RCM_PK_CUSTOM3         (1u << 6)
+#define RCM_PK_FIVE_D_UP       (1u << 7)
+#define RCM_PK_FIVE_D_DOWN     (1u << 8)
+#define RCM_PK_FIVE_D_LEFT     (1u << 9)
+#define RCM_PK_FIVE_D_RIGHT    (1u << 10)
+#define RCM_PK_FIVE_D_CENTER   (1u << 11)
+#define RCM_PK_BUTTON_MASK     0x0FFFu
+#define RCM_PK_MODE_SHIFT      12
+#define RCM_PK_MODE_MASK       (0x3u << RCM_PK_MODE_SHIFT)
+
+/* True if every bit in `pk_bits` (RCM_PK_*) is set */
+static inline bool rcm_packed_pressed(const rcm_packed_state_t *s, uint16_t pk_bits) {
+    return (s->flags & pk_bits) == pk_bits;
+}
+
+static inline rc_flight_mode_t rcm_packed_flight_mode(const rcm_packed_state_t *s) {
+    return (rc_flight_mode_t)((s->flags & RCM_PK_MODE_MASK) >> RCM_PK_MODE_SHIFT);
+}
+
+/*
+ * Convert between rc_state_t and the packed form. Lossless in both
+ * directions for every state the decoder can produce.
+ */
+void rcm_pack_state(const rc_state_t *in, rcm_packed_state_t *out);
+void rcm_unpack_state(const rcm_packed_state_t *in, rc_state_t *out);
+
 /* --- Callback --- */
 
 /*
@@ -144,6 +205,8 @@ void rcm_destroy(rcm_parser_t *p);
  * May invoke the callback zero or more times synchronously.
  * Not internally synchronized — safe to call from any single thread
  * (e.g. the USB read thread), but concurrent calls require external locking.
+ * The one exception is rcm_snapshot*(), which other threads may call at
+ * any time while this thread feeds.
  *
  * @param p    Parser handle
  * @param data Raw bytes from USB bulk transfer
@@ -157,6 +220,383 @@ int rcm_feed(rcm_parser_t *p, const uint8_t *data, size_t len);
  */
 void rcm_reset(rcm_parser_t *p);
 
+/* --- Batch Output --- */
+
+/* One RC push decoded by rcm_feed_batch() */
+typedef struct {
+    rc_state_t state;
+    uint32_t   changed;   /* RCM_CHANGED_* mask (RCM_CHANGED_ALL unless
+                             change detection is enabled) */
+    uint32_t   seq;       /* running count of pushes this parser has delivered,
+                             starting at 1; not reset by rcm_reset() */
+    uint16_t   duml_seq;  /* sequence number from the DUML header */
+    int32_t    offset;    /* offset of the frame's SOF in `data`; negative if
+                             the frame started in an earlier feed call */
+} rcm_batch_entry_t;
+
+/*
+ * Like rcm_feed(), but decoded RC pushes are written to out[] instead of
+ * invoking the callback, so a whole bulk read can be handed upward at once.
+ * If more than max_out pushes complete in this call, the surplus is
+ * delivered through the parser's callback as rcm_feed() would, in order
+ * after the entries in out[].
+ *
+ * @param p       Parser handle
+ * @param data    Raw bytes from USB bulk transfer
+ * @param len     Number of bytes
+ * @param out     Output entries (may be NULL if max_out is 0)
+ * @param max_out Capacity of out
+ * @return Number of entries written to out
+ */
+int rcm_feed_batch(rcm_parser_t *p, const uint8_t *data, size_t len,
+                   rcm_batch_entry_t *out, size_t max_out);
+
+/*
+ * rcm_feed_batch() writing only the 16-byte packed state per push, for
+ * callers that don't need the per-frame metadata. Same overflow rule.
+ * @return Number of states written to out
+ */
+int rcm_feed_batch_packed(rcm_parser_t *p, const uint8_t *data, size_t len,
+                          rcm_packed_state_t *out, size_t max_out);
+
+/* --- Change Detection --- */
+
+/* Changed-field bits, one per rc_state_t field */
+#define RCM_CHANGED_PAUSE        (1u << 0)
+#define RCM_CHANGED_GOHOME       (1u << 1)
+#define RCM_CHANGED_SHUTTER      (1u << 2)
+#define RCM_CHANGED_RECORD       (1u << 3)
+#define RCM_CHANGED_CUSTOM1      (1u << 4)
+#define RCM_CHANGED_CUSTOM2      (1u << 5)
+#define RCM_CHANGED_CUSTOM3      (1u << 6)
+#define RCM_CHANGED_FIVE_D       (1u << 7)
+#define RCM_CHANGED_FLIGHT_MODE  (1u << 8)
+#define RCM_CHANGED_STICK_RH     (1u << 9)
+#define RCM_CHANGED_STICK_RV     (1u << 10)
+#define RCM_CHANGED_STICK_LH     (1u << 11)
+#define RCM_CHANGED_STICK_LV     (1u << 12)
+#define RCM_CHANGED_LEFT_WHEEL   (1u << 13)
+#define RCM_CHANGED_RIGHT_WHEEL  (1u << 14)
+#define RCM_CHANGED_WHEEL_DELTA  (1u << 15)
+#define RCM_CHANGED_ALL          0xFFFFu
+
+/*
+ * Callback used in change-detection mode.
+ * @param state    Parsed RC state
+ * @param changed  RCM_CHANGED_* bits for fields that differ from the last
+ *                 delivered state (RCM_CHANGED_ALL for the first one)
+ * @param userdata Opaque pointer passed to rcm_create()
+ */
+typedef void (*rcm_change_callback_t)(const rc_state_t *state, uint32_t changed,
+                                      void *userdata);
+
+/*
+ * Enable or disable change-detection mode. When enabled, an RC push is
+ * delivered only if a button, the 5D joystick or the flight mode changed,
+ * a stick or wheel axis moved more than `axis_deadband` from its last
+ * delivered value, or the right wheel reports a non-zero delta (it is
+ * incremental, so a steadily turning wheel sends identical packets).
+ * Pushes whose raw payload is identical to the previous one are rejected
+ * with a 17-byte compare before any decoding. Suppressed pushes are not
+ * counted in rcm_feed()'s return value.
+ *
+ * @param p             Parser handle
+ * @param enable        true to enable, false to deliver every push again
+ * @param axis_deadband Axis movement that must be exceeded (0 = any change)
+ * @param cb            Optional callback that also receives the changed
+ *                      mask; NULL keeps using the rcm_create() callback
+ */
+void rcm_set_change_detect(rcm_parser_t *p, bool enable, uint16_t axis_deadband,
+                           rcm_change_callback_t cb);
+
+/* --- Header Layout Lock-in --- */
+
+/* rcm_stats_t.layout */
+#define RCM_LAYOUT_NONE             0   /* not locked: unclaimed frames are scanned */
+#define RCM_LAYOUT_V1               1   /* cmd_set/cmd_id at bytes 9-10 */
+#define RCM_LAYOUT_ALT              2   /* a v2/v3 variant, see layout_cmd_offset */
+
+#define RCM_LAYOUT_CONFIRM_DEFAULT  8
+#define RCM_LAYOUT_MISS_DEFAULT     1024
+
+/*
+ * A frame no handler claims at the v1 offsets is scanned for the RC push
+ * cmd_set/cmd_id pair at bytes 8-12, since DUML v2/v3 headers can differ.
+ * Once `confirm_frames` consecutive RC pushes have been found at one
+ * layout, the parser locks onto it and checks unclaimed frames at that
+ * single offset only (not at all when v1 is locked). Every unclaimed frame
+ * without a push at the locked layout, and every push found elsewhere,
+ * is a miss; after `miss_limit` consecutive misses the lock is dropped and
+ * scanning resumes. rcm_reset() also drops it. The defaults are
+ * RCM_LAYOUT_CONFIRM_DEFAULT and RCM_LAYOUT_MISS_DEFAULT.
+ *
+ * @param confirm_frames Pushes needed to lock, 0 = never lock (always scan)
+ * @param miss_limit     Consecutive misses that drop the lock, 0 = never
+ */
+void rcm_set_layout_lock(rcm_parser_t *p, uint32_t confirm_frames, uint32_t miss_limit);
+
+/* --- Frame Handlers --- */
+
+/*
+ * Read-only view of a CRC-validated DUML frame. Header fields are decoded
+ * once from the v1 layout; `frame` and `payload` point into the bytes given
+ * to rcm_feed() (or the parser's staging buffer) and are only valid for the
+ * duration of the handler call.
+ */
+typedef struct {
+    const uint8_t *frame;         /* SOF .. CRC16 */
+    uint16_t       frame_len;
+    uint8_t        version;
+    uint8_t        sender_type;
+    uint8_t        sender_index;
+    uint8_t        receiver_type;
+    uint8_t        receiver_index;
+    uint16_t       seq;
+    uint8_t        pack_type;     /* DUML_PACK_REQUEST / DUML_PACK_RESPONSE */
+    uint8_t        ack_type;
+    uint8_t        encrypt_type;
+    uint8_t        cmd_set;
+    uint8_t        cmd_id;
+    const uint8_t *payload;
+    size_t         payload_len;
+    uint64_t       stream_offset; /* offset of SOF in the parser's input stream */
+} rcm_frame_view_t;
+
+/*
+ * Called for each validated frame whose (cmd_set, cmd_id) it was registered
+ * for. The return value is added to rcm_feed()'s result; the built-in RC push
+ * handler returns 1 per decoded push. Handlers may (un)register handlers but
+ * must not feed or reset the parser that is calling them.
+ */
+typedef int (*rcm_frame_handler_t)(const rcm_frame_view_t *frame, void *userdata);
+
+/*
+ * Register `fn` for frames with the given cmd_set/cmd_id, replacing any
+ * previous handler for that pair (including the built-in RC push handler
+ * for DUML_CMD_SET_RC/DUML_CMD_RC_PUSH). Pass fn = NULL to unregister.
+ * Lookup during parsing is O(1).
+ * @return 0 on success, -1 on NULL parser or allocation failure
+ */
+int rcm_register_handler(rcm_parser_t *p, uint8_t cmd_set, uint8_t cmd_id,
+                         rcm_frame_handler_t fn, void *userdata);
+
+/*
+ * Set a handler for validated frames that have no registered handler
+ * (NULL to drop them, the default).
+ */
+void rcm_set_default_handler(rcm_parser_t *p, rcm_frame_handler_t fn,
+                             void *userdata);
+
+/* --- Statistics --- */
+
+/* Buckets in rcm_stats_t.feed_hist (log2 of rcm_feed() duration in ns) */
+#define RCM_FEED_HIST_BUCKETS 32
+
+/*
+ * Parser counters since rcm_create() or the last rcm_reset_stats(). Every
+ * input byte ends up in exactly one of: a validated frame, bytes_discarded,
+ * or the (at most one frame long) candidate still waiting for more data.
+ */
+typedef struct {
+    uint64_t bytes_in;         /* bytes passed to rcm_feed*() */
+    uint64_t bytes_discarded;  /* bytes skipped while hunting for a frame,
+                                  including staged bytes dropped by rcm_reset() */
+    uint64_t frames;           /* CRC-valid frames dispatched */
+    uint64_t crc8_failures;    /* SOF with a plausible length but bad header CRC8 */
+    uint64_t crc16_failures;   /* complete candidate with a bad CRC16 */
+    uint64_t length_errors;    /* SOF whose length field is outside
+                                  [DUML_MIN_FRAME_LEN, DUML_MAX_FRAME_LEN];
+                                  with a 10-bit field only short ones occur */
+    uint64_t rc_pushes;        /* RC pushes received, before change detection */
+    uint64_t batch_overflows;  /* states past rcm_feed_batch*()'s max_out that
+                                  went to the callback instead */
+    uint64_t frames_by_cmd_set[256];
+
+    /* Nanoseconds since the last RC push arrived (CLOCK_MONOTONIC, sampled
+     * once per rcm_feed() / rcm_feed_payload() call); UINT64_MAX if none yet. Not cleared by
+     * rcm_reset_stats(). */
+    uint64_t last_push_age_ns;
+
+    /*
+     * rcm_feed() latency histogram: feed_hist[i] counts calls that took
+     * [2^(i-1), 2^i) ns (feed_hist[0]: under 1 ns, the last bucket: anything
+     * longer). Only collected when the library is built with
+     * RCM_FEED_HISTOGRAM (CMake -DENABLE_FEED_HISTOGRAM=ON); otherwise
+     * feed_hist_enabled is false and the buckets stay zero.
+     */
+    bool     feed_hist_enabled;
+    uint64_t feed_hist[RCM_FEED_HIST_BUCKETS];
+
+    /*
+     * Request tracking (see rcm_track_request()). The RTT fields are 0 until
+     * the first matched response; rtt_smoothed_ns is an EWMA with gain 1/8
+     * and, like last_push_age_ns, is not cleared by rcm_reset_stats().
+     */
+    uint64_t requests_tracked;   /* rcm_track_request() calls that succeeded */
+    uint64_t responses_matched;  /* response frames that completed a request */
+    uint64_t request_timeouts;   /* requests dropped by rcm_expire_requests() */
+    uint64_t rtt_last_ns;
+    uint64_t rtt_min_ns;
+    uint64_t rtt_max_ns;
+    uint64_t rtt_smoothed_ns;
+
+    /*
+     * Header layout lock-in (see rcm_set_layout_lock()). layout and
+     * layout_cmd_offset describe the current lock and are not cleared by
+     * rcm_reset_stats().
+     */
+    uint8_t  layout;             /* RCM_LAYOUT_* */
+    uint8_t  layout_cmd_offset;  /* frame offset of cmd_set, 0 while scanning */
+    uint64_t layout_locks;       /* times a layout was locked */
+    uint64_t layout_fallbacks;   /* locks dropped after miss_limit misses */
+} rcm_stats_t;
+
+/*
+ * Copy the parser's counters into `out`.
+ * @return 0 on success, -1 on NULL argument
+ */
+int rcm_get_stats(const rcm_parser_t *p, rcm_stats_t *out);
+
+/* Zero all counters and the latency histogram */
+void rcm_reset_stats(rcm_parser_t *p);
+
+/* --- Latency Tracing --- */
+
+/*
+ * Trace events, in the order one RC push sees them. t_ns is CLOCK_MONOTONIC
+ * (the clock of Java's System.nanoTime()); `arg` depends on the event.
+ */
+#define RCM_TRACE_READ          0   /* rcm_trace_read(): a transport read completed; arg 0 */
+#define RCM_TRACE_FEED_BEGIN    1   /* rcm_feed*() entered; arg = bytes */
+#define RCM_TRACE_FRAME         2   /* RC push frame validated; arg = stream offset of its SOF */
+#define RCM_TRACE_CALLBACK_END  3   /* state callback returned (or batch entry stored);
+                                     * arg = push sequence number */
+#define RCM_TRACE_FEED_END      4   /* rcm_feed*() returning; arg = RC pushes decoded */
+
+typedef void (*rcm_trace_callback_t)(unsigned event, uint64_t t_ns, uint64_t arg,
+                                     void *userdata);
+
+/*
+ * Install (or with NULL remove) a trace hook, called on the feeding thread
+ * at each RCM_TRACE_* point. Each point costs one well-predicted branch
+ * while no hook is installed, so tracing can stay compiled into release
+ * builds. FRAME is reported even when change detection then suppresses
+ * the callback, so it is not always followed by CALLBACK_END; FEED_BEGIN
+ * and FEED_END always pair up. rcm_feed_payload() reports all but READ.
+ * Safe to call while another thread feeds, provided `userdata` only
+ * changes while no hook is installed.
+ */
+void rcm_set_trace_hook(rcm_parser_t *p, rcm_trace_callback_t fn, void *userdata);
+
+/*
+ * Report that the read which produced the next rcm_feed*() data completed
+ * at `t_ns` (0 = now), as an RCM_TRACE_READ event. A no-op without a hook,
+ * so readers can call it unconditionally. Feeding thread only.
+ */
+void rcm_trace_read(rcm_parser_t *p, uint64_t t_ns);
+
+/* --- Request Tracking --- */
+
+/*
+ * Outstanding-request table for commands sent with DUML_ACK_AFTER_EXEC.
+ * A tracked request occupies slot (seq % RCM_MAX_PENDING) until a
+ * DUML_PACK_RESPONSE frame with the same seq, cmd_set and cmd_id is parsed
+ * (the frame is still dispatched to its handler afterwards) or until
+ * rcm_expire_requests() finds it past its deadline. Matching costs nothing
+ * while the table is empty. Same threading rules as rcm_feed().
+ */
+#define RCM_MAX_PENDING 32
+
+/*
+ * Called once per tracked request: with the response frame and its round
+ * trip, or with resp = NULL and the time waited when it timed out.
+ */
+typedef void (*rcm_response_callback_t)(uint16_t seq, const rcm_frame_view_t *resp,
+                                        uint64_t rtt_ns, void *userdata);
+
+/* Set the response/timeout callback (NULL for statistics only) */
+void rcm_set_response_callback(rcm_parser_t *p, rcm_response_callback_t cb,
+                               void *userdata);
+
+/*
+ * Start tracking a request built by rcm_build_packet() or one of the
+ * command builders, just before (or after) it is sent; seq, cmd_set and
+ * cmd_id are read from `frame`. Tracking a seq that is already pending
+ * restarts its timer.
+ * @param timeout_ms Deadline for rcm_expire_requests(); 0 = next call
+ * @return 0 on success, -1 on NULL parser, a frame shorter than
+ *         DUML_MIN_FRAME_LEN, or a slot held by another pending seq
+ */
+int rcm_track_request(rcm_parser_t *p, const uint8_t *frame, size_t len,
+                      uint32_t timeout_ms);
+
+/*
+ * Drop every pending request whose deadline has passed, calling the
+ * response callback with resp = NULL for each.
+ * @return Number of requests that timed out
+ */
+int rcm_expire_requests(rcm_parser_t *p);
+
+/* Requests currently pending */
+unsigned rcm_pending_requests(const rcm_parser_t *p);
+
+/* Smoothed round-trip time in ns, 0 before the first matched response */
+uint64_t rcm_request_rtt_ns(const rcm_parser_t *p);
+
+/* --- Latest-State Mailbox --- */
+
+/*
+ * Every decoded RC push is also published, as a packed state, into a
+ * seqlock mailbox owned by the parser. Publishing is wait-free for the
+ * feeding thread (a handful of relaxed atomic stores); readers never block
+ * it and only retry if a publish lands mid-read, so any number of threads
+ * can poll the current sticks at their own rate without a callback or lock.
+ *
+ * Pushes are published before change detection, so the mailbox always
+ * holds the newest decoded state even when the callback was suppressed;
+ * byte-identical repeats skipped by change detection are not republished.
+ */
+
+/*
+ * Copy the most recently published state. Safe to call from any thread
+ * concurrently with rcm_feed*() and with other readers, but not with
+ * rcm_destroy().
+ * @param seq Optional; receives the publish count (1 for the first push),
+ *            so callers can tell whether anything new arrived
+ * @return 0 on success, -1 on NULL parser/state or if nothing was published yet
+ */
+int rcm_snapshot(const rcm_parser_t *p, rc_state_t *state, uint32_t *seq);
+
+/* As rcm_snapshot(), without unpacking */
+int rcm_snapshot_packed(const rcm_parser_t *p, rcm_packed_state_t *state,
+                        uint32_t *seq);
+
+/* --- Coalesced Delivery --- */
+
+/*
+ * For consumers that want state once per display frame or timer tick
+ * rather than once per push. While enabled, every mailbox publish also
+ * ORs its button bits into a pressed-since-last-take mask and adds its
+ * wheel delta to a running sum (two relaxed atomic RMWs on the feeding
+ * thread). rcm_take_coalesced() then returns the latest axes, sticks and
+ * flight mode with every button that was down in any push since the
+ * previous take, so a tap shorter than a tick is still seen once, and the
+ * wheel delta summed over the interval (saturated to int8).
+ *
+ * One consumer thread at a time. rcm_set_coalesce() clears the
+ * accumulators and marks everything published so far as taken; call it
+ * from the consumer thread, or before the consumer starts.
+ */
+void rcm_set_coalesce(rcm_parser_t *p, bool enable);
+
+/*
+ * Take the state coalesced since the previous take. Safe concurrently with
+ * rcm_feed*() on another thread.
+ * @return Pushes published since the previous take (0: nothing new, `out`
+ *         untouched), -1 on NULL argument
+ */
+int rcm_take_coalesced(rcm_parser_t *p, rcm_packed_state_t *out);
+
 /* --- Direct Payload Parsing (no DUML framing) --- */
 
 /*
@@ -170,6 +610,49 @@ void rcm_reset(rcm_parser_t *p);
  */
 int rcm_parse_payload(const uint8_t *payload, size_t len, rc_state_t *out);
 
+/*
+ * Same as rcm_parse_payload(), decoding straight into the packed form.
+ * @return 0 on success, -1 if len < 17 or a pointer is NULL
+ */
+int rcm_parse_payload_packed(const uint8_t *payload, size_t len,
+                             rcm_packed_state_t *out);
+
+/*
+ * Struct-of-arrays output of rcm_parse_payloads(): element i of each array
+ * belongs to payload i. A NULL array skips that field.
+ */
+typedef struct {
+    int16_t  *stick_right_h;
+    int16_t  *stick_right_v;
+    int16_t  *stick_left_h;
+    int16_t  *stick_left_v;
+    int16_t  *left_wheel;
+    int16_t  *right_wheel;
+    int8_t   *right_wheel_delta;
+    uint16_t *flags;             /* rcm_packed_state_t.flags: RCM_PK_* + mode */
+} rcm_payload_columns_t;
+
+/*
+ * Decode n payloads, payload i at payloads + i * stride (17 when they are
+ * contiguous), eight at a time with SSE2 or NEON where the target has it.
+ * Bit-exact with rcm_parse_payload_packed() for every input.
+ * @return 0 on success, -1 on a NULL `out`, NULL payloads with n > 0, or
+ *         stride < RC_PUSH_PAYLOAD_LEN
+ */
+int rcm_parse_payloads(const uint8_t *payloads, size_t n, size_t stride,
+                       const rcm_payload_columns_t *out);
+
+/*
+ * Deliver a raw 17-byte payload through the parser as if it had arrived in
+ * an RC push frame: change detection, the mailbox, statistics and the
+ * callback (or an active batch) all apply, with DUML seq 0. For sources
+ * that synthesize payloads instead of receiving DUML. Same threading rules
+ * as rcm_feed().
+ * @return 1 if delivered, 0 if suppressed by change detection,
+ *         -1 if len < 17 or a pointer is NULL
+ */
+int rcm_feed_payload(rcm_parser_t *p, const uint8_t *payload, size_t len);
+
 /* --- Utility --- */
 
 /*
@@ -225,6 +708,66 @@ int rcm_build_enable_cmd(uint8_t *out, size_t out_size, uint16_t seq);
  */
 int rcm_build_channel_request(uint8_t *out, size_t out_size, uint16_t seq);
 
+/* --- CRC Engine --- */
+
+/*
+ * CRC kernels. All are bit-exact with the byte-at-a-time table kernel; the
+ * fastest one the CPU supports is selected automatically on first use and
+ * is shared by the parser and rcm_build_packet().
+ */
+typedef enum {
+    RCM_CRC_KERNEL_TABLE  = 0,  /* 256-entry lookup table (reference) */
+    RCM_CRC_KERNEL_SLICE8 = 1,  /* portable slicing-by-8 */
+    RCM_CRC_KERNEL_CLMUL  = 2,  /* carry-less multiply folding (PCLMULQDQ / PMULL) */
+    RCM_CRC_KERNEL_COUNT
+} rcm_crc_kernel_t;
+
+/*
+ * Continue a DUML CRC over `data` using the active kernel.
+ * Start from DUML_CRC8_SEED / DUML_CRC16_SEED for a fresh frame. No final
+ * XOR is applied, so calls can be chained over consecutive pieces.
+ * @return Updated CRC (unchanged if data is NULL)
+ */
+uint8_t  rcm_crc8_update(uint8_t crc, const uint8_t *data, size_t len);
+uint16_t rcm_crc16_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/*
+ * Same as above, forcing a specific kernel (for self-tests and benchmarks).
+ * Unsupported kernels fall back to RCM_CRC_KERNEL_TABLE.
+ */
+uint8_t  rcm_crc8_kernel(rcm_crc_kernel_t k, uint8_t crc,
+                         const uint8_t *data, size_t len);
+uint16_t rcm_crc16_kernel(rcm_crc_kernel_t k, uint16_t crc,
+                          const uint8_t *data, size_t len);
+
+/*
+ * Whether kernel `k` can run on this CPU (and was compiled in).
+ */
+bool rcm_crc_kernel_supported(rcm_crc_kernel_t k);
+
+/*
+ * Override the automatic kernel choice process-wide.
+ * @return 0 on success, -1 if the kernel is not supported
+ */
+int rcm_crc_select(rcm_crc_kernel_t k);
+
+/*
+ * Return the kernel currently used by rcm_crc8_update()/rcm_crc16_update().
+ */
+rcm_crc_kernel_t rcm_crc_active_kernel(void);
+
+/*
+ * Return a short name for a kernel ("table", "slice8", "clmul").
+ */
+const char *rcm_crc_kernel_name(rcm_crc_kernel_t k);
+
+/*
+ * Compare every supported kernel against the table kernel over all lengths
+ * up to DUML_MAX_FRAME_LEN and several buffer alignments, for both seeds.
+ * @return 0 if all kernels agree, -1 otherwise
+ */
+int rcm_crc_self_test(void);
+
 #ifdef __cplusplus
 }
 #endif
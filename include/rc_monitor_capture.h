@@ -0,0 +1,165 @@
+/*
+ * rc_monitor_capture.h - Timestamped, indexed capture files
+ *
+ * A capture records the byte stream a parser was fed as a sequence of
+ * chunks (one per USB transfer or read()), each stamped with CLOCK_MONOTONIC
+ * nanoseconds, a source and a direction, so field logs can be replayed with
+ * their original timing and searched by time. A footer index points at the
+ * first chunk of every index_interval_ms window.
+ *
+ * File layout (all integers little-endian, every record 8-byte aligned):
+ *
+ *   header   16 B  "RCMC", u16 version (1), u16 header_len (16),
+ *                  u32 index_interval_ms, u32 reserved
+ *   chunk    16 B  u64 t_ns, u32 len, u8 source, u8 dir, u16 reserved,
+ *                  then len data bytes zero-padded to a multiple of 8
+ *   ...
+ *   index    16 B per entry: u64 t_ns, u64 file offset of the chunk
+ *   trailer  16 B  u64 index offset, u32 entry count, "RCMI"
+ *
+ * A file cut off before the trailer (crash, power loss) is still readable
+ * chunk by chunk; only the index is missing. Files that do not start with
+ * the magic are read as legacy raw .bin recordings: plain concatenated
+ * DUML frames with no timing.
+ */
+
+#ifndef RC_MONITOR_CAPTURE_H
+#define RC_MONITOR_CAPTURE_H
+
+#include "rc_monitor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RCM_CAPTURE_VERSION        1
+#define RCM_CAPTURE_HEADER_LEN     16
+#define RCM_CAPTURE_CHUNK_HDR_LEN  16
+#define RCM_CAPTURE_INDEX_ENTRY_LEN 16
+#define RCM_CAPTURE_TRAILER_LEN    16
+#define RCM_CAPTURE_MAX_CHUNK      (16u * 1024 * 1024) /* rejected by the reader above this */
+
+/* Chunk direction */
+#define RCM_CAPTURE_IN             0   /* device -> host, what rcm_feed() saw */
+#define RCM_CAPTURE_OUT            1   /* host -> device commands */
+
+/* Chunk source (free-form; these are the ones the library writes) */
+#define RCM_CAPTURE_SRC_UNKNOWN    0
+#define RCM_CAPTURE_SRC_USB        1   /* usbdevfs / UsbRequest bulk endpoint */
+#define RCM_CAPTURE_SRC_STREAM     2   /* socket, pipe or tty stream */
+#define RCM_CAPTURE_SRC_EMULATOR   3
+
+/* --- Writer --- */
+
+typedef struct rcm_capture_writer rcm_capture_writer_t;
+
+/*
+ * Create (truncate) `path` and write the file header.
+ * @param index_interval_ms Spacing of index entries, 0 = 100 ms
+ * @return Writer, or NULL with errno set
+ */
+rcm_capture_writer_t *rcm_capture_open(const char *path, uint32_t index_interval_ms);
+
+/*
+ * Append one chunk. Thread-safe: IN and OUT chunks may come from different
+ * threads. Timestamps should not go backwards, or time seeks get coarser.
+ * @param t_ns CLOCK_MONOTONIC ns, or 0 to stamp it now
+ * @return 0 on success, -1 on NULL writer/data, len > RCM_CAPTURE_MAX_CHUNK
+ *         or a write error (which is sticky)
+ */
+int rcm_capture_write(rcm_capture_writer_t *w, uint64_t t_ns, uint8_t source,
+                      uint8_t dir, const uint8_t *data, size_t len);
+
+/* Push buffered chunks to the file. @return 0 on success, -1 on error */
+int rcm_capture_flush(rcm_capture_writer_t *w);
+
+/*
+ * Write the index and trailer, close the file and free the writer. No other
+ * call may be in progress on `w`.
+ * @return 0 if every write succeeded, -1 otherwise
+ */
+int rcm_capture_close(rcm_capture_writer_t *w);
+
+/* --- Reader --- */
+
+typedef struct rcm_capture_reader rcm_capture_reader_t;
+
+/* One chunk; `data` stays valid until the next call on the reader */
+typedef struct {
+    uint64_t       t_ns;     /* 0 for raw recordings */
+    uint64_t       offset;   /* file offset of the chunk header (raw: of data) */
+    const uint8_t *data;
+    size_t         len;
+    uint8_t        source;
+    uint8_t        dir;
+} rcm_capture_chunk_t;
+
+/*
+ * Open a capture, or a raw .bin recording (returned as 4 KB IN chunks).
+ * @return Reader, or NULL with errno set
+ */
+rcm_capture_reader_t *rcm_capture_reader_open(const char *path);
+
+/*
+ * Read the next chunk.
+ * @return 1 with `out` filled, 0 at the end, -1 on a malformed or truncated
+ *         chunk (everything before it was valid)
+ */
+int rcm_capture_next(rcm_capture_reader_t *r, rcm_capture_chunk_t *out);
+
+/*
+ * Position the reader so the next chunk is the first one with
+ * t_ns >= `t_ns`, using the footer index when present (one binary search
+ * plus at most one interval of chunks) and a header-only scan otherwise.
+ * @return 0 on success, 1 if no chunk is that late (reader at the end),
+ *         -1 on a raw recording or a read error
+ */
+int rcm_capture_seek(rcm_capture_reader_t *r, uint64_t t_ns);
+
+/* True if the file is a legacy raw recording */
+bool rcm_capture_is_raw(const rcm_capture_reader_t *r);
+
+/* Index entries found in the trailer (0: raw, unindexed or truncated) */
+size_t rcm_capture_index_count(const rcm_capture_reader_t *r);
+
+void rcm_capture_reader_close(rcm_capture_reader_t *r);
+
+/* --- In-memory view --- */
+
+/*
+ * Zero-copy iteration over a capture that is already in memory (typically
+ * mmap()ed): chunks point straight into the caller's buffer, which must
+ * outlive the view. Fields are read-only for callers.
+ */
+typedef struct {
+    const uint8_t *base;
+    size_t         size;
+    size_t         pos;         /* offset of the next chunk */
+    size_t         data_start;  /* first chunk */
+    size_t         data_end;    /* start of the index, or size */
+    const uint8_t *index;       /* index entries in the buffer, NULL if none */
+    size_t         index_len;
+    bool           raw;         /* legacy raw recording */
+} rcm_capture_view_t;
+
+/* @return 0 on success, -1 on NULL arguments or a malformed capture header */
+int rcm_capture_view_init(rcm_capture_view_t *v, const void *base, size_t size);
+
+/*
+ * As rcm_capture_next(). A raw recording comes back as one IN chunk
+ * spanning the whole buffer.
+ */
+int rcm_capture_view_next(rcm_capture_view_t *v, rcm_capture_chunk_t *out);
+
+/* As rcm_capture_seek() */
+int rcm_capture_view_seek(rcm_capture_view_t *v, uint64_t t_ns);
+
+/* Read index entry `i` (either pointer may be NULL). @return 0, or -1 if out of range */
+int rcm_capture_view_index(const rcm_capture_view_t *v, size_t i,
+                           uint64_t *t_ns, uint64_t *offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RC_MONITOR_CAPTURE_H */
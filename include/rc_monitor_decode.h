@@ -0,0 +1,109 @@
+/*
+ * rc_monitor_decode.h - Parallel offline decoding into columnar files
+ *
+ * rcm_decode_capture() splits an in-memory capture (rc_monitor_capture.h,
+ * or a raw .bin recording) into segments, moves each segment start forward
+ * to a frame that passes both the header CRC8 and the frame CRC16, and
+ * decodes the segments on a pool of threads, one rcm_parser_t per thread.
+ * A segment's worker keeps only pushes whose SOF lies before the next
+ * segment's start and runs on past it until any frame in progress there
+ * has completed, so the merged rows are the ones a single parser fed the
+ * whole stream would produce (barring a CRC-valid frame hidden inside
+ * another frame's payload, which the boundary search could pick, and a
+ * stream that mixes header layouts, where each worker's parser does its
+ * own rcm_set_layout_lock() detection).
+ *
+ * The result is a struct of arrays, one row per RC push, whose memory
+ * block is exactly the columnar file rcm_columns_write() stores and
+ * rcm_columns_map() maps back, so analytics can read the columns in place.
+ *
+ * Columnar file layout (little-endian, like every supported target):
+ *
+ *   header     64 B  "RCMS", u16 version (1), u16 header_len (64),
+ *                    u32 column count, u32 reserved, u64 row count,
+ *                    40 B reserved
+ *   directory  16 B per column: u32 RCM_COL_* id, u32 element size,
+ *                    u64 file offset of the column
+ *   columns    packed arrays of `row count` elements, each 64-byte aligned
+ */
+
+#ifndef RC_MONITOR_DECODE_H
+#define RC_MONITOR_DECODE_H
+
+#include "rc_monitor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RCM_COLUMNS_VERSION     1
+#define RCM_COLUMNS_HEADER_LEN  64
+#define RCM_COLUMNS_DIR_LEN     16   /* per directory entry */
+#define RCM_COLUMNS_ALIGN       64
+
+/* Column ids, in file order */
+#define RCM_COL_T_NS            0    /* u64: t_ns of the chunk holding the SOF (0: raw) */
+#define RCM_COL_STICK_RIGHT_H   1    /* i16 */
+#define RCM_COL_STICK_RIGHT_V   2    /* i16 */
+#define RCM_COL_STICK_LEFT_H    3    /* i16 */
+#define RCM_COL_STICK_LEFT_V    4    /* i16 */
+#define RCM_COL_LEFT_WHEEL      5    /* i16 */
+#define RCM_COL_RIGHT_WHEEL     6    /* i16 */
+#define RCM_COL_WHEEL_DELTA     7    /* i8 */
+#define RCM_COL_FLAGS           8    /* u16: RCM_PK_* buttons + flight mode */
+#define RCM_COL_COUNT           9
+
+/*
+ * Decoded rows. The pointers all point into one block (`block`, `block_len`)
+ * laid out as the columnar file; do not modify a mapped one.
+ */
+typedef struct {
+    size_t    count;
+    uint64_t *t_ns;
+    int16_t  *stick_right_h;
+    int16_t  *stick_right_v;
+    int16_t  *stick_left_h;
+    int16_t  *stick_left_v;
+    int16_t  *left_wheel;
+    int16_t  *right_wheel;
+    int8_t   *right_wheel_delta;
+    uint16_t *flags;
+
+    void     *block;
+    size_t    block_len;
+    bool      mapped;       /* block is an mmap() of a file */
+} rcm_columns_t;
+
+typedef struct {
+    unsigned threads;        /* worker threads, 0 = online CPUs */
+    size_t   segment_bytes;  /* target bytes per segment, 0 = 4 MB */
+} rcm_decode_config_t;
+
+/*
+ * Decode every IN chunk of the capture (or raw recording) in
+ * base[0..size) into `out`. `cfg` may be NULL for the defaults.
+ * @return 0 on success; 1 if a malformed chunk was met (rows decoded from
+ *         the chunks before it, and from later indexed segments, are still
+ *         returned); -1 on NULL arguments, a malformed capture header or
+ *         allocation failure, with `out` zeroed
+ */
+int rcm_decode_capture(const void *base, size_t size, const rcm_decode_config_t *cfg,
+                       rcm_columns_t *out);
+
+/* Free (or unmap) the block and zero `c`. NULL-safe */
+void rcm_columns_free(rcm_columns_t *c);
+
+/* Store `c` as a columnar file. @return 0 on success, -1 with errno set */
+int rcm_columns_write(const char *path, const rcm_columns_t *c);
+
+/*
+ * Map a columnar file read-only into `out`.
+ * @return 0 on success, -1 with errno set (EINVAL for a malformed file)
+ */
+int rcm_columns_map(const char *path, rcm_columns_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RC_MONITOR_DECODE_H */
@@ -0,0 +1,75 @@
+/*
+ * rc_monitor_evdev.h - Native evdev stick reader (Linux / Android)
+ *
+ * Reads /dev/input/event* on its own thread, many struct input_event
+ * records per read(), keeps the mapped EV_ABS axes in a synthetic 17-byte
+ * RC payload and delivers it with rcm_feed_payload() once per SYN_REPORT.
+ * Sticks only: evdev carries no DUML buttons, so bytes 0-4 stay zero and
+ * both wheels sit at center.
+ */
+
+#ifndef RC_MONITOR_EVDEV_H
+#define RC_MONITOR_EVDEV_H
+
+#include "rc_monitor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Axis slots, in the order of rcm_evdev_config_t.abs_code */
+enum {
+    RCM_EVDEV_RIGHT_H = 0,
+    RCM_EVDEV_RIGHT_V,
+    RCM_EVDEV_LEFT_V,
+    RCM_EVDEV_LEFT_H,
+    RCM_EVDEV_AXES
+};
+
+typedef struct rcm_evdev_reader rcm_evdev_reader_t;
+
+typedef struct {
+    int   fd;                        /* open, readable event device */
+
+    /*
+     * ABS_* code feeding each slot, -1 = unmapped (stays centered).
+     * rcm_evdev_config_init() sets ABS_X, ABS_Y, ABS_Z, ABS_RZ.
+     */
+    int   abs_code[RCM_EVDEV_AXES];
+
+    /* Raw value multiplier into the centered ~±660 range, 0 = 660/32768 */
+    float scale;
+
+    /*
+     * Optional; called on the reader thread once per wakeup, after the
+     * reads that drained the queued events, if they delivered at least one
+     * state (so several reports arriving together get one call).
+     */
+    void (*after_feed)(void *userdata);
+    void  *userdata;
+} rcm_evdev_config_t;
+
+/* Fill `cfg` with the default axis map and scale for `fd` */
+void rcm_evdev_config_init(rcm_evdev_config_t *cfg, int fd);
+
+/*
+ * Start the reader thread on `parser`, which belongs to that thread until
+ * rcm_evdev_stop(). The parser callback runs on the reader thread.
+ * @return Reader handle, or NULL with errno set
+ */
+rcm_evdev_reader_t *rcm_evdev_start(rcm_parser_t *parser, const rcm_evdev_config_t *cfg);
+
+/* True until the device went away or the loop hit a read error */
+bool rcm_evdev_running(const rcm_evdev_reader_t *r);
+
+/*
+ * Stop the loop, join the thread and free the reader. Must not be called
+ * from the parser callback. The fd is not closed.
+ */
+void rcm_evdev_stop(rcm_evdev_reader_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RC_MONITOR_EVDEV_H */
@@ -0,0 +1,107 @@
+/*
+ * rc_monitor_history.h - Windowed motion history with O(1) queries
+ *
+ * A preallocated, 64-byte-aligned ring of timestamped packed states over a
+ * sliding window (the last `window_ns`, and at most `capacity` samples).
+ * Every push updates running sums, monotonic min/max queues per axis and
+ * per-button edge counts in amortised O(1), then publishes the resulting
+ * rcm_history_stats_t through a seqlock, so any thread can query mean,
+ * velocity, min/max and button edges over the window without scanning it
+ * and without stalling the feeding thread. Everything is integer: means
+ * are Q8 fixed point, velocities whole axis units per second.
+ *
+ * Attached to a parser with rcm_set_history(), every RC push is recorded,
+ * including repeats that change detection keeps from the callback, so the
+ * window statistics are per sample rather than per change.
+ */
+
+#ifndef RC_MONITOR_HISTORY_H
+#define RC_MONITOR_HISTORY_H
+
+#include "rc_monitor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RCM_HISTORY_MIN_ENTRIES  16
+#define RCM_HISTORY_MAX_ENTRIES  65536
+
+/* Axes of the statistics, in rcm_packed_state_t order */
+#define RCM_HIST_STICK_RIGHT_H   0
+#define RCM_HIST_STICK_RIGHT_V   1
+#define RCM_HIST_STICK_LEFT_H    2
+#define RCM_HIST_STICK_LEFT_V    3
+#define RCM_HIST_LEFT_WHEEL      4
+#define RCM_HIST_RIGHT_WHEEL     5
+#define RCM_HIST_AXES            6
+
+typedef struct rcm_history rcm_history_t;
+
+/* Window statistics as of the newest sample */
+typedef struct {
+    uint64_t t_ns;                      /* newest sample, 0 = none yet */
+    uint64_t span_ns;                   /* newest minus oldest sample in the window */
+    uint32_t samples;                   /* samples pushed so far (wraps) */
+    uint32_t count;                     /* samples in the window */
+    int32_t  mean_q8[RCM_HIST_AXES];    /* mean * 256, rounded */
+    int32_t  velocity[RCM_HIST_AXES];   /* (newest - oldest) / span, units per second */
+    int16_t  min[RCM_HIST_AXES];
+    int16_t  max[RCM_HIST_AXES];
+    rcm_packed_state_t latest;
+    int32_t  wheel_delta;               /* right_wheel_delta summed over the window */
+    uint16_t pressed;                   /* RCM_PK_* bits that went down in the window */
+    uint16_t released;                  /* RCM_PK_* bits that went up in the window */
+    uint8_t  reserved[8];
+} rcm_history_stats_t;
+
+/*
+ * Allocate a history. `capacity` is rounded up to a power of two in
+ * [RCM_HISTORY_MIN_ENTRIES, RCM_HISTORY_MAX_ENTRIES]; `window_ns` 0 means
+ * the window is simply the last `capacity` samples.
+ * @return History, or NULL on allocation failure
+ */
+rcm_history_t *rcm_history_create(unsigned capacity, uint64_t window_ns);
+
+/* Free a history (detach it from its parser first). NULL-safe */
+void rcm_history_destroy(rcm_history_t *h);
+
+/*
+ * Record every RC push of `p` into `h` (NULL detaches), timestamped with
+ * CLOCK_MONOTONIC. Call it from the feeding thread or while no feed runs;
+ * `h` must outlive the attachment.
+ */
+void rcm_set_history(rcm_parser_t *p, rcm_history_t *h);
+
+/*
+ * Add one sample by hand (offline data, or a history not attached to a
+ * parser). Single writer; `t_ns` must not go backwards.
+ */
+void rcm_history_push(rcm_history_t *h, const rcm_packed_state_t *state, uint64_t t_ns);
+
+/*
+ * Drop every sample (writer thread, or while no push runs). Buttons held
+ * in the next sample then count as pressed.
+ */
+void rcm_history_clear(rcm_history_t *h);
+
+/*
+ * Copy the window statistics. O(1), safe from any thread concurrently with
+ * the writer.
+ * @return 0 on success, -1 on NULL arguments or before the first sample
+ */
+int rcm_history_query(const rcm_history_t *h, rcm_history_stats_t *out);
+
+/*
+ * RCM_PK_* bits of `pk_bits` that had a press edge within the last
+ * `frames` samples (1 = the newest only). Independent of the window;
+ * O(1), safe from any thread.
+ */
+uint16_t rcm_history_pressed_within(const rcm_history_t *h, uint16_t pk_bits,
+                                    uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RC_MONITOR_HISTORY_H */
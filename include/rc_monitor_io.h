@@ -0,0 +1,76 @@
+/*
+ * rc_monitor_io.h - Shared native stream ingestion loop (Linux / Android)
+ *
+ * One thread epolls any number of byte-stream fds (Unix domain sockets,
+ * pipes, ttys), each bound to its own parser, and feeds whatever arrives
+ * straight into rcm_feed() from a loop-owned read buffer. Replaces a
+ * blocking reader thread per stream source.
+ */
+
+#ifndef RC_MONITOR_IO_H
+#define RC_MONITOR_IO_H
+
+#include "rc_monitor.h"
+#include "rc_monitor_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sources one loop can serve, and the size of each read() */
+#define RCM_IO_MAX_SOURCES  16
+#define RCM_IO_READ_LEN     16384
+
+typedef struct rcm_io_loop rcm_io_loop_t;
+
+/* Start an ingestion loop thread. @return Loop, or NULL with errno set */
+rcm_io_loop_t *rcm_io_create(void);
+
+/*
+ * Stop the thread and free the loop. Sources still attached are dropped
+ * without touching their fds or parsers. Not from a parser callback.
+ */
+void rcm_io_destroy(rcm_io_loop_t *loop);
+
+/*
+ * Attach `fd` (switched to O_NONBLOCK) and feed it into `parser`, which
+ * then belongs to the loop thread until rcm_io_remove(). `after_feed`
+ * (optional) runs on the loop thread after each wakeup that fed this
+ * source. Thread-safe. The fd stays owned by the caller.
+ * @return Source id >= 0, or -1 with errno set (EINVAL, ENOSPC when full)
+ */
+int rcm_io_add(rcm_io_loop_t *loop, int fd, rcm_parser_t *parser,
+               void (*after_feed)(void *userdata), void *userdata);
+
+/*
+ * Detach a source. On return the loop no longer reads its fd or feeds its
+ * parser. Thread-safe, but not from a parser callback of the same loop.
+ */
+void rcm_io_remove(rcm_io_loop_t *loop, int id);
+
+/*
+ * Record everything read from source `id` into `w` as IN chunks tagged
+ * with `source` (NULL stops). Thread-safe; once it returns the previous
+ * writer is no longer used. Cleared by rcm_io_remove().
+ */
+void rcm_io_set_capture(rcm_io_loop_t *loop, int id, rcm_capture_writer_t *w,
+                        uint8_t source);
+
+/*
+ * True while the source is attached and its stream is open. After EOF or a
+ * read error the loop stops polling it; it stays attached (and false here)
+ * until rcm_io_remove().
+ */
+bool rcm_io_alive(rcm_io_loop_t *loop, int id);
+
+/*
+ * Connect a SOCK_STREAM Unix domain socket. A leading '@' selects the
+ * abstract namespace. @return fd, or -1 with errno set
+ */
+int rcm_io_connect_unix(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RC_MONITOR_IO_H */
@@ -0,0 +1,149 @@
+/*
+ * rc_monitor_shm.h - Shared-memory state publisher (Linux / Android)
+ *
+ * One process owns the parser and publishes every decoded state, packed,
+ * into a single-producer ring in a memfd (ashmem on Android kernels
+ * without memfd_create). Any number of other processes map the fd
+ * read-only and poll the ring in place, or sleep on a futex in it until
+ * the publisher wakes them. Consumers never write to the mapping, so a
+ * misbehaving one cannot disturb the publisher or its peers.
+ *
+ * Layout (native-endian, 64 B header then `capacity` entries):
+ *
+ *   header     "RCMQ", u16 version (1), u16 header_len (64), u32 capacity
+ *              (power of two), u32 entry_len (16), u64 written (states
+ *              published so far), u64 claimed (states being or already
+ *              written), u32 futex word, u32 publisher pid, u32 closed,
+ *              20 B reserved
+ *   entries    rcm_packed_state_t; state i is entry i & (capacity - 1)
+ *
+ * The publisher overwrites the oldest entries when a consumer falls
+ * behind; the reader detects this from `written` and counts the states it
+ * skipped as lost. The fd reaches other processes through Binder (a
+ * ParcelFileDescriptor) or a Unix socket (rcm_shm_send_fd()).
+ */
+
+#ifndef RC_MONITOR_SHM_H
+#define RC_MONITOR_SHM_H
+
+#include "rc_monitor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RCM_SHM_VERSION      1
+#define RCM_SHM_HEADER_LEN   64
+#define RCM_SHM_MIN_ENTRIES  16
+#define RCM_SHM_MAX_ENTRIES  65536
+
+/* --- Publisher --- */
+
+typedef struct rcm_shm_publisher rcm_shm_publisher_t;
+
+/*
+ * Create the shared region. `capacity` is rounded up to a power of two in
+ * [RCM_SHM_MIN_ENTRIES, RCM_SHM_MAX_ENTRIES]; `name` only labels the fd
+ * (/proc/<pid>/fd, NULL = "rcm-states").
+ * @return Publisher, or NULL with errno set
+ */
+rcm_shm_publisher_t *rcm_shm_create(const char *name, unsigned capacity);
+
+/*
+ * Mark the ring closed, wake every waiter, and unmap and close the
+ * publisher's side. Consumers keep their mappings until rcm_shm_close().
+ * NULL-safe.
+ */
+void rcm_shm_destroy(rcm_shm_publisher_t *pub);
+
+/* The region's fd, to pass to consumers (the publisher keeps ownership) */
+int rcm_shm_fd(const rcm_shm_publisher_t *pub);
+
+/*
+ * Append one state without waking anyone: pollers see it at once, waiters
+ * at the next rcm_shm_wake(). Single producer: one thread at a time.
+ */
+void rcm_shm_publish(rcm_shm_publisher_t *pub, const rcm_packed_state_t *state);
+
+/* Wake the waiters if anything was published since the last wake */
+void rcm_shm_wake(rcm_shm_publisher_t *pub);
+
+/*
+ * rcm_callback_t that packs, publishes and wakes per state, for
+ * rcm_create(rcm_shm_callback, pub). To wake once per read instead, call
+ * rcm_shm_publish() from the callback and rcm_shm_wake() after the feed
+ * (e.g. from a reader's after_feed hook).
+ */
+void rcm_shm_callback(const rc_state_t *state, void *pub);
+
+/* --- Consumer --- */
+
+typedef struct {
+    const uint8_t *base;      /* read-only mapping */
+    size_t         size;
+    uint32_t       capacity;
+    uint64_t       read;      /* states consumed (or skipped) so far */
+    uint64_t       lost;      /* states overwritten before they were read */
+} rcm_shm_reader_t;
+
+/*
+ * Map a publisher's fd read-only. The fd may be closed afterwards. Reading
+ * starts at the states published from now on.
+ * @return 0 on success, -1 with errno set (EINVAL for a region that is not
+ *         a ring of this version)
+ */
+int rcm_shm_open(rcm_shm_reader_t *r, int fd);
+
+/* Unmap and zero `r`. NULL-safe */
+void rcm_shm_close(rcm_shm_reader_t *r);
+
+/* States published so far (acquire) */
+uint64_t rcm_shm_written(const rcm_shm_reader_t *r);
+
+/*
+ * For consumers that read entries in place (r->base + RCM_SHM_HEADER_LEN +
+ * (i & (capacity - 1)) * 16) instead of through rcm_shm_read(): call after
+ * the reads. States below the returned count minus capacity may have been
+ * overwritten meanwhile and must be discarded.
+ */
+uint64_t rcm_shm_claimed(const rcm_shm_reader_t *r);
+
+/* True once the publisher has called rcm_shm_destroy() */
+bool rcm_shm_closed(const rcm_shm_reader_t *r);
+
+/*
+ * Copy up to `max` unread states into `out`, oldest first. States
+ * overwritten before or during the copy are skipped and added to r->lost.
+ * @return States copied
+ */
+size_t rcm_shm_read(rcm_shm_reader_t *r, rcm_packed_state_t *out, size_t max);
+
+/*
+ * Copy the most recent state, skipping everything unread (not counted as
+ * lost). Retries while the producer laps it.
+ * @return 0 on success, -1 if nothing has been published yet
+ */
+int rcm_shm_latest(rcm_shm_reader_t *r, rcm_packed_state_t *out);
+
+/*
+ * Sleep until there are unread states, the publisher closes the ring or
+ * `timeout_ms` passes (< 0 waits forever). Needs the publisher to call
+ * rcm_shm_wake() (or use rcm_shm_callback()).
+ * @return 1 with unread states, 0 on timeout, -1 with errno set (EPIPE
+ *         once the ring is closed and fully read)
+ */
+int rcm_shm_wait(rcm_shm_reader_t *r, int timeout_ms);
+
+/* --- Passing the fd over a Unix socket --- */
+
+/* Send `fd` as SCM_RIGHTS with a one-byte message. @return 0, or -1 with errno */
+int rcm_shm_send_fd(int sock, int fd);
+
+/* Receive an fd sent by rcm_shm_send_fd(). @return fd, or -1 with errno */
+int rcm_shm_recv_fd(int sock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RC_MONITOR_SHM_H */
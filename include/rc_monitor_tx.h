@@ -0,0 +1,90 @@
+/*
+ * rc_monitor_tx.h - Command templates and a batched transmit queue
+ *
+ * A template holds the 11 header bytes of one kind of command (addresses,
+ * flags, cmd_set/cmd_id and the length its payload size implies) together
+ * with the CRC16 register after bytes 0-5, which never change between
+ * sends. Writing a frame from it copies the header, stores the seq and
+ * payload, and runs the CRC16 only from byte 6 on; the header CRC8 is
+ * computed once, at template init.
+ *
+ * rcm_tx_queue_t packs frames from any templates back to back, numbering
+ * them with consecutive seqs, so a handshake or a burst of polls leaves in
+ * a single bulk OUT transfer (rcm_usb_send(), or bulkTransfer() on the
+ * Java side). The receiver parses the transfer as an ordinary DUML stream.
+ */
+
+#ifndef RC_MONITOR_TX_H
+#define RC_MONITOR_TX_H
+
+#include "rc_monitor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bytes one queue can hold: what rcm_usb_send() accepts per transfer */
+#define RCM_TX_QUEUE_MAX  DUML_MAX_FRAME_LEN
+
+typedef struct {
+    uint8_t  header[DUML_HEADER_LEN];  /* seq bytes (6-7) zero */
+    uint16_t payload_len;
+    uint16_t crc_prefix;               /* CRC16 register after header[0..6) */
+} rcm_tx_template_t;
+
+/*
+ * Set up a template; arguments as for rcm_build_packet(), with the payload
+ * length fixed per template.
+ * @return 0 on success, -1 on NULL `t` or a payload too long for one frame
+ */
+int rcm_tx_template_init(rcm_tx_template_t *t,
+                         uint8_t sender_type, uint8_t sender_index,
+                         uint8_t receiver_type, uint8_t receiver_index,
+                         uint8_t pack_type, uint8_t ack_type, uint8_t encrypt_type,
+                         uint8_t cmd_set, uint8_t cmd_id, size_t payload_len);
+
+/* Templates of rcm_build_enable_cmd() (payload [0x01]) and rcm_build_channel_request() */
+void rcm_tx_template_enable(rcm_tx_template_t *t);
+void rcm_tx_template_channel_request(rcm_tx_template_t *t);
+
+/* Frame length of a template: header + payload + CRC16 */
+static inline size_t rcm_tx_frame_len(const rcm_tx_template_t *t) {
+    return DUML_HEADER_LEN + (size_t)t->payload_len + DUML_FOOTER_LEN;
+}
+
+/*
+ * Write one frame: identical to rcm_build_packet() with the template's
+ * fields. `payload` holds t->payload_len bytes (NULL if 0).
+ * @return Frame length, or -1 if it does not fit in out_size
+ */
+int rcm_tx_write(const rcm_tx_template_t *t, uint8_t *out, size_t out_size,
+                 uint16_t seq, const uint8_t *payload);
+
+typedef struct {
+    uint8_t  buf[RCM_TX_QUEUE_MAX];
+    size_t   len;      /* bytes queued */
+    unsigned count;    /* frames queued */
+    uint16_t seq;      /* seq the next frame gets */
+} rcm_tx_queue_t;
+
+/* Empty queue whose first frame gets `first_seq` */
+void rcm_tx_init(rcm_tx_queue_t *q, uint16_t first_seq);
+
+/*
+ * Append a frame from `t` with the next seq. The returned frame (also at
+ * q->buf + q->len - its length) stays valid until rcm_tx_clear(), e.g. to
+ * pass it to rcm_track_request().
+ * @param frame_len Optional; receives the frame length
+ * @return The queued frame, or NULL (seq not consumed) if it does not fit
+ */
+const uint8_t *rcm_tx_push(rcm_tx_queue_t *q, const rcm_tx_template_t *t,
+                           const uint8_t *payload, size_t *frame_len);
+
+/* Drop the queued frames after sending them; the seq keeps counting */
+void rcm_tx_clear(rcm_tx_queue_t *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RC_MONITOR_TX_H */
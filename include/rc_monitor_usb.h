@@ -0,0 +1,105 @@
+/*
+ * rc_monitor_usb.h - Native asynchronous USB reader (Linux / Android)
+ *
+ * Drives a DUML bulk endpoint pair directly through usbdevfs: several
+ * bulk-IN URBs stay queued at all times, each completed buffer goes
+ * straight into rcm_feed() on the reader's own thread, and OUT commands
+ * (the enable command, channel requests, anything passed to
+ * rcm_usb_send()) are submitted from the same loop. On Android the fd comes
+ * from UsbDeviceConnection.getFileDescriptor() after the interface has been
+ * claimed.
+ */
+
+#ifndef RC_MONITOR_USB_H
+#define RC_MONITOR_USB_H
+
+#include "rc_monitor.h"
+#include "rc_monitor_capture.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bulk-IN URBs kept in flight, and the size of each, unless configured */
+#define RCM_USB_DEFAULT_URBS     4
+#define RCM_USB_DEFAULT_URB_LEN  1024
+#define RCM_USB_MAX_URBS         16
+
+typedef struct rcm_usb_reader rcm_usb_reader_t;
+
+typedef struct {
+    int      fd;                /* usbdevfs fd with the interface claimed */
+    uint8_t  ep_in;             /* bulk IN endpoint address (0x8N) */
+    uint8_t  ep_out;            /* bulk OUT endpoint address, 0 = none */
+    unsigned urbs;              /* IN URBs in flight, 0 = default */
+    size_t   urb_len;           /* bytes per IN URB, 0 = default */
+
+    /*
+     * Send the DUML enable command when the loop starts (in the same
+     * transfer as a first channel request when the fallback is on), and
+     * fall back to a channel request every poll_interval_ms (250 ms if 0)
+     * while no RC push has arrived for push_timeout_ms (0 disables the
+     * fallback). Both need ep_out. Built-in commands are tracked with
+     * rcm_track_request() (timeout poll_interval_ms) and expired by the
+     * loop, so their RTT shows up in rcm_get_stats().
+     */
+    bool     send_enable;
+    int      push_timeout_ms;
+    int      poll_interval_ms;
+
+    /*
+     * Pipelined polling: keep up to poll_inflight channel requests
+     * outstanding instead of one per poll_interval_ms, sending the next as
+     * soon as a response frees a slot, at most one per smoothed RTT /
+     * poll_inflight. Until an RTT has been measured the window is filled
+     * in a single transfer. 0 = fixed interval; at most RCM_MAX_PENDING.
+     */
+    unsigned poll_inflight;
+
+    /*
+     * Optional; called on the reader thread after each batch of completed
+     * URBs has been fed, e.g. to flush work queued by the parser callback.
+     */
+    void   (*after_feed)(void *userdata);
+    void    *userdata;
+} rcm_usb_config_t;
+
+/*
+ * Start the reader thread on `parser`. From then on the parser belongs to
+ * that thread: do not feed or reset it elsewhere until rcm_usb_stop().
+ * The parser callback runs on the reader thread.
+ * @return Reader handle, or NULL with errno set (bad config, submit failed)
+ */
+rcm_usb_reader_t *rcm_usb_start(rcm_parser_t *parser, const rcm_usb_config_t *cfg);
+
+/*
+ * Queue an OUT command; it is submitted from the reader loop. Thread-safe.
+ * @return 0 if queued, -1 if the queue is full, the reader has no OUT
+ *         endpoint, len exceeds DUML_MAX_FRAME_LEN, or the reader stopped
+ */
+int rcm_usb_send(rcm_usb_reader_t *r, const uint8_t *data, size_t len);
+
+/*
+ * Record every completed IN transfer and every submitted OUT command into
+ * `w` (NULL stops recording), tagged with `source`. Thread-safe; once it
+ * returns the previous writer is no longer used and may be closed.
+ */
+void rcm_usb_set_capture(rcm_usb_reader_t *r, rcm_capture_writer_t *w, uint8_t source);
+
+/*
+ * True while the reader loop is running (false after the device went away
+ * or an unrecoverable error).
+ */
+bool rcm_usb_running(const rcm_usb_reader_t *r);
+
+/*
+ * Stop the loop, cancel outstanding URBs, join the thread and free the
+ * reader. Must not be called from the parser callback. The fd is not closed.
+ */
+void rcm_usb_stop(rcm_usb_reader_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RC_MONITOR_USB_H */
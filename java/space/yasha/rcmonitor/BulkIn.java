@@ -0,0 +1,88 @@
+package space.yasha.rcmonitor;
+
+import android.annotation.TargetApi;
+import android.hardware.usb.UsbDeviceConnection;
+import android.hardware.usb.UsbEndpoint;
+import android.hardware.usb.UsbRequest;
+import android.os.Build;
+
+import java.nio.ByteBuffer;
+import java.util.concurrent.TimeoutException;
+
+/**
+ * Bulk IN reads for the Java fallback loops of {@link UsbRcReader} and
+ * {@link DussStreamReader}. On API 26+ a {@link UsbRequest} fills one
+ * long-lived direct buffer that the parser reads in place; older releases
+ * lack {@code UsbRequest.queue(ByteBuffer)} and
+ * {@code requestWait(long)}, so there it is {@code bulkTransfer()} into a
+ * {@code byte[]}. Use from one thread.
+ */
+final class BulkIn {
+    private final UsbDeviceConnection conn;
+    private final UsbEndpoint ep;
+    private final boolean direct = Build.VERSION.SDK_INT >= Build.VERSION_CODES.O;
+    private final ByteBuffer buf;
+    private final byte[] array;
+    private UsbRequest request;
+    private boolean queued;
+
+    BulkIn(UsbDeviceConnection conn, UsbEndpoint ep, int size) {
+        this.conn = conn;
+        this.ep = ep;
+        this.buf = direct ? ByteBuffer.allocateDirect(size) : null;
+        this.array = direct ? null : new byte[size];
+    }
+
+    /** @return false if the IN request could not be set up */
+    boolean open() {
+        if (!direct) return true;
+        request = new UsbRequest();
+        return request.initialize(conn, ep);
+    }
+
+    /**
+     * Wait up to {@code timeoutMs} for data.
+     * @return Bytes read, 0 on timeout, -1 if the transfer cannot be queued
+     */
+    int read(int timeoutMs) {
+        if (!direct) return Math.max(conn.bulkTransfer(ep, array, array.length, timeoutMs), 0);
+        return readDirect(timeoutMs);
+    }
+
+    @TargetApi(Build.VERSION_CODES.O)
+    private int readDirect(int timeoutMs) {
+        if (!queued) {
+            buf.clear();
+            queued = request.queue(buf);
+            if (!queued) return -1;
+        }
+        try {
+            if (conn.requestWait(timeoutMs) == request) {
+                queued = false;
+                return buf.position();
+            }
+        } catch (TimeoutException e) {
+            /* Request stays queued for the next call */
+        }
+        return 0;
+    }
+
+    /** Parse the {@code n} bytes of the last read. */
+    void feed(RcMonitor monitor, int n) {
+        if (direct) monitor.feed(buf, 0, n);
+        else        monitor.feed(array, n);
+    }
+
+    /** Byte {@code i} of the last read, for diagnostics. */
+    int byteAt(int i) {
+        return (direct ? buf.get(i) : array[i]) & 0xFF;
+    }
+
+    /** Cancel any queued transfer and release the request. */
+    void close() {
+        if (request == null) return;
+        if (queued) request.cancel();
+        request.close();
+        request = null;
+    }
+}
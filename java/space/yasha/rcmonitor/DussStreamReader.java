@@ -17,8 +17,11 @@ import android.util.Log;
  * (rather than searching for bulk IN+OUT) and does not perform CDC ACM
  * handshake or send enable commands — Interface 7 streams without them.
  *
- * Raw bytes are fed through {@link RcMonitor#feed(byte[], int)} so the
- * DUML parser filters noise via CRC validation.
+ * Raw bytes go through the DUML parser, which filters noise via CRC
+ * validation. The native usbdevfs reader ({@link RcMonitor#startUsbReader},
+ * IN only) does the reads when it can start, so no Java thread or copy is
+ * involved; otherwise a Java loop reads through {@link BulkIn} (a
+ * UsbRequest on a direct buffer on API 26+, bulkTransfer() below).
  */
 public class DussStreamReader implements RcReader {
     private static final String TAG = "DussStreamReader";
@@ -33,6 +36,10 @@ public class DussStreamReader implements RcReader {
     private volatile boolean running;
     private Thread readThread;
 
+    /* Held while the native reader runs; released in stop() */
+    private UsbDeviceConnection nativeConn;
+    private UsbInterface nativeIface;
+
     public DussStreamReader(Context context) {
         this.context = context;
         this.monitor = new RcMonitor();
@@ -43,6 +50,11 @@ public class DussStreamReader implements RcReader {
         return "DUSS";
     }
 
+    @Override
+    public RcMonitor getMonitor() {
+        return monitor;
+    }
+
     @Override
     public boolean isAvailable() {
         UsbDevice device = findDjiDevice();
@@ -101,30 +113,51 @@ public class DussStreamReader implements RcReader {
             return false;
         }
 
+        if (monitor.startUsbReader(conn.getFileDescriptor(), bulkIn.getAddress(), 0,
+                false, 0, 0)) {
+            Log.d(TAG, "Native DUSS reader started on interface " + DUSS_INTERFACE_INDEX);
+            nativeConn = conn;
+            nativeIface = iface;
+            running = true;
+            return true;
+        }
+
         running = true;
         final UsbDeviceConnection fConn = conn;
         final UsbEndpoint fBulkIn = bulkIn;
         final UsbInterface fIface = iface;
 
         readThread = new Thread(() -> {
-            byte[] buf = new byte[BUFFER_SIZE];
+            /* Parsed in place from a direct buffer on API 26+ */
+            BulkIn in = new BulkIn(fConn, fBulkIn, BUFFER_SIZE);
+            if (!in.open()) {
+                Log.e(TAG, "Failed to initialize bulk IN request");
+                running = false;
+            }
             long lastHexLog = 0;
             Log.d(TAG, "DUSS read loop started on interface " + DUSS_INTERFACE_INDEX);
 
             while (running) {
-                int n = fConn.bulkTransfer(fBulkIn, buf, buf.length, READ_TIMEOUT_MS);
+                int n = in.read(READ_TIMEOUT_MS);
+                if (n < 0) {
+                    Log.e(TAG, "Failed to queue bulk IN request");
+                    break;
+                }
+
                 if (n > 0) {
-                    monitor.feed(buf, n);
+                    monitor.traceRead();
+                    in.feed(monitor, n);
 
                     /* Periodic hex dump to logcat for diagnostics */
                     long now = System.currentTimeMillis();
                     if (now - lastHexLog > HEX_LOG_INTERVAL_MS) {
-                        logHexSample(buf, n);
+                        logHexSample(in, n);
                         lastHexLog = now;
                     }
                 }
             }
 
+            in.close();
             monitor.destroy();
             fConn.releaseInterface(fIface);
             fConn.close();
@@ -138,6 +171,17 @@ public class DussStreamReader implements RcReader {
 
     @Override
     public void stop() {
+        if (nativeConn != null) {
+            running = false;
+            monitor.stopUsbReader();
+            monitor.destroy();
+            nativeConn.releaseInterface(nativeIface);
+            nativeConn.close();
+            nativeConn = null;
+            nativeIface = null;
+            Log.d(TAG, "Native DUSS reader stopped");
+            return;
+        }
         running = false;
         if (readThread != null) {
             try {
@@ -151,7 +195,7 @@ public class DussStreamReader implements RcReader {
 
     @Override
     public boolean isRunning() {
-        return running;
+        return running && (nativeConn == null || monitor.isUsbReaderRunning());
     }
 
     /**
@@ -178,12 +222,12 @@ public class DussStreamReader implements RcReader {
         return null;
     }
 
-    private static void logHexSample(byte[] buf, int len) {
+    private static void logHexSample(BulkIn in, int len) {
         int limit = Math.min(len, 64);
         StringBuilder sb = new StringBuilder(limit * 3);
         for (int i = 0; i < limit; i++) {
             if (i > 0) sb.append(' ');
-            sb.append(String.format("%02X", buf[i] & 0xFF));
+            sb.append(String.format("%02X", in.byteAt(i)));
         }
         if (len > limit) sb.append("...");
         Log.d(TAG, "Sample (" + len + "B): " + sb);
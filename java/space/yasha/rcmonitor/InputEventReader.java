@@ -1,16 +1,20 @@
 package space.yasha.rcmonitor;
 
 import android.content.Context;
+import android.os.ParcelFileDescriptor;
 import android.util.Log;
 
 import java.io.File;
 import java.io.FileInputStream;
+import java.io.IOException;
 import java.nio.ByteBuffer;
 import java.nio.ByteOrder;
 
 /**
  * Reads stick data from {@code /dev/input/event*} and synthesizes 17-byte
- * RC payloads fed through {@link RcMonitor#feedDirect(byte[], int)}.
+ * RC payloads. Uses the native evdev reader ({@link RcMonitor#startEvdevReader})
+ * when it can, which batches events per read() and builds the payload in C;
+ * otherwise falls back to a Java loop feeding {@link RcMonitor#feedDirect(byte[], int)}.
  *
  * This reader provides partial data — analog sticks only, no proprietary
  * buttons (those travel over DUML, not evdev). Requires read access to the
@@ -35,6 +39,8 @@ public class InputEventReader implements RcReader {
     private static final String TAG = "InputEventReader";
     private static final String DEFAULT_DEVICE = "/dev/input/event8";
     private static final int INPUT_EVENT_SIZE = 24; /* arm64 struct input_event */
+    /* How often the supervising thread checks the native reader (ms) */
+    private static final int SUPERVISE_INTERVAL_MS = 100;
 
     /* linux/input-event-codes.h */
     private static final int EV_SYN = 0x00;
@@ -92,6 +98,11 @@ public class InputEventReader implements RcReader {
         return "InputEvent";
     }
 
+    @Override
+    public RcMonitor getMonitor() {
+        return monitor;
+    }
+
     @Override
     public boolean isAvailable() {
         File dev = new File(devicePath);
@@ -120,55 +131,13 @@ public class InputEventReader implements RcReader {
         stickLeftH = 0;
 
         readThread = new Thread(() -> {
-            Log.d(TAG, "Input event read loop started: " + devicePath);
-            try (FileInputStream fis = new FileInputStream(devicePath)) {
-                activeStream = fis;
-                byte[] eventBuf = new byte[INPUT_EVENT_SIZE];
-                ByteBuffer bb = ByteBuffer.wrap(eventBuf).order(ByteOrder.LITTLE_ENDIAN);
-
-                while (running) {
-                    int total = 0;
-                    while (total < INPUT_EVENT_SIZE) {
-                        int n = fis.read(eventBuf, total, INPUT_EVENT_SIZE - total);
-                        if (n < 0) {
-                            Log.w(TAG, "Device EOF");
-                            running = false;
-                            break;
-                        }
-                        total += n;
-                    }
-                    if (!running) break;
-
-                    bb.rewind();
-                    bb.getLong(); /* tv_sec */
-                    bb.getLong(); /* tv_usec */
-                    int type = bb.getShort() & 0xFFFF;
-                    int code = bb.getShort() & 0xFFFF;
-                    int value = bb.getInt();
-
-                    if (type == EV_ABS) {
-                        int scaled = (int) (value * scaleFactor);
-                        switch (code) {
-                            case ABS_X:  stickRightH = scaled; break;
-                            case ABS_Y:  stickRightV = scaled; break;
-                            case ABS_Z:  stickLeftV  = scaled; break;
-                            case ABS_RZ: stickLeftH  = scaled; break;
-                        }
-                    } else if (type == EV_SYN) {
-                        byte[] payload = buildPayload();
-                        monitor.feedDirect(payload, payload.length);
-                    }
-                }
-            } catch (Exception e) {
-                if (running) {
-                    Log.e(TAG, "Read error: " + e.getMessage());
-                }
-            } finally {
-                activeStream = null;
-                monitor.destroy();
-                running = false;
-                Log.d(TAG, "Input event read loop stopped");
+            if (!readNative(dev)) {
+                Log.w(TAG, "Native evdev reader unavailable, using Java read loop");
+                readLoop();
             }
+            monitor.destroy();
+            running = false;
+            Log.d(TAG, "Input event read loop stopped");
         }, "rc-input-reader");
         readThread.setDaemon(true);
         readThread.start();
@@ -176,6 +145,89 @@ public class InputEventReader implements RcReader {
         return true;
     }
 
+    /**
+     * Run the native evdev reader until {@link #stop()} or the device goes
+     * away: one epoll wakeup and read() per batch of events and no JNI
+     * crossing per event. Returns false if it could not start.
+     */
+    private boolean readNative(File dev) {
+        ParcelFileDescriptor pfd;
+        try {
+            pfd = ParcelFileDescriptor.open(dev, ParcelFileDescriptor.MODE_READ_ONLY);
+        } catch (IOException e) {
+            Log.e(TAG, "Open failed: " + e.getMessage());
+            return false;
+        }
+        try {
+            if (!monitor.startEvdevReader(pfd.getFd(), null, (float) scaleFactor))
+                return false;
+            Log.d(TAG, "Native input event reader started: " + devicePath);
+            while (running && monitor.isEvdevReaderRunning()) {
+                try {
+                    Thread.sleep(SUPERVISE_INTERVAL_MS);
+                } catch (InterruptedException e) {
+                    break;
+                }
+            }
+            monitor.stopEvdevReader();
+            return true;
+        } finally {
+            try { pfd.close(); } catch (IOException ignored) {}
+        }
+    }
+
+    /** Java fallback: one input_event per read, payload fed via feedDirect. */
+    private void readLoop() {
+        Log.d(TAG, "Input event read loop started: " + devicePath);
+        try (FileInputStream fis = new FileInputStream(devicePath)) {
+            activeStream = fis;
+            byte[] eventBuf = new byte[INPUT_EVENT_SIZE];
+            byte[] payload = new byte[17]; /* rebuilt on every EV_SYN */
+            ByteBuffer bb = ByteBuffer.wrap(eventBuf).order(ByteOrder.LITTLE_ENDIAN);
+
+            while (running) {
+                int total = 0;
+                while (total < INPUT_EVENT_SIZE) {
+                    int n = fis.read(eventBuf, total, INPUT_EVENT_SIZE - total);
+                    if (n < 0) {
+                        Log.w(TAG, "Device EOF");
+                        running = false;
+                        break;
+                    }
+                    total += n;
+                }
+                if (!running) break;
+
+                bb.rewind();
+                bb.getLong(); /* tv_sec */
+                bb.getLong(); /* tv_usec */
+                int type = bb.getShort() & 0xFFFF;
+                int code = bb.getShort() & 0xFFFF;
+                int value = bb.getInt();
+
+                if (type == EV_ABS) {
+                    int scaled = (int) (value * scaleFactor);
+                    switch (code) {
+                        case ABS_X:  stickRightH = scaled; break;
+                        case ABS_Y:  stickRightV = scaled; break;
+                        case ABS_Z:  stickLeftV  = scaled; break;
+                        case ABS_RZ: stickLeftH  = scaled; break;
+                    }
+                } else if (type == EV_SYN) {
+                    monitor.traceRead(); /* the report's last read just returned */
+                    buildPayload(payload);
+                    monitor.feedDirect(payload, payload.length);
+                }
+            }
+        } catch (Exception e) {
+            if (running) {
+                Log.e(TAG, "Read error: " + e.getMessage());
+            }
+        } finally {
+            activeStream = null;
+        }
+    }
+
     @Override
     public void stop() {
         running = false;
@@ -200,8 +252,9 @@ public class InputEventReader implements RcReader {
     }
 
     /**
-     * Build a 17-byte RC push payload from the current stick state.
-     * Bytes 0–4 are zeroed (no button data from evdev).
+     * Build a 17-byte RC push payload from the current stick state into p,
+     * reused across events. Bytes 0–4 are never written and stay zero (no
+     * button data from evdev).
      * Bytes 5–16 are six uint16 LE values with 0x400 (1024) center offset.
      *
      * Layout matches rcm_parse_payload expectations:
@@ -212,8 +265,7 @@ public class InputEventReader implements RcReader {
      *   [13..14] left wheel      (uint16 LE, centered at 0x400)
      *   [15..16] right wheel     (uint16 LE, centered at 0x400)
      */
-    private byte[] buildPayload() {
-        byte[] p = new byte[17];
+    private void buildPayload(byte[] p) {
         int center = 0x400;
 
         putLE16(p, 5,  center + stickRightH);
@@ -222,8 +274,6 @@ public class InputEventReader implements RcReader {
         putLE16(p, 11, center + stickLeftH);
         putLE16(p, 13, center); /* left wheel — no evdev source */
         putLE16(p, 15, center); /* right wheel — no evdev source */
-
-        return p;
     }
 
     private static void putLE16(byte[] buf, int offset, int value) {
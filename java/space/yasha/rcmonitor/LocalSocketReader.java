@@ -6,11 +6,16 @@ import android.net.LocalSocketAddress;
 import android.util.Log;
 
 import java.io.File;
-import java.io.InputStream;
+import java.io.FileInputStream;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
 
 /**
  * Root-required reader that connects to dji_link's Unix domain socket
- * and feeds raw DUML frames through {@link RcMonitor#feed(byte[], int)}.
+ * and feeds raw DUML frames to the parser. The socket is normally served by
+ * the shared native ingestion thread ({@link RcMonitor#attachStream}), so the
+ * reader needs no thread of its own; if that fails it falls back to a Java
+ * read loop.
  *
  * The socket path (e.g. {@code /dev/socket/dji_xxx}) must be discovered
  * on-device and passed to the constructor.
@@ -25,6 +30,7 @@ public class LocalSocketReader implements RcReader {
     private final RcMonitor monitor;
 
     private volatile boolean running;
+    private volatile boolean nativeStream;
     private Thread readThread;
     private volatile LocalSocket activeSocket;
 
@@ -43,6 +49,11 @@ public class LocalSocketReader implements RcReader {
         return "LocalSocket";
     }
 
+    @Override
+    public RcMonitor getMonitor() {
+        return monitor;
+    }
+
     @Override
     public boolean isAvailable() {
         File sock = new File(socketPath);
@@ -70,6 +81,13 @@ public class LocalSocketReader implements RcReader {
             return false;
         }
 
+        if (monitor.attachStream(socketPath)) {
+            Log.d(TAG, "LocalSocket attached to native ingestion loop: " + socketPath);
+            nativeStream = true;
+            running = true;
+            return true;
+        }
+
         LocalSocket socket = new LocalSocket();
         try {
             socket.connect(new LocalSocketAddress(socketPath,
@@ -87,15 +105,20 @@ public class LocalSocketReader implements RcReader {
         final LocalSocket fSocket = socket;
 
         readThread = new Thread(() -> {
-            byte[] buf = new byte[BUFFER_SIZE];
+            /* Read through a channel on the socket fd so each read lands in
+             * one long-lived direct buffer that the parser reads in place */
+            ByteBuffer buf = ByteBuffer.allocateDirect(BUFFER_SIZE);
             Log.d(TAG, "LocalSocket read loop started: " + socketPath);
 
             try {
-                InputStream in = fSocket.getInputStream();
+                /* Not closed here: the fd belongs to fSocket, closed below */
+                FileChannel in = new FileInputStream(fSocket.getFileDescriptor()).getChannel();
                 while (running) {
+                    buf.clear();
                     int n = in.read(buf);
                     if (n > 0) {
-                        monitor.feed(buf, n);
+                        monitor.traceRead();
+                        monitor.feed(buf, 0, n);
                     } else if (n < 0) {
                         Log.w(TAG, "Socket EOF");
                         break;
@@ -121,6 +144,14 @@ public class LocalSocketReader implements RcReader {
 
     @Override
     public void stop() {
+        if (nativeStream) {
+            running = false;
+            nativeStream = false;
+            monitor.detachStream();
+            monitor.destroy();
+            Log.d(TAG, "LocalSocket detached");
+            return;
+        }
         running = false;
         /* Close socket to unblock any pending read */
         LocalSocket socket = activeSocket;
@@ -139,6 +170,6 @@ public class LocalSocketReader implements RcReader {
 
     @Override
     public boolean isRunning() {
-        return running;
+        return running && (!nativeStream || monitor.isStreamAlive());
     }
 }
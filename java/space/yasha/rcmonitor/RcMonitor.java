@@ -1,5 +1,8 @@
 package space.yasha.rcmonitor;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
 /**
  * DJI RM510 RC Monitor - reads raw USB data from DJI remote controller
  * and parses button/stick state from DUML protocol frames.
@@ -84,6 +87,40 @@ public class RcMonitor {
         public int stickLeftH, stickLeftV;
         public int leftWheel, rightWheel, rightWheelDelta;
 
+        /** Overwrite every field, in {@link RcStateListener#onRcState} order. */
+        public RcState set(
+                boolean pause, boolean gohome, boolean shutter, boolean record,
+                boolean custom1, boolean custom2, boolean custom3,
+                boolean fiveDUp, boolean fiveDDown, boolean fiveDLeft,
+                boolean fiveDRight, boolean fiveDCenter,
+                int flightMode,
+                int stickRightH, int stickRightV,
+                int stickLeftH, int stickLeftV,
+                int leftWheel, int rightWheel, int rightWheelDelta) {
+            this.pause = pause;      this.gohome = gohome;
+            this.shutter = shutter;  this.record = record;
+            this.custom1 = custom1;  this.custom2 = custom2;  this.custom3 = custom3;
+            this.fiveDUp = fiveDUp;  this.fiveDDown = fiveDDown;
+            this.fiveDLeft = fiveDLeft; this.fiveDRight = fiveDRight;
+            this.fiveDCenter = fiveDCenter;
+            this.flightMode = flightMode;
+            this.stickRightH = stickRightH; this.stickRightV = stickRightV;
+            this.stickLeftH = stickLeftH;   this.stickLeftV = stickLeftV;
+            this.leftWheel = leftWheel;     this.rightWheel = rightWheel;
+            this.rightWheelDelta = rightWheelDelta;
+            return this;
+        }
+
+        /** Copy every field of {@code o} into this state. */
+        public RcState copyFrom(RcState o) {
+            return set(o.pause, o.gohome, o.shutter, o.record,
+                       o.custom1, o.custom2, o.custom3,
+                       o.fiveDUp, o.fiveDDown, o.fiveDLeft, o.fiveDRight, o.fiveDCenter,
+                       o.flightMode,
+                       o.stickRightH, o.stickRightV, o.stickLeftH, o.stickLeftV,
+                       o.leftWheel, o.rightWheel, o.rightWheelDelta);
+        }
+
         public String flightModeString() {
             switch (flightMode) {
                 case 0: return "Sport";
@@ -94,7 +131,11 @@ public class RcMonitor {
         }
     }
 
-    /** Listener adapter that delivers an RcState object. */
+    /**
+     * Listener adapter that delivers an RcState object. Allocates a new
+     * RcState per packet, so {@code onState} may keep it indefinitely; use
+     * {@link ReusingListener} on hot paths.
+     */
     public static abstract class SimpleListener implements RcStateListener {
         public abstract void onState(RcState state);
 
@@ -108,32 +149,77 @@ public class RcMonitor {
                 int stickRightH, int stickRightV,
                 int stickLeftH, int stickLeftV,
                 int leftWheel, int rightWheel, int rightWheelDelta) {
-            RcState s = new RcState();
-            s.pause = pause;      s.gohome = gohome;
-            s.shutter = shutter;  s.record = record;
-            s.custom1 = custom1;  s.custom2 = custom2;  s.custom3 = custom3;
-            s.fiveDUp = fiveDUp;  s.fiveDDown = fiveDDown;
-            s.fiveDLeft = fiveDLeft; s.fiveDRight = fiveDRight;
-            s.fiveDCenter = fiveDCenter;
-            s.flightMode = flightMode;
-            s.stickRightH = stickRightH; s.stickRightV = stickRightV;
-            s.stickLeftH = stickLeftH;   s.stickLeftV = stickLeftV;
-            s.leftWheel = leftWheel;     s.rightWheel = rightWheel;
-            s.rightWheelDelta = rightWheelDelta;
-            onState(s);
+            onState(new RcState().set(pause, gohome, shutter, record,
+                    custom1, custom2, custom3,
+                    fiveDUp, fiveDDown, fiveDLeft, fiveDRight, fiveDCenter,
+                    flightMode, stickRightH, stickRightV, stickLeftH, stickLeftV,
+                    leftWheel, rightWheel, rightWheelDelta));
         }
     }
 
-    private boolean initialized = false;
+    /**
+     * Allocation-free listener adapter. States come from a fixed pool of
+     * {@code depth} instances filled round-robin, so nothing is allocated
+     * after construction.
+     *
+     * Ownership: the RcState passed to {@code onState} stays valid until
+     * {@code depth - 1} further callbacks have been made, then it is
+     * overwritten. With the default depth of 2 (double buffering) it can be
+     * handed to one other thread, e.g. published through a volatile field
+     * for the render thread, while the next packet is decoded into the
+     * other instance. Anything kept longer must be copied with
+     * {@link RcState#copyFrom}. For a view straight onto the native packed
+     * states, see {@link #enableStateRing}.
+     */
+    public static abstract class ReusingListener implements RcStateListener {
+        private final RcState[] pool;
+        private int next;
+
+        protected ReusingListener() {
+            this(2);
+        }
+
+        /** @param depth Pool size, at least 1 */
+        protected ReusingListener(int depth) {
+            pool = new RcState[Math.max(depth, 1)];
+            for (int i = 0; i < pool.length; i++) pool[i] = new RcState();
+        }
+
+        public abstract void onState(RcState state);
+
+        @Override
+        public final void onRcState(
+                boolean pause, boolean gohome, boolean shutter, boolean record,
+                boolean custom1, boolean custom2, boolean custom3,
+                boolean fiveDUp, boolean fiveDDown, boolean fiveDLeft,
+                boolean fiveDRight, boolean fiveDCenter,
+                int flightMode,
+                int stickRightH, int stickRightV,
+                int stickLeftH, int stickLeftV,
+                int leftWheel, int rightWheel, int rightWheelDelta) {
+            RcState s = pool[next];
+            next = next + 1 == pool.length ? 0 : next + 1;
+            onState(s.set(pause, gohome, shutter, record,
+                    custom1, custom2, custom3,
+                    fiveDUp, fiveDDown, fiveDLeft, fiveDRight, fiveDCenter,
+                    flightMode, stickRightH, stickRightV, stickLeftH, stickLeftV,
+                    leftWheel, rightWheel, rightWheelDelta));
+        }
+    }
+
+    /** Native context of this instance (parser + listener ref), 0 if not initialized. */
+    private volatile long handle;
 
     /**
-     * Initialize the native parser with a listener.
+     * Initialize the native parser with a listener. Each RcMonitor has its
+     * own parser, so several streams can be parsed at once, each on its own
+     * thread, without sharing any native state.
      * @return true on success
      */
     public boolean init(RcStateListener listener) {
-        if (initialized) return false;
-        initialized = nativeInit(listener);
-        return initialized;
+        if (handle != 0) return false;
+        handle = nativeInit(listener);
+        return handle != 0;
     }
 
     /**
@@ -144,36 +230,856 @@ public class RcMonitor {
      * @return Number of RC packets decoded
      */
     public int feed(byte[] data, int length) {
-        if (!initialized) return 0;
-        return nativeFeed(data, length);
+        long h = handle;
+        if (h == 0) return 0;
+        return nativeFeed(h, data, length);
+    }
+
+    /**
+     * Feed raw bytes straight from a direct ByteBuffer, with no copy, pin or
+     * release per call. Readers can keep one long-lived buffer
+     * ({@link ByteBuffer#allocateDirect}) and hand over each transfer.
+     * The buffer's position and limit are ignored.
+     * @param buffer Direct buffer holding the data
+     * @param offset Index of the first byte to parse
+     * @param length Number of bytes to parse
+     * @return Number of RC packets decoded
+     * @throws IllegalArgumentException if {@code buffer} is not direct
+     */
+    public int feed(ByteBuffer buffer, int offset, int length) {
+        if (!buffer.isDirect())
+            throw new IllegalArgumentException("feed(ByteBuffer) needs a direct buffer");
+        long h = handle;
+        if (h == 0) return 0;
+        return nativeFeedBuffer(h, buffer, offset, length);
+    }
+
+    /* --- Batch output layout (see feedBatch) --- */
+
+    /** Ints per decoded state in the {@link #feedBatch} output array. */
+    public static final int BATCH_STRIDE = 13;
+    /** Maximum states returned per {@link #feedBatch} call. */
+    public static final int BATCH_MAX_ENTRIES = 128;
+
+    public static final int BATCH_BUTTONS     = 0;  // BTN_* bit mask
+    public static final int BATCH_FLIGHT_MODE = 1;
+    public static final int BATCH_STICK_RH    = 2;
+    public static final int BATCH_STICK_RV    = 3;
+    public static final int BATCH_STICK_LH    = 4;
+    public static final int BATCH_STICK_LV    = 5;
+    public static final int BATCH_LEFT_WHEEL  = 6;
+    public static final int BATCH_RIGHT_WHEEL = 7;
+    public static final int BATCH_WHEEL_DELTA = 8;
+    /** Running count of pushes decoded by the parser, starting at 1. */
+    public static final int BATCH_SEQ         = 9;
+    /** Sequence number from the DUML frame header. */
+    public static final int BATCH_DUML_SEQ    = 10;
+    /** Offset of the frame's SOF in the fed data; negative if it began in an earlier feed. */
+    public static final int BATCH_OFFSET      = 11;
+    /** CHANGED_* mask of fields that changed (all bits unless change detection is on). */
+    public static final int BATCH_CHANGED     = 12;
+
+    public static final int BTN_PAUSE        = 1 << 0;
+    public static final int BTN_GOHOME       = 1 << 1;
+    public static final int BTN_SHUTTER      = 1 << 2;
+    public static final int BTN_RECORD       = 1 << 3;
+    public static final int BTN_CUSTOM1      = 1 << 4;
+    public static final int BTN_CUSTOM2      = 1 << 5;
+    public static final int BTN_CUSTOM3      = 1 << 6;
+    public static final int BTN_FIVE_D_UP    = 1 << 7;
+    public static final int BTN_FIVE_D_DOWN  = 1 << 8;
+    public static final int BTN_FIVE_D_LEFT  = 1 << 9;
+    public static final int BTN_FIVE_D_RIGHT = 1 << 10;
+    public static final int BTN_FIVE_D_CENTER = 1 << 11;
+
+    /* Changed-field bits (mirror RCM_CHANGED_* in rc_monitor.h) */
+    public static final int CHANGED_PAUSE       = 1 << 0;
+    public static final int CHANGED_GOHOME      = 1 << 1;
+    public static final int CHANGED_SHUTTER     = 1 << 2;
+    public static final int CHANGED_RECORD      = 1 << 3;
+    public static final int CHANGED_CUSTOM1     = 1 << 4;
+    public static final int CHANGED_CUSTOM2     = 1 << 5;
+    public static final int CHANGED_CUSTOM3     = 1 << 6;
+    public static final int CHANGED_FIVE_D      = 1 << 7;
+    public static final int CHANGED_FLIGHT_MODE = 1 << 8;
+    public static final int CHANGED_STICK_RH    = 1 << 9;
+    public static final int CHANGED_STICK_RV    = 1 << 10;
+    public static final int CHANGED_STICK_LH    = 1 << 11;
+    public static final int CHANGED_STICK_LV    = 1 << 12;
+    public static final int CHANGED_LEFT_WHEEL  = 1 << 13;
+    public static final int CHANGED_RIGHT_WHEEL = 1 << 14;
+    public static final int CHANGED_WHEEL_DELTA = 1 << 15;
+    public static final int CHANGED_ALL         = 0xFFFF;
+
+    /**
+     * Deliver RC pushes only when something changed: a button, the 5D
+     * joystick, the flight mode, a non-zero wheel delta, or a stick/wheel
+     * axis moving more than {@code deadband} from its last delivered value.
+     * Cuts the listener rate to near zero while the sticks are at rest.
+     * Set it before {@link #startUsbReader}, {@link #startEvdevReader} or
+     * {@link #attachStream}.
+     *
+     * @param enable   true to enable, false to deliver every push again
+     * @param deadband Axis movement that must be exceeded (0 = any change)
+     * @return false if not initialized or a native reader is running
+     */
+    public boolean setChangeDetect(boolean enable, int deadband) {
+        long h = handle;
+        return h != 0 && nativeSetChangeDetect(h, enable, deadband);
+    }
+
+    /**
+     * Tune header layout lock-in. After {@code confirmFrames} consecutive RC
+     * pushes at one header layout (v1, or a v2/v3 variant with cmd_set at
+     * another offset), frames no handler claims are checked at that offset
+     * only; {@code missLimit} consecutive misses go back to scanning bytes
+     * 8-12. Defaults: 8 and 1024. Set it before a native reader starts.
+     *
+     * @param confirmFrames Pushes needed to lock, 0 to always scan
+     * @param missLimit     Misses that drop the lock, 0 to keep it until reset
+     * @return false if not initialized or a native reader is running
+     */
+    public boolean setLayoutLock(int confirmFrames, int missLimit) {
+        long h = handle;
+        return h != 0 && nativeSetLayoutLock(h, confirmFrames, missLimit);
+    }
+
+    /* --- Latency tracing --- */
+
+    private volatile boolean tracing;
+
+    /**
+     * Emit ATrace sections and counters for systrace / Perfetto (app
+     * atrace category): an {@code rcm.feed} section per feed, the listener
+     * upcall as {@code rcm.onRcState} (or {@code rcm.onStates} with the
+     * state ring), and per delivered push the counters
+     * {@code rcm.read_to_frame_ns}, {@code rcm.frame_to_return_ns} and
+     * {@code rcm.read_to_return_ns}. Read times come from the native
+     * readers or from {@link #traceRead()}. Off by default; while off the
+     * parser pays one branch per trace point. Safe to toggle while feeding.
+     *
+     * @return true if ATrace sections are available (API 23+; counters need 29+)
+     */
+    public boolean setTracing(boolean enable) {
+        long h = handle;
+        if (h == 0) return false;
+        tracing = enable;
+        return nativeSetTracing(h, enable);
+    }
+
+    /** @return true while {@link #setTracing} is on */
+    public boolean isTracing() {
+        return tracing;
+    }
+
+    /**
+     * Stamp the completion of a transport read, for the read-to-callback
+     * counters. Call on the feeding thread right after the read returns and
+     * before feeding its data; does nothing while tracing is off.
+     */
+    public void traceRead() {
+        if (!tracing) return;
+        long h = handle;
+        if (h != 0) nativeTraceRead(h, System.nanoTime());
+    }
+
+    /**
+     * Feed raw bytes and receive every decoded RC push in one native call,
+     * instead of one listener call per frame. Entry {@code i} occupies
+     * {@code out[i * BATCH_STRIDE .. (i + 1) * BATCH_STRIDE)}; see the
+     * {@code BATCH_*} constants for the layout.
+     *
+     * <p>At most {@code min(out.length / BATCH_STRIDE, BATCH_MAX_ENTRIES)}
+     * states are written; any further pushes in the same data are delivered
+     * to the listener as {@link #feed} would.</p>
+     *
+     * @param data Raw USB data
+     * @param length Number of valid bytes in data
+     * @param out Output array, BATCH_STRIDE ints per state
+     * @return Number of states written to out
+     */
+    public int feedBatch(byte[] data, int length, int[] out) {
+        long h = handle;
+        if (h == 0) return 0;
+        return nativeFeedBatch(h, data, length, out);
+    }
+
+    /**
+     * Copy entry {@code index} of a {@link #feedBatch} result into an RcState.
+     * @return {@code state}, for chaining
+     */
+    public static RcState batchState(int[] batch, int index, RcState state) {
+        int o = index * BATCH_STRIDE;
+        int b = batch[o + BATCH_BUTTONS];
+        state.pause       = (b & BTN_PAUSE) != 0;
+        state.gohome      = (b & BTN_GOHOME) != 0;
+        state.shutter     = (b & BTN_SHUTTER) != 0;
+        state.record      = (b & BTN_RECORD) != 0;
+        state.custom1     = (b & BTN_CUSTOM1) != 0;
+        state.custom2     = (b & BTN_CUSTOM2) != 0;
+        state.custom3     = (b & BTN_CUSTOM3) != 0;
+        state.fiveDUp     = (b & BTN_FIVE_D_UP) != 0;
+        state.fiveDDown   = (b & BTN_FIVE_D_DOWN) != 0;
+        state.fiveDLeft   = (b & BTN_FIVE_D_LEFT) != 0;
+        state.fiveDRight  = (b & BTN_FIVE_D_RIGHT) != 0;
+        state.fiveDCenter = (b & BTN_FIVE_D_CENTER) != 0;
+        state.flightMode  = batch[o + BATCH_FLIGHT_MODE];
+        state.stickRightH = batch[o + BATCH_STICK_RH];
+        state.stickRightV = batch[o + BATCH_STICK_RV];
+        state.stickLeftH  = batch[o + BATCH_STICK_LH];
+        state.stickLeftV  = batch[o + BATCH_STICK_LV];
+        state.leftWheel   = batch[o + BATCH_LEFT_WHEEL];
+        state.rightWheel  = batch[o + BATCH_RIGHT_WHEEL];
+        state.rightWheelDelta = batch[o + BATCH_WHEEL_DELTA];
+        return state;
+    }
+
+    /**
+     * Read the newest decoded RC state without a listener or lock. Safe to
+     * call from any thread (render loop, control loop) while the reader
+     * thread feeds; it never blocks the reader. The state is written as
+     * entry 0 of a {@link #feedBatch}-style array, so decode it with
+     * {@code batchState(out, 0, state)}. BATCH_SEQ holds the returned count;
+     * BATCH_DUML_SEQ, BATCH_OFFSET and BATCH_CHANGED are zero.
+     *
+     * @param out At least BATCH_STRIDE ints
+     * @return Number of states published so far (changes when a new push
+     *         arrives), or -1 if none yet or not initialized
+     */
+    public long snapshot(int[] out) {
+        long h = handle;
+        if (h == 0) return -1;
+        return nativeSnapshot(h, out);
+    }
+
+    /* --- Coalesced dispatch --- */
+
+    /**
+     * Stop calling the listener once per push; instead each
+     * {@link #dispatchCoalesced()} delivers one state folding in every push
+     * since the previous call: the latest sticks, wheels and flight mode,
+     * every button that was down in any of them (so a tap between two
+     * ticks is never lost), and the summed wheel delta. Drive it from a
+     * Choreographer frame callback ({@link VsyncDispatcher} does this) or
+     * use {@link #startTimerDispatch} instead. Call on the dispatching
+     * thread; the state ring, if enabled, is unaffected.
+     */
+    public void setCoalescedDispatch(boolean enable) {
+        long h = handle;
+        if (h != 0) nativeSetCoalesce(h, enable);
+    }
+
+    /**
+     * Deliver the coalesced state to the listener on the calling thread.
+     * One thread at a time, and not while {@link #startTimerDispatch} runs:
+     * the two drivers are mutually exclusive.
+     * @return Pushes it covered; 0 if none arrived (no listener call),
+     *         coalesced dispatch is off or the timer is dispatching
+     */
+    public int dispatchCoalesced() {
+        long h = handle;
+        if (h == 0) return 0;
+        return nativeDispatchCoalesced(h);
+    }
+
+    /**
+     * Coalesced dispatch driven by a native timerfd: the listener is called
+     * at most once every {@code periodUs} on a dedicated thread, with the
+     * same folding as {@link #dispatchCoalesced()}, which does nothing
+     * until {@link #stopTimerDispatch} (do not start a VsyncDispatcher too).
+     * @return false if not initialized, already running or on error
+     */
+    public boolean startTimerDispatch(int periodUs) {
+        long h = handle;
+        if (h == 0) return false;
+        return nativeStartCoalesceTimer(h, periodUs);
+    }
+
+    /** Stop the timer thread and go back to one listener call per push. */
+    public void stopTimerDispatch() {
+        long h = handle;
+        if (h != 0) nativeStopCoalesceTimer(h);
+    }
+
+    /* --- Arrival scoring and muting (hot standby, see RcReaderChain) --- */
+
+    /** Length of the {@link #getArrivals} output array. */
+    public static final int ARRIVAL_LEN         = 5;
+
+    /** Pushes scored since {@link #trackArrivals}. */
+    public static final int ARRIVAL_COUNT       = 0;
+    /** {@link System#nanoTime()} of the latest push. */
+    public static final int ARRIVAL_LAST_NS     = 1;
+    /** Mean push interval (EWMA, 1/8 gain). */
+    public static final int ARRIVAL_INTERVAL_NS = 2;
+    /** Start of the current run of pushes without a stall. */
+    public static final int ARRIVAL_RUN_NS      = 3;
+    /** Current stall threshold: a gap longer than this is a stall. */
+    public static final int ARRIVAL_STALL_NS    = 4;
+
+    /**
+     * Timestamp and score every decoded push natively, muted or not, with
+     * a stall threshold of {@code stallFactor} x the mean interval clamped
+     * to [minStallNs, maxStallNs]. Restarts the scores (the feeding thread
+     * clears them at its next push; {@link #getArrivals} reads zeros until
+     * then); call after {@link #init}. Safe while a reader feeds.
+     */
+    public void trackArrivals(int stallFactor, long minStallNs, long maxStallNs) {
+        long h = handle;
+        if (h != 0) nativeTrackArrivals(h, stallFactor, minStallNs, maxStallNs);
+    }
+
+    /**
+     * Read the arrival scores from any thread.
+     * @param out At least ARRIVAL_LEN longs, indexed by the ARRIVAL_* constants
+     * @return false if not initialized
+     */
+    public boolean getArrivals(long[] out) {
+        long h = handle;
+        if (h == 0) return false;
+        return nativeGetArrivals(h, out);
+    }
+
+    /**
+     * Keep parsing (and scoring arrivals) but stop calling the listener,
+     * so a warm standby costs no JNI upcall per push. Any thread.
+     */
+    public void setMuted(boolean muted) {
+        long h = handle;
+        if (h != 0) nativeMuteUntil(h, muted ? Long.MAX_VALUE : 0, 0);
+    }
+
+    /**
+     * Mute until {@code watched} (which must {@link #trackArrivals}) would
+     * count as stalled: its last push plus its stall threshold, or at once
+     * if it has none yet. Pushes after that reach the listener again until
+     * the next call, so calling this from {@code watched}'s listener on
+     * every push keeps this instance quiet exactly while the other one
+     * delivers.
+     */
+    public void muteUntilStalled(RcMonitor watched) {
+        long h = handle, w = watched.handle;
+        if (h != 0 && w != 0) nativeMuteUntil(h, 0, w);
+    }
+
+    /* --- Shared state ring (see enableStateRing) --- */
+
+    /** Notified once per feed call that published states into the ring. */
+    public interface StateRingListener {
+        /** @param written Total states published so far (pass to {@link StateRing#read}) */
+        void onStates(long written);
+    }
+
+    /**
+     * Ring of packed RC states in native memory, shared with the parser
+     * through a direct ByteBuffer. The native side overwrites the oldest
+     * entries when the consumer falls behind; {@link #lost()} counts them.
+     * Use from one consumer thread.
+     */
+    public static final class StateRing {
+        private static final int HDR_LEN = 64;   /* jni_ring_hdr_t */
+        private static final int ENTRY_LEN = 16; /* rcm_packed_state_t */
+
+        private final RcMonitor owner;
+        private final ByteBuffer buf;
+        private final int capacity;
+        private long read;
+        private long lost;
+
+        StateRing(RcMonitor owner, ByteBuffer buf) {
+            this.owner = owner;
+            this.buf = buf.order(ByteOrder.nativeOrder());
+            this.capacity = this.buf.getInt(8);
+        }
+
+        public int capacity() { return capacity; }
+
+        /** States that were overwritten before they could be read. */
+        public long lost() { return lost; }
+
+        /** Total states published so far. */
+        public long written() {
+            long h = owner.handle;
+            return h == 0 ? read : nativeRingWritten(h);
+        }
+
+        /** Read new states without a notify, e.g. from a polling loop. */
+        public int read(RcState[] out) {
+            return read(written(), out);
+        }
+
+        /**
+         * Copy unread states up to {@code written} into {@code out}, oldest
+         * first, without allocating. Entries the producer may have
+         * overwritten during the copy are discarded and counted as lost.
+         * @return Number of states written to out
+         */
+        public int read(long written, RcState[] out) {
+            if (written - read > capacity) {
+                lost += written - read - capacity;
+                read = written - capacity;
+            }
+            int n = (int)Math.min(written - read, out.length);
+            for (int i = 0; i < n; i++)
+                unpack(buf, HDR_LEN + (int)((read + i) & (capacity - 1)) * ENTRY_LEN, out[i]);
+
+            /* Entries below claimed - capacity may have been reused mid-copy */
+            long h = owner.handle;
+            long claimed = h == 0 ? read + n : nativeRingClaimed(h);
+            int bad = (int)Math.max(0, Math.min(n, claimed - capacity - read));
+            for (int i = bad; i < n; i++) {
+                RcState t = out[i - bad];
+                out[i - bad] = out[i];
+                out[i] = t;
+            }
+            lost += bad;
+            read += n;
+            return n - bad;
+        }
+
+        /** Decode the rcm_packed_state_t at {@code off}; also used by {@link SharedStateRing}. */
+        static void unpack(ByteBuffer buf, int off, RcState s) {
+            int f = buf.getShort(off) & 0xFFFF;
+            s.pause       = (f & BTN_PAUSE) != 0;
+            s.gohome      = (f & BTN_GOHOME) != 0;
+            s.shutter     = (f & BTN_SHUTTER) != 0;
+            s.record      = (f & BTN_RECORD) != 0;
+            s.custom1     = (f & BTN_CUSTOM1) != 0;
+            s.custom2     = (f & BTN_CUSTOM2) != 0;
+            s.custom3     = (f & BTN_CUSTOM3) != 0;
+            s.fiveDUp     = (f & BTN_FIVE_D_UP) != 0;
+            s.fiveDDown   = (f & BTN_FIVE_D_DOWN) != 0;
+            s.fiveDLeft   = (f & BTN_FIVE_D_LEFT) != 0;
+            s.fiveDRight  = (f & BTN_FIVE_D_RIGHT) != 0;
+            s.fiveDCenter = (f & BTN_FIVE_D_CENTER) != 0;
+            s.flightMode  = (f >> 12) & 0x3;
+            s.stickRightH = buf.getShort(off + 2);
+            s.stickRightV = buf.getShort(off + 4);
+            s.stickLeftH  = buf.getShort(off + 6);
+            s.stickLeftV  = buf.getShort(off + 8);
+            s.leftWheel   = buf.getShort(off + 10);
+            s.rightWheel  = buf.getShort(off + 12);
+            s.rightWheelDelta = buf.get(off + 14);
+        }
+    }
+
+    /**
+     * Deliver decoded states through a shared-memory ring instead of one
+     * {@link RcStateListener#onRcState} upcall per frame. With a
+     * {@code notify} listener the native side makes a single
+     * {@code onStates(written)} call per feed; with null it makes none and
+     * the consumer polls {@link StateRing#read(RcState[])}. Call before
+     * feeding starts (or from the feeding thread), and before
+     * {@link #startUsbReader}, {@link #startEvdevReader} or
+     * {@link #attachStream}; can be enabled once per instance and the ring
+     * must not be used after {@link #destroy}.
+     *
+     * @param capacity Entries, rounded up to a power of two in [16, 65536]
+     * @return The ring, or null if not initialized, already enabled or a
+     *         native reader is running
+     */
+    public StateRing enableStateRing(int capacity, StateRingListener notify) {
+        long h = handle;
+        if (h == 0) return null;
+        ByteBuffer buf = nativeEnableStateRing(h, capacity, notify);
+        return buf == null ? null : new StateRing(this, buf);
+    }
+
+    /**
+     * Also publish every decoded state into a shared-memory ring (memfd, or
+     * ashmem on older kernels) that other processes map read-only with
+     * {@link SharedStateRing#open}. Hand the returned descriptor to them
+     * over Binder, e.g. as the result of a bound service call; each feed
+     * wakes their {@link SharedStateRing#await} once. Works alongside any
+     * listener or {@link #enableStateRing}. Can be started once per
+     * instance; the ring is closed by {@link #destroy}.
+     *
+     * @param name Label of the region (null = "rcm-states")
+     * @param capacity Entries, rounded up to a power of two in [16, 65536]
+     * @return A duplicate of the region's fd (close it when shared), or
+     *         null if not initialized, already started or on failure
+     */
+    public android.os.ParcelFileDescriptor startSharedPublisher(String name, int capacity) {
+        long h = handle;
+        if (h == 0) return null;
+        int fd = nativeStartSharedPublisher(h, name, capacity);
+        if (fd < 0) return null;
+        try {
+            return android.os.ParcelFileDescriptor.fromFd(fd);
+        } catch (java.io.IOException e) {
+            return null;
+        }
+    }
+
+    /* --- Parser statistics (see getStats) --- */
+
+    /** Length of the {@link #getStats} output array. */
+    public static final int STAT_COUNT            = 20;
+
+    public static final int STAT_BYTES_IN         = 0;
+    /** Bytes skipped while hunting for a frame (noise, false SOFs, reset). */
+    public static final int STAT_BYTES_DISCARDED  = 1;
+    public static final int STAT_FRAMES           = 2;
+    public static final int STAT_CRC8_FAILURES    = 3;
+    public static final int STAT_CRC16_FAILURES   = 4;
+    public static final int STAT_LENGTH_ERRORS    = 5;
+    /** RC pushes received, including ones suppressed by change detection. */
+    public static final int STAT_RC_PUSHES        = 6;
+    /** States past the feedBatch capacity that went to the listener. */
+    public static final int STAT_BATCH_OVERFLOWS  = 7;
+    /** Nanoseconds since the last RC push arrived, -1 if none yet. */
+    public static final int STAT_LAST_PUSH_AGE_NS = 8;
+    /** Outgoing commands entered in the native request table. */
+    public static final int STAT_REQUESTS         = 9;
+    /** Response frames matched to a tracked request by seq. */
+    public static final int STAT_RESPONSES        = 10;
+    public static final int STAT_REQUEST_TIMEOUTS = 11;
+    /** Round-trip times of matched responses, 0 until the first one. */
+    public static final int STAT_RTT_LAST_NS      = 12;
+    public static final int STAT_RTT_MIN_NS       = 13;
+    public static final int STAT_RTT_MAX_NS       = 14;
+    /** Smoothed RTT (EWMA); not cleared by {@link #resetStats}. */
+    public static final int STAT_RTT_SMOOTHED_NS  = 15;
+    /** Locked header layout, one of the {@code LAYOUT_*} constants. */
+    public static final int STAT_LAYOUT           = 16;
+    /** Frame offset of cmd_set in the locked layout, 0 while scanning. */
+    public static final int STAT_LAYOUT_CMD_OFFSET = 17;
+    public static final int STAT_LAYOUT_LOCKS     = 18;
+    /** Locks dropped after too many frames without an RC push at that layout. */
+    public static final int STAT_LAYOUT_FALLBACKS = 19;
+
+    /* Values of STAT_LAYOUT (mirror RCM_LAYOUT_* in rc_monitor.h) */
+    public static final int LAYOUT_NONE = 0;
+    public static final int LAYOUT_V1   = 1;
+    public static final int LAYOUT_ALT  = 2;
+
+    /**
+     * Read the parser counters accumulated since init or {@link #resetStats}.
+     * While a native reader runs they are the copy its thread took after its
+     * last read that carried data ({@code STAT_LAST_PUSH_AGE_NS} is still
+     * current); the same goes for {@link #getCmdSetFrames} and
+     * {@link #getFeedHistogram}.
+     * @param out At least STAT_COUNT longs, indexed by the STAT_* constants
+     * @return false if not initialized
+     */
+    public boolean getStats(long[] out) {
+        long h = handle;
+        if (h == 0) return false;
+        return nativeGetStats(h, out, null, null) >= 0;
+    }
+
+    /**
+     * Validated frames per DUML cmd_set.
+     * @param out 256 longs, indexed by cmd_set
+     * @return false if not initialized
+     */
+    public boolean getCmdSetFrames(long[] out) {
+        long h = handle;
+        if (h == 0) return false;
+        return nativeGetStats(h, null, out, null) >= 0;
+    }
+
+    /**
+     * feed() latency histogram: bucket {@code i} counts calls that took
+     * [2^(i-1), 2^i) ns. Only collected when the native library is built
+     * with -DENABLE_FEED_HISTOGRAM=ON.
+     * @param out Up to 32 longs
+     * @return Number of buckets available, 0 if compiled out or not initialized
+     */
+    public int getFeedHistogram(long[] out) {
+        long h = handle;
+        if (h == 0) return 0;
+        return Math.max(nativeGetStats(h, null, null, out), 0);
+    }
+
+    /**
+     * Zero all parser counters and the latency histogram. While a native
+     * reader runs its thread does this after its next read that carries data.
+     */
+    public void resetStats() {
+        long h = handle;
+        if (h != 0) nativeResetStats(h);
+    }
+
+    /* --- Motion history (see enableHistory) --- */
+
+    /** Length of the {@link #queryHistory} output array. */
+    public static final int HIST_LEN         = 31;
+
+    /** CLOCK_MONOTONIC ns of the newest sample. */
+    public static final int HIST_T_NS        = 0;
+    /** Newest minus oldest sample time in the window. */
+    public static final int HIST_SPAN_NS     = 1;
+    /** Samples recorded so far (wraps at 2^32). */
+    public static final int HIST_SAMPLES     = 2;
+    /** Samples in the window. */
+    public static final int HIST_COUNT       = 3;
+    /** BTN_* bits that went down within the window. */
+    public static final int HIST_PRESSED     = 4;
+    /** BTN_* bits that went up within the window. */
+    public static final int HIST_RELEASED    = 5;
+    /** Right wheel deltas summed over the window. */
+    public static final int HIST_WHEEL_DELTA = 6;
+    /** Mean * 256 per axis: {@code out[HIST_MEAN_Q8 + HIST_AXIS_*]}. */
+    public static final int HIST_MEAN_Q8     = 7;
+    /** (newest - oldest) / span per axis, units per second. */
+    public static final int HIST_VELOCITY    = 13;
+    public static final int HIST_MIN         = 19;
+    public static final int HIST_MAX         = 25;
+
+    /* Axis offsets within the HIST_MEAN_Q8 / VELOCITY / MIN / MAX blocks */
+    public static final int HIST_AXIS_STICK_RIGHT_H = 0;
+    public static final int HIST_AXIS_STICK_RIGHT_V = 1;
+    public static final int HIST_AXIS_STICK_LEFT_H  = 2;
+    public static final int HIST_AXIS_STICK_LEFT_V  = 3;
+    public static final int HIST_AXIS_LEFT_WHEEL    = 4;
+    public static final int HIST_AXIS_RIGHT_WHEEL   = 5;
+
+    /**
+     * Keep a native history of every RC push (repeats included) over a
+     * sliding window, with mean, velocity, min/max and button edges kept
+     * up to date per sample, so {@link #queryHistory} is O(1) regardless of
+     * the window length. Call before {@link #startUsbReader} or
+     * {@link #startEvdevReader}; once per instance, freed by {@link #destroy}.
+     *
+     * @param capacity Samples kept, rounded up to a power of two in [16, 65536]
+     * @param windowMs Window length, 0 = just the last {@code capacity} samples
+     * @return false if not initialized, already enabled, a reader is running
+     *         or on allocation failure
+     */
+    public boolean enableHistory(int capacity, int windowMs) {
+        long h = handle;
+        if (h == 0) return false;
+        return nativeEnableHistory(h, capacity, windowMs);
+    }
+
+    /**
+     * Read the window statistics as of the newest sample, from any thread.
+     * @param out At least HIST_LEN longs, indexed by the HIST_* constants
+     * @return false without a history or before the first sample
+     */
+    public boolean queryHistory(long[] out) {
+        long h = handle;
+        if (h == 0) return false;
+        return nativeQueryHistory(h, out);
+    }
+
+    /**
+     * Which of {@code buttons} (BTN_* bits) were pressed within the last
+     * {@code frames} RC pushes (1 = only the newest), e.g. for double-press
+     * detection. Independent of the window.
+     * @return Matching BTN_* bits, 0 without a history
+     */
+    public int historyPressedWithin(int buttons, int frames) {
+        long h = handle;
+        if (h == 0) return 0;
+        return nativeHistoryPressedWithin(h, buttons, frames);
     }
 
     /**
      * Feed a raw 17-byte RC push payload directly (no DUML framing).
      * Use this if you extract the payload from the DJI SDK's push data callback.
+     * The payload goes through the parser like a framed push: change
+     * detection, coalesced dispatch, {@link #snapshot}, statistics and the
+     * history all see it.
      * @param payload Raw 17-byte payload
      * @param length Must be >= 17
-     * @return 1 if decoded, 0 otherwise
+     * @return 1 if delivered, 0 if suppressed by change detection or too short
      */
     public int feedDirect(byte[] payload, int length) {
-        if (!initialized) return 0;
-        return nativeFeedDirect(payload, length);
+        long h = handle;
+        if (h == 0) return 0;
+        return nativeFeedDirect(h, payload, length);
+    }
+
+    /**
+     * {@link #feedDirect(byte[], int)} for a payload in a direct ByteBuffer.
+     * @return 1 if delivered, 0 if suppressed by change detection or too short
+     * @throws IllegalArgumentException if {@code buffer} is not direct
+     */
+    public int feedDirect(ByteBuffer buffer, int offset, int length) {
+        if (!buffer.isDirect())
+            throw new IllegalArgumentException("feedDirect(ByteBuffer) needs a direct buffer");
+        long h = handle;
+        if (h == 0) return 0;
+        return nativeFeedDirectBuffer(h, buffer, offset, length);
+    }
+
+    /* --- Native USB reader --- */
+
+    /**
+     * Hand this instance to a native reader thread that drives the bulk
+     * endpoints through usbdevfs, keeping several IN transfers queued and
+     * feeding each one as it completes. Until {@link #stopUsbReader()} the
+     * caller must not feed or reset this instance; listener callbacks (and
+     * state ring notifies) arrive on the native thread.
+     * @param fd From {@code UsbDeviceConnection.getFileDescriptor()}, with the
+     *           interface already claimed
+     * @param epIn Bulk IN endpoint address ({@code UsbEndpoint.getAddress()})
+     * @param epOut Bulk OUT endpoint address, or 0 for a read-only stream
+     * @param sendEnable Send the DUML enable command when the loop starts
+     * @param pushTimeoutMs Poll with channel requests after this long
+     *                      without an RC push (0 = never; needs epOut)
+     * @param pollIntervalMs Interval between channel requests while polling,
+     *                       and the response timeout of each request
+     * @return false if the reader could not start (the caller keeps the parser)
+     */
+    public boolean startUsbReader(int fd, int epIn, int epOut, boolean sendEnable,
+                                  int pushTimeoutMs, int pollIntervalMs) {
+        return startUsbReader(fd, epIn, epOut, sendEnable, pushTimeoutMs, pollIntervalMs, 0);
+    }
+
+    /**
+     * As {@link #startUsbReader(int, int, int, boolean, int, int)}, with
+     * pipelined polling: while polling, up to {@code pollInFlight} channel
+     * requests stay outstanding and each response releases the next one,
+     * paced by the measured round trip instead of {@code pollIntervalMs}.
+     * @param pollInFlight Requests in flight (1-32), 0 = fixed interval
+     */
+    public boolean startUsbReader(int fd, int epIn, int epOut, boolean sendEnable,
+                                  int pushTimeoutMs, int pollIntervalMs, int pollInFlight) {
+        long h = handle;
+        if (h == 0) return false;
+        return nativeStartUsbReader(h, fd, epIn, epOut, sendEnable, pushTimeoutMs,
+                                    pollIntervalMs, pollInFlight);
+    }
+
+    /**
+     * True while the native reader loop is running; false once it stopped
+     * on its own (device detached) or was never started.
+     */
+    public boolean isUsbReaderRunning() {
+        long h = handle;
+        return h != 0 && nativeUsbReaderRunning(h);
+    }
+
+    /**
+     * Queue a DUML command on the native reader's bulk OUT endpoint.
+     * @return true if queued
+     */
+    public boolean usbSend(byte[] data) {
+        long h = handle;
+        return h != 0 && nativeUsbSend(h, data) == 0;
+    }
+
+    /**
+     * Stop the native reader, cancel its transfers and join its thread.
+     * Call before releasing the interface or closing the connection.
+     */
+    public void stopUsbReader() {
+        long h = handle;
+        if (h != 0) nativeStopUsbReader(h);
+    }
+
+    /* --- Native evdev reader --- */
+
+    /**
+     * Hand this instance to a native reader thread that epolls an input
+     * event device, reads many events per syscall, and delivers one state per
+     * SYN_REPORT without crossing JNI for the input. Same ownership rules as
+     * {@link #startUsbReader}.
+     * @param fd Readable /dev/input/event* fd (e.g. from ParcelFileDescriptor)
+     * @param absCodes ABS code for right H, right V, left V, left H (-1 =
+     *                 unmapped), or null for ABS_X, ABS_Y, ABS_Z, ABS_RZ
+     * @param scale Raw value multiplier into the ±660 range, 0 = 660/32768
+     * @return false if the reader could not start
+     */
+    public boolean startEvdevReader(int fd, int[] absCodes, float scale) {
+        long h = handle;
+        if (h == 0) return false;
+        return nativeStartEvdevReader(h, fd, absCodes, scale);
+    }
+
+    /** True while the native evdev reader loop is running. */
+    public boolean isEvdevReaderRunning() {
+        long h = handle;
+        return h != 0 && nativeEvdevReaderRunning(h);
+    }
+
+    /** Stop the native evdev reader and join its thread. Does not close the fd. */
+    public void stopEvdevReader() {
+        long h = handle;
+        if (h != 0) nativeStopEvdevReader(h);
+    }
+
+    /* --- Shared native stream loop --- */
+
+    /**
+     * Connect to a Unix domain socket and feed it from the process-wide
+     * native ingestion thread, which epolls every attached stream: no Java
+     * thread or copy per source. Same ownership rules as
+     * {@link #startUsbReader}; callbacks run on the ingestion thread.
+     * @param socketPath Filesystem path, or "@name" for the abstract namespace
+     * @return false if the connect or attach failed
+     */
+    public boolean attachStream(String socketPath) {
+        long h = handle;
+        return h != 0 && nativeAttachStream(h, socketPath);
+    }
+
+    /** True while attached and the peer has not closed the stream. */
+    public boolean isStreamAlive() {
+        long h = handle;
+        return h != 0 && nativeStreamAlive(h);
+    }
+
+    /** Detach from the ingestion thread and close the socket. */
+    public void detachStream() {
+        long h = handle;
+        if (h != 0) nativeDetachStream(h);
+    }
+
+    /* --- Capture recording --- */
+
+    /** Chunk source tags in capture files (see rc_monitor_capture.h). */
+    public static final int CAPTURE_SRC_UNKNOWN = 0;
+    public static final int CAPTURE_SRC_USB     = 1;
+    public static final int CAPTURE_SRC_STREAM  = 2;
+
+    /**
+     * Record everything this instance ingests into a timestamped, indexed
+     * capture file that {@code verify_recording} and the capture reader
+     * replay with the original timing: bytes passed to {@link #feed}, the
+     * native USB reader's IN transfers and OUT commands, and an attached
+     * stream. Replaces a capture that is already open.
+     * @param path File to create (truncated if it exists)
+     * @param indexIntervalMs Spacing of the time index, 0 = 100 ms
+     * @param source CAPTURE_SRC_* tag for chunks fed from Java
+     * @return false if the file could not be created
+     */
+    public boolean startCapture(String path, int indexIntervalMs, int source) {
+        long h = handle;
+        return h != 0 && nativeStartCapture(h, path, indexIntervalMs, source);
+    }
+
+    /** {@link #startCapture(String, int, int)} with defaults. */
+    public boolean startCapture(String path) {
+        return startCapture(path, 0, CAPTURE_SRC_UNKNOWN);
+    }
+
+    /** Write the index and close the capture file. Safe while feeding. */
+    public void stopCapture() {
+        long h = handle;
+        if (h != 0) nativeStopCapture(h);
     }
 
     /**
      * Reset parser state. Call after USB disconnect/reconnect.
      */
     public void reset() {
-        if (initialized) nativeReset();
+        long h = handle;
+        if (h != 0) nativeReset(h);
     }
 
     /**
-     * Release all native resources. Must be called when done.
+     * Release all native resources. Must be called when done, and not while
+     * another thread is still feeding or polling this instance.
      */
     public void destroy() {
-        if (initialized) {
-            nativeDestroy();
-            initialized = false;
+        long h = handle;
+        if (h != 0) {
+            handle = 0;
+            nativeDestroy(h);
         }
     }
 
@@ -199,14 +1105,66 @@ public class RcMonitor {
         return nativeBuildChannelRequest(seq);
     }
 
+    /**
+     * Build several commands into one array, to go out in a single bulk
+     * OUT transfer: the enable command if {@code enable}, then
+     * {@code channelRequests} channel requests, numbered {@code seq},
+     * {@code seq + 1}, ... in that order.
+     * @return Ready-to-send bytes, or null if empty or larger than one transfer
+     */
+    public static byte[] buildCommands(int seq, boolean enable, int channelRequests) {
+        return nativeBuildCommands(seq, enable, channelRequests);
+    }
+
     /* --- Native methods --- */
-    private native boolean nativeInit(RcStateListener listener);
-    private native int nativeFeed(byte[] data, int length);
-    private native int nativeFeedDirect(byte[] payload, int length);
-    private native void nativeReset();
-    private native void nativeDestroy();
+    private static native long nativeInit(RcStateListener listener);
+    private static native int nativeFeed(long handle, byte[] data, int length);
+    private static native int nativeFeedBuffer(long handle, ByteBuffer buffer, int offset, int length);
+    private static native int nativeFeedBatch(long handle, byte[] data, int length, int[] out);
+    private static native boolean nativeSetChangeDetect(long handle, boolean enable, int deadband);
+    private static native boolean nativeSetLayoutLock(long handle, int confirmFrames, int missLimit);
+    private static native boolean nativeSetTracing(long handle, boolean enable);
+    private static native void nativeSetCoalesce(long handle, boolean enable);
+    private static native int nativeDispatchCoalesced(long handle);
+    private static native boolean nativeStartCoalesceTimer(long handle, int periodUs);
+    private static native void nativeStopCoalesceTimer(long handle);
+    private static native void nativeTrackArrivals(long handle, int stallFactor, long minStallNs, long maxStallNs);
+    private static native boolean nativeGetArrivals(long handle, long[] out);
+    private static native void nativeMuteUntil(long handle, long untilNs, long watched);
+    private static native void nativeTraceRead(long handle, long tNs);
+    private static native long nativeSnapshot(long handle, int[] out);
+    private static native int nativeGetStats(long handle, long[] out, long[] cmdSetFrames, long[] feedHist);
+    private static native void nativeResetStats(long handle);
+    private static native boolean nativeEnableHistory(long handle, int capacity, int windowMs);
+    private static native boolean nativeQueryHistory(long handle, long[] out);
+    private static native int nativeHistoryPressedWithin(long handle, int buttons, int frames);
+    private static native int nativeFeedDirect(long handle, byte[] payload, int length);
+    private static native int nativeFeedDirectBuffer(long handle, ByteBuffer buffer, int offset, int length);
+    private static native ByteBuffer nativeEnableStateRing(long handle, int capacity, StateRingListener notify);
+    private static native long nativeRingWritten(long handle);
+    private static native long nativeRingClaimed(long handle);
+    private static native int nativeStartSharedPublisher(long handle, String name, int capacity);
+    private static native boolean nativeStartUsbReader(long handle, int fd, int epIn, int epOut,
+                                                       boolean sendEnable, int pushTimeoutMs,
+                                                       int pollIntervalMs, int pollInFlight);
+    private static native void nativeStopUsbReader(long handle);
+    private static native boolean nativeUsbReaderRunning(long handle);
+    private static native int nativeUsbSend(long handle, byte[] data);
+    private static native boolean nativeStartEvdevReader(long handle, int fd, int[] absCodes,
+                                                         float scale);
+    private static native void nativeStopEvdevReader(long handle);
+    private static native boolean nativeEvdevReaderRunning(long handle);
+    private static native boolean nativeAttachStream(long handle, String socketPath);
+    private static native void nativeDetachStream(long handle);
+    private static native boolean nativeStreamAlive(long handle);
+    private static native boolean nativeStartCapture(long handle, String path, int indexIntervalMs,
+                                                     int source);
+    private static native void nativeStopCapture(long handle);
+    private static native void nativeReset(long handle);
+    private static native void nativeDestroy(long handle);
     private static native byte[] nativeBuildEnableCmd(int seq);
     private static native byte[] nativeBuildChannelRequest(int seq);
+    private static native byte[] nativeBuildCommands(int seq, boolean enable, int channelRequests);
 
     /* --- DJI USB constants --- */
     public static final int DJI_USB_VID = 0x2CA3;
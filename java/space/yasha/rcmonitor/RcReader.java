@@ -28,4 +28,10 @@ public interface RcReader {
      * on the main thread in tight loops.
      */
     boolean isAvailable();
+
+    /**
+     * The RcMonitor this reader feeds (initialized by {@link #start}). Used
+     * by {@link RcReaderChain} to mute and score warm standbys natively.
+     */
+    RcMonitor getMonitor();
 }
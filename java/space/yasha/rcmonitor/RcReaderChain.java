@@ -7,6 +7,7 @@ import java.util.Arrays;
 import java.util.HashMap;
 import java.util.List;
 import java.util.Map;
+import java.util.concurrent.CopyOnWriteArrayList;
 
 /**
  * Tries readers in priority order and activates the first one that starts.
@@ -22,13 +23,41 @@ import java.util.Map;
  *   // ...
  *   chain.stop();
  * </pre>
+ *
+ * With {@link #startHotStandby} every available reader is started and kept
+ * warm; only the active one's states reach the listener, and the chain
+ * fails over to a standby once the active source stalls. Standbys are
+ * muted natively ({@link RcMonitor#muteUntilStalled}), so their pushes
+ * are parsed and timestamped but cost no JNI upcall until they are needed.
  */
 public class RcReaderChain {
     private static final String TAG = "RcReaderChain";
 
+    /* Stall threshold = STALL_FACTOR x the source's mean push interval,
+     * clamped to [MIN_STALL_MS, stallTimeoutMs] */
+    private static final int STALL_FACTOR = 3;
+    private static final int MIN_STALL_MS = 10;
+    private static final long MIN_STALL_NS = MIN_STALL_MS * 1_000_000L;
+    private static final int DEFAULT_STALL_TIMEOUT_MS = 80;
+    /* A higher-priority source must deliver steadily this long to win back */
+    private static final int DEFAULT_FAILBACK_MS = 500;
+
+    /** Notified on the reader thread that triggered a hot-standby switch. */
+    public interface SwitchListener {
+        /** @param from Reader that stalled or was outranked */
+        void onSwitch(RcReader from, RcReader to);
+    }
+
     private final List<RcReader> readers;
     private RcReader active;
 
+    /* Iterated by reader threads on every active push */
+    private final List<Source> sources = new CopyOnWriteArrayList<>();
+    private volatile Source activeSource;
+    private volatile SwitchListener switchListener;
+    private volatile long stallTimeoutNs = DEFAULT_STALL_TIMEOUT_MS * 1_000_000L;
+    private volatile long failbackNs = DEFAULT_FAILBACK_MS * 1_000_000L;
+
     public RcReaderChain(RcReader... readers) {
         this.readers = new ArrayList<>(Arrays.asList(readers));
     }
@@ -38,10 +67,7 @@ public class RcReaderChain {
      * @return the active reader, or null if none could start
      */
     public RcReader start(RcMonitor.RcStateListener listener) {
-        if (active != null) {
-            active.stop();
-            active = null;
-        }
+        stop();
         for (RcReader reader : readers) {
             String name = reader.getName();
             if (!reader.isAvailable()) {
@@ -60,32 +86,211 @@ public class RcReaderChain {
         return null;
     }
 
-    /** Stop the active reader. */
+    /**
+     * Start every available reader and keep the secondaries warm: they stay
+     * connected and parsing, and each push is timestamped natively, but a
+     * standby's listener upcall is muted while the active source delivers
+     * (each active push moves the standbys' mute deadline to the moment
+     * the active source would count as stalled). The first standby push
+     * after that deadline reaches Java, takes over and is delivered.
+     *
+     * <p>Failover bound: the listener goes without a state for at most the
+     * active source's stall threshold (3x its mean push interval, clamped to
+     * 10 ms..{@link #setStallTimeoutMs}) plus one standby push interval,
+     * e.g. 3 x 7 ms + 7 ms = 28 ms for two 140 Hz sources. It is not one
+     * push interval: a gap shorter than the threshold is not a stall.
+     *
+     * <p>A higher-priority source that delivers steadily for the failback
+     * period wins back (checked on each push of the active source); until
+     * the first active source has delivered anything, any standby that does
+     * is used. The listener may be called from a different reader thread
+     * after each switch.
+     *
+     * @return the initially active reader (highest priority that started),
+     *         or null if none could start
+     */
+    public RcReader startHotStandby(RcMonitor.RcStateListener listener) {
+        stop();
+        for (int i = 0; i < readers.size(); i++) {
+            RcReader reader = readers.get(i);
+            String name = reader.getName();
+            if (!reader.isAvailable()) {
+                Log.d(TAG, name + ": not available, skipping");
+                continue;
+            }
+            Source src = new Source(reader, i, listener);
+            if (!reader.start(src)) {
+                Log.w(TAG, name + ": start failed");
+                continue;
+            }
+            src.monitor.trackArrivals(STALL_FACTOR, MIN_STALL_NS, stallTimeoutNs);
+            sources.add(src);
+            if (activeSource == null) {
+                activeSource = src;
+                active = reader;
+                Log.i(TAG, name + ": started, active");
+            } else {
+                src.monitor.muteUntilStalled(activeSource.monitor);
+                Log.i(TAG, name + ": started, standby");
+            }
+        }
+        if (active == null) Log.e(TAG, "No reader could start");
+        return active;
+    }
+
+    /** Stop the active reader, and every standby in hot-standby mode. */
     public void stop() {
-        if (active != null) {
+        if (!sources.isEmpty()) {
+            activeSource = null;
+            for (Source src : sources) src.reader.stop();
+            sources.clear();
+        } else if (active != null) {
             active.stop();
-            active = null;
         }
+        active = null;
     }
 
     /** Get the currently active reader, or null. */
     public RcReader getActive() {
-        return active;
+        Source src = activeSource;
+        return src != null ? src.reader : active;
+    }
+
+    /** Called after each hot-standby switch; null to clear. */
+    public void setSwitchListener(SwitchListener l) {
+        switchListener = l;
+    }
+
+    /** Upper bound on the stall threshold (default 80 ms), from the next {@link #startHotStandby}. */
+    public void setStallTimeoutMs(int ms) {
+        stallTimeoutNs = Math.max(ms, MIN_STALL_MS) * 1_000_000L;
+    }
+
+    /** How long a higher-priority source must run before it wins back (default 500 ms). */
+    public void setFailbackMs(int ms) {
+        failbackNs = Math.max(ms, 0) * 1_000_000L;
     }
 
     /**
      * Get status of all readers.
-     * Each entry contains: "name", "available", "active".
+     * Each entry contains: "name", "available", "active"; in hot-standby
+     * mode also "standby", "packets", "intervalMs" (mean push interval)
+     * and "ageMs" (since the last push, -1 if none yet).
      */
     public List<Map<String, Object>> status() {
         List<Map<String, Object>> result = new ArrayList<>();
+        RcReader current = getActive();
+        long now = System.nanoTime();
         for (RcReader reader : readers) {
             Map<String, Object> entry = new HashMap<>();
             entry.put("name", reader.getName());
             entry.put("available", reader.isAvailable());
-            entry.put("active", reader == active && reader.isRunning());
+            entry.put("active", reader == current && reader.isRunning());
+            for (Source src : sources) {
+                if (src.reader != reader) continue;
+                long[] a = new long[RcMonitor.ARRIVAL_LEN];
+                src.monitor.getArrivals(a);
+                long packets = a[RcMonitor.ARRIVAL_COUNT];
+                entry.put("standby", reader != current && reader.isRunning());
+                entry.put("packets", packets);
+                entry.put("intervalMs", a[RcMonitor.ARRIVAL_INTERVAL_NS] / 1e6);
+                entry.put("ageMs", packets == 0 ? -1.0 : (now - a[RcMonitor.ARRIVAL_LAST_NS]) / 1e6);
+            }
             result.add(entry);
         }
         return result;
     }
+
+    /**
+     * Per-reader listener in hot-standby mode. Arrivals are scored natively
+     * by the reader's RcMonitor; this only sees the pushes that were not
+     * muted.
+     */
+    private final class Source implements RcMonitor.RcStateListener {
+        final RcReader reader;
+        final RcMonitor monitor;
+        final int priority;              /* index in readers, lower wins */
+        final RcMonitor.RcStateListener out;
+        private final long[] arrivals = new long[RcMonitor.ARRIVAL_LEN];
+
+        Source(RcReader reader, int priority, RcMonitor.RcStateListener out) {
+            this.reader = reader;
+            this.monitor = reader.getMonitor();
+            this.priority = priority;
+            this.out = out;
+        }
+
+        /** Stalled: not running, nothing yet, or quiet past its threshold. */
+        synchronized boolean stalled(long now) {
+            if (!reader.isRunning() || !monitor.getArrivals(arrivals)) return true;
+            return arrivals[RcMonitor.ARRIVAL_COUNT] == 0 ||
+                   now - arrivals[RcMonitor.ARRIVAL_LAST_NS] > arrivals[RcMonitor.ARRIVAL_STALL_NS];
+        }
+
+        /** Delivering without a stall for at least {@code ns}. */
+        synchronized boolean steadyFor(long now, long ns) {
+            if (!reader.isRunning() || !monitor.getArrivals(arrivals)) return false;
+            return arrivals[RcMonitor.ARRIVAL_COUNT] != 0 &&
+                   now - arrivals[RcMonitor.ARRIVAL_LAST_NS] <= arrivals[RcMonitor.ARRIVAL_STALL_NS] &&
+                   now - arrivals[RcMonitor.ARRIVAL_RUN_NS] >= ns;
+        }
+
+        @Override
+        public void onRcState(
+                boolean pause, boolean gohome, boolean shutter, boolean record,
+                boolean custom1, boolean custom2, boolean custom3,
+                boolean fiveDUp, boolean fiveDDown, boolean fiveDLeft,
+                boolean fiveDRight, boolean fiveDCenter,
+                int flightMode,
+                int stickRightH, int stickRightV,
+                int stickLeftH, int stickLeftV,
+                int leftWheel, int rightWheel, int rightWheelDelta) {
+            long now = System.nanoTime();
+            if (activeSource != this && !takeOver(activeSource, this, now, true))
+                return; /* woke early, or another standby won the race */
+            out.onRcState(pause, gohome, shutter, record,
+                    custom1, custom2, custom3,
+                    fiveDUp, fiveDDown, fiveDLeft, fiveDRight, fiveDCenter,
+                    flightMode, stickRightH, stickRightV, stickLeftH, stickLeftV,
+                    leftWheel, rightWheel, rightWheelDelta);
+            afterActivePush(now);
+        }
+
+        /**
+         * Push every standby's mute deadline to when this source would
+         * stall, then let a steady higher-priority standby win back.
+         */
+        private void afterActivePush(long now) {
+            Source better = null;
+            for (Source src : sources) {
+                if (src == this) continue;
+                src.monitor.muteUntilStalled(monitor);
+                if (better == null && src.priority < priority && src.steadyFor(now, failbackNs))
+                    better = src;
+            }
+            if (better != null) takeOver(this, better, now, false);
+        }
+    }
+
+    /**
+     * Make {@code next} the active source in place of {@code cur}: on a
+     * failover if {@code cur} stalled, otherwise as a failback.
+     * @return Whether {@code next} is active afterwards
+     */
+    private boolean takeOver(Source cur, Source next, long now, boolean failover) {
+        if (cur == null) return false; /* chain stopped */
+        if (failover && !cur.stalled(now)) return false;
+
+        synchronized (this) {
+            if (activeSource != cur) return activeSource == next;
+            activeSource = next;
+        }
+        next.monitor.setMuted(false);
+        cur.monitor.muteUntilStalled(next.monitor);
+        Log.i(TAG, (failover ? "Failover " : "Failback ") + cur.reader.getName() +
+                   " -> " + next.reader.getName());
+        SwitchListener l = switchListener;
+        if (l != null) l.onSwitch(cur.reader, next.reader);
+        return true;
+    }
 }
@@ -0,0 +1,153 @@
+package space.yasha.rcmonitor;
+
+import android.os.ParcelFileDescriptor;
+
+import java.io.Closeable;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Read-only view of another process's {@link RcMonitor#startSharedPublisher}
+ * ring. States are decoded straight out of the shared mapping, so polling
+ * allocates nothing and makes one native call per side of the copy.
+ *
+ * <pre>
+ *   SharedStateRing ring = SharedStateRing.open(pfdFromPublisher);
+ *   RcMonitor.RcState[] states = ...;   // preallocated
+ *   while (ring.await(1000) >= 0) {
+ *       int n = ring.read(states);
+ *       // ...
+ *   }
+ *   ring.close();
+ * </pre>
+ *
+ * The publisher overwrites the oldest states when this consumer falls
+ * behind; {@link #lost()} counts them. Use from one consumer thread.
+ */
+public final class SharedStateRing implements Closeable {
+
+    static {
+        System.loadLibrary("rc_monitor");
+    }
+
+    private static final int HDR_LEN = 64;   /* RCM_SHM_HEADER_LEN */
+    private static final int ENTRY_LEN = 16; /* rcm_packed_state_t */
+
+    private long handle;
+    private final ByteBuffer buf;
+    private final int capacity;
+    private long read;
+    private long lost;
+
+    private SharedStateRing(long handle) {
+        this.handle = handle;
+        this.buf = nativeBuffer(handle).asReadOnlyBuffer().order(ByteOrder.nativeOrder());
+        this.capacity = buf.getInt(8);
+        this.read = nativeWritten(handle);
+    }
+
+    /**
+     * Map the publisher's region. The descriptor can be closed afterwards.
+     * Reading starts with the states published from now on.
+     * @return The ring, or null if {@code pfd} is not such a region
+     */
+    public static SharedStateRing open(ParcelFileDescriptor pfd) {
+        if (pfd == null) return null;
+        long h = nativeOpen(pfd.getFd());
+        return h == 0 ? null : new SharedStateRing(h);
+    }
+
+    public int capacity() { return capacity; }
+
+    /** States that were overwritten before they could be read. */
+    public long lost() { return lost; }
+
+    /** Total states published so far. */
+    public long written() {
+        long h = handle;
+        return h == 0 ? read : nativeWritten(h);
+    }
+
+    /** True once the publisher's RcMonitor was destroyed (or after {@link #close}). */
+    public boolean isClosed() {
+        long h = handle;
+        return h == 0 || nativeClosed(h);
+    }
+
+    /**
+     * Copy unread states into {@code out}, oldest first, without
+     * allocating. States overwritten before or during the copy are skipped
+     * and counted as lost.
+     * @return Number of states written to out
+     */
+    public int read(RcMonitor.RcState[] out) {
+        long h = handle;
+        if (h == 0) return 0;
+        long written = nativeWritten(h);
+        if (written - read > capacity) {
+            lost += written - read - capacity;
+            read = written - capacity;
+        }
+        int n = (int)Math.min(written - read, out.length);
+        for (int i = 0; i < n; i++)
+            RcMonitor.StateRing.unpack(buf, HDR_LEN + (int)((read + i) & (capacity - 1)) * ENTRY_LEN, out[i]);
+
+        long claimed = nativeClaimed(h);
+        int bad = (int)Math.max(0, Math.min(n, claimed - capacity - read));
+        for (int i = bad; i < n; i++) {
+            RcMonitor.RcState t = out[i - bad];
+            out[i - bad] = out[i];
+            out[i] = t;
+        }
+        lost += bad;
+        read += n;
+        return n - bad;
+    }
+
+    /**
+     * Decode the most recent state into {@code out}, skipping anything
+     * unread (not counted as lost).
+     * @return false if nothing has been published yet
+     */
+    public boolean latest(RcMonitor.RcState out) {
+        long h = handle;
+        if (h == 0) return false;
+        for (;;) {
+            long written = nativeWritten(h);
+            if (written == 0) return false;
+            RcMonitor.StateRing.unpack(buf, HDR_LEN + (int)((written - 1) & (capacity - 1)) * ENTRY_LEN, out);
+            if (nativeClaimed(h) - (written - 1) <= capacity) {
+                if (written > read) read = written;
+                return true;
+            }
+        }
+    }
+
+    /**
+     * Block until there are unread states (futex wait in the shared
+     * region, no polling).
+     * @param timeoutMs Maximum wait, negative = forever
+     * @return 1 with unread states, 0 on timeout, -1 once the publisher
+     *         has closed the ring and everything was read
+     */
+    public int await(int timeoutMs) {
+        long h = handle;
+        return h == 0 ? -1 : nativeWait(h, read, timeoutMs);
+    }
+
+    /** Unmap the region. The ring must not be used afterwards. */
+    @Override
+    public void close() {
+        long h = handle;
+        handle = 0;
+        if (h != 0) nativeClose(h);
+    }
+
+    private static native long nativeOpen(int fd);
+    private static native ByteBuffer nativeBuffer(long handle);
+    private static native long nativeWritten(long handle);
+    private static native long nativeClaimed(long handle);
+    private static native int nativeWait(long handle, long read, int timeoutMs);
+    private static native boolean nativeClosed(long handle);
+    private static native void nativeClose(long handle);
+}
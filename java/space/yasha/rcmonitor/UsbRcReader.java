@@ -17,8 +17,10 @@ import android.util.Log;
  * 1. Finds the Protocol interface (with both bulk IN and OUT endpoints)
  * 2. Configures CDC ACM line coding (115200 baud, 8N1) and control lines (DTR+RTS)
  * 3. Sends the DUML enable command to start push data streaming
- * 4. Reads incoming DUML frames and feeds them to the parser
- * 5. Falls back to polling with channel requests if no push data arrives
+ * 4. Reads incoming DUML frames and feeds them to the parser, on the native
+ *    usbdevfs reader when available and a Java {@link BulkIn} loop otherwise
+ * 5. Falls back to polling with channel requests if no push data arrives;
+ *    the native reader pipelines them, paced by the measured round trip
  *
  * Usage:
  * <pre>
@@ -45,8 +47,11 @@ public class UsbRcReader implements RcReader {
 
     /* Timeout for push data before falling back to polling (ms) */
     private static final int PUSH_TIMEOUT_MS = 2000;
-    /* Interval between poll requests when in polling mode (ms) */
+    /* Interval between poll requests when in polling mode (ms); the native
+     * reader also uses it as the response timeout of each request */
     private static final int POLL_INTERVAL_MS = 50;
+    /* Channel requests the native reader keeps in flight while polling */
+    private static final int POLL_IN_FLIGHT = 4;
 
     private final Context context;
     private final RcMonitor monitor;
@@ -215,49 +220,26 @@ public class UsbRcReader implements RcReader {
         final UsbInterface fIface = iface;
 
         readThread = new Thread(() -> {
-            byte[] buf = new byte[BUFFER_SIZE];
-            int seq = 1;
-            Log.d(TAG, "USB read loop started");
-
-            /* Send enable command to start push data streaming */
-            byte[] enableCmd = RcMonitor.buildEnableCommand(seq++);
-            if (enableCmd != null) {
-                int sent = fConn.bulkTransfer(fBulkOut, enableCmd, enableCmd.length, 1000);
-                if (sent >= 0) {
-                    Log.d(TAG, "Enable command sent (" + sent + " bytes)");
-                } else {
-                    Log.w(TAG, "Failed to send enable command");
-                }
-            }
-
-            boolean pushMode = true;
-            long lastDataTime = System.currentTimeMillis();
-            long lastPollTime = 0;
-
-            while (running) {
-                int n = fConn.bulkTransfer(fBulkIn, buf, buf.length, READ_TIMEOUT_MS);
-                if (n > 0) {
-                    monitor.feed(buf, n);
-                    lastDataTime = System.currentTimeMillis();
-                    pushMode = true;
-                } else {
-                    /* No data received - check if we should switch to polling */
-                    long now = System.currentTimeMillis();
-                    if (now - lastDataTime > PUSH_TIMEOUT_MS) {
-                        pushMode = false;
-                    }
-
-                    if (!pushMode && now - lastPollTime > POLL_INTERVAL_MS) {
-                        /* Send channel request to poll for data */
-                        byte[] pollCmd = RcMonitor.buildChannelRequest(seq++);
-                        if (pollCmd != null) {
-                            fConn.bulkTransfer(fBulkOut, pollCmd, pollCmd.length, 100);
-                        }
-                        lastPollTime = now;
+            /* Prefer the native usbdevfs reader: it keeps several IN
+             * transfers queued so the endpoint is never idle between reads */
+            if (monitor.startUsbReader(fConn.getFileDescriptor(),
+                    fBulkIn.getAddress(), fBulkOut.getAddress(), true,
+                    PUSH_TIMEOUT_MS, POLL_INTERVAL_MS, POLL_IN_FLIGHT)) {
+                Log.d(TAG, "Native USB read loop started");
+                while (running && monitor.isUsbReaderRunning()) {
+                    try {
+                        Thread.sleep(READ_TIMEOUT_MS);
+                    } catch (InterruptedException e) {
+                        break;
                     }
                 }
+                monitor.stopUsbReader();
+            } else {
+                Log.w(TAG, "Native USB reader unavailable, using Java read loop");
+                readLoop(fConn, fBulkIn, fBulkOut);
             }
 
+            running = false;
             monitor.destroy();
             fConn.releaseInterface(fIface);
             fConn.close();
@@ -269,6 +251,71 @@ public class UsbRcReader implements RcReader {
         return true;
     }
 
+    /**
+     * Java read loop, used when the native reader cannot be started.
+     * Runs until {@link #stop()} or a queue failure.
+     */
+    private void readLoop(UsbDeviceConnection conn, UsbEndpoint bulkIn, UsbEndpoint bulkOut) {
+        /* On API 26+ one direct buffer for the life of the loop: the IN
+         * request fills it and the parser reads it in place, with no copies */
+        BulkIn in = new BulkIn(conn, bulkIn, BUFFER_SIZE);
+        if (!in.open()) {
+            Log.e(TAG, "Failed to initialize bulk IN request");
+            return;
+        }
+        int seq = 1;
+        Log.d(TAG, "USB read loop started");
+
+        /* Enable push streaming and poll once, in one transfer, so a
+         * state arrives even if the RC only answers polls */
+        byte[] handshake = RcMonitor.buildCommands(seq, true, 1);
+        seq += 2;
+        if (handshake != null) {
+            int sent = conn.bulkTransfer(bulkOut, handshake, handshake.length, 1000);
+            if (sent >= 0) {
+                Log.d(TAG, "Enable command sent (" + sent + " bytes)");
+            } else {
+                Log.w(TAG, "Failed to send enable command");
+            }
+        }
+
+        boolean pushMode = true;
+        long lastDataTime = System.currentTimeMillis();
+        long lastPollTime = 0;
+
+        while (running) {
+            int n = in.read(READ_TIMEOUT_MS);
+            if (n < 0) {
+                Log.e(TAG, "Failed to queue bulk IN request");
+                break;
+            }
+
+            if (n > 0) {
+                monitor.traceRead();
+                in.feed(monitor, n);
+                lastDataTime = System.currentTimeMillis();
+                pushMode = true;
+            } else {
+                /* No data received - check if we should switch to polling */
+                long now = System.currentTimeMillis();
+                if (now - lastDataTime > PUSH_TIMEOUT_MS) {
+                    pushMode = false;
+                }
+
+                if (!pushMode && now - lastPollTime > POLL_INTERVAL_MS) {
+                    /* Send channel request to poll for data */
+                    byte[] pollCmd = RcMonitor.buildChannelRequest(seq++);
+                    if (pollCmd != null) {
+                        conn.bulkTransfer(bulkOut, pollCmd, pollCmd.length, 100);
+                    }
+                    lastPollTime = now;
+                }
+            }
+        }
+
+        in.close();
+    }
+
     /**
      * Stop reading and release USB resources.
      */
@@ -295,6 +342,11 @@ public class UsbRcReader implements RcReader {
         return "USB";
     }
 
+    @Override
+    public RcMonitor getMonitor() {
+        return monitor;
+    }
+
     @Override
     public boolean isAvailable() {
         return findDjiDevice() != null;
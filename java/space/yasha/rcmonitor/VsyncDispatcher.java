@@ -0,0 +1,57 @@
+package space.yasha.rcmonitor;
+
+import android.os.Handler;
+import android.os.Looper;
+import android.view.Choreographer;
+
+/**
+ * Delivers an RcMonitor's states once per display frame, on the main
+ * thread, through {@link RcMonitor#dispatchCoalesced()}.
+ *
+ * <pre>
+ *   VsyncDispatcher vsync = new VsyncDispatcher(monitor);
+ *   vsync.start();   // listener now runs once per vsync with new data
+ *   // ...
+ *   vsync.stop();    // back to one call per push
+ * </pre>
+ *
+ * Frames with no new push make no listener call. Button presses shorter
+ * than a frame are still reported (see {@link RcMonitor#setCoalescedDispatch}).
+ */
+public class VsyncDispatcher implements Choreographer.FrameCallback {
+    private final RcMonitor monitor;
+    private final Handler main = new Handler(Looper.getMainLooper());
+    private boolean running;   /* main thread only */
+
+    public VsyncDispatcher(RcMonitor monitor) {
+        this.monitor = monitor;
+    }
+
+    /** Start dispatching; may be called from any thread. */
+    public void start() {
+        main.post(() -> {
+            if (running) return;
+            running = true;
+            monitor.setCoalescedDispatch(true);
+            Choreographer.getInstance().postFrameCallback(this);
+        });
+    }
+
+    /** Stop, delivering anything still pending first; may be called from any thread. */
+    public void stop() {
+        main.post(() -> {
+            if (!running) return;
+            running = false;
+            Choreographer.getInstance().removeFrameCallback(this);
+            monitor.dispatchCoalesced();
+            monitor.setCoalescedDispatch(false);
+        });
+    }
+
+    @Override
+    public void doFrame(long frameTimeNanos) {
+        if (!running) return;
+        monitor.dispatchCoalesced();
+        Choreographer.getInstance().postFrameCallback(this);
+    }
+}
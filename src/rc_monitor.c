@@ -5,78 +5,26 @@
  * Reverse-engineered from libdjisdk_jni.so (DJI Mobile SDK V5 5.17.0).
  */
 
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+#endif
+
 #include "rc_monitor.h"
+#include "rc_monitor_internal.h"
+#include "rc_monitor_history.h"
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-/* ---------- CRC tables for DUML protocol ---------- */
-
-static const uint8_t crc8_table[256] = {
-    0x00,0x5e,0xbc,0xe2,0x61,0x3f,0xdd,0x83,0xc2,0x9c,0x7e,0x20,0xa3,0xfd,0x1f,0x41,
-    0x9d,0xc3,0x21,0x7f,0xfc,0xa2,0x40,0x1e,0x5f,0x01,0xe3,0xbd,0x3e,0x60,0x82,0xdc,
-    0x23,0x7d,0x9f,0xc1,0x42,0x1c,0xfe,0xa0,0xe1,0xbf,0x5d,0x03,0x80,0xde,0x3c,0x62,
-    0xbe,0xe0,0x02,0x5c,0xdf,0x81,0x63,0x3d,0x7c,0x22,0xc0,0x9e,0x1d,0x43,0xa1,0xff,
-    0x46,0x18,0xfa,0xa4,0x27,0x79,0x9b,0xc5,0x84,0xda,0x38,0x66,0xe5,0xbb,0x59,0x07,
-    0xdb,0x85,0x67,0x39,0xba,0xe4,0x06,0x58,0x19,0x47,0xa5,0xfb,0x78,0x26,0xc4,0x9a,
-    0x65,0x3b,0xd9,0x87,0x04,0x5a,0xb8,0xe6,0xa7,0xf9,0x1b,0x45,0xc6,0x98,0x7a,0x24,
-    0xf8,0xa6,0x44,0x1a,0x99,0xc7,0x25,0x7b,0x3a,0x64,0x86,0xd8,0x5b,0x05,0xe7,0xb9,
-    0x8c,0xd2,0x30,0x6e,0xed,0xb3,0x51,0x0f,0x4e,0x10,0xf2,0xac,0x2f,0x71,0x93,0xcd,
-    0x11,0x4f,0xad,0xf3,0x70,0x2e,0xcc,0x92,0xd3,0x8d,0x6f,0x31,0xb2,0xec,0x0e,0x50,
-    0xaf,0xf1,0x13,0x4d,0xce,0x90,0x72,0x2c,0x6d,0x33,0xd1,0x8f,0x0c,0x52,0xb0,0xee,
-    0x32,0x6c,0x8e,0xd0,0x53,0x0d,0xef,0xb1,0xf0,0xae,0x4c,0x12,0x91,0xcf,0x2d,0x73,
-    0xca,0x94,0x76,0x28,0xab,0xf5,0x17,0x49,0x08,0x56,0xb4,0xea,0x69,0x37,0xd5,0x8b,
-    0x57,0x09,0xeb,0xb5,0x36,0x68,0x8a,0xd4,0x95,0xcb,0x29,0x77,0xf4,0xaa,0x48,0x16,
-    0xe9,0xb7,0x55,0x0b,0x88,0xd6,0x34,0x6a,0x2b,0x75,0x97,0xc9,0x4a,0x14,0xf6,0xa8,
-    0x74,0x2a,0xc8,0x96,0x15,0x4b,0xa9,0xf7,0xb6,0xe8,0x0a,0x54,0xd7,0x89,0x6b,0x35
-};
-
-static const uint16_t crc16_table[256] = {
-    0x0000,0x1189,0x2312,0x329b,0x4624,0x57ad,0x6536,0x74bf,
-    0x8c48,0x9dc1,0xaf5a,0xbed3,0xca6c,0xdbe5,0xe97e,0xf8f7,
-    0x1081,0x0108,0x3393,0x221a,0x56a5,0x472c,0x75b7,0x643e,
-    0x9cc9,0x8d40,0xbfdb,0xae52,0xdaed,0xcb64,0xf9ff,0xe876,
-    0x2102,0x308b,0x0210,0x1399,0x6726,0x76af,0x4434,0x55bd,
-    0xad4a,0xbcc3,0x8e58,0x9fd1,0xeb6e,0xfae7,0xc87c,0xd9f5,
-    0x3183,0x200a,0x1291,0x0318,0x77a7,0x662e,0x54b5,0x453c,
-    0xbdcb,0xac42,0x9ed9,0x8f50,0xfbef,0xea66,0xd8fd,0xc974,
-    0x4204,0x538d,0x6116,0x709f,0x0420,0x15a9,0x2732,0x36bb,
-    0xce4c,0xdfc5,0xed5e,0xfcd7,0x8868,0x99e1,0xab7a,0xbaf3,
-    0x5285,0x430c,0x7197,0x601e,0x14a1,0x0528,0x37b3,0x263a,
-    0xdecd,0xcf44,0xfddf,0xec56,0x98e9,0x8960,0xbbfb,0xaa72,
-    0x6306,0x728f,0x4014,0x519d,0x2522,0x34ab,0x0630,0x17b9,
-    0xef4e,0xfec7,0xcc5c,0xddd5,0xa96a,0xb8e3,0x8a78,0x9bf1,
-    0x7387,0x620e,0x5095,0x411c,0x35a3,0x242a,0x16b1,0x0738,
-    0xffcf,0xee46,0xdcdd,0xcd54,0xb9eb,0xa862,0x9af9,0x8b70,
-    0x8408,0x9581,0xa71a,0xb693,0xc22c,0xd3a5,0xe13e,0xf0b7,
-    0x0840,0x19c9,0x2b52,0x3adb,0x4e64,0x5fed,0x6d76,0x7cff,
-    0x9489,0x8500,0xb79b,0xa612,0xd2ad,0xc324,0xf1bf,0xe036,
-    0x18c1,0x0948,0x3bd3,0x2a5a,0x5ee5,0x4f6c,0x7df7,0x6c7e,
-    0xa50a,0xb483,0x8618,0x9791,0xe32e,0xf2a7,0xc03c,0xd1b5,
-    0x2942,0x38cb,0x0a50,0x1bd9,0x6f66,0x7eef,0x4c74,0x5dfd,
-    0xb58b,0xa402,0x9699,0x8710,0xf3af,0xe226,0xd0bd,0xc134,
-    0x39c3,0x284a,0x1ad1,0x0b58,0x7fe7,0x6e6e,0x5cf5,0x4d7c,
-    0xc60c,0xd785,0xe51e,0xf497,0x8028,0x91a1,0xa33a,0xb2b3,
-    0x4a44,0x5bcd,0x6956,0x78df,0x0c60,0x1de9,0x2f72,0x3efb,
-    0xd68d,0xc704,0xf59f,0xe416,0x90a9,0x8120,0xb3bb,0xa232,
-    0x5ac5,0x4b4c,0x79d7,0x685e,0x1ce1,0x0d68,0x3ff3,0x2e7a,
-    0xe70e,0xf687,0xc41c,0xd595,0xa12a,0xb0a3,0x8238,0x93b1,
-    0x6b46,0x7acf,0x4854,0x59dd,0x2d62,0x3ceb,0x0e70,0x1ff9,
-    0xf78f,0xe606,0xd49d,0xc514,0xb1ab,0xa022,0x92b9,0x8330,
-    0x7bc7,0x6a4e,0x58d5,0x495c,0x3de3,0x2c6a,0x1ef1,0x0f78
-};
+/* ---------- CRC helpers (engine in rc_monitor_crc.c) ---------- */
 
-static uint8_t duml_crc8(const uint8_t *data, size_t len) {
-    uint8_t crc = 0x77; /* DUML CRC8 seed */
-    for (size_t i = 0; i < len; i++)
-        crc = crc8_table[(crc ^ data[i]) & 0xFF];
-    return crc;
+static inline uint8_t duml_crc8(const uint8_t *data, size_t len) {
+    return rcm_crc8_update(DUML_CRC8_SEED, data, len);
 }
 
-static uint16_t duml_crc16(const uint8_t *data, size_t len) {
-    uint16_t crc = 0x3692; /* DUML CRC16 seed */
-    for (size_t i = 0; i < len; i++)
-        crc = crc16_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
-    return crc;
+static inline uint16_t duml_crc16(const uint8_t *data, size_t len) {
+    return rcm_crc16_update(DUML_CRC16_SEED, data, len);
 }
 
 /* ---------- Payload parser ---------- */
@@ -139,207 +87,1066 @@ int rcm_parse_payload(const uint8_t *payload, size_t len, rc_state_t *out) {
     return 0;
 }
 
-/* ---------- DUML frame parser with ring buffer ---------- */
+int rcm_parse_payload_packed(const uint8_t *payload, size_t len,
+                             rcm_packed_state_t *out) {
+    if (!payload || !out || len < RC_PUSH_PAYLOAD_LEN)
+        return -1;
+
+    uint8_t b0 = payload[0];
+    uint8_t b1 = payload[1];
+    uint8_t b2 = payload[2];
+    uint8_t b4 = payload[4];
+
+    uint16_t f = 0;
+    f |= ((b0 >> 4) & 1) ? RCM_PK_PAUSE : 0;
+    f |= ((b0 >> 5) & 1) ? RCM_PK_GOHOME : 0;
+    f |= ((b0 >> 6) & 1) ? RCM_PK_SHUTTER : 0;
+    f |= ((b1 >> 0) & 1) ? RCM_PK_RECORD : 0;
+    f |= ((b2 >> 2) & 1) ? RCM_PK_CUSTOM1 : 0;
+    f |= ((b2 >> 3) & 1) ? RCM_PK_CUSTOM2 : 0;
+    f |= ((b2 >> 4) & 1) ? RCM_PK_CUSTOM3 : 0;
+    f |= ((b1 >> 3) & 1) ? RCM_PK_FIVE_D_RIGHT : 0;
+    f |= ((b1 >> 4) & 1) ? RCM_PK_FIVE_D_UP : 0;
+    f |= ((b1 >> 5) & 1) ? RCM_PK_FIVE_D_DOWN : 0;
+    f |= ((b1 >> 6) & 1) ? RCM_PK_FIVE_D_LEFT : 0;
+    f |= ((b1 >> 7) & 1) ? RCM_PK_FIVE_D_CENTER : 0;
+    f |= (uint16_t)((b2 & 0x03) << RCM_PK_MODE_SHIFT);
+    out->flags = f;
+
+    out->stick_right_h = (int16_t)(read_u16_le(payload + 5)  - 0x400);
+    out->stick_right_v = (int16_t)(read_u16_le(payload + 7)  - 0x400);
+    out->stick_left_v  = (int16_t)(read_u16_le(payload + 9)  - 0x400);
+    out->stick_left_h  = (int16_t)(read_u16_le(payload + 11) - 0x400);
+    out->left_wheel    = (int16_t)(read_u16_le(payload + 13) - 0x400);
+    out->right_wheel   = (int16_t)(read_u16_le(payload + 15) - 0x400);
+
+    /* Same sign convention as rcm_parse_payload() */
+    int mag  = (b4 >> 1) & 0x1F;
+    int sign = (b4 >> 6) & 1;
+    out->right_wheel_delta = (int8_t)(sign ? mag : -mag);
+    out->reserved = 0;
+    return 0;
+}
+
+void rcm_pack_state(const rc_state_t *in, rcm_packed_state_t *out) {
+    if (!in || !out) return;
+    uint16_t f = 0;
+    f |= in->pause         ? RCM_PK_PAUSE : 0;
+    f |= in->gohome        ? RCM_PK_GOHOME : 0;
+    f |= in->shutter       ? RCM_PK_SHUTTER : 0;
+    f |= in->record        ? RCM_PK_RECORD : 0;
+    f |= in->custom1       ? RCM_PK_CUSTOM1 : 0;
+    f |= in->custom2       ? RCM_PK_CUSTOM2 : 0;
+    f |= in->custom3       ? RCM_PK_CUSTOM3 : 0;
+    f |= in->five_d.up     ? RCM_PK_FIVE_D_UP : 0;
+    f |= in->five_d.down   ? RCM_PK_FIVE_D_DOWN : 0;
+    f |= in->five_d.left   ? RCM_PK_FIVE_D_LEFT : 0;
+    f |= in->five_d.right  ? RCM_PK_FIVE_D_RIGHT : 0;
+    f |= in->five_d.center ? RCM_PK_FIVE_D_CENTER : 0;
+    f |= (uint16_t)(((unsigned)in->flight_mode & 0x03) << RCM_PK_MODE_SHIFT);
+    out->flags = f;
+    out->stick_right_h     = in->stick_right.horizontal;
+    out->stick_right_v     = in->stick_right.vertical;
+    out->stick_left_h      = in->stick_left.horizontal;
+    out->stick_left_v      = in->stick_left.vertical;
+    out->left_wheel        = in->left_wheel;
+    out->right_wheel       = in->right_wheel;
+    out->right_wheel_delta = in->right_wheel_delta;
+    out->reserved          = 0;
+}
+
+void rcm_unpack_state(const rcm_packed_state_t *in, rc_state_t *out) {
+    if (!in || !out) return;
+    memset(out, 0, sizeof(*out));
+    uint16_t f = in->flags;
+    out->pause         = (f & RCM_PK_PAUSE) != 0;
+    out->gohome        = (f & RCM_PK_GOHOME) != 0;
+    out->shutter       = (f & RCM_PK_SHUTTER) != 0;
+    out->record        = (f & RCM_PK_RECORD) != 0;
+    out->custom1       = (f & RCM_PK_CUSTOM1) != 0;
+    out->custom2       = (f & RCM_PK_CUSTOM2) != 0;
+    out->custom3       = (f & RCM_PK_CUSTOM3) != 0;
+    out->five_d.up     = (f & RCM_PK_FIVE_D_UP) != 0;
+    out->five_d.down   = (f & RCM_PK_FIVE_D_DOWN) != 0;
+    out->five_d.left   = (f & RCM_PK_FIVE_D_LEFT) != 0;
+    out->five_d.right  = (f & RCM_PK_FIVE_D_RIGHT) != 0;
+    out->five_d.center = (f & RCM_PK_FIVE_D_CENTER) != 0;
+    out->flight_mode   = rcm_packed_flight_mode(in);
+    out->stick_right.horizontal = in->stick_right_h;
+    out->stick_right.vertical   = in->stick_right_v;
+    out->stick_left.horizontal  = in->stick_left_h;
+    out->stick_left.vertical    = in->stick_left_v;
+    out->left_wheel        = in->left_wheel;
+    out->right_wheel       = in->right_wheel;
+    out->right_wheel_delta = in->right_wheel_delta;
+}
+
+/* ---------- DUML frame parser ---------- */
+
+/* One (cmd_set, cmd_id) handler registration */
+typedef struct {
+    rcm_frame_handler_t fn;
+    void               *userdata;
+} handler_slot_t;
+
+/* One tracked request; sent_ns == 0 marks a free slot */
+typedef struct {
+    uint64_t sent_ns;
+    uint64_t deadline_ns;
+    uint16_t seq;
+    uint8_t  cmd_set;
+    uint8_t  cmd_id;
+} pending_req_t;
 
-#define RING_SIZE 4096
+/* Prefix-state ring size; must exceed DUML_MAX_FRAME_LEN (power of two) */
+#define PFX_WINDOW 2048
+#define PFX_MASK   (PFX_WINDOW - 1)
+
+/* cmd_set position in a v1 header (the locked offset for RCM_LAYOUT_V1) */
+#define DUML_V1_CMD_OFFSET 9
 
 struct rcm_parser {
     rcm_callback_t  callback;
     void           *userdata;
 
-    uint8_t  ring[RING_SIZE];
-    size_t   head;   /* write position */
-    size_t   count;  /* bytes in buffer */
+    /*
+     * Trace hook (rcm_set_trace_hook()). Atomic so it can be installed while
+     * another thread feeds: userdata is stored before the release store of
+     * trace_cb, and read after an acquire fence once trace_cb is non-NULL.
+     */
+    _Atomic(rcm_trace_callback_t) trace_cb;
+    _Atomic(void *)               trace_userdata;
+
+    /*
+     * Staging buffer for a frame candidate that straddles rcm_feed() calls.
+     * stage[stage_head..+stage_len) is either empty or an incomplete
+     * candidate starting at a SOF byte, so it never holds more than one
+     * maximum-length frame. Consuming from the head instead of memmove-ing
+     * keeps resync inside the stage linear; the buffer is compacted only
+     * once the head has moved past a whole frame's worth of bytes.
+     */
+    uint8_t  stage[2 * DUML_MAX_FRAME_LEN];
+    size_t   stage_head;
+    size_t   stage_len;
+
+    /* Stream offset of the next byte rcm_feed() will receive */
+    uint64_t stream_pos;
+
+    /*
+     * Resync state. Candidates starting before resync_end lie inside a frame
+     * that failed its CRC16; their CRC16 is computed from the prefix states
+     * pfx[] (CRC16 register before each stream offset in [pfx_lo, pfx_hi],
+     * from an arbitrary base) instead of rescanning the frame body.
+     */
+    uint64_t resync_end;
+    uint64_t pfx_lo, pfx_hi;
+    uint16_t pfx[PFX_WINDOW];
+
+    /*
+     * Handler table indexed [cmd_set][cmd_id]. The second level is allocated
+     * on first registration for a cmd_set, so a parser with only the RC push
+     * handler carries one 256-entry row.
+     */
+    handler_slot_t *handlers[256];
+    handler_slot_t  default_handler;
+
+    /* Outstanding requests, indexed by seq % RCM_MAX_PENDING */
+    pending_req_t           req[RCM_MAX_PENDING];
+    unsigned                req_count;
+    uint64_t                rtt_smoothed_ns;
+    rcm_response_callback_t resp_cb;
+    void                   *resp_userdata;
+
+    /*
+     * Change detection: last raw payload seen (for the cheap equality test)
+     * and last delivered state (for the deadband, so slow drift still fires).
+     */
+    bool                  change_detect;
+    bool                  have_last;
+    uint16_t              deadband;
+    rcm_change_callback_t change_cb;
+    uint8_t               last_raw[RC_PUSH_PAYLOAD_LEN];
+    rc_state_t            last_state;
+
+    /*
+     * Header layout lock-in. layout_off is the locked cmd_set offset (9 for
+     * v1, 8-12 for a v2/v3 variant) or 0 while scanning; cand_off/cand_n
+     * count consecutive pushes found at one offset while scanning.
+     */
+    uint8_t  layout_off;
+    uint8_t  layout_cand_off;
+    uint32_t layout_cand_n;
+    uint32_t layout_misses;
+    uint32_t layout_confirm;
+    uint32_t layout_miss_limit;
+
+    /* Output sink while inside rcm_feed_batch*(); at most one is non-NULL */
+    rcm_batch_entry_t  *batch;
+    rcm_packed_state_t *batch_packed;
+    size_t   batch_max;
+    size_t   batch_len;
+    uint64_t batch_base;  /* stream offset of the batch call's data[0] */
+    uint32_t push_seq;
+
+    /* Counters for rcm_get_stats(); last_push_age_ns and feed_hist_enabled
+     * are filled in on read */
+    rcm_stats_t stats;
+    uint64_t    last_push_ns;  /* CLOCK_MONOTONIC, 0 = no push yet */
+
+    rcm_priv_work_t work;
+
+    /*
+     * Latest-state seqlock. mb_seq is odd while a publish is in progress;
+     * the state is two words of rcm_packed_state_t so every access is a
+     * plain atomic load/store. Kept off the cache lines the feeding thread
+     * writes on every call so polling readers don't slow it down.
+     */
+    uint8_t          mb_pad[64];
+    _Atomic uint32_t mb_seq;
+    _Atomic uint32_t mb_count;
+    _Atomic uint64_t mb_word[2];
+
+    /*
+     * Coalescing (rcm_set_coalesce()): button bits pressed in any push and
+     * the summed wheel delta since the last rcm_take_coalesced(), which
+     * swaps them for zero. Updated before the mailbox publish of the same
+     * push, so a take that sees the publish also sees them. co_taken is
+     * the mb_count at the last take and belongs to the consumer.
+     */
+    _Atomic bool     co_enabled;
+    _Atomic uint32_t co_pressed;
+    _Atomic int32_t  co_wheel;
+    uint32_t         co_taken;
 
-    /* Frame assembly state */
-    enum { SCAN_SOF, READ_FRAME } state;
-    uint16_t frame_len;  /* expected frame length once header decoded */
+    /* Motion history (rcm_set_history()); fed every push, repeats included */
+    rcm_history_t *history;
 };
 
+static int rc_push_handler(const rcm_frame_view_t *v, void *userdata);
+
 rcm_parser_t *rcm_create(rcm_callback_t cb, void *userdata) {
     if (!cb) return NULL;
     rcm_parser_t *p = (rcm_parser_t *)calloc(1, sizeof(rcm_parser_t));
     if (!p) return NULL;
     p->callback = cb;
     p->userdata = userdata;
-    p->state = SCAN_SOF;
+    p->pfx_lo = 1; /* empty prefix window */
+    p->layout_confirm = RCM_LAYOUT_CONFIRM_DEFAULT;
+    p->layout_miss_limit = RCM_LAYOUT_MISS_DEFAULT;
+    if (rcm_register_handler(p, DUML_CMD_SET_RC, DUML_CMD_RC_PUSH,
+                             rc_push_handler, p) != 0) {
+        free(p);
+        return NULL;
+    }
     return p;
 }
 
 void rcm_destroy(rcm_parser_t *p) {
     if (!p) return;
+    for (int i = 0; i < 256; i++)
+        free(p->handlers[i]);
     free(p);
 }
 
+int rcm_register_handler(rcm_parser_t *p, uint8_t cmd_set, uint8_t cmd_id,
+                         rcm_frame_handler_t fn, void *userdata) {
+    if (!p) return -1;
+    handler_slot_t *row = p->handlers[cmd_set];
+    if (!row) {
+        if (!fn) return 0;
+        row = (handler_slot_t *)calloc(256, sizeof(handler_slot_t));
+        if (!row) return -1;
+        p->handlers[cmd_set] = row;
+    }
+    row[cmd_id].fn = fn;
+    row[cmd_id].userdata = fn ? userdata : NULL;
+    return 0;
+}
+
+void rcm_set_default_handler(rcm_parser_t *p, rcm_frame_handler_t fn,
+                             void *userdata) {
+    if (!p) return;
+    p->default_handler.fn = fn;
+    p->default_handler.userdata = fn ? userdata : NULL;
+}
+
 void rcm_reset(rcm_parser_t *p) {
     if (!p) return;
-    p->head = 0;
-    p->count = 0;
-    p->state = SCAN_SOF;
-    p->frame_len = 0;
+    /* stream_pos keeps counting, so the resync and prefix state (which only
+     * cover offsets already seen) can never match new data */
+    p->stats.bytes_discarded += p->stage_len;
+    p->stage_head = 0;
+    p->stage_len = 0;
+    p->have_last = false;
+    p->layout_off = 0;
+    p->layout_cand_n = 0;
+    p->layout_misses = 0;
+}
+
+void rcm_set_change_detect(rcm_parser_t *p, bool enable, uint16_t axis_deadband,
+                           rcm_change_callback_t cb) {
+    if (!p) return;
+    p->change_detect = enable;
+    p->deadband      = axis_deadband;
+    p->change_cb     = enable ? cb : NULL;
+    p->have_last     = false;
+}
+
+void rcm_set_layout_lock(rcm_parser_t *p, uint32_t confirm_frames, uint32_t miss_limit) {
+    if (!p) return;
+    p->layout_confirm    = confirm_frames;
+    p->layout_miss_limit = miss_limit;
+    p->layout_off        = 0;
+    p->layout_cand_n     = 0;
+    p->layout_misses     = 0;
+}
+
+/* CLOCK_MONOTONIC in nanoseconds, never 0 */
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec + 1;
+}
+
+/* Report a trace event; a single branch while no hook is installed */
+static inline void trace(rcm_parser_t *p, unsigned event, uint64_t t_ns, uint64_t arg) {
+    rcm_trace_callback_t fn = atomic_load_explicit(&p->trace_cb, memory_order_relaxed);
+    if (fn) {
+        atomic_thread_fence(memory_order_acquire);
+        fn(event, t_ns ? t_ns : monotonic_ns(), arg,
+           atomic_load_explicit(&p->trace_userdata, memory_order_relaxed));
+    }
+}
+
+void rcm_set_trace_hook(rcm_parser_t *p, rcm_trace_callback_t fn, void *userdata) {
+    if (!p) return;
+    if (fn)
+        atomic_store_explicit(&p->trace_userdata, userdata, memory_order_relaxed);
+    atomic_store_explicit(&p->trace_cb, fn, memory_order_release);
+}
+
+void rcm_trace_read(rcm_parser_t *p, uint64_t t_ns) {
+    if (p)
+        trace(p, RCM_TRACE_READ, t_ns, 0);
+}
+
+int rcm_get_stats(const rcm_parser_t *p, rcm_stats_t *out) {
+    if (!p || !out) return -1;
+    *out = p->stats;
+    out->last_push_age_ns = p->last_push_ns
+                          ? monotonic_ns() - p->last_push_ns : UINT64_MAX;
+    out->rtt_smoothed_ns = p->rtt_smoothed_ns;
+    out->layout = p->layout_off == 0 ? RCM_LAYOUT_NONE
+                : p->layout_off == DUML_V1_CMD_OFFSET ? RCM_LAYOUT_V1 : RCM_LAYOUT_ALT;
+    out->layout_cmd_offset = p->layout_off;
+#ifdef RCM_FEED_HISTOGRAM
+    out->feed_hist_enabled = true;
+#else
+    out->feed_hist_enabled = false;
+#endif
+    return 0;
+}
+
+void rcm_reset_stats(rcm_parser_t *p) {
+    if (!p) return;
+    memset(&p->stats, 0, sizeof(p->stats));
 }
 
-/* Read byte at logical position `idx` (0 = oldest byte in buffer) */
-static inline uint8_t ring_peek(const rcm_parser_t *p, size_t idx) {
-    size_t tail = (p->head + RING_SIZE - p->count) % RING_SIZE;
-    return p->ring[(tail + idx) % RING_SIZE];
+void rcm_priv_parser_work(const rcm_parser_t *p, rcm_priv_work_t *out) {
+    if (!p || !out) return;
+    *out = p->work;
 }
 
-/* Copy `n` bytes starting at logical position `idx` into `dst` */
-static void ring_copy(const rcm_parser_t *p, size_t idx, uint8_t *dst, size_t n) {
-    for (size_t i = 0; i < n; i++)
-        dst[i] = ring_peek(p, idx + i);
+/* ---------- Request tracking ---------- */
+
+void rcm_set_response_callback(rcm_parser_t *p, rcm_response_callback_t cb,
+                               void *userdata) {
+    if (!p) return;
+    p->resp_cb       = cb;
+    p->resp_userdata = userdata;
+}
+
+int rcm_track_request(rcm_parser_t *p, const uint8_t *frame, size_t len,
+                      uint32_t timeout_ms) {
+    if (!p || !frame || len < DUML_MIN_FRAME_LEN) return -1;
+    uint16_t seq = read_u16_le(frame + 6);
+    pending_req_t *r = &p->req[seq % RCM_MAX_PENDING];
+    if (r->sent_ns && r->seq != seq) return -1;
+
+    if (!r->sent_ns) p->req_count++;
+    r->sent_ns     = monotonic_ns();
+    r->deadline_ns = r->sent_ns + (uint64_t)timeout_ms * 1000000u;
+    r->seq         = seq;
+    r->cmd_set     = frame[9];
+    r->cmd_id      = frame[10];
+    p->stats.requests_tracked++;
+    return 0;
 }
 
-/* Discard `n` bytes from the front of the buffer */
-static void ring_consume(rcm_parser_t *p, size_t n) {
-    if (n > p->count) n = p->count;
-    p->count -= n;
+int rcm_expire_requests(rcm_parser_t *p) {
+    if (!p || p->req_count == 0) return 0;
+    uint64_t now = monotonic_ns();
+    int expired = 0;
+    for (unsigned i = 0; i < RCM_MAX_PENDING; i++) {
+        pending_req_t *r = &p->req[i];
+        if (!r->sent_ns || now < r->deadline_ns) continue;
+        uint64_t waited = now - r->sent_ns;
+        r->sent_ns = 0;
+        p->req_count--;
+        p->stats.request_timeouts++;
+        expired++;
+        if (p->resp_cb)
+            p->resp_cb(r->seq, NULL, waited, p->resp_userdata);
+    }
+    return expired;
 }
 
-/* Push one byte into the ring buffer */
-static void ring_push(rcm_parser_t *p, uint8_t b) {
-    p->ring[p->head] = b;
-    p->head = (p->head + 1) % RING_SIZE;
-    if (p->count < RING_SIZE)
-        p->count++;
-    /* If overflow, oldest byte is silently lost */
+unsigned rcm_pending_requests(const rcm_parser_t *p) {
+    return p ? p->req_count : 0;
+}
+
+uint64_t rcm_request_rtt_ns(const rcm_parser_t *p) {
+    return p ? p->rtt_smoothed_ns : 0;
+}
+
+/* Complete the pending request `v` answers, if any */
+static void match_response(rcm_parser_t *p, const rcm_frame_view_t *v) {
+    pending_req_t *r = &p->req[v->seq % RCM_MAX_PENDING];
+    if (!r->sent_ns || r->seq != v->seq ||
+        r->cmd_set != v->cmd_set || r->cmd_id != v->cmd_id)
+        return;
+
+    uint64_t rtt = monotonic_ns() - r->sent_ns;
+    if (!rtt) rtt = 1; /* 0 means "no sample" in the stats */
+    r->sent_ns = 0;
+    p->req_count--;
+
+    rcm_stats_t *st = &p->stats;
+    st->responses_matched++;
+    st->rtt_last_ns = rtt;
+    if (!st->rtt_min_ns || rtt < st->rtt_min_ns) st->rtt_min_ns = rtt;
+    if (rtt > st->rtt_max_ns) st->rtt_max_ns = rtt;
+    if (!p->rtt_smoothed_ns)
+        p->rtt_smoothed_ns = rtt;
+    else
+        p->rtt_smoothed_ns = (uint64_t)((int64_t)p->rtt_smoothed_ns +
+                             ((int64_t)rtt - (int64_t)p->rtt_smoothed_ns) / 8);
+
+    if (p->resp_cb)
+        p->resp_cb(v->seq, v, rtt, p->resp_userdata);
+}
+
+/* Frame length field (10 bits from bytes 1-2) of a header starting at SOF */
+static inline uint16_t header_frame_len(const uint8_t *hdr) {
+    uint16_t len_ver = (uint16_t)hdr[1] | ((uint16_t)hdr[2] << 8);
+    return len_ver & 0x03FF;
 }
 
 /*
- * Try to decode one DUML frame from the ring buffer.
- * Returns 1 if an RC push packet was decoded and callback invoked,
- * 0 if a non-RC frame was consumed, -1 if more data needed.
+ * Deliver a decoded RC push that starts at stream offset `at`: into the
+ * batch array while one is active and has room, else to the callback.
  */
-static int try_decode_frame(rcm_parser_t *p) {
-    while (p->count > 0) {
-        if (p->state == SCAN_SOF) {
-            /* Scan for SOF byte 0x55 */
-            if (ring_peek(p, 0) != DUML_SOF) {
-                ring_consume(p, 1);
-                continue;
-            }
-            /* Need at least 4 bytes to read header (SOF + LenVer + CRC8) */
-            if (p->count < 4)
-                return -1;
-
-            /* Verify CRC8 of first 3 bytes */
-            uint8_t hdr[3];
-            ring_copy(p, 0, hdr, 3);
-            uint8_t expected_crc8 = ring_peek(p, 3);
-            if (duml_crc8(hdr, 3) != expected_crc8) {
-                /* Not a valid frame start, skip this 0x55 */
-                ring_consume(p, 1);
-                continue;
-            }
+static void emit_state(rcm_parser_t *p, const rc_state_t *state,
+                       uint32_t changed, uint16_t duml_seq, uint64_t at) {
+    p->push_seq++;
+    if (p->batch_len < p->batch_max) {
+        if (p->batch_packed) {
+            rcm_pack_state(state, &p->batch_packed[p->batch_len++]);
+        } else {
+            rcm_batch_entry_t *e = &p->batch[p->batch_len++];
+            e->state    = *state;
+            e->changed  = changed;
+            e->seq      = p->push_seq;
+            e->duml_seq = duml_seq;
+            e->offset   = (int32_t)(int64_t)(at - p->batch_base);
+        }
+    } else {
+        if (p->batch || p->batch_packed)
+            p->stats.batch_overflows++;
+        if (p->change_cb)
+            p->change_cb(state, changed, p->userdata);
+        else
+            p->callback(state, p->userdata);
+    }
+    trace(p, RCM_TRACE_CALLBACK_END, 0, p->push_seq);
+}
+
+/* Publish `ps` to the mailbox; only ever called by the feeding thread */
+static void mailbox_publish(rcm_parser_t *p, const rcm_packed_state_t *ps) {
+    uint64_t w[2];
+    memcpy(w, ps, sizeof(w));
+
+    uint32_t s = atomic_load_explicit(&p->mb_seq, memory_order_relaxed);
+    uint32_t n = atomic_load_explicit(&p->mb_count, memory_order_relaxed);
+    atomic_store_explicit(&p->mb_seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&p->mb_word[0], w[0], memory_order_relaxed);
+    atomic_store_explicit(&p->mb_word[1], w[1], memory_order_relaxed);
+    atomic_store_explicit(&p->mb_count, n + 1, memory_order_relaxed);
+    atomic_store_explicit(&p->mb_seq, s + 2, memory_order_release);
+}
+
+int rcm_snapshot_packed(const rcm_parser_t *p, rcm_packed_state_t *state,
+                        uint32_t *seq) {
+    if (!p || !state) return -1;
+    uint64_t w[2];
+    uint32_t s1, s2, n;
+    do {
+        s1 = atomic_load_explicit(&p->mb_seq, memory_order_acquire);
+        w[0] = atomic_load_explicit(&p->mb_word[0], memory_order_relaxed);
+        w[1] = atomic_load_explicit(&p->mb_word[1], memory_order_relaxed);
+        n = atomic_load_explicit(&p->mb_count, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        s2 = atomic_load_explicit(&p->mb_seq, memory_order_relaxed);
+    } while ((s1 & 1) || s1 != s2);
+
+    if (n == 0) return -1;
+    memcpy(state, w, sizeof(w));
+    if (seq) *seq = n;
+    return 0;
+}
+
+int rcm_snapshot(const rcm_parser_t *p, rc_state_t *state, uint32_t *seq) {
+    rcm_packed_state_t ps;
+    if (!state || rcm_snapshot_packed(p, &ps, seq) != 0) return -1;
+    rcm_unpack_state(&ps, state);
+    return 0;
+}
 
-            /* Extract frame length (10 bits from bytes 1-2) */
-            uint16_t len_ver = (uint16_t)hdr[1] | ((uint16_t)hdr[2] << 8);
-            p->frame_len = len_ver & 0x03FF;
+void rcm_set_coalesce(rcm_parser_t *p, bool enable) {
+    if (!p) return;
+    atomic_store_explicit(&p->co_enabled, enable, memory_order_relaxed);
+    atomic_store_explicit(&p->co_pressed, 0, memory_order_relaxed);
+    atomic_store_explicit(&p->co_wheel, 0, memory_order_relaxed);
+    p->co_taken = atomic_load_explicit(&p->mb_count, memory_order_acquire);
+}
+
+int rcm_take_coalesced(rcm_parser_t *p, rcm_packed_state_t *out) {
+    if (!p || !out) return -1;
+    rcm_packed_state_t s;
+    uint32_t n;
+    if (rcm_snapshot_packed(p, &s, &n) != 0 || n == p->co_taken)
+        return 0;
+    uint32_t folded = n - p->co_taken;
+    p->co_taken = n;
+
+    /* After the snapshot: may fold a newer push's press in early, never drop one */
+    uint32_t pressed = atomic_exchange_explicit(&p->co_pressed, 0, memory_order_relaxed);
+    int32_t wheel = atomic_exchange_explicit(&p->co_wheel, 0, memory_order_relaxed);
+    s.flags |= (uint16_t)(pressed & RCM_PK_BUTTON_MASK);
+    s.right_wheel_delta = (int8_t)(wheel > INT8_MAX ? INT8_MAX
+                                 : wheel < INT8_MIN ? INT8_MIN : wheel);
+    *out = s;
+    return folded > INT32_MAX ? INT32_MAX : (int)folded;
+}
+
+void rcm_set_history(rcm_parser_t *p, rcm_history_t *h) {
+    if (p) p->history = h;
+}
 
-            if (p->frame_len < DUML_MIN_FRAME_LEN ||
-                p->frame_len > DUML_MAX_FRAME_LEN) {
-                ring_consume(p, 1);
-                continue;
+/* Raw payload equality as two 64-bit words plus the final byte */
+static inline bool raw_payload_equal(const uint8_t *a, const uint8_t *b) {
+    uint64_t a0, a1, b0, b1;
+    memcpy(&a0, a, 8);     memcpy(&b0, b, 8);
+    memcpy(&a1, a + 8, 8); memcpy(&b1, b + 8, 8);
+    return ((a0 ^ b0) | (a1 ^ b1) | (uint64_t)(a[16] ^ b[16])) == 0;
+}
+
+static inline bool axis_moved(int16_t prev, int16_t cur, uint16_t deadband) {
+    int d = (int)cur - (int)prev;
+    return (d < 0 ? -d : d) > (int)deadband;
+}
+
+/* RCM_CHANGED_* mask of `cur` against the last delivered state `prev` */
+static uint32_t state_changes(const rc_state_t *prev, const rc_state_t *cur,
+                              uint16_t deadband) {
+    uint32_t m = 0;
+    if (cur->pause   != prev->pause)   m |= RCM_CHANGED_PAUSE;
+    if (cur->gohome  != prev->gohome)  m |= RCM_CHANGED_GOHOME;
+    if (cur->shutter != prev->shutter) m |= RCM_CHANGED_SHUTTER;
+    if (cur->record  != prev->record)  m |= RCM_CHANGED_RECORD;
+    if (cur->custom1 != prev->custom1) m |= RCM_CHANGED_CUSTOM1;
+    if (cur->custom2 != prev->custom2) m |= RCM_CHANGED_CUSTOM2;
+    if (cur->custom3 != prev->custom3) m |= RCM_CHANGED_CUSTOM3;
+    if (memcmp(&cur->five_d, &prev->five_d, sizeof(cur->five_d)) != 0)
+        m |= RCM_CHANGED_FIVE_D;
+    if (cur->flight_mode != prev->flight_mode) m |= RCM_CHANGED_FLIGHT_MODE;
+    if (axis_moved(prev->stick_right.horizontal, cur->stick_right.horizontal, deadband))
+        m |= RCM_CHANGED_STICK_RH;
+    if (axis_moved(prev->stick_right.vertical, cur->stick_right.vertical, deadband))
+        m |= RCM_CHANGED_STICK_RV;
+    if (axis_moved(prev->stick_left.horizontal, cur->stick_left.horizontal, deadband))
+        m |= RCM_CHANGED_STICK_LH;
+    if (axis_moved(prev->stick_left.vertical, cur->stick_left.vertical, deadband))
+        m |= RCM_CHANGED_STICK_LV;
+    if (axis_moved(prev->left_wheel, cur->left_wheel, deadband))
+        m |= RCM_CHANGED_LEFT_WHEEL;
+    if (axis_moved(prev->right_wheel, cur->right_wheel, deadband))
+        m |= RCM_CHANGED_RIGHT_WHEEL;
+    if (cur->right_wheel_delta != 0 || prev->right_wheel_delta != 0)
+        m |= RCM_CHANGED_WHEEL_DELTA;
+    return m;
+}
+
+/*
+ * Decode the 17-byte RC push payload at `raw` and deliver it, subject to
+ * change detection. Returns 1 if it was delivered, 0 if suppressed.
+ */
+static int deliver_push(rcm_parser_t *p, const uint8_t *raw,
+                        uint16_t duml_seq, uint64_t at) {
+    trace(p, RCM_TRACE_FRAME, 0, at);
+    p->stats.rc_pushes++;
+    if (p->change_detect && p->have_last) {
+        /* Identical raw bytes and no wheel delta: nothing can have changed */
+        if (raw_payload_equal(raw, p->last_raw) && (raw[4] & 0x3E) == 0) {
+            if (p->history) {
+                /* The mailbox still holds this very payload, decoded */
+                uint64_t w[2] = {
+                    atomic_load_explicit(&p->mb_word[0], memory_order_relaxed),
+                    atomic_load_explicit(&p->mb_word[1], memory_order_relaxed),
+                };
+                rcm_packed_state_t last;
+                memcpy(&last, w, sizeof(last));
+                rcm_history_push(p->history, &last, monotonic_ns());
             }
+            return 0;
+        }
+    }
 
-            p->state = READ_FRAME;
+    rc_state_t state;
+    rcm_packed_state_t ps;
+    rcm_parse_payload(raw, RC_PUSH_PAYLOAD_LEN, &state);
+    rcm_pack_state(&state, &ps);
+    if (atomic_load_explicit(&p->co_enabled, memory_order_relaxed)) {
+        atomic_fetch_or_explicit(&p->co_pressed, ps.flags & RCM_PK_BUTTON_MASK,
+                                 memory_order_relaxed);
+        if (ps.right_wheel_delta)
+            atomic_fetch_add_explicit(&p->co_wheel, ps.right_wheel_delta,
+                                      memory_order_relaxed);
+    }
+    mailbox_publish(p, &ps);
+    if (p->history)
+        rcm_history_push(p->history, &ps, monotonic_ns());
+
+    uint32_t changed = RCM_CHANGED_ALL;
+    if (p->change_detect) {
+        memcpy(p->last_raw, raw, RC_PUSH_PAYLOAD_LEN);
+        if (p->have_last) {
+            changed = state_changes(&p->last_state, &state, p->deadband);
+            if (!changed)
+                return 0;
         }
+        p->last_state = state;
+        p->have_last = true;
+    }
 
-        if (p->state == READ_FRAME) {
-            if (p->count < p->frame_len)
-                return -1; /* Need more data */
-
-            /* Copy full frame out */
-            uint8_t frame[DUML_MAX_FRAME_LEN];
-            ring_copy(p, 0, frame, p->frame_len);
-
-            /* Verify CRC16 over entire frame except last 2 bytes */
-            uint16_t expected_crc16 = (uint16_t)frame[p->frame_len - 2] |
-                                      ((uint16_t)frame[p->frame_len - 1] << 8);
-            uint16_t actual_crc16 = duml_crc16(frame, p->frame_len - 2);
-
-            ring_consume(p, p->frame_len);
-            p->state = SCAN_SOF;
-
-            if (actual_crc16 != expected_crc16)
-                continue; /* Bad CRC, skip frame */
-
-            /*
-             * DUML v1 frame layout:
-             *   [0]     SOF
-             *   [1-2]   length(10) + version(6)
-             *   [3]     CRC8
-             *   [4]     sender_type(5) + sender_index(3)
-             *   [5]     receiver_type(5) + receiver_index(3)
-             *   [6-7]   sequence number (LE)
-             *   [8]     pack_type(1) + ack_type(2) + encrypt(3) + padding(2)
-             *   [9]     cmd_set
-             *   [10]    cmd_id
-             *   [11..]  payload
-             *   [-2,-1] CRC16
-             *
-             * Note: the exact header layout can vary between DUML versions.
-             * We search for cmd_set=0x06 at multiple possible offsets.
-             */
-            /* Try standard DUML v1 offsets */
-            if (p->frame_len >= 13) {
-                uint8_t cmd_set = frame[9];
-                uint8_t cmd_id  = frame[10];
-
-                if (cmd_set == DUML_CMD_SET_RC && cmd_id == DUML_CMD_RC_PUSH) {
-                    size_t payload_len = p->frame_len - 13; /* 11 header + 2 CRC16 */
-                    if (payload_len >= RC_PUSH_PAYLOAD_LEN) {
-                        rc_state_t state;
-                        if (rcm_parse_payload(frame + 11, payload_len, &state) == 0) {
-                            p->callback(&state, p->userdata);
-                            return 1;
-                        }
-                    }
-                }
-            }
+    emit_state(p, &state, changed, duml_seq, at);
+    return 1;
+}
 
-            /*
-             * DUML v2/v3 may have a slightly different header.
-             * Try scanning for the RC cmd_set/cmd_id pair in bytes 8-12.
-             */
-            if (p->frame_len >= 14) {
-                for (int off = 8; off <= 12 && off + 2 + RC_PUSH_PAYLOAD_LEN <= (int)p->frame_len - 2; off++) {
-                    if (frame[off] == DUML_CMD_SET_RC && frame[off + 1] == DUML_CMD_RC_PUSH) {
-                        rc_state_t state;
-                        size_t payload_off = off + 2;
-                        size_t payload_len = p->frame_len - 2 - payload_off;
-                        if (payload_len >= RC_PUSH_PAYLOAD_LEN &&
-                            payload_len <= RC_PUSH_PAYLOAD_LEN + 4 &&
-                            rcm_parse_payload(frame + payload_off, payload_len, &state) == 0) {
-                            p->callback(&state, p->userdata);
-                            return 1;
-                        }
-                    }
+/* An unclaimed frame had no RC push at the locked layout */
+static void layout_miss(rcm_parser_t *p) {
+    if (p->layout_miss_limit && ++p->layout_misses >= p->layout_miss_limit) {
+        p->layout_off = 0;
+        p->layout_cand_n = 0;
+        p->stats.layout_fallbacks++;
+    }
+}
+
+/* An RC push was found with cmd_set at frame offset `off` */
+static void layout_seen(rcm_parser_t *p, uint8_t off) {
+    if (p->layout_off) {
+        if (off == p->layout_off)
+            p->layout_misses = 0;
+        else
+            layout_miss(p);
+        return;
+    }
+    if (!p->layout_confirm)
+        return;
+    if (p->layout_cand_n && off == p->layout_cand_off) {
+        p->layout_cand_n++;
+    } else {
+        p->layout_cand_off = off;
+        p->layout_cand_n = 1;
+    }
+    if (p->layout_cand_n >= p->layout_confirm) {
+        p->layout_off = off;
+        p->layout_misses = 0;
+        p->stats.layout_locks++;
+    }
+}
+
+/*
+ * DUML v2/v3 may have a slightly different header.
+ * Try scanning for the RC cmd_set/cmd_id pair in bytes 8-12, or only at
+ * the locked offset once rcm_set_layout_lock() has settled on one (with
+ * v1 locked there is nothing to look at).
+ * Sets *matched if an RC push was found, even if change detection then
+ * suppressed it; returns 1 if it was delivered.
+ */
+static int rc_push_scan_alt(rcm_parser_t *p, const rcm_frame_view_t *v,
+                            bool *matched) {
+    const uint8_t *frame = v->frame;
+    size_t frame_len = v->frame_len;
+    *matched = false;
+    int lo = 8, hi = 12;
+    if (p->layout_off) {
+        if (p->layout_off == DUML_V1_CMD_OFFSET) {
+            layout_miss(p);
+            return 0;
+        }
+        lo = hi = p->layout_off;
+    }
+    if (frame_len >= 14) {
+        for (int off = lo; off <= hi && off + 2 + RC_PUSH_PAYLOAD_LEN <= (int)frame_len - 2; off++) {
+            if (frame[off] == DUML_CMD_SET_RC && frame[off + 1] == DUML_CMD_RC_PUSH) {
+                size_t payload_off = off + 2;
+                size_t payload_len = frame_len - 2 - payload_off;
+                if (payload_len >= RC_PUSH_PAYLOAD_LEN &&
+                    payload_len <= RC_PUSH_PAYLOAD_LEN + 4) {
+                    *matched = true;
+                    layout_seen(p, (uint8_t)off);
+                    return deliver_push(p, frame + payload_off, v->seq,
+                                        v->stream_offset);
                 }
             }
+        }
+    }
+    if (p->layout_off)
+        layout_miss(p);
+    return 0;
+}
+
+/* Built-in handler for DUML_CMD_SET_RC / DUML_CMD_RC_PUSH; userdata is the parser */
+static int rc_push_handler(const rcm_frame_view_t *v, void *userdata) {
+    rcm_parser_t *p = (rcm_parser_t *)userdata;
+    if (v->payload_len >= RC_PUSH_PAYLOAD_LEN) {
+        layout_seen(p, DUML_V1_CMD_OFFSET);
+        return deliver_push(p, v->payload, v->seq, v->stream_offset);
+    }
+    bool matched;
+    return rc_push_scan_alt(p, v, &matched);
+}
+
+/*
+ * Handle one CRC-validated frame in place; `at` is its stream offset.
+ * Returns the handler's result (1 for a delivered RC push), 0 if no
+ * handler took the frame.
+ */
+static int dispatch_frame(rcm_parser_t *p, const uint8_t *frame,
+                          size_t frame_len, uint64_t at) {
+    /*
+     * DUML v1 frame layout:
+     *   [0]     SOF
+     *   [1-2]   length(10) + version(6)
+     *   [3]     CRC8
+     *   [4]     sender_type(5) + sender_index(3)
+     *   [5]     receiver_type(5) + receiver_index(3)
+     *   [6-7]   sequence number (LE)
+     *   [8]     pack_type(1) + ack_type(2) + encrypt(3) + padding(2)
+     *   [9]     cmd_set
+     *   [10]    cmd_id
+     *   [11..]  payload
+     *   [-2,-1] CRC16
+     */
+    rcm_frame_view_t v;
+    v.frame          = frame;
+    v.frame_len      = (uint16_t)frame_len;
+    v.version        = frame[2] >> 2;
+    v.sender_type    = frame[4] & 0x1F;
+    v.sender_index   = frame[4] >> 5;
+    v.receiver_type  = frame[5] & 0x1F;
+    v.receiver_index = frame[5] >> 5;
+    v.seq            = read_u16_le(frame + 6);
+    v.pack_type      = frame[8] >> 7;
+    v.ack_type       = (frame[8] >> 5) & 0x03;
+    v.encrypt_type   = frame[8] & 0x07;
+    v.cmd_set        = frame[9];
+    v.cmd_id         = frame[10];
+    v.payload        = frame + DUML_HEADER_LEN;
+    v.payload_len    = frame_len - DUML_HEADER_LEN - DUML_FOOTER_LEN;
+    v.stream_offset  = at;
+
+    p->stats.frames++;
+    p->stats.frames_by_cmd_set[v.cmd_set]++;
+
+    if (v.pack_type == DUML_PACK_RESPONSE && p->req_count)
+        match_response(p, &v);
+
+    const handler_slot_t *row = p->handlers[v.cmd_set];
+    if (row && row[v.cmd_id].fn)
+        return row[v.cmd_id].fn(&v, row[v.cmd_id].userdata);
+
+    /*
+     * The exact header layout can vary between DUML versions, so a frame
+     * nobody claimed at the v1 offsets may still be an RC push.
+     */
+    const handler_slot_t *rc = p->handlers[DUML_CMD_SET_RC];
+    if (rc && rc[DUML_CMD_RC_PUSH].fn == rc_push_handler) {
+        bool matched;
+        int n = rc_push_scan_alt(p, &v, &matched);
+        if (matched) return n;
+    }
+
+    if (p->default_handler.fn)
+        return p->default_handler.fn(&v, p->default_handler.userdata);
+    return 0;
+}
+
+/*
+ * CRC16 over all but the last two bytes of the complete candidate `f` of
+ * length frame_len, which starts at stream offset `at`.
+ *
+ * Outside a resync region this is a single pass of the active CRC kernel.
+ * Inside one, the candidate overlaps bytes that earlier candidates already
+ * covered, so the result is rebuilt from prefix states instead: every byte
+ * is run through the table kernel at most once per region and each check
+ * costs one GF(2^16) multiply.
+ */
+static uint16_t frame_crc16(rcm_parser_t *p, const uint8_t *f, uint64_t at,
+                            size_t frame_len) {
+    size_t body = frame_len - DUML_FOOTER_LEN;
+    if (at >= p->resync_end) {
+        p->work.crc16_bytes += body;
+        return duml_crc16(f, body);
+    }
+
+    uint64_t end = at + body;
+    if (at < p->pfx_lo || at > p->pfx_hi) {
+        /* Window does not reach this candidate: restart it here */
+        p->pfx_hi = at;
+        p->pfx[at & PFX_MASK] = 0;
+    }
+    p->pfx_lo = at; /* older states are never needed again */
+    if (end > p->pfx_hi) {
+        size_t have = (size_t)(p->pfx_hi - at);
+        rcm_priv_crc16_prefix(p->pfx[p->pfx_hi & PFX_MASK], f + have,
+                              body - have, p->pfx, PFX_MASK, p->pfx_hi);
+        p->work.crc16_bytes += body - have;
+        p->pfx_hi = end;
+    }
+    uint16_t s_at = p->pfx[at & PFX_MASK];
+    uint16_t s_end = p->pfx[end & PFX_MASK];
+    return s_end ^ rcm_priv_crc16_shift(s_at ^ DUML_CRC16_SEED, body);
+}
+
+/*
+ * Decode every complete frame in the contiguous span buf[0..n), whose first
+ * byte is at stream offset `base`, validating and dispatching each one in
+ * place without copying it out.
+ *
+ * SOF bytes are located with memchr(), which every libc we ship on
+ * vectorises (SSE2/AVX2 on x86, NEON on arm64). A candidate whose header
+ * passes but whose CRC16 fails may be a false SOF hiding real frames, so
+ * the scan resumes at the byte after it rather than skipping its claimed
+ * length, and [SOF, SOF + frame_len) becomes a resync region.
+ *
+ * Worst-case cost, for any input and any chunking (checked by
+ * test/fuzz_resync.c through the rcm_priv_work_t counters):
+ *   - header checks   <= 2 * bytes + calls  (each: length test, 3-byte CRC8,
+ *                                            at most one GF(2^16) multiply)
+ *   - CRC16 bytes     <= 2 * bytes          (one pass with the active kernel
+ *                                            outside resync, one table-kernel
+ *                                            prefix pass inside)
+ *   - staging copies  <= 2 * bytes
+ * plus one memchr() pass. That is a constant number of table lookups per
+ * byte regardless of how many CRC8-valid false headers the stream holds;
+ * rescanning each false frame body instead would cost up to
+ * DUML_MAX_FRAME_LEN CRC steps per byte.
+ *
+ * Returns the number of bytes consumed. The unconsumed remainder is either
+ * empty or a single incomplete candidate that starts with DUML_SOF: fewer
+ * than 4 header bytes, or a CRC8-valid header whose frame has not fully
+ * arrived yet.
+ */
+static size_t decode_span(rcm_parser_t *p, const uint8_t *buf, size_t n,
+                          uint64_t base, int *decoded) {
+    size_t pos = 0;
+    while (pos < n) {
+        /* Jump to the next SOF byte 0x55 */
+        const uint8_t *sof = memchr(buf + pos, DUML_SOF, n - pos);
+        if (!sof) {
+            p->stats.bytes_discarded += n - pos;
+            return n;
+        }
+        p->stats.bytes_discarded += (size_t)(sof - buf) - pos;
+        pos = (size_t)(sof - buf);
+
+        /* Need at least 4 bytes to read header (SOF + LenVer + CRC8) */
+        const uint8_t *f = buf + pos;
+        size_t avail = n - pos;
+        if (avail < 4)
+            break;
+        p->work.header_checks++;
+
+        /* Range test first: it is cheaper than the CRC8 */
+        uint16_t frame_len = header_frame_len(f);
+        if (frame_len < DUML_MIN_FRAME_LEN ||
+            frame_len > DUML_MAX_FRAME_LEN) {
+            /* Not a valid frame start, skip this 0x55 */
+            p->stats.length_errors++;
+            p->stats.bytes_discarded++;
+            pos++;
+            continue;
+        }
+        if (duml_crc8(f, 3) != f[3]) {
+            p->stats.crc8_failures++;
+            p->stats.bytes_discarded++;
+            pos++;
+            continue;
+        }
 
-            return 0; /* Valid frame but not RC push */
+        if (avail < frame_len)
+            break; /* Need more data */
+
+        /* Verify CRC16 over entire frame except last 2 bytes */
+        uint16_t expected_crc16 = read_u16_le(f + frame_len - 2);
+        if (frame_crc16(p, f, base + pos, frame_len) != expected_crc16) {
+            /* Bad CRC: resync from the byte after this SOF */
+            uint64_t end = base + pos + frame_len;
+            if (end > p->resync_end)
+                p->resync_end = end;
+            p->stats.crc16_failures++;
+            p->stats.bytes_discarded++;
+            pos++;
+            continue;
         }
+
+        *decoded += dispatch_frame(p, f, frame_len, base + pos);
+        pos += frame_len;
     }
-    return -1;
+    return pos;
 }
 
-int rcm_feed(rcm_parser_t *p, const uint8_t *data, size_t len) {
-    if (!p || !data) return 0;
+/* Bytes still missing before the staged candidate can be checked */
+static size_t stage_missing(const rcm_parser_t *p) {
+    if (p->stage_len < 4)
+        return 4 - p->stage_len;
+    return (size_t)header_frame_len(p->stage + p->stage_head) - p->stage_len;
+}
 
+/* rcm_feed() without the argument checks and instrumentation */
+static int feed_stream(rcm_parser_t *p, const uint8_t *data, size_t len) {
     int decoded = 0;
-    for (size_t i = 0; i < len; i++) {
-        ring_push(p, data[i]);
 
-        int ret;
-        while ((ret = try_decode_frame(p)) >= 0) {
-            decoded += ret;
+    /*
+     * Finish the candidate left over from the previous call. The staging
+     * buffer is topped up only as far as that candidate needs, so frames
+     * further into `data` are still decoded in place below.
+     */
+    while (p->stage_len > 0 && len > 0) {
+        size_t take = stage_missing(p);
+        if (take > len) take = len;
+        if (p->stage_head + p->stage_len + take > sizeof(p->stage)) {
+            memmove(p->stage, p->stage + p->stage_head, p->stage_len);
+            p->work.copy_bytes += p->stage_len;
+            p->stage_head = 0;
         }
+        uint8_t *s = p->stage + p->stage_head;
+        memcpy(s + p->stage_len, data, take);
+        p->work.copy_bytes += take;
+        p->stage_len += take;
+        p->stream_pos += take;
+        data += take;
+        len -= take;
+
+        size_t used = decode_span(p, s, p->stage_len,
+                                  p->stream_pos - p->stage_len, &decoded);
+        p->stage_head += used;
+        p->stage_len -= used;
+        if (p->stage_len == 0)
+            p->stage_head = 0;
     }
+    if (len == 0)
+        return decoded;
+
+    /* Fast path: frames that sit wholly inside `data` are never copied */
+    size_t used = decode_span(p, data, len, p->stream_pos, &decoded);
+    p->stream_pos += len;
+
+    /* Stage the incomplete tail (always shorter than one frame) */
+    p->stage_head = 0;
+    p->stage_len = len - used;
+    memcpy(p->stage, data + used, p->stage_len);
+    p->work.copy_bytes += p->stage_len;
     return decoded;
 }
 
+#ifdef RCM_FEED_HISTOGRAM
+/* Bucket for a duration of `ns`: bit length of ns, clamped to the last one */
+static inline unsigned feed_hist_bucket(uint64_t ns) {
+    unsigned b = ns ? 64u - (unsigned)__builtin_clzll(ns) : 0u;
+    return b < RCM_FEED_HIST_BUCKETS ? b : RCM_FEED_HIST_BUCKETS - 1;
+}
+#endif
+
+int rcm_feed(rcm_parser_t *p, const uint8_t *data, size_t len) {
+    if (!p || !data) return 0;
+    if (len == 0) return 0;
+
+    trace(p, RCM_TRACE_FEED_BEGIN, 0, len);
+    p->work.feed_calls++;
+    p->work.bytes_in += len;
+    p->stats.bytes_in += len;
+    uint64_t pushes = p->stats.rc_pushes;
+
+#ifdef RCM_FEED_HISTOGRAM
+    uint64_t t0 = monotonic_ns();
+    int decoded = feed_stream(p, data, len);
+    uint64_t t1 = monotonic_ns();
+    p->stats.feed_hist[feed_hist_bucket(t1 - t0)]++;
+    if (p->stats.rc_pushes != pushes)
+        p->last_push_ns = t1;
+#else
+    int decoded = feed_stream(p, data, len);
+    if (p->stats.rc_pushes != pushes)
+        p->last_push_ns = monotonic_ns();
+#endif
+    trace(p, RCM_TRACE_FEED_END, 0, (uint64_t)decoded);
+    return decoded;
+}
+
+int rcm_feed_payload(rcm_parser_t *p, const uint8_t *payload, size_t len) {
+    if (!p || !payload || len < RC_PUSH_PAYLOAD_LEN) return -1;
+    trace(p, RCM_TRACE_FEED_BEGIN, 0, len);
+    int ret = deliver_push(p, payload, 0, p->stream_pos);
+    p->last_push_ns = monotonic_ns();
+    trace(p, RCM_TRACE_FEED_END, 0, (uint64_t)ret);
+    return ret;
+}
+
+/* Run rcm_feed() with one of the batch sinks installed */
+static int feed_into_batch(rcm_parser_t *p, const uint8_t *data, size_t len,
+                           rcm_batch_entry_t *entries,
+                           rcm_packed_state_t *packed, size_t max_out) {
+    p->batch        = entries;
+    p->batch_packed = packed;
+    p->batch_max    = (entries || packed) ? max_out : 0;
+    p->batch_len    = 0;
+    p->batch_base   = p->stream_pos;
+    rcm_feed(p, data, len);
+
+    int n = (int)p->batch_len;
+    p->batch        = NULL;
+    p->batch_packed = NULL;
+    p->batch_max    = 0;
+    p->batch_len    = 0;
+    return n;
+}
+
+int rcm_feed_batch(rcm_parser_t *p, const uint8_t *data, size_t len,
+                   rcm_batch_entry_t *out, size_t max_out) {
+    if (!p || !data) return 0;
+    return feed_into_batch(p, data, len, out, NULL, max_out);
+}
+
+int rcm_feed_batch_packed(rcm_parser_t *p, const uint8_t *data, size_t len,
+                          rcm_packed_state_t *out, size_t max_out) {
+    if (!p || !data) return 0;
+    return feed_into_batch(p, data, len, NULL, out, max_out);
+}
+
 /* ---------- Packet builder ---------- */
 
 static inline void write_u16_le(uint8_t *p, uint16_t v) {
@@ -0,0 +1,504 @@
+/*
+ * rc_monitor_capture.c - Capture file writer and reader
+ *
+ * The writer appends chunk records through stdio under one mutex and keeps
+ * the index in memory until rcm_capture_close() writes it after the last
+ * chunk, so recording never seeks. The reader seeks explicitly before every
+ * record and never reads past the start of the index.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* fseeko, ftello */
+#endif
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "rc_monitor_capture.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define DEFAULT_INDEX_MS 100
+#define RAW_CHUNK        4096
+
+static const uint8_t k_magic[4]   = { 'R', 'C', 'M', 'C' };
+static const uint8_t k_trailer[4] = { 'R', 'C', 'M', 'I' };
+static const uint8_t k_pad[8];
+
+typedef struct {
+    uint64_t t_ns;
+    uint64_t offset;
+} index_entry_t;
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static size_t padded(size_t len) {
+    return (len + 7) & ~(size_t)7;
+}
+
+/*
+ * Validate a file header. @return header length, 0 if `hdr` is not a
+ * capture (raw recording), -1 if it claims to be one but is malformed
+ */
+static int parse_file_header(const uint8_t *hdr, uint64_t size) {
+    if (size < RCM_CAPTURE_HEADER_LEN || memcmp(hdr, k_magic, 4) != 0)
+        return 0;
+    uint16_t hdr_len = (uint16_t)(hdr[6] | (hdr[7] << 8));
+    if (hdr_len < RCM_CAPTURE_HEADER_LEN || hdr_len > size)
+        return -1;
+    return hdr_len;
+}
+
+/* Validate the trailer at the end of a `size`-byte file */
+static bool parse_trailer(const uint8_t *t, uint64_t size, uint64_t hdr_len,
+                          uint64_t *index_start, uint64_t *count) {
+    if (memcmp(t + 12, k_trailer, 4) != 0) return false;
+    *index_start = get_u64(t);
+    *count = get_u32(t + 8);
+    /* Compared without sums, so a huge start or count cannot wrap around */
+    if (size < RCM_CAPTURE_TRAILER_LEN) return false;
+    uint64_t end = size - RCM_CAPTURE_TRAILER_LEN;
+    return *index_start >= hdr_len && *index_start <= end &&
+           *count == (end - *index_start) / RCM_CAPTURE_INDEX_ENTRY_LEN &&
+           (end - *index_start) % RCM_CAPTURE_INDEX_ENTRY_LEN == 0;
+}
+
+/* True if an index entry's offset can be a chunk of [data_start, data_end] */
+static bool index_offset_valid(uint64_t off, uint64_t data_start, uint64_t data_end) {
+    return off >= data_start && off <= data_end;
+}
+
+/*
+ * Decode the chunk header `hdr` found at `pos`; -1 if the chunk would run
+ * past data_end
+ */
+static int decode_chunk_header(const uint8_t *hdr, uint64_t pos, uint64_t data_end,
+                               rcm_capture_chunk_t *out) {
+    out->t_ns   = get_u64(hdr);
+    out->len    = get_u32(hdr + 8);
+    out->source = hdr[12];
+    out->dir    = hdr[13];
+    out->offset = pos;
+    out->data   = NULL;
+    if (out->len > RCM_CAPTURE_MAX_CHUNK ||
+        padded(out->len) > data_end - pos - RCM_CAPTURE_CHUNK_HDR_LEN)
+        return -1;
+    return 1;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec + 1;
+}
+
+/* ---------- Writer ---------- */
+
+struct rcm_capture_writer {
+    FILE           *fp;
+    pthread_mutex_t lock;
+    uint64_t        pos;         /* file offset of the next chunk */
+    uint64_t        interval_ns;
+    uint64_t        next_mark;   /* t_ns that starts the next index window */
+    bool            have_mark;
+    bool            failed;
+    index_entry_t  *index;
+    size_t          index_len, index_cap;
+};
+
+rcm_capture_writer_t *rcm_capture_open(const char *path, uint32_t index_interval_ms) {
+    if (!path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!index_interval_ms) index_interval_ms = DEFAULT_INDEX_MS;
+
+    rcm_capture_writer_t *w = (rcm_capture_writer_t *)calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->fp = fopen(path, "wb");
+    if (!w->fp) {
+        int err = errno;
+        free(w);
+        errno = err;
+        return NULL;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    w->interval_ns = (uint64_t)index_interval_ms * 1000000u;
+
+    uint8_t hdr[RCM_CAPTURE_HEADER_LEN] = { 0 };
+    memcpy(hdr, k_magic, 4);
+    put_u16(hdr + 4, RCM_CAPTURE_VERSION);
+    put_u16(hdr + 6, RCM_CAPTURE_HEADER_LEN);
+    put_u32(hdr + 8, index_interval_ms);
+    if (fwrite(hdr, 1, sizeof(hdr), w->fp) != sizeof(hdr))
+        w->failed = true;
+    w->pos = RCM_CAPTURE_HEADER_LEN;
+    return w;
+}
+
+/* Index the chunk about to be written at w->pos; caller holds w->lock */
+static void index_chunk(rcm_capture_writer_t *w, uint64_t t_ns) {
+    if (w->have_mark && t_ns < w->next_mark)
+        return;
+    if (w->index_len == w->index_cap) {
+        size_t cap = w->index_cap ? w->index_cap * 2 : 256;
+        index_entry_t *n = (index_entry_t *)realloc(w->index, cap * sizeof(*n));
+        if (!n) return; /* the index only gets coarser */
+        w->index = n;
+        w->index_cap = cap;
+    }
+    w->index[w->index_len].t_ns = t_ns;
+    w->index[w->index_len].offset = w->pos;
+    w->index_len++;
+    w->next_mark = t_ns - t_ns % w->interval_ns + w->interval_ns;
+    w->have_mark = true;
+}
+
+int rcm_capture_write(rcm_capture_writer_t *w, uint64_t t_ns, uint8_t source,
+                      uint8_t dir, const uint8_t *data, size_t len) {
+    if (!w || (!data && len) || len > RCM_CAPTURE_MAX_CHUNK) return -1;
+
+    uint8_t hdr[RCM_CAPTURE_CHUNK_HDR_LEN] = { 0 };
+    put_u32(hdr + 8, (uint32_t)len);
+    hdr[12] = source;
+    hdr[13] = dir;
+    size_t pad = padded(len) - len;
+
+    pthread_mutex_lock(&w->lock);
+    if (!t_ns) t_ns = monotonic_ns();
+    put_u64(hdr, t_ns);
+    if (!w->failed) {
+        index_chunk(w, t_ns);
+        if (fwrite(hdr, 1, sizeof(hdr), w->fp) != sizeof(hdr) ||
+            fwrite(data, 1, len, w->fp) != len ||
+            fwrite(k_pad, 1, pad, w->fp) != pad)
+            w->failed = true;
+        w->pos += sizeof(hdr) + len + pad;
+    }
+    int ret = w->failed ? -1 : 0;
+    pthread_mutex_unlock(&w->lock);
+    return ret;
+}
+
+int rcm_capture_flush(rcm_capture_writer_t *w) {
+    if (!w) return -1;
+    pthread_mutex_lock(&w->lock);
+    if (!w->failed && fflush(w->fp) != 0)
+        w->failed = true;
+    int ret = w->failed ? -1 : 0;
+    pthread_mutex_unlock(&w->lock);
+    return ret;
+}
+
+int rcm_capture_close(rcm_capture_writer_t *w) {
+    if (!w) return -1;
+    bool ok = !w->failed;
+    for (size_t i = 0; ok && i < w->index_len; i++) {
+        uint8_t e[RCM_CAPTURE_INDEX_ENTRY_LEN];
+        put_u64(e, w->index[i].t_ns);
+        put_u64(e + 8, w->index[i].offset);
+        ok = fwrite(e, 1, sizeof(e), w->fp) == sizeof(e);
+    }
+    if (ok) {
+        uint8_t t[RCM_CAPTURE_TRAILER_LEN];
+        put_u64(t, w->pos);
+        put_u32(t + 8, (uint32_t)w->index_len);
+        memcpy(t + 12, k_trailer, 4);
+        ok = fwrite(t, 1, sizeof(t), w->fp) == sizeof(t);
+    }
+    if (fclose(w->fp) != 0) ok = false;
+    pthread_mutex_destroy(&w->lock);
+    free(w->index);
+    free(w);
+    return ok ? 0 : -1;
+}
+
+/* ---------- Reader ---------- */
+
+struct rcm_capture_reader {
+    FILE          *fp;
+    bool           raw;
+    uint64_t       pos;        /* file offset of the next chunk */
+    uint64_t       data_start; /* first chunk (the header length) */
+    uint64_t       data_end;   /* start of the index, or the file size */
+    index_entry_t *index;
+    size_t         index_len;
+    uint8_t       *buf;
+    size_t         buf_cap;
+};
+
+static bool read_at(rcm_capture_reader_t *r, uint64_t off, void *dst, size_t len) {
+    if (fseeko(r->fp, (off_t)off, SEEK_SET) != 0) return false;
+    return fread(dst, 1, len, r->fp) == len;
+}
+
+/* Load the footer index if the trailer is intact */
+static void load_index(rcm_capture_reader_t *r, uint64_t size, uint64_t hdr_len) {
+    uint8_t t[RCM_CAPTURE_TRAILER_LEN];
+    uint64_t start, count;
+    if (size < hdr_len + RCM_CAPTURE_TRAILER_LEN ||
+        !read_at(r, size - RCM_CAPTURE_TRAILER_LEN, t, sizeof(t)) ||
+        !parse_trailer(t, size, hdr_len, &start, &count))
+        return;
+
+    if (count == 0) {
+        r->data_end = start;
+        return;
+    }
+    r->index = (index_entry_t *)malloc((size_t)count * sizeof(*r->index));
+    if (!r->index) return;
+    for (uint64_t i = 0; i < count; i++) {
+        uint8_t e[RCM_CAPTURE_INDEX_ENTRY_LEN];
+        if (!read_at(r, start + i * RCM_CAPTURE_INDEX_ENTRY_LEN, e, sizeof(e))) {
+            free(r->index);
+            r->index = NULL;
+            return;
+        }
+        r->index[i].t_ns = get_u64(e);
+        r->index[i].offset = get_u64(e + 8);
+    }
+    r->data_end = start;
+    r->index_len = (size_t)count;
+}
+
+rcm_capture_reader_t *rcm_capture_reader_open(const char *path) {
+    if (!path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    rcm_capture_reader_t *r = (rcm_capture_reader_t *)calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->fp = fopen(path, "rb");
+    if (!r->fp || fseeko(r->fp, 0, SEEK_END) != 0) {
+        int err = errno;
+        if (r->fp) fclose(r->fp);
+        free(r);
+        errno = err;
+        return NULL;
+    }
+    uint64_t size = (uint64_t)ftello(r->fp);
+    r->data_end = size;
+
+    uint8_t hdr[RCM_CAPTURE_HEADER_LEN];
+    int hdr_len = size < sizeof(hdr) || !read_at(r, 0, hdr, sizeof(hdr))
+                ? 0 : parse_file_header(hdr, size);
+    if (hdr_len == 0) {
+        r->raw = true;
+        return r;
+    }
+    if (hdr_len < 0) {
+        rcm_capture_reader_close(r);
+        errno = EINVAL;
+        return NULL;
+    }
+    r->data_start = (uint64_t)hdr_len;
+    load_index(r, size, r->data_start);
+    r->pos = r->data_start;
+    return r;
+}
+
+static bool reserve(rcm_capture_reader_t *r, size_t len) {
+    if (len <= r->buf_cap) return true;
+    uint8_t *n = (uint8_t *)realloc(r->buf, len);
+    if (!n) return false;
+    r->buf = n;
+    r->buf_cap = len;
+    return true;
+}
+
+/* Decode the chunk header at r->pos without consuming it */
+static int peek_header(rcm_capture_reader_t *r, rcm_capture_chunk_t *out) {
+    if (r->pos >= r->data_end) return 0;
+    out->offset = r->pos;
+    uint8_t hdr[RCM_CAPTURE_CHUNK_HDR_LEN];
+    if (r->data_end - r->pos < sizeof(hdr) || !read_at(r, r->pos, hdr, sizeof(hdr)))
+        return -1;
+    return decode_chunk_header(hdr, r->pos, r->data_end, out);
+}
+
+int rcm_capture_next(rcm_capture_reader_t *r, rcm_capture_chunk_t *out) {
+    if (!r || !out) return -1;
+
+    if (r->raw) {
+        if (r->pos >= r->data_end) return 0;
+        size_t len = r->data_end - r->pos < RAW_CHUNK ? (size_t)(r->data_end - r->pos)
+                                                      : RAW_CHUNK;
+        if (!reserve(r, RAW_CHUNK) || !read_at(r, r->pos, r->buf, len))
+            return -1;
+        memset(out, 0, sizeof(*out));
+        out->offset = r->pos;
+        out->data   = r->buf;
+        out->len    = len;
+        out->dir    = RCM_CAPTURE_IN;
+        r->pos += len;
+        return 1;
+    }
+
+    int got = peek_header(r, out);
+    if (got <= 0) return got;
+    if (!reserve(r, out->len ? out->len : 1) ||
+        (out->len && fread(r->buf, 1, out->len, r->fp) != out->len))
+        return -1;
+    out->data = r->buf;
+    r->pos += RCM_CAPTURE_CHUNK_HDR_LEN + padded(out->len);
+    return 1;
+}
+
+int rcm_capture_seek(rcm_capture_reader_t *r, uint64_t t_ns) {
+    if (!r || r->raw) return -1;
+
+    /* Start from the last index entry at or before t_ns */
+    uint64_t pos = r->data_start;
+    size_t lo = 0, hi = r->index_len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (r->index[mid].t_ns <= t_ns) lo = mid + 1;
+        else                            hi = mid;
+    }
+    if (lo > 0) pos = r->index[lo - 1].offset;
+    if (!index_offset_valid(pos, r->data_start, r->data_end)) return -1;
+    r->pos = pos;
+
+    for (;;) {
+        rcm_capture_chunk_t c;
+        int got = peek_header(r, &c);
+        if (got < 0) return -1;
+        if (got == 0) return 1;
+        if (c.t_ns >= t_ns) return 0;
+        r->pos += RCM_CAPTURE_CHUNK_HDR_LEN + padded(c.len);
+    }
+}
+
+bool rcm_capture_is_raw(const rcm_capture_reader_t *r) {
+    return r && r->raw;
+}
+
+size_t rcm_capture_index_count(const rcm_capture_reader_t *r) {
+    return r ? r->index_len : 0;
+}
+
+void rcm_capture_reader_close(rcm_capture_reader_t *r) {
+    if (!r) return;
+    if (r->fp) fclose(r->fp);
+    free(r->index);
+    free(r->buf);
+    free(r);
+}
+
+/* ---------- In-memory view ---------- */
+
+int rcm_capture_view_init(rcm_capture_view_t *v, const void *base, size_t size) {
+    if (!v || (!base && size)) return -1;
+    memset(v, 0, sizeof(*v));
+    v->base     = (const uint8_t *)base;
+    v->size     = size;
+    v->data_end = size;
+
+    int hdr_len = parse_file_header(v->base, size);
+    if (hdr_len < 0) return -1;
+    if (hdr_len == 0) {
+        v->raw = true;
+        return 0;
+    }
+    v->data_start = (size_t)hdr_len;
+    v->pos = v->data_start;
+
+    uint64_t start, count;
+    if (size >= v->data_start + RCM_CAPTURE_TRAILER_LEN &&
+        parse_trailer(v->base + size - RCM_CAPTURE_TRAILER_LEN, size, v->data_start,
+                      &start, &count)) {
+        v->data_end  = (size_t)start;
+        v->index     = v->base + start;
+        v->index_len = (size_t)count;
+    }
+    return 0;
+}
+
+/* Decode the chunk at v->pos without consuming it */
+static int view_peek(const rcm_capture_view_t *v, rcm_capture_chunk_t *out) {
+    if (v->pos >= v->data_end) return 0;
+    out->offset = v->pos;
+    if (v->data_end - v->pos < RCM_CAPTURE_CHUNK_HDR_LEN) return -1;
+    if (decode_chunk_header(v->base + v->pos, v->pos, v->data_end, out) < 0)
+        return -1;
+    out->data = v->base + v->pos + RCM_CAPTURE_CHUNK_HDR_LEN;
+    return 1;
+}
+
+int rcm_capture_view_next(rcm_capture_view_t *v, rcm_capture_chunk_t *out) {
+    if (!v || !out) return -1;
+    if (v->raw) {
+        if (v->pos >= v->data_end) return 0;
+        memset(out, 0, sizeof(*out));
+        out->offset = v->pos;
+        out->data   = v->base + v->pos;
+        out->len    = v->data_end - v->pos;
+        out->dir    = RCM_CAPTURE_IN;
+        v->pos = v->data_end;
+        return 1;
+    }
+    int got = view_peek(v, out);
+    if (got > 0)
+        v->pos += RCM_CAPTURE_CHUNK_HDR_LEN + padded(out->len);
+    return got;
+}
+
+int rcm_capture_view_index(const rcm_capture_view_t *v, size_t i,
+                           uint64_t *t_ns, uint64_t *offset) {
+    if (!v || i >= v->index_len) return -1;
+    const uint8_t *e = v->index + i * RCM_CAPTURE_INDEX_ENTRY_LEN;
+    if (t_ns)   *t_ns = get_u64(e);
+    if (offset) *offset = get_u64(e + 8);
+    return 0;
+}
+
+int rcm_capture_view_seek(rcm_capture_view_t *v, uint64_t t_ns) {
+    if (!v || v->raw) return -1;
+
+    size_t lo = 0, hi = v->index_len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint64_t t = 0;
+        rcm_capture_view_index(v, mid, &t, NULL);
+        if (t <= t_ns) lo = mid + 1;
+        else           hi = mid;
+    }
+    uint64_t pos = v->data_start;
+    if (lo > 0) rcm_capture_view_index(v, lo - 1, NULL, &pos);
+    if (!index_offset_valid(pos, v->data_start, v->data_end)) return -1;
+    v->pos = (size_t)pos;
+
+    for (;;) {
+        rcm_capture_chunk_t c;
+        int got = view_peek(v, &c);
+        if (got < 0) return -1;
+        if (got == 0) return 1;
+        if (c.t_ns >= t_ns) return 0;
+        v->pos += RCM_CAPTURE_CHUNK_HDR_LEN + padded(c.len);
+    }
+}
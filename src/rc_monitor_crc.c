@@ -0,0 +1,312 @@
+/*
+ * rc_monitor_crc.c - DUML CRC engine
+ *
+ * CRC8 (seed 0x77, reflected poly 0x8C) for headers and CRC16 (seed 0x3692,
+ * reflected poly 0x8408) for whole frames, with three bit-exact kernels:
+ *
+ *   table   byte-at-a-time lookup — the reference every other kernel is
+ *           checked against
+ *   slice8  portable slicing-by-8, eight bytes per step
+ *   clmul   carry-less multiply folding (PCLMULQDQ on x86-64, PMULL on
+ *           arm64), see rc_monitor_crc_clmul.c
+ *
+ * The fastest kernel the CPU supports is picked on first use, after a quick
+ * agreement check against the table kernel.
+ */
+
+#include "rc_monitor.h"
+#include "rc_monitor_internal.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* ---------- Reference tables ---------- */
+
+static const uint8_t crc8_table[256] = {
+    0x00,0x5e,0xbc,0xe2,0x61,0x3f,0xdd,0x83,0xc2,0x9c,0x7e,0x20,0xa3,0xfd,0x1f,0x41,
+    0x9d,0xc3,0x21,0x7f,0xfc,0xa2,0x40,0x1e,0x5f,0x01,0xe3,0xbd,0x3e,0x60,0x82,0xdc,
+    0x23,0x7d,0x9f,0xc1,0x42,0x1c,0xfe,0xa0,0xe1,0xbf,0x5d,0x03,0x80,0xde,0x3c,0x62,
+    0xbe,0xe0,0x02,0x5c,0xdf,0x81,0x63,0x3d,0x7c,0x22,0xc0,0x9e,0x1d,0x43,0xa1,0xff,
+    0x46,0x18,0xfa,0xa4,0x27,0x79,0x9b,0xc5,0x84,0xda,0x38,0x66,0xe5,0xbb,0x59,0x07,
+    0xdb,0x85,0x67,0x39,0xba,0xe4,0x06,0x58,0x19,0x47,0xa5,0xfb,0x78,0x26,0xc4,0x9a,
+    0x65,0x3b,0xd9,0x87,0x04,0x5a,0xb8,0xe6,0xa7,0xf9,0x1b,0x45,0xc6,0x98,0x7a,0x24,
+    0xf8,0xa6,0x44,0x1a,0x99,0xc7,0x25,0x7b,0x3a,0x64,0x86,0xd8,0x5b,0x05,0xe7,0xb9,
+    0x8c,0xd2,0x30,0x6e,0xed,0xb3,0x51,0x0f,0x4e,0x10,0xf2,0xac,0x2f,0x71,0x93,0xcd,
+    0x11,0x4f,0xad,0xf3,0x70,0x2e,0xcc,0x92,0xd3,0x8d,0x6f,0x31,0xb2,0xec,0x0e,0x50,
+    0xaf,0xf1,0x13,0x4d,0xce,0x90,0x72,0x2c,0x6d,0x33,0xd1,0x8f,0x0c,0x52,0xb0,0xee,
+    0x32,0x6c,0x8e,0xd0,0x53,0x0d,0xef,0xb1,0xf0,0xae,0x4c,0x12,0x91,0xcf,0x2d,0x73,
+    0xca,0x94,0x76,0x28,0xab,0xf5,0x17,0x49,0x08,0x56,0xb4,0xea,0x69,0x37,0xd5,0x8b,
+    0x57,0x09,0xeb,0xb5,0x36,0x68,0x8a,0xd4,0x95,0xcb,0x29,0x77,0xf4,0xaa,0x48,0x16,
+    0xe9,0xb7,0x55,0x0b,0x88,0xd6,0x34,0x6a,0x2b,0x75,0x97,0xc9,0x4a,0x14,0xf6,0xa8,
+    0x74,0x2a,0xc8,0x96,0x15,0x4b,0xa9,0xf7,0xb6,0xe8,0x0a,0x54,0xd7,0x89,0x6b,0x35
+};
+
+static const uint16_t crc16_table[256] = {
+    0x0000,0x1189,0x2312,0x329b,0x4624,0x57ad,0x6536,0x74bf,
+    0x8c48,0x9dc1,0xaf5a,0xbed3,0xca6c,0xdbe5,0xe97e,0xf8f7,
+    0x1081,0x0108,0x3393,0x221a,0x56a5,0x472c,0x75b7,0x643e,
+    0x9cc9,0x8d40,0xbfdb,0xae52,0xdaed,0xcb64,0xf9ff,0xe876,
+    0x2102,0x308b,0x0210,0x1399,0x6726,0x76af,0x4434,0x55bd,
+    0xad4a,0xbcc3,0x8e58,0x9fd1,0xeb6e,0xfae7,0xc87c,0xd9f5,
+    0x3183,0x200a,0x1291,0x0318,0x77a7,0x662e,0x54b5,0x453c,
+    0xbdcb,0xac42,0x9ed9,0x8f50,0xfbef,0xea66,0xd8fd,0xc974,
+    0x4204,0x538d,0x6116,0x709f,0x0420,0x15a9,0x2732,0x36bb,
+    0xce4c,0xdfc5,0xed5e,0xfcd7,0x8868,0x99e1,0xab7a,0xbaf3,
+    0x5285,0x430c,0x7197,0x601e,0x14a1,0x0528,0x37b3,0x263a,
+    0xdecd,0xcf44,0xfddf,0xec56,0x98e9,0x8960,0xbbfb,0xaa72,
+    0x6306,0x728f,0x4014,0x519d,0x2522,0x34ab,0x0630,0x17b9,
+    0xef4e,0xfec7,0xcc5c,0xddd5,0xa96a,0xb8e3,0x8a78,0x9bf1,
+    0x7387,0x620e,0x5095,0x411c,0x35a3,0x242a,0x16b1,0x0738,
+    0xffcf,0xee46,0xdcdd,0xcd54,0xb9eb,0xa862,0x9af9,0x8b70,
+    0x8408,0x9581,0xa71a,0xb693,0xc22c,0xd3a5,0xe13e,0xf0b7,
+    0x0840,0x19c9,0x2b52,0x3adb,0x4e64,0x5fed,0x6d76,0x7cff,
+    0x9489,0x8500,0xb79b,0xa612,0xd2ad,0xc324,0xf1bf,0xe036,
+    0x18c1,0x0948,0x3bd3,0x2a5a,0x5ee5,0x4f6c,0x7df7,0x6c7e,
+    0xa50a,0xb483,0x8618,0x9791,0xe32e,0xf2a7,0xc03c,0xd1b5,
+    0x2942,0x38cb,0x0a50,0x1bd9,0x6f66,0x7eef,0x4c74,0x5dfd,
+    0xb58b,0xa402,0x9699,0x8710,0xf3af,0xe226,0xd0bd,0xc134,
+    0x39c3,0x284a,0x1ad1,0x0b58,0x7fe7,0x6e6e,0x5cf5,0x4d7c,
+    0xc60c,0xd785,0xe51e,0xf497,0x8028,0x91a1,0xa33a,0xb2b3,
+    0x4a44,0x5bcd,0x6956,0x78df,0x0c60,0x1de9,0x2f72,0x3efb,
+    0xd68d,0xc704,0xf59f,0xe416,0x90a9,0x8120,0xb3bb,0xa232,
+    0x5ac5,0x4b4c,0x79d7,0x685e,0x1ce1,0x0d68,0x3ff3,0x2e7a,
+    0xe70e,0xf687,0xc41c,0xd595,0xa12a,0xb0a3,0x8238,0x93b1,
+    0x6b46,0x7acf,0x4854,0x59dd,0x2d62,0x3ceb,0x0e70,0x1ff9,
+    0xf78f,0xe606,0xd49d,0xc514,0xb1ab,0xa022,0x92b9,0x8330,
+    0x7bc7,0x6a4e,0x58d5,0x495c,0x3de3,0x2c6a,0x1ef1,0x0f78
+};
+
+/* Slicing-by-8 tables: [k][b] is the CRC of byte b followed by k zero bytes */
+static uint8_t  crc8_slice[8][256];
+static uint16_t crc16_slice[8][256];
+
+/* x^(8n) mod P for the CRC16 polynomial (reflected), n = 0..DUML_MAX_FRAME_LEN */
+static uint16_t crc16_xpow8[DUML_MAX_FRAME_LEN + 1];
+
+/* ---------- Kernels ---------- */
+
+static uint8_t crc8_table_kernel(uint8_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        crc = crc8_table[crc ^ data[i]];
+    return crc;
+}
+
+static uint16_t crc16_table_kernel(uint16_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        crc = crc16_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static inline uint64_t read_u64_le(const uint8_t *p) {
+    return  (uint64_t)p[0]        | ((uint64_t)p[1] << 8)  |
+           ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+           ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+uint8_t rcm_priv_crc8_slice8(uint8_t crc, const uint8_t *data, size_t len) {
+    while (len >= 8) {
+        uint64_t v = read_u64_le(data) ^ crc;
+        crc = crc8_slice[7][v & 0xFF]         ^ crc8_slice[6][(v >> 8) & 0xFF]  ^
+              crc8_slice[5][(v >> 16) & 0xFF] ^ crc8_slice[4][(v >> 24) & 0xFF] ^
+              crc8_slice[3][(v >> 32) & 0xFF] ^ crc8_slice[2][(v >> 40) & 0xFF] ^
+              crc8_slice[1][(v >> 48) & 0xFF] ^ crc8_slice[0][v >> 56];
+        data += 8;
+        len -= 8;
+    }
+    return crc8_table_kernel(crc, data, len);
+}
+
+uint16_t rcm_priv_crc16_slice8(uint16_t crc, const uint8_t *data, size_t len) {
+    while (len >= 8) {
+        uint64_t v = read_u64_le(data) ^ crc;
+        crc = crc16_slice[7][v & 0xFF]         ^ crc16_slice[6][(v >> 8) & 0xFF]  ^
+              crc16_slice[5][(v >> 16) & 0xFF] ^ crc16_slice[4][(v >> 24) & 0xFF] ^
+              crc16_slice[3][(v >> 32) & 0xFF] ^ crc16_slice[2][(v >> 40) & 0xFF] ^
+              crc16_slice[1][(v >> 48) & 0xFF] ^ crc16_slice[0][v >> 56];
+        data += 8;
+        len -= 8;
+    }
+    return crc16_table_kernel(crc, data, len);
+}
+
+/* ---------- Dispatch ---------- */
+
+typedef struct {
+    const char *name;
+    uint8_t  (*crc8)(uint8_t crc, const uint8_t *data, size_t len);
+    uint16_t (*crc16)(uint16_t crc, const uint8_t *data, size_t len);
+} crc_kernel_ops_t;
+
+static const crc_kernel_ops_t g_kernels[RCM_CRC_KERNEL_COUNT] = {
+    [RCM_CRC_KERNEL_TABLE]  = { "table",  crc8_table_kernel,    crc16_table_kernel },
+    [RCM_CRC_KERNEL_SLICE8] = { "slice8", rcm_priv_crc8_slice8, rcm_priv_crc16_slice8 },
+    [RCM_CRC_KERNEL_CLMUL]  = { "clmul",  rcm_priv_crc8_clmul,  rcm_priv_crc16_clmul },
+};
+
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+static _Atomic int    g_active = -1;
+static bool           g_clmul_cpu;  /* CPUID/HWCAP result, written once by crc_init() */
+
+/*
+ * Compare kernel `k` against the table kernel over every length in
+ * [0, max_len] at `offsets` different buffer alignments, for both seeds.
+ */
+static int kernel_agrees(rcm_crc_kernel_t k, size_t max_len, size_t offsets) {
+    uint8_t buf[DUML_MAX_FRAME_LEN + 16];
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(x >> 16);
+    }
+
+    const crc_kernel_ops_t *ops = &g_kernels[k];
+    for (size_t off = 0; off < offsets; off++) {
+        for (size_t len = 0; len <= max_len; len++) {
+            if (ops->crc8(DUML_CRC8_SEED, buf + off, len) !=
+                crc8_table_kernel(DUML_CRC8_SEED, buf + off, len))
+                return 0;
+            if (ops->crc16(DUML_CRC16_SEED, buf + off, len) !=
+                crc16_table_kernel(DUML_CRC16_SEED, buf + off, len))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static void crc_init(void) {
+    for (int b = 0; b < 256; b++) {
+        crc8_slice[0][b]  = crc8_table[b];
+        crc16_slice[0][b] = crc16_table[b];
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int b = 0; b < 256; b++) {
+            uint8_t  c8  = crc8_slice[k - 1][b];
+            uint16_t c16 = crc16_slice[k - 1][b];
+            crc8_slice[k][b]  = crc8_table[c8];
+            crc16_slice[k][b] = crc16_table[c16 & 0xFF] ^ (c16 >> 8);
+        }
+    }
+
+    crc16_xpow8[0] = 0x8000; /* x^0 */
+    for (size_t n = 1; n <= DUML_MAX_FRAME_LEN; n++) {
+        uint16_t c = crc16_xpow8[n - 1];
+        crc16_xpow8[n] = crc16_table[c & 0xFF] ^ (c >> 8); /* one zero byte */
+    }
+
+    /* Probed once: CPUID traps to the hypervisor in VMs and costs microseconds */
+    g_clmul_cpu = rcm_priv_clmul_supported();
+    int best = RCM_CRC_KERNEL_SLICE8;
+    if (g_clmul_cpu && kernel_agrees(RCM_CRC_KERNEL_CLMUL, 96, 2))
+        best = RCM_CRC_KERNEL_CLMUL;
+    atomic_store_explicit(&g_active, best, memory_order_release);
+}
+
+static const crc_kernel_ops_t *crc_engine(void) {
+    int k = atomic_load_explicit(&g_active, memory_order_acquire);
+    if (k < 0) {
+        pthread_once(&g_crc_once, crc_init);
+        k = atomic_load_explicit(&g_active, memory_order_acquire);
+    }
+    return &g_kernels[k];
+}
+
+/* ---------- Range arithmetic ---------- */
+
+/*
+ * Multiply two polynomials modulo the CRC16 polynomial, both in the
+ * reflected bit order the register uses (bit 15 is x^0).
+ */
+static uint16_t crc16_mulmod(uint16_t a, uint16_t b) {
+    uint16_t prod = 0;
+    for (uint16_t m = 0x8000; m; m >>= 1) {
+        if (a & m) prod ^= b;
+        b = (b & 1) ? (uint16_t)((b >> 1) ^ 0x8408) : (uint16_t)(b >> 1);
+    }
+    return prod;
+}
+
+uint16_t rcm_priv_crc16_shift(uint16_t crc, size_t n) {
+    crc_engine();
+    while (n > DUML_MAX_FRAME_LEN) {
+        crc = crc16_mulmod(crc16_xpow8[DUML_MAX_FRAME_LEN], crc);
+        n -= DUML_MAX_FRAME_LEN;
+    }
+    return crc16_mulmod(crc16_xpow8[n], crc);
+}
+
+uint16_t rcm_priv_crc16_prefix(uint16_t crc, const uint8_t *data, size_t len,
+                               uint16_t *ring, size_t mask, uint64_t first) {
+    for (size_t i = 0; i < len; i++) {
+        crc = crc16_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        ring[(first + i + 1) & mask] = crc;
+    }
+    return crc;
+}
+
+/* ---------- Public API ---------- */
+
+uint8_t rcm_crc8_update(uint8_t crc, const uint8_t *data, size_t len) {
+    if (!data) return crc;
+    return crc_engine()->crc8(crc, data, len);
+}
+
+uint16_t rcm_crc16_update(uint16_t crc, const uint8_t *data, size_t len) {
+    if (!data) return crc;
+    return crc_engine()->crc16(crc, data, len);
+}
+
+bool rcm_crc_kernel_supported(rcm_crc_kernel_t k) {
+    switch (k) {
+        case RCM_CRC_KERNEL_TABLE:
+        case RCM_CRC_KERNEL_SLICE8: return true;
+        case RCM_CRC_KERNEL_CLMUL:  crc_engine(); return g_clmul_cpu;
+        default:                    return false;
+    }
+}
+
+int rcm_crc_select(rcm_crc_kernel_t k) {
+    if (!rcm_crc_kernel_supported(k))
+        return -1;
+    crc_engine(); /* make sure the slicing tables exist */
+    atomic_store_explicit(&g_active, (int)k, memory_order_release);
+    return 0;
+}
+
+rcm_crc_kernel_t rcm_crc_active_kernel(void) {
+    return (rcm_crc_kernel_t)(crc_engine() - g_kernels);
+}
+
+const char *rcm_crc_kernel_name(rcm_crc_kernel_t k) {
+    if ((unsigned)k >= RCM_CRC_KERNEL_COUNT)
+        return "unknown";
+    return g_kernels[k].name;
+}
+
+uint8_t rcm_crc8_kernel(rcm_crc_kernel_t k, uint8_t crc,
+                        const uint8_t *data, size_t len) {
+    if (!data) return crc;
+    crc_engine();
+    if (!rcm_crc_kernel_supported(k))
+        k = RCM_CRC_KERNEL_TABLE;
+    return g_kernels[k].crc8(crc, data, len);
+}
+
+uint16_t rcm_crc16_kernel(rcm_crc_kernel_t k, uint16_t crc,
+                          const uint8_t *data, size_t len) {
+    if (!data) return crc;
+    crc_engine();
+    if (!rcm_crc_kernel_supported(k))
+        k = RCM_CRC_KERNEL_TABLE;
+    return g_kernels[k].crc16(crc, data, len);
+}
+
+int rcm_crc_self_test(void) {
+    crc_engine();
+    for (int k = 0; k < RCM_CRC_KERNEL_COUNT; k++) {
+        if (!rcm_crc_kernel_supported((rcm_crc_kernel_t)k))
+            continue;
+        if (!kernel_agrees((rcm_crc_kernel_t)k, DUML_MAX_FRAME_LEN, 4))
+            return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * rc_monitor_crc_clmul.c - Carry-less multiply CRC kernel
+ *
+ * Folds the message 16 bytes at a time with PCLMULQDQ (x86-64) or PMULL
+ * (arm64), then hands the 128-bit remainder and any tail to slicing-by-8.
+ * This is the only file built with ISA extension flags (see CMakeLists.txt);
+ * the dispatcher in rc_monitor_crc.c only calls in here after
+ * rcm_priv_clmul_supported() has confirmed the CPU feature at runtime.
+ *
+ * The ARMv8 CRC32 instructions only implement the CRC-32 and CRC-32C
+ * polynomials, so they cannot compute DUML's CRC8/CRC16; PMULL folding is
+ * the arm64 hardware path.
+ *
+ * Folding math, in the reflected bit order DUML uses (a 16-byte block loaded
+ * little-endian has byte 0 bit 0 as its highest-degree coefficient, x^127):
+ *
+ *   X = A0·x^64 + A1           (A0 = low 64-bit lane, A1 = high lane)
+ *   X·x^128 + D ≡ A0·(x^191 mod P)·x + A1·(x^127 mod P)·x + D   (mod P)
+ *
+ * A reflected 64x64 carry-less product already carries the extra factor of
+ * x, so each fold is two multiplies and two XORs, and the result stays
+ * congruent to the message so far. The final 16-byte remainder X satisfies
+ * CRC(0, X) == CRC(0, message so far), which slicing-by-8 finishes off.
+ *
+ * Constants are x^191 mod P and x^127 mod P with the x^t coefficient stored
+ * in bit (63 - t):
+ *   CRC16 (P = x^16+x^12+x^5+1): 0xa95d000000000000, 0x7eea000000000000
+ *   CRC8  (P = x^8+x^5+x^4+1):   0x9200000000000000, 0x8000000000000000
+ */
+
+#include "rc_monitor_internal.h"
+
+#if defined(__x86_64__) && defined(__PCLMUL__)
+#define RCM_CLMUL_X86 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#define RCM_CLMUL_ARM64 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+#define CRC16_K191  0xa95d000000000000ULL
+#define CRC16_K127  0x7eea000000000000ULL
+#define CRC8_K191   0x9200000000000000ULL
+#define CRC8_K127   0x8000000000000000ULL
+
+/* Below this the fold setup costs more than it saves */
+#define CLMUL_MIN_LEN 32
+
+#if defined(RCM_CLMUL_X86)
+
+bool rcm_priv_clmul_supported(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (ecx & bit_PCLMUL) != 0;
+}
+
+/* Fold all whole 16-byte blocks; returns the remainder in `rem` */
+static const uint8_t *clmul_fold(uint32_t crc, const uint8_t *data, size_t *len,
+                                 uint64_t k191, uint64_t k127, uint8_t rem[16]) {
+    const __m128i k = _mm_set_epi64x((long long)k127, (long long)k191);
+    __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)data),
+                              _mm_cvtsi32_si128((int)crc));
+    data += 16;
+    *len -= 16;
+    while (*len >= 16) {
+        __m128i hi = _mm_clmulepi64_si128(x, k, 0x00);
+        __m128i lo = _mm_clmulepi64_si128(x, k, 0x11);
+        x = _mm_xor_si128(_mm_xor_si128(hi, lo),
+                          _mm_loadu_si128((const __m128i *)data));
+        data += 16;
+        *len -= 16;
+    }
+    _mm_storeu_si128((__m128i *)rem, x);
+    return data;
+}
+
+#elif defined(RCM_CLMUL_ARM64)
+
+bool rcm_priv_clmul_supported(void) {
+#if defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+#else
+    return true; /* e.g. Apple silicon: PMULL is part of the baseline */
+#endif
+}
+
+static const uint8_t *clmul_fold(uint32_t crc, const uint8_t *data, size_t *len,
+                                 uint64_t k191, uint64_t k127, uint8_t rem[16]) {
+    uint64x2_t x = vreinterpretq_u64_u8(vld1q_u8(data));
+    x = veorq_u64(x, vcombine_u64(vcreate_u64(crc), vcreate_u64(0)));
+    data += 16;
+    *len -= 16;
+    while (*len >= 16) {
+        poly128_t hi = vmull_p64((poly64_t)vgetq_lane_u64(x, 0), (poly64_t)k191);
+        poly128_t lo = vmull_p64((poly64_t)vgetq_lane_u64(x, 1), (poly64_t)k127);
+        x = veorq_u64(veorq_u64(vreinterpretq_u64_p128(hi),
+                                vreinterpretq_u64_p128(lo)),
+                      vreinterpretq_u64_u8(vld1q_u8(data)));
+        data += 16;
+        *len -= 16;
+    }
+    vst1q_u8(rem, vreinterpretq_u8_u64(x));
+    return data;
+}
+
+#endif
+
+#if defined(RCM_CLMUL_X86) || defined(RCM_CLMUL_ARM64)
+
+uint8_t rcm_priv_crc8_clmul(uint8_t crc, const uint8_t *data, size_t len) {
+    if (len < CLMUL_MIN_LEN)
+        return rcm_priv_crc8_slice8(crc, data, len);
+    uint8_t rem[16];
+    data = clmul_fold(crc, data, &len, CRC8_K191, CRC8_K127, rem);
+    return rcm_priv_crc8_slice8(rcm_priv_crc8_slice8(0, rem, 16), data, len);
+}
+
+uint16_t rcm_priv_crc16_clmul(uint16_t crc, const uint8_t *data, size_t len) {
+    if (len < CLMUL_MIN_LEN)
+        return rcm_priv_crc16_slice8(crc, data, len);
+    uint8_t rem[16];
+    data = clmul_fold(crc, data, &len, CRC16_K191, CRC16_K127, rem);
+    return rcm_priv_crc16_slice8(rcm_priv_crc16_slice8(0, rem, 16), data, len);
+}
+
+#else /* no carry-less multiply on this target */
+
+bool rcm_priv_clmul_supported(void) {
+    return false;
+}
+
+uint8_t rcm_priv_crc8_clmul(uint8_t crc, const uint8_t *data, size_t len) {
+    return rcm_priv_crc8_slice8(crc, data, len);
+}
+
+uint16_t rcm_priv_crc16_clmul(uint16_t crc, const uint8_t *data, size_t len) {
+    return rcm_priv_crc16_slice8(crc, data, len);
+}
+
+#endif
@@ -0,0 +1,554 @@
+/*
+ * rc_monitor_decode.c - Parallel offline decoder and columnar files
+ *
+ * Positions below are offsets into the capture buffer. IN data keeps its
+ * stream order in the file, so "before" in the stream is "at a lower
+ * offset", for captures and raw recordings alike.
+ *
+ * Segment k nominally covers [split[k], split[k+1]): split points are chunk
+ * header offsets taken from the footer index (or a chunk header walk when
+ * there is none), or plain byte offsets for raw recordings. Phase one moves
+ * each segment start to the first fully CRC-valid frame at or after its
+ * split point, still before the next one; a segment without such a frame
+ * is folded into its predecessor. Phase two decodes each segment from its
+ * start, through the next segment's start and at most DUML_MAX_FRAME_LEN
+ * bytes further, keeping the pushes whose SOF is before that next start.
+ * Both phases hand segments to the same threads through an atomic counter.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+
+#include "rc_monitor_decode.h"
+#include "rc_monitor_capture.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DEFAULT_SEGMENT_BYTES (4u << 20)
+
+/* Bytes per rcm_feed_batch() call, and room for every push it can complete
+ * (this span plus a staged partial frame), so nothing overflows to the
+ * callback */
+#define FEED_SPAN  4096
+#define BATCH_MAX  ((FEED_SPAN + DUML_MAX_FRAME_LEN) / DUML_MIN_FRAME_LEN + 1)
+
+static const uint8_t k_magic[4] = { 'R', 'C', 'M', 'S' };
+
+/* Element size of each RCM_COL_* column */
+static const uint8_t k_col_size[RCM_COL_COUNT] = { 8, 2, 2, 2, 2, 2, 2, 1, 2 };
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_u32(uint8_t *p, uint32_t v) { put_u16(p, (uint16_t)v); put_u16(p + 2, (uint16_t)(v >> 16)); }
+static void put_u64(uint8_t *p, uint64_t v) { put_u32(p, (uint32_t)v); put_u32(p + 4, (uint32_t)(v >> 32)); }
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const uint8_t *p) { return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+static uint64_t get_u64(const uint8_t *p) { return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32); }
+
+static size_t align_up(size_t n) {
+    return (n + RCM_COLUMNS_ALIGN - 1) & ~(size_t)(RCM_COLUMNS_ALIGN - 1);
+}
+
+/* ---------- IN data cursor ---------- */
+
+typedef struct {
+    rcm_capture_view_t  v;      /* v.pos: the chunk after `c` */
+    rcm_capture_chunk_t c;      /* current IN chunk, valid if `valid` */
+    size_t              off;    /* next byte within c.data */
+    bool                valid;
+    bool                bad;    /* stopped at a malformed chunk */
+} cursor_t;
+
+/* Step to the next non-empty IN chunk */
+static bool cursor_next_chunk(cursor_t *cur) {
+    int got;
+    while ((got = rcm_capture_view_next(&cur->v, &cur->c)) > 0) {
+        if (cur->c.dir == RCM_CAPTURE_IN && cur->c.len > 0) {
+            cur->off = 0;
+            return cur->valid = true;
+        }
+    }
+    if (got < 0) cur->bad = true;
+    return cur->valid = false;
+}
+
+/* Cursor at the first IN byte of the chunk (or raw offset) at `pos` */
+static void cursor_init(cursor_t *cur, const rcm_capture_view_t *v, size_t pos) {
+    memset(cur, 0, sizeof(*cur));
+    cur->v = *v;
+    cur->v.pos = pos;
+    cursor_next_chunk(cur);
+}
+
+static size_t cursor_pos(const cursor_t *cur) {
+    return (size_t)(cur->c.data - cur->v.base) + cur->off;
+}
+
+/* Copy up to n bytes from the cursor on, across chunks, without moving it */
+static size_t cursor_peek(const cursor_t *cur, uint8_t *buf, size_t n) {
+    if (!cur->valid) return 0;
+    size_t have = cur->c.len - cur->off;
+    if (have >= n) {
+        memcpy(buf, cur->c.data + cur->off, n);
+        return n;
+    }
+    memcpy(buf, cur->c.data + cur->off, have);
+    cursor_t tmp = *cur;
+    while (have < n && cursor_next_chunk(&tmp)) {
+        size_t k = tmp.c.len < n - have ? tmp.c.len : n - have;
+        memcpy(buf + have, tmp.c.data, k);
+        have += k;
+    }
+    return have;
+}
+
+/* True if a complete frame passing CRC8 and CRC16 starts at the cursor */
+static bool frame_at(const cursor_t *cur, uint8_t *tmp) {
+    if (cursor_peek(cur, tmp, 4) < 4) return false;
+    size_t len = get_u16(tmp + 1) & 0x03FF;
+    if (len < DUML_MIN_FRAME_LEN || len > DUML_MAX_FRAME_LEN ||
+        rcm_crc8_update(DUML_CRC8_SEED, tmp, 3) != tmp[3])
+        return false;
+    if (cursor_peek(cur, tmp, len) < len) return false;
+    return rcm_crc16_update(DUML_CRC16_SEED, tmp, len - 2) == get_u16(tmp + len - 2);
+}
+
+/* Move the cursor to the first valid frame before position `limit` */
+static bool find_sync(cursor_t *cur, size_t limit) {
+    uint8_t tmp[DUML_MAX_FRAME_LEN];
+    while (cur->valid && cursor_pos(cur) < limit) {
+        const uint8_t *d = cur->c.data + cur->off;
+        const uint8_t *s = (const uint8_t *)memchr(d, DUML_SOF, cur->c.len - cur->off);
+        if (!s) {
+            cursor_next_chunk(cur);
+            continue;
+        }
+        cur->off += (size_t)(s - d);
+        if (cursor_pos(cur) >= limit) break;
+        if (frame_at(cur, tmp)) return true;
+        if (++cur->off == cur->c.len) cursor_next_chunk(cur);
+    }
+    return false;
+}
+
+/* ---------- Segments and workers ---------- */
+
+typedef struct {
+    uint64_t           t_ns;
+    rcm_packed_state_t s;
+} row_t;
+
+/* Where an IN chunk starts in a worker's stream, for timestamping rows */
+typedef struct {
+    uint64_t at;
+    uint64_t t_ns;
+} mark_t;
+
+typedef struct {
+    rcm_parser_t      *p;
+    rcm_batch_entry_t *batch;
+    mark_t            *marks;   /* chunks fed in the current segment */
+    size_t             nmarks;
+    size_t             cap;
+} worker_t;
+
+typedef struct {
+    size_t   split;      /* nominal start */
+    cursor_t start;      /* first valid frame, if `found` */
+    bool     found;
+    size_t   stop;       /* position of the next found segment start, SIZE_MAX if none */
+    row_t   *rows;
+    size_t   count;
+    size_t   cap;
+    bool     bad;
+} segment_t;
+
+typedef struct {
+    rcm_capture_view_t v;
+    segment_t         *seg;
+    size_t             nseg;
+    int                phase;        /* 1: find starts, 2: decode */
+    atomic_size_t      next;
+    atomic_bool        failed;       /* allocation failure */
+} job_t;
+
+static void discard_cb(const rc_state_t *s, void *ud) {
+    (void)s; (void)ud; /* never reached: BATCH_MAX holds every push of a span */
+}
+
+static bool append_row(segment_t *seg, uint64_t t_ns, const rc_state_t *s) {
+    if (seg->count == seg->cap) {
+        size_t cap = seg->cap ? seg->cap * 2 : 1024;
+        row_t *rows = (row_t *)realloc(seg->rows, cap * sizeof(*rows));
+        if (!rows) return false;
+        seg->rows = rows;
+        seg->cap = cap;
+    }
+    row_t *r = &seg->rows[seg->count++];
+    r->t_ns = t_ns;
+    rcm_pack_state(s, &r->s);
+    return true;
+}
+
+static void find_start(job_t *job, size_t k) {
+    segment_t *seg = &job->seg[k];
+    size_t limit = k + 1 < job->nseg ? job->seg[k + 1].split : SIZE_MAX;
+    cursor_init(&seg->start, &job->v, seg->split);
+    seg->found = find_sync(&seg->start, limit);
+    if (seg->start.bad) seg->bad = true;
+}
+
+static bool add_mark(worker_t *wk, uint64_t at, uint64_t t_ns) {
+    if (wk->nmarks == wk->cap) {
+        size_t cap = wk->cap ? wk->cap * 2 : 256;
+        mark_t *m = (mark_t *)realloc(wk->marks, cap * sizeof(*m));
+        if (!m) return false;
+        wk->marks = m;
+        wk->cap = cap;
+    }
+    wk->marks[wk->nmarks++] = (mark_t){ at, t_ns };
+    return true;
+}
+
+static bool decode_segment(segment_t *seg, worker_t *wk) {
+    cursor_t cur = seg->start;
+    uint64_t fed = 0, stop_at = UINT64_MAX;
+    bool stop_known = false;
+    size_t mi = 0; /* mark of the last row's SOF; SOFs only move forward */
+
+    rcm_reset(wk->p);
+    wk->nmarks = 0;
+    while (cur.valid) {
+        const uint8_t *d = cur.c.data + cur.off;
+        size_t n = cur.c.len - cur.off;
+        size_t here = cursor_pos(&cur);
+        if (!stop_known && seg->stop != SIZE_MAX && seg->stop >= here &&
+            seg->stop - here < n) {
+            stop_at = fed + (seg->stop - here);
+            stop_known = true;
+        }
+        if (stop_known) {
+            uint64_t lim = stop_at + DUML_MAX_FRAME_LEN;
+            if (fed >= lim) break;
+            if (n > lim - fed) n = (size_t)(lim - fed);
+        }
+        if (!add_mark(wk, fed, cur.c.t_ns)) return false;
+        for (size_t o = 0; o < n; ) {
+            size_t k = n - o < FEED_SPAN ? n - o : FEED_SPAN;
+            int got = rcm_feed_batch(wk->p, d + o, k, wk->batch, BATCH_MAX);
+            for (int i = 0; i < got; i++) {
+                uint64_t at = (uint64_t)((int64_t)(fed + o) + wk->batch[i].offset);
+                if (at >= stop_at) continue; /* the next segment's */
+                while (mi + 1 < wk->nmarks && wk->marks[mi + 1].at <= at)
+                    mi++;
+                if (!append_row(seg, wk->marks[mi].t_ns, &wk->batch[i].state))
+                    return false;
+            }
+            o += k;
+        }
+        fed += n;
+        cursor_next_chunk(&cur);
+    }
+    if (cur.bad) seg->bad = true;
+    return true;
+}
+
+static void *worker(void *arg) {
+    job_t *job = (job_t *)arg;
+    worker_t wk = { 0 };
+    if (job->phase == 2) {
+        wk.p = rcm_create(discard_cb, NULL);
+        wk.batch = (rcm_batch_entry_t *)malloc(BATCH_MAX * sizeof(*wk.batch));
+        if (!wk.p || !wk.batch) {
+            atomic_store(&job->failed, true);
+            goto out;
+        }
+    }
+    size_t k;
+    while ((k = atomic_fetch_add(&job->next, 1)) < job->nseg &&
+           !atomic_load_explicit(&job->failed, memory_order_relaxed)) {
+        if (job->phase == 1)
+            find_start(job, k);
+        else if (job->seg[k].found && !decode_segment(&job->seg[k], &wk))
+            atomic_store(&job->failed, true);
+    }
+out:
+    free(wk.marks);
+    free(wk.batch);
+    rcm_destroy(wk.p);
+    return NULL;
+}
+
+/* Run one phase on `threads` threads, the calling one included */
+static void run_phase(job_t *job, int phase, unsigned threads) {
+    job->phase = phase;
+    atomic_store(&job->next, 0);
+    pthread_t tid[64];
+    unsigned started = 0;
+    if (threads > 64) threads = 64;
+    while (started + 1 < threads &&
+           pthread_create(&tid[started], NULL, worker, job) == 0)
+        started++;
+    worker(job);
+    for (unsigned i = 0; i < started; i++)
+        pthread_join(tid[i], NULL);
+}
+
+/* Nominal segment starts: chunk header offsets, or byte offsets for raw */
+static size_t *split_points(const rcm_capture_view_t *v, size_t seg_bytes,
+                            size_t *count, bool *bad) {
+    size_t cap = v->size / seg_bytes + 2, n = 0;
+    size_t *split = (size_t *)malloc(cap * sizeof(*split));
+    if (!split) return NULL;
+    split[n++] = v->data_start;
+
+    if (v->raw) {
+        for (size_t pos = seg_bytes; pos < v->size && n < cap; pos += seg_bytes)
+            split[n++] = pos;
+    } else if (v->index_len) {
+        for (size_t i = 0; i < v->index_len && n < cap; i++) {
+            uint64_t off;
+            rcm_capture_view_index(v, i, NULL, &off);
+            if (off >= v->data_start && off < v->data_end &&
+                off >= split[n - 1] + seg_bytes)
+                split[n++] = (size_t)off;
+        }
+    } else {
+        rcm_capture_view_t w = *v;
+        rcm_capture_chunk_t c;
+        int got;
+        while ((got = rcm_capture_view_next(&w, &c)) > 0) {
+            if (c.offset >= split[n - 1] + seg_bytes && n < cap)
+                split[n++] = (size_t)c.offset;
+        }
+        if (got < 0) *bad = true;
+    }
+    *count = n;
+    return split;
+}
+
+/* ---------- Columns ---------- */
+
+/* Column offsets for `rows` rows; returns the block length */
+static size_t columns_layout(size_t rows, size_t off[RCM_COL_COUNT]) {
+    size_t pos = align_up(RCM_COLUMNS_HEADER_LEN + RCM_COL_COUNT * RCM_COLUMNS_DIR_LEN);
+    for (int i = 0; i < RCM_COL_COUNT; i++) {
+        off[i] = pos;
+        pos = align_up(pos + rows * k_col_size[i]);
+    }
+    return pos;
+}
+
+static void columns_bind(rcm_columns_t *c, uint8_t *block, const uint64_t off[RCM_COL_COUNT]) {
+    c->t_ns              = (uint64_t *)(void *)(block + off[RCM_COL_T_NS]);
+    c->stick_right_h     = (int16_t *)(void *)(block + off[RCM_COL_STICK_RIGHT_H]);
+    c->stick_right_v     = (int16_t *)(void *)(block + off[RCM_COL_STICK_RIGHT_V]);
+    c->stick_left_h      = (int16_t *)(void *)(block + off[RCM_COL_STICK_LEFT_H]);
+    c->stick_left_v      = (int16_t *)(void *)(block + off[RCM_COL_STICK_LEFT_V]);
+    c->left_wheel        = (int16_t *)(void *)(block + off[RCM_COL_LEFT_WHEEL]);
+    c->right_wheel       = (int16_t *)(void *)(block + off[RCM_COL_RIGHT_WHEEL]);
+    c->right_wheel_delta = (int8_t *)(void *)(block + off[RCM_COL_WHEEL_DELTA]);
+    c->flags             = (uint16_t *)(void *)(block + off[RCM_COL_FLAGS]);
+}
+
+static int columns_alloc(rcm_columns_t *c, size_t rows) {
+    size_t off[RCM_COL_COUNT];
+    size_t len = columns_layout(rows, off);
+    uint8_t *block = (uint8_t *)calloc(1, len);
+    if (!block) return -1;
+
+    memcpy(block, k_magic, 4);
+    put_u16(block + 4, RCM_COLUMNS_VERSION);
+    put_u16(block + 6, RCM_COLUMNS_HEADER_LEN);
+    put_u32(block + 8, RCM_COL_COUNT);
+    put_u64(block + 16, rows);
+    uint64_t off64[RCM_COL_COUNT];
+    for (int i = 0; i < RCM_COL_COUNT; i++) {
+        uint8_t *e = block + RCM_COLUMNS_HEADER_LEN + (size_t)i * RCM_COLUMNS_DIR_LEN;
+        put_u32(e, (uint32_t)i);
+        put_u32(e + 4, k_col_size[i]);
+        put_u64(e + 8, off[i]);
+        off64[i] = off[i];
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->count = rows;
+    c->block = block;
+    c->block_len = len;
+    columns_bind(c, block, off64);
+    return 0;
+}
+
+static void columns_fill(rcm_columns_t *c, size_t at, const row_t *rows, size_t n) {
+    for (size_t i = 0; i < n; i++, at++) {
+        const rcm_packed_state_t *s = &rows[i].s;
+        c->t_ns[at]              = rows[i].t_ns;
+        c->stick_right_h[at]     = s->stick_right_h;
+        c->stick_right_v[at]     = s->stick_right_v;
+        c->stick_left_h[at]      = s->stick_left_h;
+        c->stick_left_v[at]      = s->stick_left_v;
+        c->left_wheel[at]        = s->left_wheel;
+        c->right_wheel[at]       = s->right_wheel;
+        c->right_wheel_delta[at] = s->right_wheel_delta;
+        c->flags[at]             = s->flags;
+    }
+}
+
+/* ---------- Public API ---------- */
+
+int rcm_decode_capture(const void *base, size_t size, const rcm_decode_config_t *cfg,
+                       rcm_columns_t *out) {
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    job_t job;
+    memset(&job, 0, sizeof(job));
+    if (rcm_capture_view_init(&job.v, base, size) != 0) return -1;
+
+    unsigned threads = cfg ? cfg->threads : 0;
+    size_t seg_bytes = cfg && cfg->segment_bytes ? cfg->segment_bytes : DEFAULT_SEGMENT_BYTES;
+    if (threads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (unsigned)n : 1;
+    }
+
+    bool bad = false;
+    size_t nsplit;
+    size_t *split = split_points(&job.v, seg_bytes, &nsplit, &bad);
+    if (!split) return -1;
+    job.seg = (segment_t *)calloc(nsplit, sizeof(*job.seg));
+    if (!job.seg) {
+        free(split);
+        return -1;
+    }
+    job.nseg = nsplit;
+    for (size_t k = 0; k < nsplit; k++)
+        job.seg[k].split = split[k];
+    free(split);
+    if (threads > job.nseg) threads = (unsigned)job.nseg;
+
+    run_phase(&job, 1, threads);
+    size_t stop = SIZE_MAX;
+    for (size_t k = job.nseg; k-- > 0; ) {
+        job.seg[k].stop = stop;
+        if (job.seg[k].found) stop = cursor_pos(&job.seg[k].start);
+    }
+    run_phase(&job, 2, threads);
+
+    size_t rows = 0;
+    for (size_t k = 0; k < job.nseg; k++) {
+        rows += job.seg[k].count;
+        bad |= job.seg[k].bad;
+    }
+    int rc = -1;
+    if (!atomic_load(&job.failed) && columns_alloc(out, rows) == 0) {
+        size_t at = 0;
+        for (size_t k = 0; k < job.nseg; k++) {
+            columns_fill(out, at, job.seg[k].rows, job.seg[k].count);
+            at += job.seg[k].count;
+        }
+        rc = bad ? 1 : 0;
+    }
+    for (size_t k = 0; k < job.nseg; k++)
+        free(job.seg[k].rows);
+    free(job.seg);
+    return rc;
+}
+
+void rcm_columns_free(rcm_columns_t *c) {
+    if (!c) return;
+    if (c->mapped)
+        munmap(c->block, c->block_len);
+    else
+        free(c->block);
+    memset(c, 0, sizeof(*c));
+}
+
+int rcm_columns_write(const char *path, const rcm_columns_t *c) {
+    if (!path || !c || !c->block) {
+        errno = EINVAL;
+        return -1;
+    }
+    FILE *fp = fopen(path, "wb");
+    if (!fp) return -1;
+    size_t n = fwrite(c->block, 1, c->block_len, fp);
+    int err = errno;
+    if (fclose(fp) != 0 && n == c->block_len) return -1;
+    if (n != c->block_len) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+int rcm_columns_map(const char *path, rcm_columns_t *out) {
+    if (!path || !out) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(out, 0, sizeof(*out));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size < RCM_COLUMNS_HEADER_LEN) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    uint8_t *block = (uint8_t *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);
+    if (block == MAP_FAILED) {
+        errno = err;
+        return -1;
+    }
+
+    /* Validate the header and find every known column in the directory */
+    uint64_t rows = get_u64(block + 16);
+    size_t hdr_len = get_u16(block + 6);
+    uint32_t ncols = get_u32(block + 8);
+    uint64_t off[RCM_COL_COUNT];
+    bool have[RCM_COL_COUNT] = { false };
+    bool ok = memcmp(block, k_magic, 4) == 0 &&
+              get_u16(block + 4) == RCM_COLUMNS_VERSION &&
+              hdr_len >= RCM_COLUMNS_HEADER_LEN && ncols <= 4096 &&
+              hdr_len + (uint64_t)ncols * RCM_COLUMNS_DIR_LEN <= size &&
+              rows <= size;
+    for (uint32_t i = 0; ok && i < ncols; i++) {
+        const uint8_t *e = block + hdr_len + (size_t)i * RCM_COLUMNS_DIR_LEN;
+        uint32_t id = get_u32(e);
+        if (id >= RCM_COL_COUNT) continue; /* newer column */
+        uint64_t at = get_u64(e + 8);
+        ok = get_u32(e + 4) == k_col_size[id] && at % k_col_size[id] == 0 &&
+             at <= size && rows * k_col_size[id] <= size - at;
+        off[id] = at;
+        have[id] = true;
+    }
+    for (int i = 0; ok && i < RCM_COL_COUNT; i++)
+        ok = have[i];
+    if (!ok) {
+        munmap(block, size);
+        errno = EINVAL;
+        return -1;
+    }
+
+    out->count = (size_t)rows;
+    out->block = block;
+    out->block_len = size;
+    out->mapped = true;
+    columns_bind(out, block, off);
+    return 0;
+}
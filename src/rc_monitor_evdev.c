@@ -0,0 +1,235 @@
+/*
+ * rc_monitor_evdev.c - Native evdev stick reader
+ *
+ * One thread waits in epoll_wait() on the event device and an eventfd used
+ * for stop, then drains the device with read()s of up to EV_BATCH records.
+ * EV_ABS events write the mapped axis straight into the synthetic payload
+ * (uint16 LE, 0x400 center, the layout rcm_parse_payload() expects);
+ * SYN_REPORT hands that payload to rcm_feed_payload(). After SYN_DROPPED,
+ * events are discarded up to the next SYN_REPORT and the axes re-read with
+ * EVIOCGABS, as the evdev protocol requires.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* epoll_create1, eventfd flags */
+#endif
+
+#include "rc_monitor_evdev.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+/* input_event records per read() */
+#define EV_BATCH 64
+
+#define AXIS_CENTER 0x400
+
+/* Payload byte offset of each RCM_EVDEV_* slot */
+static const uint8_t k_axis_off[RCM_EVDEV_AXES] = { 5, 7, 9, 11 };
+
+struct rcm_evdev_reader {
+    rcm_parser_t      *parser;
+    rcm_evdev_config_t cfg;
+    pthread_t          thread;
+    int                epfd;
+    int                wake;           /* eventfd: stop */
+    _Atomic bool       stop;
+    _Atomic bool       running;
+
+    int8_t             slot_of[ABS_CNT]; /* ABS code -> slot, -1 = unmapped */
+    bool               dropped;        /* inside a SYN_DROPPED gap */
+    uint8_t            payload[RC_PUSH_PAYLOAD_LEN];
+};
+
+void rcm_evdev_config_init(rcm_evdev_config_t *cfg, int fd) {
+    if (!cfg) return;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->fd = fd;
+    cfg->abs_code[RCM_EVDEV_RIGHT_H] = ABS_X;
+    cfg->abs_code[RCM_EVDEV_RIGHT_V] = ABS_Y;
+    cfg->abs_code[RCM_EVDEV_LEFT_V]  = ABS_Z;
+    cfg->abs_code[RCM_EVDEV_LEFT_H]  = ABS_RZ;
+}
+
+static void put_le16(uint8_t *p, unsigned v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void set_axis(rcm_evdev_reader_t *r, int slot, int32_t raw) {
+    int32_t v = (int32_t)((float)raw * r->cfg.scale);
+    if (v < -AXIS_CENTER)          v = -AXIS_CENTER;
+    if (v > 0xFFFF - AXIS_CENTER)  v = 0xFFFF - AXIS_CENTER;
+    put_le16(r->payload + k_axis_off[slot], (unsigned)(AXIS_CENTER + v));
+}
+
+/* Re-read every mapped axis after a SYN_DROPPED gap */
+static void resync_axes(rcm_evdev_reader_t *r) {
+    for (int s = 0; s < RCM_EVDEV_AXES; s++) {
+        int code = r->cfg.abs_code[s];
+        struct input_absinfo ai;
+        if (code >= 0 && ioctl(r->cfg.fd, EVIOCGABS(code), &ai) == 0)
+            set_axis(r, s, ai.value);
+    }
+}
+
+/* Apply one batch of events; returns the number of states delivered */
+static int apply_events(rcm_evdev_reader_t *r, const struct input_event *ev, size_t n) {
+    int delivered = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (ev[i].type == EV_SYN) {
+            if (ev[i].code == SYN_DROPPED) {
+                r->dropped = true;
+            } else if (ev[i].code == SYN_REPORT) {
+                if (r->dropped) {
+                    r->dropped = false;
+                    resync_axes(r);
+                }
+                if (rcm_feed_payload(r->parser, r->payload, sizeof(r->payload)) > 0)
+                    delivered++;
+            }
+        } else if (ev[i].type == EV_ABS && !r->dropped && ev[i].code < ABS_CNT) {
+            int slot = r->slot_of[ev[i].code];
+            if (slot >= 0)
+                set_axis(r, slot, ev[i].value);
+        }
+    }
+    return delivered;
+}
+
+static void *reader_thread(void *arg) {
+    rcm_evdev_reader_t *r = (rcm_evdev_reader_t *)arg;
+    struct input_event ev[EV_BATCH];
+
+    while (!atomic_load_explicit(&r->stop, memory_order_acquire)) {
+        struct epoll_event out[2];
+        int n = epoll_wait(r->epfd, out, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        bool readable = false, gone = false;
+        for (int i = 0; i < n; i++) {
+            if (out[i].data.fd != r->cfg.fd) continue;
+            readable = (out[i].events & EPOLLIN) != 0;
+            gone = (out[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+        }
+        if (!readable) {
+            if (gone) break; /* device unplugged */
+            continue;        /* stop wake */
+        }
+
+        /* Drain everything queued; the fd is non-blocking */
+        int delivered = 0;
+        bool fatal = false;
+        for (;;) {
+            ssize_t got = read(r->cfg.fd, ev, sizeof(ev));
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                fatal = errno != EAGAIN;
+                break;
+            }
+            if (got == 0) {
+                fatal = true; /* EOF: not an event device, or it went away */
+                break;
+            }
+            rcm_trace_read(r->parser, 0);
+            delivered += apply_events(r, ev, (size_t)got / sizeof(ev[0]));
+            if ((size_t)got < sizeof(ev))
+                break;
+        }
+        if (delivered && r->cfg.after_feed)
+            r->cfg.after_feed(r->cfg.userdata);
+        if (fatal)
+            break;
+    }
+
+    atomic_store_explicit(&r->running, false, memory_order_release);
+    return NULL;
+}
+
+static void reader_free(rcm_evdev_reader_t *r) {
+    if (r->epfd >= 0) close(r->epfd);
+    if (r->wake >= 0) close(r->wake);
+    free(r);
+}
+
+rcm_evdev_reader_t *rcm_evdev_start(rcm_parser_t *parser, const rcm_evdev_config_t *cfg) {
+    if (!parser || !cfg || cfg->fd < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    for (int s = 0; s < RCM_EVDEV_AXES; s++) {
+        if (cfg->abs_code[s] >= ABS_CNT) {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+
+    rcm_evdev_reader_t *r = (rcm_evdev_reader_t *)calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->parser = parser;
+    r->cfg = *cfg;
+    if (r->cfg.scale == 0.0f)
+        r->cfg.scale = 660.0f / 32768.0f;
+    memset(r->slot_of, -1, sizeof(r->slot_of));
+    for (int s = 0; s < RCM_EVDEV_AXES; s++) {
+        if (cfg->abs_code[s] >= 0)
+            r->slot_of[cfg->abs_code[s]] = (int8_t)s;
+        put_le16(r->payload + k_axis_off[s], AXIS_CENTER);
+    }
+    put_le16(r->payload + 13, AXIS_CENTER); /* wheels: no evdev source */
+    put_le16(r->payload + 15, AXIS_CENTER);
+
+    r->epfd = epoll_create1(EPOLL_CLOEXEC);
+    r->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r->epfd < 0 || r->wake < 0) {
+        int err = errno;
+        reader_free(r);
+        errno = err;
+        return NULL;
+    }
+
+    /* Reads drain until EAGAIN, so the device fd must not block */
+    int fl = fcntl(cfg->fd, F_GETFL);
+    struct epoll_event e_dev  = { .events = EPOLLIN, .data.fd = cfg->fd };
+    struct epoll_event e_wake = { .events = EPOLLIN, .data.fd = r->wake };
+    if (fl < 0 || fcntl(cfg->fd, F_SETFL, fl | O_NONBLOCK) != 0 ||
+        epoll_ctl(r->epfd, EPOLL_CTL_ADD, cfg->fd, &e_dev) != 0 ||
+        epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->wake, &e_wake) != 0) {
+        int err = errno;
+        reader_free(r);
+        errno = err;
+        return NULL;
+    }
+
+    atomic_store(&r->running, true);
+    int err = pthread_create(&r->thread, NULL, reader_thread, r);
+    if (err != 0) {
+        reader_free(r);
+        errno = err;
+        return NULL;
+    }
+    return r;
+}
+
+bool rcm_evdev_running(const rcm_evdev_reader_t *r) {
+    return r && atomic_load_explicit(&r->running, memory_order_acquire);
+}
+
+void rcm_evdev_stop(rcm_evdev_reader_t *r) {
+    if (!r) return;
+    atomic_store_explicit(&r->stop, true, memory_order_release);
+    uint64_t one = 1;
+    (void)!write(r->wake, &one, sizeof(one));
+    pthread_join(r->thread, NULL);
+    reader_free(r);
+}
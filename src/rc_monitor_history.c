@@ -0,0 +1,292 @@
+/*
+ * rc_monitor_history.c - Windowed motion history
+ *
+ * The writer keeps the window as [head, next) in absolute sample numbers
+ * (uint32, wrapping; the ring index is the number masked). Per axis it
+ * holds a running int64 sum and two monotonic queues of sample numbers,
+ * ascending values for the minimum and descending for the maximum, so the
+ * front of each is the window's extreme; every sample enters and leaves
+ * each queue once. Button edges are counted per bit while in the window,
+ * and separately the sample number of each bit's latest press edge is
+ * kept for rcm_history_pressed_within(), which needs no window at all.
+ *
+ * Readers only ever touch the published statistics (a seqlock over 16
+ * words, like the parser's mailbox) and the press table, which live after
+ * a pad so polling them does not pull in the writer's lines.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* posix_memalign */
+#endif
+
+#include "rc_monitor_history.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIST_BUTTONS     12   /* bits of RCM_PK_BUTTON_MASK */
+#define HIST_STAT_WORDS  (sizeof(rcm_history_stats_t) / sizeof(uint64_t))
+
+_Static_assert(sizeof(rcm_history_stats_t) == 128, "rcm_history_stats_t layout");
+_Static_assert(offsetof(rcm_packed_state_t, right_wheel) ==
+               offsetof(rcm_packed_state_t, stick_right_h) + 5 * sizeof(int16_t),
+               "history axes are contiguous");
+
+typedef struct {
+    uint64_t           t_ns;
+    rcm_packed_state_t st;
+    uint16_t           down;   /* press edges of this sample */
+    uint16_t           up;     /* release edges */
+    uint8_t            pad[4];
+} hist_entry_t;
+
+_Static_assert(sizeof(hist_entry_t) == 32, "two history entries per cache line");
+
+typedef struct {
+    uint32_t *q;       /* capacity sample numbers */
+    uint32_t  front;
+    uint32_t  back;    /* one past the last; both masked on use */
+} hist_queue_t;
+
+struct rcm_history {
+    /* Writer */
+    hist_entry_t *ring;
+    uint32_t     *queue_mem;
+    uint32_t      mask;
+    uint64_t      window_ns;
+    uint32_t      head;                     /* oldest sample in the window */
+    uint32_t      next;                     /* number of the next sample */
+    int64_t       sum[RCM_HIST_AXES];
+    int32_t       wheel;
+    uint16_t      prev_flags;
+    uint16_t      down_mask;                /* bits with down_n != 0 */
+    uint16_t      up_mask;
+    uint32_t      down_n[HIST_BUTTONS];
+    uint32_t      up_n[HIST_BUTTONS];
+    hist_queue_t  minq[RCM_HIST_AXES];
+    hist_queue_t  maxq[RCM_HIST_AXES];
+
+    /* Readers */
+    uint8_t          pad[64];
+    _Atomic uint32_t st_seq;                /* odd while publishing */
+    _Atomic uint32_t samples;               /* == next, for pressed_within */
+    _Atomic uint64_t st_word[HIST_STAT_WORDS];
+    _Atomic uint32_t press_at[HIST_BUTTONS];  /* samples after the last press, 0 = never */
+};
+
+/* Axis `a` of a packed state: the six int16 fields are contiguous */
+static inline int16_t axis(const rcm_packed_state_t *s, int a) {
+    int16_t v;
+    memcpy(&v, (const uint8_t *)s + offsetof(rcm_packed_state_t, stick_right_h) +
+               (size_t)a * sizeof(int16_t), sizeof(v));
+    return v;
+}
+
+static inline int16_t sample_axis(const rcm_history_t *h, uint32_t n, int a) {
+    return axis(&h->ring[n & h->mask].st, a);
+}
+
+static inline void queue_push(const rcm_history_t *h, hist_queue_t *q, uint32_t n, int a, bool max) {
+    int16_t v = sample_axis(h, n, a);
+    while (q->back != q->front) {
+        int16_t b = sample_axis(h, q->q[(q->back - 1) & h->mask], a);
+        if (max ? b > v : b < v) break;
+        q->back--;
+    }
+    q->q[q->back++ & h->mask] = n;
+}
+
+static inline void queue_evict(const rcm_history_t *h, hist_queue_t *q, uint32_t n) {
+    if (q->back != q->front && q->q[q->front & h->mask] == n)
+        q->front++;
+}
+
+rcm_history_t *rcm_history_create(unsigned capacity, uint64_t window_ns) {
+    uint32_t cap = RCM_HISTORY_MIN_ENTRIES;
+    while (cap < capacity && cap < RCM_HISTORY_MAX_ENTRIES)
+        cap <<= 1;
+
+    rcm_history_t *h = calloc(1, sizeof(*h));
+    if (!h) return NULL;
+    void *ring = NULL;
+    if (posix_memalign(&ring, 64, (size_t)cap * sizeof(hist_entry_t)) != 0) {
+        free(h);
+        return NULL;
+    }
+    h->queue_mem = malloc((size_t)cap * 2 * RCM_HIST_AXES * sizeof(uint32_t));
+    if (!h->queue_mem) {
+        free(ring);
+        free(h);
+        return NULL;
+    }
+    h->ring = ring;
+    h->mask = cap - 1;
+    h->window_ns = window_ns;
+    for (int a = 0; a < RCM_HIST_AXES; a++) {
+        h->minq[a].q = h->queue_mem + (size_t)(2 * a) * cap;
+        h->maxq[a].q = h->queue_mem + (size_t)(2 * a + 1) * cap;
+    }
+    rcm_history_clear(h);
+    return h;
+}
+
+void rcm_history_destroy(rcm_history_t *h) {
+    if (!h) return;
+    free(h->ring);
+    free(h->queue_mem);
+    free(h);
+}
+
+static void publish(rcm_history_t *h, const rcm_history_stats_t *st) {
+    uint64_t w[HIST_STAT_WORDS];
+    memcpy(w, st, sizeof(w));
+
+    uint32_t s = atomic_load_explicit(&h->st_seq, memory_order_relaxed);
+    atomic_store_explicit(&h->st_seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i < HIST_STAT_WORDS; i++)
+        atomic_store_explicit(&h->st_word[i], w[i], memory_order_relaxed);
+    atomic_store_explicit(&h->st_seq, s + 2, memory_order_release);
+}
+
+void rcm_history_clear(rcm_history_t *h) {
+    if (!h) return;
+    h->head = h->next = 0;
+    memset(h->sum, 0, sizeof(h->sum));
+    h->wheel = 0;
+    h->prev_flags = 0;
+    h->down_mask = h->up_mask = 0;
+    memset(h->down_n, 0, sizeof(h->down_n));
+    memset(h->up_n, 0, sizeof(h->up_n));
+    for (int a = 0; a < RCM_HIST_AXES; a++) {
+        h->minq[a].front = h->minq[a].back = 0;
+        h->maxq[a].front = h->maxq[a].back = 0;
+    }
+    for (int b = 0; b < HIST_BUTTONS; b++)
+        atomic_store_explicit(&h->press_at[b], 0, memory_order_relaxed);
+    atomic_store_explicit(&h->samples, 0, memory_order_release);
+
+    rcm_history_stats_t st;
+    memset(&st, 0, sizeof(st));
+    publish(h, &st);
+}
+
+/* Add (+1) or remove (-1) a sample's edges from the window counts */
+static void count_edges(rcm_history_t *h, uint16_t down, uint16_t up, int dir) {
+    for (uint16_t m = down; m; m &= (uint16_t)(m - 1)) {
+        int b = __builtin_ctz(m);
+        h->down_n[b] += (uint32_t)dir;
+        if (h->down_n[b]) h->down_mask |= (uint16_t)(1u << b);
+        else              h->down_mask &= (uint16_t)~(1u << b);
+    }
+    for (uint16_t m = up; m; m &= (uint16_t)(m - 1)) {
+        int b = __builtin_ctz(m);
+        h->up_n[b] += (uint32_t)dir;
+        if (h->up_n[b]) h->up_mask |= (uint16_t)(1u << b);
+        else            h->up_mask &= (uint16_t)~(1u << b);
+    }
+}
+
+static void evict_oldest(rcm_history_t *h) {
+    uint32_t n = h->head++;
+    const hist_entry_t *e = &h->ring[n & h->mask];
+    for (int a = 0; a < RCM_HIST_AXES; a++) {
+        h->sum[a] -= axis(&e->st, a);
+        queue_evict(h, &h->minq[a], n);
+        queue_evict(h, &h->maxq[a], n);
+    }
+    h->wheel -= e->st.right_wheel_delta;
+    count_edges(h, e->down, e->up, -1);
+}
+
+void rcm_history_push(rcm_history_t *h, const rcm_packed_state_t *state, uint64_t t_ns) {
+    if (!h || !state) return;
+    if (h->next - h->head > h->mask)
+        evict_oldest(h);   /* full: the new sample reuses the oldest slot */
+
+    uint32_t n = h->next;
+    hist_entry_t *e = &h->ring[n & h->mask];
+    uint16_t flags = state->flags & RCM_PK_BUTTON_MASK;
+    e->t_ns = t_ns;
+    e->st   = *state;
+    e->down = (uint16_t)(flags & ~h->prev_flags);
+    e->up   = (uint16_t)(h->prev_flags & ~flags);
+    h->prev_flags = flags;
+
+    for (int a = 0; a < RCM_HIST_AXES; a++) {
+        h->sum[a] += axis(state, a);
+        queue_push(h, &h->minq[a], n, a, false);
+        queue_push(h, &h->maxq[a], n, a, true);
+    }
+    h->wheel += state->right_wheel_delta;
+    count_edges(h, e->down, e->up, +1);
+    h->next = n + 1;
+
+    if (h->window_ns)
+        while (t_ns - h->ring[h->head & h->mask].t_ns >= h->window_ns)
+            evict_oldest(h);   /* never the new sample: its age is 0 */
+
+    for (uint16_t m = e->down; m; m &= (uint16_t)(m - 1))
+        atomic_store_explicit(&h->press_at[__builtin_ctz(m)], h->next, memory_order_relaxed);
+    atomic_store_explicit(&h->samples, h->next, memory_order_release);
+
+    rcm_history_stats_t st;
+    const hist_entry_t *old = &h->ring[h->head & h->mask];
+    uint32_t count = h->next - h->head;
+    st.t_ns    = t_ns;
+    st.span_ns = t_ns - old->t_ns;
+    st.samples = h->next;
+    st.count   = count;
+    for (int a = 0; a < RCM_HIST_AXES; a++) {
+        int64_t q = h->sum[a] * 256;
+        int64_t half = count / 2;
+        st.mean_q8[a] = (int32_t)((q >= 0 ? q + half : q - half) / (int64_t)count);
+        int64_t v = 0;
+        if (st.span_ns)
+            v = (int64_t)(axis(state, a) - axis(&old->st, a)) * 1000000000LL /
+                (int64_t)st.span_ns;
+        st.velocity[a] = (int32_t)(v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : v);
+        st.min[a] = sample_axis(h, h->minq[a].q[h->minq[a].front & h->mask], a);
+        st.max[a] = sample_axis(h, h->maxq[a].q[h->maxq[a].front & h->mask], a);
+    }
+    st.latest      = *state;
+    st.wheel_delta = h->wheel;
+    st.pressed     = h->down_mask;
+    st.released    = h->up_mask;
+    memset(st.reserved, 0, sizeof(st.reserved));
+    publish(h, &st);
+}
+
+int rcm_history_query(const rcm_history_t *h, rcm_history_stats_t *out) {
+    if (!h || !out) return -1;
+    uint64_t w[HIST_STAT_WORDS];
+    uint32_t s1, s2;
+    do {
+        s1 = atomic_load_explicit(&h->st_seq, memory_order_acquire);
+        for (size_t i = 0; i < HIST_STAT_WORDS; i++)
+            w[i] = atomic_load_explicit(&h->st_word[i], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        s2 = atomic_load_explicit(&h->st_seq, memory_order_relaxed);
+    } while ((s1 & 1) || s1 != s2);
+
+    memcpy(out, w, sizeof(w));
+    return out->count ? 0 : -1;
+}
+
+uint16_t rcm_history_pressed_within(const rcm_history_t *h, uint16_t pk_bits,
+                                    uint32_t frames) {
+    if (!h || frames == 0) return 0;
+    if (frames > INT32_MAX) frames = INT32_MAX;
+    uint32_t n = atomic_load_explicit(&h->samples, memory_order_acquire);
+    uint16_t out = 0;
+    for (uint16_t m = pk_bits & RCM_PK_BUTTON_MASK; m; m &= (uint16_t)(m - 1)) {
+        int b = __builtin_ctz(m);
+        uint32_t at = atomic_load_explicit(&h->press_at[b], memory_order_relaxed);
+        /* A press newer than `n` (pushed meanwhile) counts as within */
+        if (at && (int32_t)(n - at) < (int32_t)frames)
+            out |= (uint16_t)(1u << b);
+    }
+    return out;
+}
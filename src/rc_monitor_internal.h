@@ -0,0 +1,56 @@
+/*
+ * rc_monitor_internal.h - Declarations shared between library translation
+ * units. Not part of the public API and not installed.
+ */
+
+#ifndef RC_MONITOR_INTERNAL_H
+#define RC_MONITOR_INTERNAL_H
+
+#include "rc_monitor.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* ---------- CRC kernels (rc_monitor_crc.c, rc_monitor_crc_clmul.c) ---------- */
+
+uint8_t  rcm_priv_crc8_slice8(uint8_t crc, const uint8_t *data, size_t len);
+uint16_t rcm_priv_crc16_slice8(uint16_t crc, const uint8_t *data, size_t len);
+
+/* True if the clmul kernel was compiled in and the CPU supports it */
+bool     rcm_priv_clmul_supported(void);
+uint8_t  rcm_priv_crc8_clmul(uint8_t crc, const uint8_t *data, size_t len);
+uint16_t rcm_priv_crc16_clmul(uint16_t crc, const uint8_t *data, size_t len);
+
+/*
+ * Advance a CRC16 register over `n` zero bytes in O(1): multiplies it by
+ * x^(8n) mod P. Because the register update is linear, a range CRC can be
+ * rebuilt from two prefix states S[a], S[b] of the same stream as
+ *     crc(seed, data[a..b)) = S[b] ^ rcm_priv_crc16_shift(S[a] ^ seed, b - a)
+ */
+uint16_t rcm_priv_crc16_shift(uint16_t crc, size_t n);
+
+/*
+ * Table-kernel CRC16 over data[0..len) that also records the register after
+ * each byte: ring[(first + i) & mask] for i = 1..len. `first` is the stream
+ * offset of data[0]. Returns the final register.
+ */
+uint16_t rcm_priv_crc16_prefix(uint16_t crc, const uint8_t *data, size_t len,
+                               uint16_t *ring, size_t mask, uint64_t first);
+
+/* ---------- Parser work accounting (rc_monitor.c) ---------- */
+
+/*
+ * Operation counts kept by every parser so fuzz_resync can check the
+ * worst-case cost bound documented above decode_span() in rc_monitor.c.
+ */
+typedef struct {
+    uint64_t feed_calls;     /* rcm_feed() calls with data */
+    uint64_t bytes_in;       /* bytes passed to rcm_feed() */
+    uint64_t header_checks;  /* SOF candidates whose 4-byte header was examined */
+    uint64_t crc16_bytes;    /* bytes run through a CRC16 kernel */
+    uint64_t copy_bytes;     /* bytes copied into or moved within the stage */
+} rcm_priv_work_t;
+
+void rcm_priv_parser_work(const rcm_parser_t *p, rcm_priv_work_t *out);
+
+#endif /* RC_MONITOR_INTERNAL_H */
@@ -0,0 +1,254 @@
+/*
+ * rc_monitor_io.c - Shared native stream ingestion loop
+ *
+ * The loop thread sleeps in epoll_wait() (level-triggered) on every
+ * attached fd plus an eventfd for stop. Each ready source gets up to
+ * READS_PER_WAKE non-blocking read()s into the loop's single buffer, fed in
+ * place by rcm_feed(); a source with more pending is simply reported ready
+ * again, so one busy stream cannot starve the others. The lock is held for
+ * a whole dispatch round, which is what lets rcm_io_remove() promise that
+ * the parser is no longer touched once it returns. Epoll entries carry the
+ * slot and a generation so an event for a slot that was removed and reused
+ * within one round is ignored.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* epoll_create1, eventfd flags */
+#endif
+
+#include "rc_monitor_io.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* read()s per source per wakeup before moving on to the next source */
+#define READS_PER_WAKE 4
+
+#define WAKE_TAG UINT64_MAX
+
+typedef struct {
+    int                   fd;
+    rcm_parser_t         *parser;
+    void                (*after_feed)(void *userdata);
+    void                 *userdata;
+    rcm_capture_writer_t *capture;        /* optional; guarded by the loop lock */
+    uint8_t               capture_source;
+    uint32_t              gen;
+    bool                  used;
+    _Atomic bool          alive;
+} io_source_t;
+
+struct rcm_io_loop {
+    pthread_t       thread;
+    int             epfd;
+    int             wake;              /* eventfd: stop */
+    _Atomic bool    stop;
+    pthread_mutex_t lock;              /* guards src[]; held per dispatch round */
+    io_source_t     src[RCM_IO_MAX_SOURCES];
+    uint8_t         buf[RCM_IO_READ_LEN];
+};
+
+static uint64_t slot_tag(unsigned slot, uint32_t gen) {
+    return ((uint64_t)gen << 32) | slot;
+}
+
+/* Stop polling a source after EOF or a read error; caller holds the lock */
+static void source_closed(rcm_io_loop_t *loop, io_source_t *s) {
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+    atomic_store_explicit(&s->alive, false, memory_order_release);
+}
+
+/* Read and feed one ready source; caller holds the lock */
+static void service(rcm_io_loop_t *loop, io_source_t *s) {
+    bool fed = false;
+    for (int i = 0; i < READS_PER_WAKE; i++) {
+        ssize_t n = read(s->fd, loop->buf, sizeof(loop->buf));
+        if (n > 0) {
+            rcm_trace_read(s->parser, 0);
+            if (s->capture)
+                rcm_capture_write(s->capture, 0, s->capture_source,
+                                  RCM_CAPTURE_IN, loop->buf, (size_t)n);
+            rcm_feed(s->parser, loop->buf, (size_t)n);
+            fed = true;
+            if ((size_t)n < sizeof(loop->buf))
+                break; /* drained */
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        source_closed(loop, s); /* EOF or hard error */
+        break;
+    }
+    if (fed && s->after_feed)
+        s->after_feed(s->userdata);
+}
+
+static void *loop_thread(void *arg) {
+    rcm_io_loop_t *loop = (rcm_io_loop_t *)arg;
+    struct epoll_event ev[RCM_IO_MAX_SOURCES + 1];
+
+    while (!atomic_load_explicit(&loop->stop, memory_order_acquire)) {
+        int n = epoll_wait(loop->epfd, ev, RCM_IO_MAX_SOURCES + 1, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        pthread_mutex_lock(&loop->lock);
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = ev[i].data.u64;
+            if (tag == WAKE_TAG) continue;
+            unsigned slot = (unsigned)(tag & 0xFFFFFFFFu);
+            io_source_t *s = &loop->src[slot];
+            if (!s->used || s->gen != (uint32_t)(tag >> 32) ||
+                !atomic_load_explicit(&s->alive, memory_order_relaxed))
+                continue; /* removed (or reused) earlier in this round */
+            service(loop, s);
+        }
+        pthread_mutex_unlock(&loop->lock);
+    }
+    return NULL;
+}
+
+rcm_io_loop_t *rcm_io_create(void) {
+    rcm_io_loop_t *loop = (rcm_io_loop_t *)calloc(1, sizeof(*loop));
+    if (!loop) return NULL;
+    pthread_mutex_init(&loop->lock, NULL);
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    loop->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct epoll_event e = { .events = EPOLLIN, .data.u64 = WAKE_TAG };
+    int err = 0;
+    if (loop->epfd < 0 || loop->wake < 0 ||
+        epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->wake, &e) != 0)
+        err = errno;
+    else
+        err = pthread_create(&loop->thread, NULL, loop_thread, loop);
+    if (err != 0) {
+        if (loop->epfd >= 0) close(loop->epfd);
+        if (loop->wake >= 0) close(loop->wake);
+        pthread_mutex_destroy(&loop->lock);
+        free(loop);
+        errno = err;
+        return NULL;
+    }
+    return loop;
+}
+
+void rcm_io_destroy(rcm_io_loop_t *loop) {
+    if (!loop) return;
+    atomic_store_explicit(&loop->stop, true, memory_order_release);
+    uint64_t one = 1;
+    (void)!write(loop->wake, &one, sizeof(one));
+    pthread_join(loop->thread, NULL);
+    close(loop->epfd);
+    close(loop->wake);
+    pthread_mutex_destroy(&loop->lock);
+    free(loop);
+}
+
+int rcm_io_add(rcm_io_loop_t *loop, int fd, rcm_parser_t *parser,
+               void (*after_feed)(void *userdata), void *userdata) {
+    if (!loop || fd < 0 || !parser) {
+        errno = EINVAL;
+        return -1;
+    }
+    int fl = fcntl(fd, F_GETFL);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) != 0)
+        return -1;
+
+    pthread_mutex_lock(&loop->lock);
+    int id = -1;
+    for (int i = 0; i < RCM_IO_MAX_SOURCES; i++) {
+        if (!loop->src[i].used) { id = i; break; }
+    }
+    if (id < 0) {
+        pthread_mutex_unlock(&loop->lock);
+        errno = ENOSPC;
+        return -1;
+    }
+
+    io_source_t *s = &loop->src[id];
+    s->fd         = fd;
+    s->parser     = parser;
+    s->after_feed = after_feed;
+    s->userdata   = userdata;
+    s->capture    = NULL;
+    s->gen++;
+    struct epoll_event e = { .events = EPOLLIN, .data.u64 = slot_tag((unsigned)id, s->gen) };
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &e) != 0) {
+        int err = errno;
+        pthread_mutex_unlock(&loop->lock);
+        errno = err;
+        return -1;
+    }
+    s->used = true;
+    atomic_store_explicit(&s->alive, true, memory_order_release);
+    pthread_mutex_unlock(&loop->lock);
+    return id;
+}
+
+void rcm_io_remove(rcm_io_loop_t *loop, int id) {
+    if (!loop || id < 0 || id >= RCM_IO_MAX_SOURCES) return;
+    pthread_mutex_lock(&loop->lock);
+    io_source_t *s = &loop->src[id];
+    if (s->used) {
+        if (atomic_load_explicit(&s->alive, memory_order_relaxed))
+            epoll_ctl(loop->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+        atomic_store_explicit(&s->alive, false, memory_order_release);
+        s->used = false;
+        s->capture = NULL;
+    }
+    pthread_mutex_unlock(&loop->lock);
+}
+
+void rcm_io_set_capture(rcm_io_loop_t *loop, int id, rcm_capture_writer_t *w,
+                        uint8_t source) {
+    if (!loop || id < 0 || id >= RCM_IO_MAX_SOURCES) return;
+    pthread_mutex_lock(&loop->lock);
+    if (loop->src[id].used) {
+        loop->src[id].capture = w;
+        loop->src[id].capture_source = source;
+    }
+    pthread_mutex_unlock(&loop->lock);
+}
+
+bool rcm_io_alive(rcm_io_loop_t *loop, int id) {
+    if (!loop || id < 0 || id >= RCM_IO_MAX_SOURCES) return false;
+    return atomic_load_explicit(&loop->src[id].alive, memory_order_acquire);
+}
+
+int rcm_io_connect_unix(const char *path) {
+    struct sockaddr_un addr;
+    size_t len = path ? strlen(path) : 0;
+    if (len == 0 || len >= sizeof(addr.sun_path)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, len);
+    socklen_t alen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len + 1);
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0'; /* abstract: no trailing NUL in the name */
+        alen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (const struct sockaddr *)&addr, alen) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
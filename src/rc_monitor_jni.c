@@ -5,52 +5,328 @@
  * The Java side reads raw USB bulk data and passes it here for parsing.
  */
 
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* posix_memalign */
+#endif
+
+#include <dlfcn.h>
+#include <errno.h>
 #include <jni.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <android/log.h>
 #include "rc_monitor.h"
+#include "rc_monitor_usb.h"
+#include "rc_monitor_evdev.h"
+#include "rc_monitor_io.h"
+#include "rc_monitor_capture.h"
+#include "rc_monitor_tx.h"
+#include "rc_monitor_shm.h"
+#include "rc_monitor_history.h"
 
 #define TAG "RcMonitor"
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
 
-/* Per-instance context shared between JNI calls */
+/*
+ * Shared state ring header, at the start of the direct ByteBuffer returned
+ * by nativeEnableStateRing(). Entry i (a native-endian rcm_packed_state_t)
+ * lives at RING_HDR_LEN + (i & (capacity - 1)) * RING_ENTRY_LEN. The
+ * producer overwrites the oldest entries. Before writing entry i it stores
+ * `claimed` = i + 1 followed by a release fence, and after it stores
+ * `written` = i + 1 with release order (the rcm_shm_publish() protocol), so
+ * a reader that re-reads `claimed` after its copies knows which of them may
+ * have been overwritten. Must match RcMonitor.StateRing.
+ */
+typedef struct {
+    _Atomic int64_t written;     /* states published so far */
+    int32_t         capacity;    /* entries, power of two */
+    int32_t         entry_len;   /* RING_ENTRY_LEN */
+    _Atomic int64_t claimed;     /* states being or already written */
+    uint8_t         pad[40];
+} jni_ring_hdr_t;
+
+#define RING_HDR_LEN        64
+#define RING_ENTRY_LEN      16
+#define RING_MIN_ENTRIES    16
+#define RING_MAX_ENTRIES    65536
+
+_Static_assert(sizeof(jni_ring_hdr_t) == RING_HDR_LEN, "ring header layout");
+_Static_assert(sizeof(rcm_packed_state_t) == RING_ENTRY_LEN, "ring entry layout");
+
+/*
+ * Per-instance context. nativeInit() returns its address to Java as a long
+ * handle that every other native takes back, so each RcMonitor owns its own
+ * parser and listener and instances never touch shared state: separate
+ * streams can be fed from separate threads without locking.
+ */
 typedef struct {
     rcm_parser_t *parser;
     JavaVM       *jvm;
     jobject       listener_ref;  /* Global ref to Java listener */
     jmethodID    on_state_mid;   /* Cached method ID */
+
+    /* Ring delivery (replaces onRcState upcalls once enabled) */
+    jni_ring_hdr_t *ring;
+    uint32_t        ring_mask;
+    int64_t         ring_written;   /* producer's copy of ring->written */
+    int64_t         ring_notified;  /* ring_written at the last notify */
+    jobject         ring_notify_ref; /* Global ref, NULL = consumer polls */
+    jmethodID       ring_notify_mid;
+
+    /*
+     * Cross-process publisher (nativeStartSharedPublisher()), in addition to
+     * any other delivery. Set once, possibly while a native reader runs,
+     * and destroyed in nativeDestroy() after the readers have stopped.
+     */
+    _Atomic(rcm_shm_publisher_t *) shm;
+
+    /* Motion history (nativeEnableHistory()), freed after the parser */
+    rcm_history_t *history;
+
+    /* Native readers; while one runs it owns the parser */
+    rcm_usb_reader_t   *usb;
+    rcm_evdev_reader_t *evdev;
+    bool                io_attached;    /* on the shared stream loop */
+    int                 io_id;
+    int                 io_fd;
+
+    /*
+     * Optional recording of everything this instance ingests. Feed natives
+     * check the pointer without the lock and write under it, so
+     * nativeStopCapture() can close the writer while another thread feeds.
+     */
+    pthread_mutex_t                 capture_lock;
+    _Atomic(rcm_capture_writer_t *) capture;
+    uint8_t                         capture_source;  /* tag for Java-fed chunks */
+
+    /*
+     * Latency tracing (nativeSetTracing()). The timestamps are only touched
+     * by the trace hook, on the feeding thread.
+     */
+    _Atomic bool tracing;
+    uint64_t     trace_read_ns;   /* last RCM_TRACE_READ, 0 = none this feed */
+    uint64_t     trace_frame_ns;  /* last RCM_TRACE_FRAME */
+
+    /*
+     * Coalesced dispatch (nativeSetCoalesce()): per-push upcalls stop and
+     * the listener gets one rcm_take_coalesced() state per tick, from
+     * nativeDispatchCoalesced() or from the timerfd thread below, never
+     * both: the former refuses while co_timer is set.
+     */
+    _Atomic bool coalesce;
+    _Atomic bool co_timer;        /* co_thread is (about to be) running */
+    pthread_t    co_thread;
+    int          co_timer_fd;
+    int          co_stop_fd;
+
+    /*
+     * Arrival scoring (nativeTrackArrivals()) and muting, for hot standby:
+     * written by the feeding thread in jni_rc_callback(), read by any.
+     * The stall threshold is clamp(interval * factor, min, max). A restart
+     * only sets arr_reset; the feeding thread clears the scores itself.
+     */
+    _Atomic bool     arr_on;
+    _Atomic bool     arr_reset;
+    _Atomic uint32_t arr_factor;
+    _Atomic uint64_t arr_min_ns, arr_max_ns;
+    _Atomic uint64_t arr_count;
+    _Atomic uint64_t arr_last_ns;      /* CLOCK_MONOTONIC (System.nanoTime()) */
+    _Atomic uint64_t arr_interval_ns;  /* EWMA of inter-arrival time, 1/8 gain */
+    _Atomic uint64_t arr_run_ns;       /* start of the current unbroken run */
+    _Atomic uint64_t arr_stall_ns;
+    _Atomic uint64_t mute_until_ns;    /* no listener upcalls before this, 0 = none */
+
+    /*
+     * Statistics while a native reader owns the parser: its thread copies
+     * rcm_get_stats() here after each wakeup that fed data (skipping the
+     * copy when nativeGetStats() holds the lock) and applies a pending
+     * nativeResetStats() first. stats_copy_ns is when the copy was taken.
+     */
+    pthread_mutex_t stats_lock;
+    rcm_stats_t     stats_copy;
+    uint64_t        stats_copy_ns;
+    _Atomic bool    stats_reset;
 } jni_ctx_t;
 
 /*
- * Global singleton context. Not protected by a mutex — concurrent calls to
- * nativeInit()/nativeDestroy() from different threads would race. In practice,
- * the Java RcMonitor class is used as a singleton from a single thread and
- * UsbRcReader manages the lifecycle, so this is acceptable.
+ * One stream ingestion loop (one thread) for every instance attached to a
+ * socket, created by the first attach and destroyed with the last detach.
  */
-static jni_ctx_t *g_ctx = NULL;
+static pthread_mutex_t g_io_lock = PTHREAD_MUTEX_INITIALIZER;
+static rcm_io_loop_t  *g_io;
+static int             g_io_users;
 
-/* Called from the C parser when an RC push packet is decoded */
-static void jni_rc_callback(const rc_state_t *state, void *userdata) {
-    jni_ctx_t *ctx = (jni_ctx_t *)userdata;
-    if (!ctx || !ctx->listener_ref) return;
+static inline jni_ctx_t *ctx_from_handle(jlong handle) {
+    return (jni_ctx_t *)(intptr_t)handle;
+}
 
-    JNIEnv *env = NULL;
-    int need_detach = 0;
+/* True while a native reader thread owns the parser */
+static inline bool reader_owned(const jni_ctx_t *ctx) {
+    return ctx->usb || ctx->evdev || ctx->io_attached;
+}
+
+/*
+ * JNIEnv of the calling thread, attaching it on first use. Threads we
+ * attach stay attached and are detached by the key destructor when they
+ * exit, so a native producer thread pays for AttachCurrentThread once
+ * rather than per frame.
+ */
+static pthread_key_t  g_detach_key;
+static pthread_once_t g_detach_once = PTHREAD_ONCE_INIT;
+static _Thread_local JNIEnv *t_env;
+
+static void detach_thread(void *jvm) {
+    JavaVM *vm = (JavaVM *)jvm;
+    (*vm)->DetachCurrentThread(vm);
+}
+
+static void make_detach_key(void) {
+    pthread_key_create(&g_detach_key, detach_thread);
+}
+
+static JNIEnv *thread_env(JavaVM *jvm) {
+    if (t_env) return t_env;
 
-    /* Attach current thread to JVM if needed (USB read may be on a native thread) */
-    jint status = (*ctx->jvm)->GetEnv(ctx->jvm, (void **)&env, JNI_VERSION_1_6);
+    JNIEnv *env = NULL;
+    jint status = (*jvm)->GetEnv(jvm, (void **)&env, JNI_VERSION_1_6);
     if (status == JNI_EDETACHED) {
-        if ((*ctx->jvm)->AttachCurrentThread(ctx->jvm, &env, NULL) != JNI_OK) {
+        if ((*jvm)->AttachCurrentThread(jvm, &env, NULL) != JNI_OK) {
             LOGE("Failed to attach thread to JVM");
-            return;
+            return NULL;
         }
-        need_detach = 1;
+        pthread_once(&g_detach_once, make_detach_key);
+        pthread_setspecific(g_detach_key, jvm);
     } else if (status != JNI_OK) {
         LOGE("GetEnv failed: %d", status);
+        return NULL;
+    }
+    t_env = env;
+    return env;
+}
+
+/*
+ * ATrace entry points, looked up in libandroid on first use: the NDK only
+ * declares them from API 23 (ATrace_setCounter from 29), below minSdk.
+ * Sections and counters show up in systrace and in Perfetto traces that
+ * enable the app's atrace category; they cost nothing while no trace runs.
+ */
+static struct {
+    void (*begin)(const char *name);
+    void (*end)(void);
+    void (*counter)(const char *name, int64_t value);
+} g_atrace;
+static pthread_once_t g_atrace_once = PTHREAD_ONCE_INIT;
+
+static void load_atrace(void) {
+    void *lib = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+    if (!lib) return;
+    /* POSIX allows this way of turning dlsym()'s result into a function pointer */
+    *(void **)&g_atrace.counter = dlsym(lib, "ATrace_setCounter");
+    *(void **)&g_atrace.begin   = dlsym(lib, "ATrace_beginSection");
+    *(void **)&g_atrace.end     = dlsym(lib, "ATrace_endSection");
+    if (!g_atrace.begin || !g_atrace.end)
+        g_atrace.begin = NULL, g_atrace.end = NULL;
+}
+
+static inline void atrace_begin(const char *name) {
+    if (g_atrace.begin) g_atrace.begin(name);
+}
+
+static inline void atrace_end(void) {
+    if (g_atrace.end) g_atrace.end();
+}
+
+static inline void atrace_counter(const char *name, uint64_t from, uint64_t to) {
+    if (g_atrace.counter && from && to >= from)
+        g_atrace.counter(name, (int64_t)(to - from));
+}
+
+/*
+ * Parser trace hook: each feed becomes an "rcm.feed" section, and every
+ * delivered push updates three latency counters (ns): bulk read done to
+ * frame validated, frame validated to callback returned (the listener
+ * upcall or ring publish), and read done to callback returned.
+ */
+static void jni_trace_hook(unsigned event, uint64_t t_ns, uint64_t arg, void *userdata) {
+    jni_ctx_t *ctx = (jni_ctx_t *)userdata;
+    (void)arg;
+    switch (event) {
+    case RCM_TRACE_READ:
+        ctx->trace_read_ns = t_ns;
+        break;
+    case RCM_TRACE_FEED_BEGIN:
+        atrace_begin("rcm.feed");
+        break;
+    case RCM_TRACE_FRAME:
+        ctx->trace_frame_ns = t_ns;
+        atrace_counter("rcm.read_to_frame_ns", ctx->trace_read_ns, t_ns);
+        break;
+    case RCM_TRACE_CALLBACK_END:
+        atrace_counter("rcm.frame_to_return_ns", ctx->trace_frame_ns, t_ns);
+        atrace_counter("rcm.read_to_return_ns", ctx->trace_read_ns, t_ns);
+        break;
+    case RCM_TRACE_FEED_END:
+        atrace_end();
+        ctx->trace_read_ns = 0;
+        break;
+    }
+}
+
+static inline bool trace_on(const jni_ctx_t *ctx) {
+    return atomic_load_explicit(&ctx->tracing, memory_order_relaxed);
+}
+
+/* Publish one state into the shared ring (producer thread only) */
+static void ring_push(jni_ctx_t *ctx, const rc_state_t *state) {
+    rcm_packed_state_t ps;
+    rcm_pack_state(state, &ps);
+    uint8_t *slot = (uint8_t *)ctx->ring + RING_HDR_LEN +
+                    (size_t)((uint64_t)ctx->ring_written & ctx->ring_mask) * RING_ENTRY_LEN;
+    atomic_store_explicit(&ctx->ring->claimed, ctx->ring_written + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); /* claimed before the overwrite */
+    memcpy(slot, &ps, RING_ENTRY_LEN);
+    ctx->ring_written++;
+    atomic_store_explicit(&ctx->ring->written, ctx->ring_written, memory_order_release);
+}
+
+static inline rcm_shm_publisher_t *shm_of(jni_ctx_t *ctx) {
+    return atomic_load_explicit(&ctx->shm, memory_order_acquire);
+}
+
+/*
+ * After a feed: wake the shared-memory consumers, and with ring delivery
+ * and a notify listener, make one upcall for everything published during
+ * the call.
+ */
+static void feed_notify(JNIEnv *env, jni_ctx_t *ctx) {
+    rcm_shm_publisher_t *shm = shm_of(ctx);
+    if (shm)
+        rcm_shm_wake(shm);
+    if (!ctx->ring_notify_ref || ctx->ring_written == ctx->ring_notified)
         return;
+    ctx->ring_notified = ctx->ring_written;
+    bool traced = trace_on(ctx);
+    if (traced) atrace_begin("rcm.onStates");
+    (*env)->CallVoidMethod(env, ctx->ring_notify_ref, ctx->ring_notify_mid,
+                           (jlong)ctx->ring_written);
+    if (traced) atrace_end();
+    if ((*env)->ExceptionCheck(env)) {
+        (*env)->ExceptionDescribe(env);
+        (*env)->ExceptionClear(env);
     }
+}
 
+/* Deliver `state` to the Java listener on the calling thread */
+static void call_listener(JNIEnv *env, jni_ctx_t *ctx, const rc_state_t *state) {
     /* Call listener.onRcState(
      *   pause, gohome, shutter, record,
      *   custom1, custom2, custom3,
@@ -60,6 +336,8 @@ static void jni_rc_callback(const rc_state_t *state, void *userdata) {
      *   leftWheel, rightWheel, rightWheelDelta
      * )
      */
+    bool traced = trace_on(ctx);
+    if (traced) atrace_begin("rcm.onRcState");
     (*env)->CallVoidMethod(env, ctx->listener_ref, ctx->on_state_mid,
         (jboolean)state->pause,
         (jboolean)state->gohome,
@@ -82,71 +360,161 @@ static void jni_rc_callback(const rc_state_t *state, void *userdata) {
         (jint)state->right_wheel,
         (jint)state->right_wheel_delta
     );
+    if (traced) atrace_end();
 
     if ((*env)->ExceptionCheck(env)) {
         (*env)->ExceptionDescribe(env);
         (*env)->ExceptionClear(env);
     }
+}
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Score one arrival at `now` (feeding thread only) */
+static void note_arrival(jni_ctx_t *ctx, uint64_t now) {
+    uint64_t n     = atomic_load_explicit(&ctx->arr_count, memory_order_relaxed);
+    uint64_t last  = atomic_load_explicit(&ctx->arr_last_ns, memory_order_relaxed);
+    uint64_t iv    = atomic_load_explicit(&ctx->arr_interval_ns, memory_order_relaxed);
+    uint64_t stall = atomic_load_explicit(&ctx->arr_stall_ns, memory_order_relaxed);
+    if (atomic_exchange_explicit(&ctx->arr_reset, false, memory_order_acquire))
+        n = iv = 0;
+    if (n == 0 || now - last > stall)
+        atomic_store_explicit(&ctx->arr_run_ns, now, memory_order_relaxed);
+    else if (n == 1)
+        iv = now - last;
+    else
+        iv = (uint64_t)((int64_t)iv + ((int64_t)(now - last) - (int64_t)iv) / 8);
+
+    uint64_t lo = atomic_load_explicit(&ctx->arr_min_ns, memory_order_relaxed);
+    uint64_t hi = atomic_load_explicit(&ctx->arr_max_ns, memory_order_relaxed);
+    stall = iv * atomic_load_explicit(&ctx->arr_factor, memory_order_relaxed);
+    stall = stall < lo ? lo : stall > hi ? hi : stall;
+    atomic_store_explicit(&ctx->arr_interval_ns, iv, memory_order_relaxed);
+    atomic_store_explicit(&ctx->arr_stall_ns, stall, memory_order_relaxed);
+    atomic_store_explicit(&ctx->arr_last_ns, now, memory_order_relaxed);
+    atomic_store_explicit(&ctx->arr_count, n + 1, memory_order_release);
+}
+
+/* Pushes scored so far, 0 while a nativeTrackArrivals() restart is pending */
+static uint64_t arrival_count(const jni_ctx_t *ctx) {
+    uint64_t n = atomic_load_explicit(&ctx->arr_count, memory_order_acquire);
+    return atomic_load_explicit(&ctx->arr_reset, memory_order_relaxed) ? 0 : n;
+}
+
+/* Called from the C parser when an RC push packet is decoded */
+static void jni_rc_callback(const rc_state_t *state, void *userdata) {
+    jni_ctx_t *ctx = (jni_ctx_t *)userdata;
+    if (!ctx) return;
+    uint64_t now = 0;
+    if (atomic_load_explicit(&ctx->arr_on, memory_order_relaxed))
+        note_arrival(ctx, now = clock_ns());
+    rcm_shm_publisher_t *shm = shm_of(ctx);
+    if (shm) {
+        rcm_packed_state_t ps;
+        rcm_pack_state(state, &ps);
+        rcm_shm_publish(shm, &ps);
+    }
+    if (ctx->ring) {
+        ring_push(ctx, state);
+        return;
+    }
+    if (!ctx->listener_ref || atomic_load_explicit(&ctx->coalesce, memory_order_relaxed))
+        return;
+
+    /* Muted (warm standby): the state was parsed and timestamped, that's all */
+    uint64_t until = atomic_load_explicit(&ctx->mute_until_ns, memory_order_relaxed);
+    if (until && (now ? now : clock_ns()) < until)
+        return;
+
+    JNIEnv *env = thread_env(ctx->jvm);
+    if (env)
+        call_listener(env, ctx, state);
+}
 
-    if (need_detach) {
-        (*ctx->jvm)->DetachCurrentThread(ctx->jvm);
+/* One coalesced delivery; returns the pushes it covered */
+static int dispatch_coalesced(JNIEnv *env, jni_ctx_t *ctx) {
+    rcm_packed_state_t ps;
+    int n = rcm_take_coalesced(ctx->parser, &ps);
+    if (n > 0 && ctx->listener_ref) {
+        rc_state_t state;
+        rcm_unpack_state(&ps, &state);
+        call_listener(env, ctx, &state);
     }
+    return n;
 }
 
 /*
  * Class:     space_yasha_rcmonitor_RcMonitor
  * Method:    nativeInit
- * Signature: (Lspace/yasha/rcmonitor/RcMonitor$RcStateListener;)Z
+ * Signature: (Lspace/yasha/rcmonitor/RcMonitor$RcStateListener;)J
+ *
+ * Returns the new instance's handle, or 0 on failure.
  */
-JNIEXPORT jboolean JNICALL
-Java_space_yasha_rcmonitor_RcMonitor_nativeInit(JNIEnv *env, jobject thiz, jobject listener) {
-    if (g_ctx) {
-        LOGE("Already initialized");
-        return JNI_FALSE;
-    }
+JNIEXPORT jlong JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeInit(JNIEnv *env, jclass clazz, jobject listener) {
+    if (!listener) return 0;
 
     /* Find listener method */
     jclass cls = (*env)->GetObjectClass(env, listener);
     if (!cls) {
         LOGE("Failed to get listener class");
-        return JNI_FALSE;
+        return 0;
     }
 
     jmethodID mid = (*env)->GetMethodID(env, cls, "onRcState",
         "(ZZZZZZZZZZZZIIIIIIII)V");
     if (!mid) {
         LOGE("Failed to find onRcState method");
-        return JNI_FALSE;
+        return 0;
     }
 
     jni_ctx_t *ctx = (jni_ctx_t *)calloc(1, sizeof(jni_ctx_t));
-    if (!ctx) return JNI_FALSE;
+    if (!ctx) return 0;
 
     (*env)->GetJavaVM(env, &ctx->jvm);
     ctx->listener_ref = (*env)->NewGlobalRef(env, listener);
     ctx->on_state_mid = mid;
+    pthread_mutex_init(&ctx->capture_lock, NULL);
+    pthread_mutex_init(&ctx->stats_lock, NULL);
 
     ctx->parser = rcm_create(jni_rc_callback, ctx);
     if (!ctx->parser) {
         (*env)->DeleteGlobalRef(env, ctx->listener_ref);
+        pthread_mutex_destroy(&ctx->capture_lock);
+        pthread_mutex_destroy(&ctx->stats_lock);
         free(ctx);
-        return JNI_FALSE;
+        return 0;
     }
 
-    g_ctx = ctx;
     LOGD("RC Monitor initialized");
-    return JNI_TRUE;
+    return (jlong)(intptr_t)ctx;
+}
+
+/* Record bytes fed from Java, if a capture is open */
+static void capture_in(jni_ctx_t *ctx, const uint8_t *data, size_t len) {
+    if (!atomic_load_explicit(&ctx->capture, memory_order_relaxed))
+        return;
+    pthread_mutex_lock(&ctx->capture_lock);
+    rcm_capture_writer_t *w = atomic_load_explicit(&ctx->capture, memory_order_relaxed);
+    if (w)
+        rcm_capture_write(w, 0, ctx->capture_source, RCM_CAPTURE_IN, data, len);
+    pthread_mutex_unlock(&ctx->capture_lock);
 }
 
 /*
  * Class:     space_yasha_rcmonitor_RcMonitor
  * Method:    nativeFeed
- * Signature: ([BI)I
+ * Signature: (J[BI)I
  */
 JNIEXPORT jint JNICALL
-Java_space_yasha_rcmonitor_RcMonitor_nativeFeed(JNIEnv *env, jobject thiz,
+Java_space_yasha_rcmonitor_RcMonitor_nativeFeed(JNIEnv *env, jclass clazz, jlong handle,
                                              jbyteArray data, jint length) {
-    if (!g_ctx || !g_ctx->parser) return 0;
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return 0;
     if (!data || length <= 0) return 0;
 
     jint arrLen = (*env)->GetArrayLength(env, data);
@@ -155,24 +523,693 @@ Java_space_yasha_rcmonitor_RcMonitor_nativeFeed(JNIEnv *env, jobject thiz,
     jbyte *buf = (*env)->GetByteArrayElements(env, data, NULL);
     if (!buf) return 0;
 
-    int decoded = rcm_feed(g_ctx->parser, (const uint8_t *)buf, (size_t)length);
+    capture_in(ctx, (const uint8_t *)buf, (size_t)length);
+    int decoded = rcm_feed(ctx->parser, (const uint8_t *)buf, (size_t)length);
+    feed_notify(env, ctx);
 
     (*env)->ReleaseByteArrayElements(env, data, buf, JNI_ABORT);
     return decoded;
 }
 
+/*
+ * Resolve [offset, offset + length) of a direct ByteBuffer, clamping the
+ * length to its capacity. Returns NULL for a non-direct buffer or an empty
+ * or out-of-range window.
+ */
+static const uint8_t *direct_window(JNIEnv *env, jobject buffer, jint offset,
+                                    jint *length) {
+    if (!buffer || offset < 0 || *length <= 0) return NULL;
+    uint8_t *base = (uint8_t *)(*env)->GetDirectBufferAddress(env, buffer);
+    jlong cap = (*env)->GetDirectBufferCapacity(env, buffer);
+    if (!base || cap <= offset) return NULL;
+    if ((jlong)*length > cap - offset)
+        *length = (jint)(cap - offset);
+    return base + offset;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeFeedBuffer
+ * Signature: (JLjava/nio/ByteBuffer;II)I
+ *
+ * Zero-copy variant of nativeFeed(): parses the bytes in place in a direct
+ * ByteBuffer, so nothing is pinned, copied or released per transfer.
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeFeedBuffer(JNIEnv *env, jclass clazz, jlong handle,
+                                                    jobject buffer, jint offset, jint length) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return 0;
+
+    const uint8_t *buf = direct_window(env, buffer, offset, &length);
+    if (!buf) return 0;
+    capture_in(ctx, buf, (size_t)length);
+    int decoded = rcm_feed(ctx->parser, buf, (size_t)length);
+    feed_notify(env, ctx);
+    return decoded;
+}
+
+/*
+ * Layout of one entry in nativeFeedBatch()'s int[] output. Must match the
+ * BATCH_* constants in RcMonitor.java.
+ */
+#define BATCH_BUTTONS      0   /* RCM_PK_* button bits (RcMonitor.BTN_*) */
+#define BATCH_FLIGHT_MODE  1
+#define BATCH_STICK_RH     2
+#define BATCH_STICK_RV     3
+#define BATCH_STICK_LH     4
+#define BATCH_STICK_LV     5
+#define BATCH_LEFT_WHEEL   6
+#define BATCH_RIGHT_WHEEL  7
+#define BATCH_WHEEL_DELTA  8
+#define BATCH_SEQ          9
+#define BATCH_DUML_SEQ     10
+#define BATCH_OFFSET       11
+#define BATCH_CHANGED      12  /* RCM_CHANGED_* mask */
+#define BATCH_STRIDE       13
+
+/* Entries decoded per nativeFeedBatch() call; the rest go to the listener */
+#define BATCH_MAX_ENTRIES  128
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeFeedBatch
+ * Signature: (J[BI[I)I
+ *
+ * Decode a whole bulk read and return every RC push in one int[] copy
+ * instead of one listener call per frame.
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeFeedBatch(JNIEnv *env, jclass clazz, jlong handle,
+                                                   jbyteArray data, jint length,
+                                                   jintArray out) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return 0;
+    if (!data || !out || length <= 0) return 0;
+
+    jint arrLen = (*env)->GetArrayLength(env, data);
+    if (length > arrLen) length = arrLen;
+
+    jsize max_out = (*env)->GetArrayLength(env, out) / BATCH_STRIDE;
+    if (max_out > BATCH_MAX_ENTRIES) max_out = BATCH_MAX_ENTRIES;
+
+    jbyte *buf = (*env)->GetByteArrayElements(env, data, NULL);
+    if (!buf) return 0;
+
+    capture_in(ctx, (const uint8_t *)buf, (size_t)length);
+    rcm_batch_entry_t entries[BATCH_MAX_ENTRIES];
+    int n = rcm_feed_batch(ctx->parser, (const uint8_t *)buf, (size_t)length,
+                           entries, (size_t)max_out);
+    feed_notify(env, ctx);
+
+    (*env)->ReleaseByteArrayElements(env, data, buf, JNI_ABORT);
+
+    jint packed[BATCH_MAX_ENTRIES * BATCH_STRIDE];
+    for (int i = 0; i < n; i++) {
+        const rcm_batch_entry_t *e = &entries[i];
+        rcm_packed_state_t ps;
+        rcm_pack_state(&e->state, &ps);
+        jint *o = packed + i * BATCH_STRIDE;
+        o[BATCH_BUTTONS]     = ps.flags & RCM_PK_BUTTON_MASK;
+        o[BATCH_FLIGHT_MODE] = (jint)rcm_packed_flight_mode(&ps);
+        o[BATCH_STICK_RH]    = ps.stick_right_h;
+        o[BATCH_STICK_RV]    = ps.stick_right_v;
+        o[BATCH_STICK_LH]    = ps.stick_left_h;
+        o[BATCH_STICK_LV]    = ps.stick_left_v;
+        o[BATCH_LEFT_WHEEL]  = ps.left_wheel;
+        o[BATCH_RIGHT_WHEEL] = ps.right_wheel;
+        o[BATCH_WHEEL_DELTA] = ps.right_wheel_delta;
+        o[BATCH_SEQ]         = (jint)e->seq;
+        o[BATCH_DUML_SEQ]    = e->duml_seq;
+        o[BATCH_OFFSET]      = e->offset;
+        o[BATCH_CHANGED]     = (jint)e->changed;
+    }
+    if (n > 0)
+        (*env)->SetIntArrayRegion(env, out, 0, n * BATCH_STRIDE, packed);
+    return n;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeSetChangeDetect
+ * Signature: (JZI)Z
+ *
+ * Refused while a native reader owns the parser: its thread reads the
+ * change-detect settings on every push.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeSetChangeDetect(JNIEnv *env, jclass clazz, jlong handle,
+                                                         jboolean enable, jint deadband) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser || reader_owned(ctx)) return JNI_FALSE;
+    if (deadband < 0) deadband = 0;
+    if (deadband > 0xFFFF) deadband = 0xFFFF;
+    rcm_set_change_detect(ctx->parser, enable == JNI_TRUE, (uint16_t)deadband, NULL);
+    return JNI_TRUE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeSetLayoutLock
+ * Signature: (JII)Z
+ *
+ * Refused while a native reader owns the parser, which updates the lock
+ * state on every unclaimed frame.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeSetLayoutLock(JNIEnv *env, jclass clazz, jlong handle,
+                                                       jint confirmFrames, jint missLimit) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser || reader_owned(ctx)) return JNI_FALSE;
+    if (confirmFrames < 0) confirmFrames = 0;
+    if (missLimit < 0) missLimit = 0;
+    rcm_set_layout_lock(ctx->parser, (uint32_t)confirmFrames, (uint32_t)missLimit);
+    return JNI_TRUE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeSetCoalesce
+ * Signature: (JZ)V
+ *
+ * Switch between one listener upcall per push and coalesced dispatch.
+ * Call on the thread that will dispatch (or before the timer starts).
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeSetCoalesce(JNIEnv *env, jclass clazz, jlong handle,
+                                                     jboolean enable) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return;
+    bool on = enable == JNI_TRUE;
+    rcm_set_coalesce(ctx->parser, on);
+    atomic_store_explicit(&ctx->coalesce, on, memory_order_relaxed);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeDispatchCoalesced
+ * Signature: (J)I
+ *
+ * Deliver the state coalesced since the last tick to the listener on
+ * the calling thread (e.g. from a Choreographer frame callback).
+ * Returns the pushes it covered, 0 (no upcall) if none arrived or while
+ * the timer thread (nativeStartCoalesceTimer()) is the dispatcher.
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeDispatchCoalesced(JNIEnv *env, jclass clazz,
+                                                           jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser || !atomic_load_explicit(&ctx->coalesce, memory_order_relaxed) ||
+        atomic_load(&ctx->co_timer))
+        return 0;
+    return dispatch_coalesced(env, ctx);
+}
+
+/* Coalesced dispatch thread: one delivery per timerfd expiry until stopped */
+static void *coalesce_thread(void *arg) {
+    jni_ctx_t *ctx = (jni_ctx_t *)arg;
+    JNIEnv *env = thread_env(ctx->jvm);
+    if (!env) return NULL;
+
+    struct pollfd fds[2] = {
+        { .fd = ctx->co_timer_fd, .events = POLLIN },
+        { .fd = ctx->co_stop_fd,  .events = POLLIN },
+    };
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        uint64_t expirations;
+        if (read(ctx->co_timer_fd, &expirations, sizeof(expirations)) > 0)
+            dispatch_coalesced(env, ctx);
+    }
+    return NULL;
+}
+
+static void stop_coalesce_timer(jni_ctx_t *ctx) {
+    if (!ctx->co_timer) return;
+    uint64_t one = 1;
+    if (write(ctx->co_stop_fd, &one, sizeof(one)) < 0)
+        LOGE("Coalesce timer stop signal failed: %d", errno);
+    pthread_join(ctx->co_thread, NULL);
+    close(ctx->co_timer_fd);
+    close(ctx->co_stop_fd);
+    ctx->co_timer = false;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStartCoalesceTimer
+ * Signature: (JI)Z
+ *
+ * Enable coalesced dispatch driven by a native CLOCK_MONOTONIC timerfd
+ * every `periodUs`; the listener is called on that timer's thread. The
+ * timer and nativeDispatchCoalesced() are mutually exclusive drivers.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStartCoalesceTimer(JNIEnv *env, jclass clazz,
+                                                            jlong handle, jint periodUs) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser || ctx->co_timer || periodUs <= 0) return JNI_FALSE;
+
+    ctx->co_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    ctx->co_stop_fd = eventfd(0, EFD_CLOEXEC);
+    struct itimerspec its = {
+        .it_interval = { .tv_sec = periodUs / 1000000, .tv_nsec = (long)(periodUs % 1000000) * 1000 },
+    };
+    its.it_value = its.it_interval;
+    if (ctx->co_timer_fd < 0 || ctx->co_stop_fd < 0 ||
+        timerfd_settime(ctx->co_timer_fd, 0, &its, NULL) != 0) {
+        LOGE("Coalesce timer setup failed: %d", errno);
+        goto fail;
+    }
+
+    /* Set before the thread exists, so nativeDispatchCoalesced() stops first */
+    atomic_store(&ctx->co_timer, true);
+    rcm_set_coalesce(ctx->parser, true);
+    atomic_store_explicit(&ctx->coalesce, true, memory_order_relaxed);
+    if (pthread_create(&ctx->co_thread, NULL, coalesce_thread, ctx) != 0) {
+        atomic_store_explicit(&ctx->coalesce, false, memory_order_relaxed);
+        rcm_set_coalesce(ctx->parser, false);
+        atomic_store(&ctx->co_timer, false);
+        goto fail;
+    }
+    return JNI_TRUE;
+
+fail:
+    if (ctx->co_timer_fd >= 0) close(ctx->co_timer_fd);
+    if (ctx->co_stop_fd >= 0) close(ctx->co_stop_fd);
+    return JNI_FALSE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStopCoalesceTimer
+ * Signature: (J)V
+ *
+ * Stop the timer thread and return to one upcall per push.
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStopCoalesceTimer(JNIEnv *env, jclass clazz,
+                                                           jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->co_timer) return;
+    stop_coalesce_timer(ctx);
+    atomic_store_explicit(&ctx->coalesce, false, memory_order_relaxed);
+    rcm_set_coalesce(ctx->parser, false);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeTrackArrivals
+ * Signature: (JIJJ)V
+ *
+ * Timestamp and score every push the listener path sees (before muting),
+ * with a stall threshold of clamp(interval * stallFactor, minStallNs,
+ * maxStallNs). Counters restart from zero at the next push, which the
+ * feeding thread scores, so this is safe while a reader feeds.
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeTrackArrivals(JNIEnv *env, jclass clazz, jlong handle,
+                                                       jint stallFactor, jlong minStallNs,
+                                                       jlong maxStallNs) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx) return;
+    atomic_store(&ctx->arr_factor, stallFactor > 0 ? (uint32_t)stallFactor : 1u);
+    atomic_store(&ctx->arr_min_ns, minStallNs > 0 ? (uint64_t)minStallNs : 0u);
+    atomic_store(&ctx->arr_max_ns, maxStallNs > minStallNs ? (uint64_t)maxStallNs
+                                                           : (uint64_t)minStallNs);
+    atomic_store(&ctx->arr_reset, true);
+    atomic_store(&ctx->arr_on, true);
+}
+
+/* Layout of the nativeGetArrivals() output (mirror RcMonitor.ARRIVAL_*) */
+#define ARRIVAL_COUNT       0
+#define ARRIVAL_LAST_NS     1
+#define ARRIVAL_INTERVAL_NS 2
+#define ARRIVAL_RUN_NS      3
+#define ARRIVAL_STALL_NS    4
+#define ARRIVAL_LEN         5
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeGetArrivals
+ * Signature: (J[J)Z
+ *
+ * Copy the arrival scores, any thread (fields may be one push apart);
+ * all zero until the first push after nativeTrackArrivals().
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeGetArrivals(JNIEnv *env, jclass clazz, jlong handle,
+                                                     jlongArray out) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !out || (*env)->GetArrayLength(env, out) < ARRIVAL_LEN) return JNI_FALSE;
+    jlong v[ARRIVAL_LEN] = {0};
+    v[ARRIVAL_COUNT] = (jlong)arrival_count(ctx);
+    if (v[ARRIVAL_COUNT] != 0) {
+        v[ARRIVAL_LAST_NS]     = (jlong)atomic_load_explicit(&ctx->arr_last_ns, memory_order_relaxed);
+        v[ARRIVAL_INTERVAL_NS] = (jlong)atomic_load_explicit(&ctx->arr_interval_ns, memory_order_relaxed);
+        v[ARRIVAL_RUN_NS]      = (jlong)atomic_load_explicit(&ctx->arr_run_ns, memory_order_relaxed);
+        v[ARRIVAL_STALL_NS]    = (jlong)atomic_load_explicit(&ctx->arr_stall_ns, memory_order_relaxed);
+    }
+    (*env)->SetLongArrayRegion(env, out, 0, ARRIVAL_LEN, v);
+    return JNI_TRUE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeMuteUntil
+ * Signature: (JJJ)V
+ *
+ * Suppress listener upcalls for pushes arriving before `untilNs` (0 =
+ * unmuted). With a non-zero `watched` handle the deadline is instead the
+ * moment that instance's arrivals would stall (last arrival + stall
+ * threshold, or now if it has none yet), so a muted standby speaks up
+ * exactly when its active peer goes quiet. Any thread; `watched` must be
+ * alive for the duration of the call.
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeMuteUntil(JNIEnv *env, jclass clazz, jlong handle,
+                                                   jlong untilNs, jlong watched) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx) return;
+    uint64_t until = (uint64_t)untilNs;
+    jni_ctx_t *w = ctx_from_handle(watched);
+    if (w) {
+        until = 1;
+        if (arrival_count(w) != 0)
+            until = atomic_load_explicit(&w->arr_last_ns, memory_order_relaxed) +
+                    atomic_load_explicit(&w->arr_stall_ns, memory_order_relaxed) + 1;
+    }
+    atomic_store_explicit(&ctx->mute_until_ns, until, memory_order_relaxed);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeSetTracing
+ * Signature: (JZ)Z
+ *
+ * Install or remove the ATrace trace hook. Safe while a native reader
+ * feeds. Returns whether ATrace sections are available on this device.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeSetTracing(JNIEnv *env, jclass clazz, jlong handle,
+                                                    jboolean enable) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return JNI_FALSE;
+    pthread_once(&g_atrace_once, load_atrace);
+    bool on = enable == JNI_TRUE;
+    atomic_store_explicit(&ctx->tracing, on, memory_order_relaxed);
+    rcm_set_trace_hook(ctx->parser, on ? jni_trace_hook : NULL, ctx);
+    return g_atrace.begin ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeTraceRead
+ * Signature: (JJ)V
+ *
+ * A Java reader's bulk read completed at `tNs` (System.nanoTime()).
+ * Called on the feeding thread just before the data is fed.
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeTraceRead(JNIEnv *env, jclass clazz, jlong handle,
+                                                   jlong tNs) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return;
+    rcm_trace_read(ctx->parser, (uint64_t)tNs);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeSnapshot
+ * Signature: (J[I)J
+ *
+ * Copy the parser's latest-state mailbox into entry 0 of `out` (batch
+ * layout). Safe to call from any thread while the reader thread feeds.
+ * Returns the publish count, or -1 if nothing was published yet.
+ */
+JNIEXPORT jlong JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeSnapshot(JNIEnv *env, jclass clazz, jlong handle,
+                                                  jintArray out) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return -1;
+    if (!out || (*env)->GetArrayLength(env, out) < BATCH_STRIDE) return -1;
+
+    rcm_packed_state_t ps;
+    uint32_t seq;
+    if (rcm_snapshot_packed(ctx->parser, &ps, &seq) != 0) return -1;
+
+    jint o[BATCH_STRIDE];
+    o[BATCH_BUTTONS]     = ps.flags & RCM_PK_BUTTON_MASK;
+    o[BATCH_FLIGHT_MODE] = (jint)rcm_packed_flight_mode(&ps);
+    o[BATCH_STICK_RH]    = ps.stick_right_h;
+    o[BATCH_STICK_RV]    = ps.stick_right_v;
+    o[BATCH_STICK_LH]    = ps.stick_left_h;
+    o[BATCH_STICK_LV]    = ps.stick_left_v;
+    o[BATCH_LEFT_WHEEL]  = ps.left_wheel;
+    o[BATCH_RIGHT_WHEEL] = ps.right_wheel;
+    o[BATCH_WHEEL_DELTA] = ps.right_wheel_delta;
+    o[BATCH_SEQ]         = (jint)seq;
+    o[BATCH_DUML_SEQ]    = 0;
+    o[BATCH_OFFSET]      = 0;
+    o[BATCH_CHANGED]     = 0;
+    (*env)->SetIntArrayRegion(env, out, 0, BATCH_STRIDE, o);
+    return (jlong)seq;
+}
+
+/* Scalar layout of the nativeGetStats() output (mirror RcMonitor.STAT_*) */
+#define STAT_BYTES_IN          0
+#define STAT_BYTES_DISCARDED   1
+#define STAT_FRAMES            2
+#define STAT_CRC8_FAILURES     3
+#define STAT_CRC16_FAILURES    4
+#define STAT_LENGTH_ERRORS     5
+#define STAT_RC_PUSHES         6
+#define STAT_BATCH_OVERFLOWS   7
+#define STAT_LAST_PUSH_AGE_NS  8   /* -1 if no push yet */
+#define STAT_REQUESTS          9
+#define STAT_RESPONSES         10
+#define STAT_REQUEST_TIMEOUTS  11
+#define STAT_RTT_LAST_NS       12
+#define STAT_RTT_MIN_NS        13
+#define STAT_RTT_MAX_NS        14
+#define STAT_RTT_SMOOTHED_NS   15
+#define STAT_LAYOUT            16  /* RCM_LAYOUT_* */
+#define STAT_LAYOUT_CMD_OFFSET 17
+#define STAT_LAYOUT_LOCKS      18
+#define STAT_LAYOUT_FALLBACKS  19
+#define STAT_COUNT             20
+
+/* Copy up to `n` counters into a Java long[] (NULL arrays are skipped) */
+static void put_longs(JNIEnv *env, jlongArray arr, const uint64_t *v, jsize n) {
+    if (!arr) return;
+    jsize len = (*env)->GetArrayLength(env, arr);
+    if (len > n) len = n;
+    jlong tmp[256];
+    for (jsize i = 0; i < len; i++)
+        tmp[i] = (jlong)v[i];
+    (*env)->SetLongArrayRegion(env, arr, 0, len, tmp);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeGetStats
+ * Signature: (J[J[J[J)I
+ *
+ * Any of the arrays may be null. Returns the number of latency histogram
+ * buckets available (0 if the library was built without it), or -1 if the
+ * parser is not initialised. While a native reader owns the parser the
+ * counters are the copy its thread took after its last feed, with
+ * last_push_age_ns brought up to date.
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeGetStats(JNIEnv *env, jclass clazz, jlong handle,
+                                                  jlongArray out,
+                                                  jlongArray cmdSetFrames,
+                                                  jlongArray feedHist) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return -1;
+
+    rcm_stats_t st;
+    if (reader_owned(ctx)) {
+        pthread_mutex_lock(&ctx->stats_lock);
+        st = ctx->stats_copy;
+        uint64_t taken = ctx->stats_copy_ns;
+        pthread_mutex_unlock(&ctx->stats_lock);
+        if (st.last_push_age_ns != UINT64_MAX)
+            st.last_push_age_ns += clock_ns() - taken;
+    } else {
+        /* A reset requested while a reader ran but never applied by it */
+        if (atomic_exchange_explicit(&ctx->stats_reset, false, memory_order_relaxed))
+            rcm_reset_stats(ctx->parser);
+        if (rcm_get_stats(ctx->parser, &st) != 0) return -1;
+    }
+
+    uint64_t v[STAT_COUNT];
+    v[STAT_BYTES_IN]         = st.bytes_in;
+    v[STAT_BYTES_DISCARDED]  = st.bytes_discarded;
+    v[STAT_FRAMES]           = st.frames;
+    v[STAT_CRC8_FAILURES]    = st.crc8_failures;
+    v[STAT_CRC16_FAILURES]   = st.crc16_failures;
+    v[STAT_LENGTH_ERRORS]    = st.length_errors;
+    v[STAT_RC_PUSHES]        = st.rc_pushes;
+    v[STAT_BATCH_OVERFLOWS]  = st.batch_overflows;
+    v[STAT_LAST_PUSH_AGE_NS] = st.last_push_age_ns; /* UINT64_MAX -> -1 */
+    v[STAT_REQUESTS]         = st.requests_tracked;
+    v[STAT_RESPONSES]        = st.responses_matched;
+    v[STAT_REQUEST_TIMEOUTS] = st.request_timeouts;
+    v[STAT_RTT_LAST_NS]      = st.rtt_last_ns;
+    v[STAT_RTT_MIN_NS]       = st.rtt_min_ns;
+    v[STAT_RTT_MAX_NS]       = st.rtt_max_ns;
+    v[STAT_RTT_SMOOTHED_NS]  = st.rtt_smoothed_ns;
+    v[STAT_LAYOUT]           = st.layout;
+    v[STAT_LAYOUT_CMD_OFFSET] = st.layout_cmd_offset;
+    v[STAT_LAYOUT_LOCKS]     = st.layout_locks;
+    v[STAT_LAYOUT_FALLBACKS] = st.layout_fallbacks;
+    put_longs(env, out, v, STAT_COUNT);
+    put_longs(env, cmdSetFrames, st.frames_by_cmd_set, 256);
+    if (!st.feed_hist_enabled)
+        return 0;
+    put_longs(env, feedHist, st.feed_hist, RCM_FEED_HIST_BUCKETS);
+    return RCM_FEED_HIST_BUCKETS;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeResetStats
+ * Signature: (J)V
+ *
+ * While a native reader owns the parser the reset is left to its thread,
+ * which applies it before its next stats copy.
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeResetStats(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser) return;
+    if (reader_owned(ctx)) {
+        atomic_store_explicit(&ctx->stats_reset, true, memory_order_relaxed);
+        return;
+    }
+    atomic_store_explicit(&ctx->stats_reset, false, memory_order_relaxed);
+    rcm_reset_stats(ctx->parser);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeEnableHistory
+ * Signature: (JII)Z
+ *
+ * Attach a motion history of `capacity` samples over the last `windowMs`
+ * (0 = just the last `capacity` samples) to the parser. Once per instance,
+ * not while a native reader owns the parser; it lives until nativeDestroy().
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeEnableHistory(JNIEnv *env, jclass clazz, jlong handle,
+                                                       jint capacity, jint windowMs) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser || ctx->history || reader_owned(ctx) ||
+        capacity < 0 || windowMs < 0)
+        return JNI_FALSE;
+    ctx->history = rcm_history_create((unsigned)capacity, (uint64_t)windowMs * 1000000u);
+    if (!ctx->history) return JNI_FALSE;
+    rcm_set_history(ctx->parser, ctx->history);
+    return JNI_TRUE;
+}
+
+/* Layout of the nativeQueryHistory() output (mirror RcMonitor.HIST_*) */
+#define HIST_T_NS        0
+#define HIST_SPAN_NS     1
+#define HIST_SAMPLES     2
+#define HIST_COUNT       3
+#define HIST_PRESSED     4
+#define HIST_RELEASED    5
+#define HIST_WHEEL_DELTA 6
+#define HIST_MEAN_Q8     7                        /* + RCM_HIST_* axis */
+#define HIST_VELOCITY    (HIST_MEAN_Q8 + RCM_HIST_AXES)
+#define HIST_MIN         (HIST_VELOCITY + RCM_HIST_AXES)
+#define HIST_MAX         (HIST_MIN + RCM_HIST_AXES)
+#define HIST_LEN         (HIST_MAX + RCM_HIST_AXES)
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeQueryHistory
+ * Signature: (J[J)Z
+ *
+ * rcm_history_query() into one long[] of HIST_LEN, any thread. False
+ * without a history, before its first sample or for a short array.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeQueryHistory(JNIEnv *env, jclass clazz, jlong handle,
+                                                      jlongArray out) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    rcm_history_stats_t st;
+    if (!ctx || !ctx->history || !out || (*env)->GetArrayLength(env, out) < HIST_LEN ||
+        rcm_history_query(ctx->history, &st) != 0)
+        return JNI_FALSE;
+
+    jlong v[HIST_LEN];
+    v[HIST_T_NS]        = (jlong)st.t_ns;
+    v[HIST_SPAN_NS]     = (jlong)st.span_ns;
+    v[HIST_SAMPLES]     = st.samples;
+    v[HIST_COUNT]       = st.count;
+    v[HIST_PRESSED]     = st.pressed;
+    v[HIST_RELEASED]    = st.released;
+    v[HIST_WHEEL_DELTA] = st.wheel_delta;
+    for (int a = 0; a < RCM_HIST_AXES; a++) {
+        v[HIST_MEAN_Q8 + a]  = st.mean_q8[a];
+        v[HIST_VELOCITY + a] = st.velocity[a];
+        v[HIST_MIN + a]      = st.min[a];
+        v[HIST_MAX + a]      = st.max[a];
+    }
+    (*env)->SetLongArrayRegion(env, out, 0, HIST_LEN, v);
+    return JNI_TRUE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeHistoryPressedWithin
+ * Signature: (JII)I
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeHistoryPressedWithin(JNIEnv *env, jclass clazz,
+                                                              jlong handle, jint buttons,
+                                                              jint frames) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->history || frames <= 0) return 0;
+    return rcm_history_pressed_within(ctx->history, (uint16_t)buttons, (uint32_t)frames);
+}
+
+/*
+ * Deliver a raw payload through the parser (rcm_feed_payload()), so it
+ * reaches coalescing, change detection, the mailbox, statistics and the
+ * history like a framed push. @return 1 if delivered, 0 if suppressed by
+ * change detection or shorter than a payload
+ */
+static int feed_payload(JNIEnv *env, jni_ctx_t *ctx, const uint8_t *payload, size_t len) {
+    if (!ctx->parser) return -1;
+    int ret = rcm_feed_payload(ctx->parser, payload, len);
+    if (ret < 0) return 0;
+    feed_notify(env, ctx);
+    return ret;
+}
+
 /*
  * Class:     space_yasha_rcmonitor_RcMonitor
  * Method:    nativeFeedDirect
- * Signature: ([BI)I
+ * Signature: (J[BI)I
  *
  * Feed raw 17-byte payload directly (bypasses DUML framing).
  * Use this if you already extract the RC push payload elsewhere.
  */
 JNIEXPORT jint JNICALL
-Java_space_yasha_rcmonitor_RcMonitor_nativeFeedDirect(JNIEnv *env, jobject thiz,
+Java_space_yasha_rcmonitor_RcMonitor_nativeFeedDirect(JNIEnv *env, jclass clazz, jlong handle,
                                                     jbyteArray payload, jint length) {
-    if (!g_ctx) return -1;
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx) return -1;
     if (!payload || length <= 0) return -1;
 
     jint arrLen = (*env)->GetArrayLength(env, payload);
@@ -181,45 +1218,534 @@ Java_space_yasha_rcmonitor_RcMonitor_nativeFeedDirect(JNIEnv *env, jobject thiz,
     jbyte *buf = (*env)->GetByteArrayElements(env, payload, NULL);
     if (!buf) return -1;
 
-    rc_state_t state;
-    int ret = rcm_parse_payload((const uint8_t *)buf, (size_t)length, &state);
+    int ret = feed_payload(env, ctx, (const uint8_t *)buf, (size_t)length);
 
     (*env)->ReleaseByteArrayElements(env, payload, buf, JNI_ABORT);
+    return ret;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeFeedDirectBuffer
+ * Signature: (JLjava/nio/ByteBuffer;II)I
+ *
+ * nativeFeedDirect() for a raw payload held in a direct ByteBuffer.
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeFeedDirectBuffer(JNIEnv *env, jclass clazz, jlong handle,
+                                                          jobject buffer, jint offset, jint length) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx) return -1;
+
+    const uint8_t *buf = direct_window(env, buffer, offset, &length);
+    if (!buf) return -1;
+    return feed_payload(env, ctx, buf, (size_t)length);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeEnableStateRing
+ * Signature: (JILspace/yasha/rcmonitor/RcMonitor$StateRingListener;)Ljava/nio/ByteBuffer;
+ *
+ * Switch this instance from per-frame onRcState upcalls to the shared
+ * state ring. `capacity` is rounded up to a power of two in
+ * [RING_MIN_ENTRIES, RING_MAX_ENTRIES]. With a non-null `notify`, each feed
+ * that published states makes one onStates(written) call; with null the
+ * consumer polls. The ring lives until nativeDestroy() and can be enabled
+ * once, not while a native reader owns the parser (its thread reads
+ * ctx->ring in jni_rc_callback()); returns null then, if it already is
+ * enabled or on failure.
+ */
+JNIEXPORT jobject JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeEnableStateRing(JNIEnv *env, jclass clazz, jlong handle,
+                                                         jint capacity, jobject notify) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || ctx->ring || reader_owned(ctx)) return NULL;
+
+    uint32_t cap = RING_MIN_ENTRIES;
+    while (cap < (uint32_t)capacity && cap < RING_MAX_ENTRIES)
+        cap <<= 1;
+
+    jmethodID mid = NULL;
+    if (notify) {
+        jclass cls = (*env)->GetObjectClass(env, notify);
+        mid = cls ? (*env)->GetMethodID(env, cls, "onStates", "(J)V") : NULL;
+        if (!mid) {
+            LOGE("Failed to find onStates method");
+            return NULL;
+        }
+    }
+
+    size_t bytes = RING_HDR_LEN + (size_t)cap * RING_ENTRY_LEN;
+    void *mem = NULL;
+    if (posix_memalign(&mem, 64, bytes) != 0) return NULL;
+    memset(mem, 0, bytes);
+
+    jobject buffer = (*env)->NewDirectByteBuffer(env, mem, (jlong)bytes);
+    if (!buffer) {
+        free(mem);
+        return NULL;
+    }
+
+    jni_ring_hdr_t *hdr = (jni_ring_hdr_t *)mem;
+    hdr->capacity  = (int32_t)cap;
+    hdr->entry_len = RING_ENTRY_LEN;
+    ctx->ring_mask = cap - 1;
+    ctx->ring_written = 0;
+    ctx->ring_notified = 0;
+    if (notify) {
+        ctx->ring_notify_ref = (*env)->NewGlobalRef(env, notify);
+        ctx->ring_notify_mid = mid;
+    }
+    ctx->ring = hdr;
+    LOGD("State ring enabled (%u entries)", cap);
+    return buffer;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeRingWritten
+ * Signature: (J)J
+ *
+ * Acquire-load of the ring's write counter. Java reads the entries with
+ * plain ByteBuffer gets, so it brackets them with this call instead of
+ * reading the header word itself.
+ */
+JNIEXPORT jlong JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeRingWritten(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->ring) return 0;
+    atomic_thread_fence(memory_order_acquire); /* order the caller's earlier reads */
+    return (jlong)atomic_load_explicit(&ctx->ring->written, memory_order_acquire);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeRingClaimed
+ * Signature: (J)J
+ *
+ * The ring's `claimed` counter, after an acquire fence that orders the
+ * caller's entry reads before it: entries below the result minus capacity
+ * may have been overwritten during those reads.
+ */
+JNIEXPORT jlong JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeRingClaimed(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->ring) return 0;
+    atomic_thread_fence(memory_order_acquire);
+    return (jlong)atomic_load_explicit(&ctx->ring->claimed, memory_order_relaxed);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStartSharedPublisher
+ * Signature: (JLjava/lang/String;I)I
+ *
+ * Also publish every decoded state into a shared-memory ring that other
+ * processes map read-only (rc_monitor_shm.h); consumers are woken once per
+ * feed. Returns the region's fd, which stays owned by the instance (Java
+ * dups it into a ParcelFileDescriptor), or -1. Can be started once; the
+ * publisher lives until nativeDestroy().
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStartSharedPublisher(JNIEnv *env, jclass clazz,
+                                                              jlong handle, jstring name,
+                                                              jint capacity) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || shm_of(ctx) || capacity < 0) return -1;
+
+    const char *cname = name ? (*env)->GetStringUTFChars(env, name, NULL) : NULL;
+    if (name && !cname) return -1;
+    rcm_shm_publisher_t *shm = rcm_shm_create(cname, (unsigned)capacity);
+    if (cname) (*env)->ReleaseStringUTFChars(env, name, cname);
+    if (!shm) {
+        LOGE("Shared publisher failed: %s", strerror(errno));
+        return -1;
+    }
+    atomic_store_explicit(&ctx->shm, shm, memory_order_release);
+    LOGD("Shared publisher started (fd %d)", rcm_shm_fd(shm));
+    return rcm_shm_fd(shm);
+}
+
+/*
+ * Refresh stats_copy from the thread that owns the parser. The reader
+ * thread passes wait=false so it never blocks on nativeGetStats(); the
+ * start natives seed the copy with wait=true before handing the parser over.
+ */
+static void publish_stats(jni_ctx_t *ctx, bool wait) {
+    if (atomic_exchange_explicit(&ctx->stats_reset, false, memory_order_relaxed))
+        rcm_reset_stats(ctx->parser);
+    if (wait)
+        pthread_mutex_lock(&ctx->stats_lock);
+    else if (pthread_mutex_trylock(&ctx->stats_lock) != 0)
+        return;
+    rcm_get_stats(ctx->parser, &ctx->stats_copy);
+    ctx->stats_copy_ns = clock_ns();
+    pthread_mutex_unlock(&ctx->stats_lock);
+}
+
+/* after_feed hook of the native readers: runs on the reader thread */
+static void reader_after_feed(void *userdata) {
+    jni_ctx_t *ctx = (jni_ctx_t *)userdata;
+    publish_stats(ctx, false);
+    if (!ctx->ring_notify_ref) {
+        rcm_shm_publisher_t *shm = shm_of(ctx);
+        if (shm)
+            rcm_shm_wake(shm);
+        return;
+    }
+    JNIEnv *env = thread_env(ctx->jvm);
+    if (env)
+        feed_notify(env, ctx);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStartUsbReader
+ * Signature: (JIIIZIII)Z
+ *
+ * Hand the parser to a native usbdevfs reader thread on `fd` (from
+ * UsbDeviceConnection.getFileDescriptor(), interface already claimed).
+ * Until nativeStopUsbReader() the Java side must not feed or reset this
+ * instance; listener upcalls come from the reader thread.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStartUsbReader(JNIEnv *env, jclass clazz, jlong handle,
+                                                        jint fd, jint ep_in, jint ep_out,
+                                                        jboolean send_enable,
+                                                        jint push_timeout_ms,
+                                                        jint poll_interval_ms,
+                                                        jint poll_inflight) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser || reader_owned(ctx)) return JNI_FALSE;
+
+    rcm_usb_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.fd               = fd;
+    cfg.ep_in            = (uint8_t)ep_in;
+    cfg.ep_out           = (uint8_t)ep_out;
+    cfg.send_enable      = send_enable;
+    cfg.push_timeout_ms  = push_timeout_ms;
+    cfg.poll_interval_ms = poll_interval_ms;
+    cfg.poll_inflight    = poll_inflight > 0 ? (unsigned)poll_inflight : 0;
+    cfg.after_feed       = reader_after_feed;
+    cfg.userdata         = ctx;
+
+    publish_stats(ctx, true);
+    ctx->usb = rcm_usb_start(ctx->parser, &cfg);
+    if (!ctx->usb) {
+        LOGE("Native USB reader failed to start");
+        return JNI_FALSE;
+    }
+    pthread_mutex_lock(&ctx->capture_lock);
+    rcm_usb_set_capture(ctx->usb, atomic_load(&ctx->capture), RCM_CAPTURE_SRC_USB);
+    pthread_mutex_unlock(&ctx->capture_lock);
+    LOGD("Native USB reader started (ep 0x%02x/0x%02x)", ep_in & 0xFF, ep_out & 0xFF);
+    return JNI_TRUE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStopUsbReader
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStopUsbReader(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->usb) return;
+    rcm_usb_stop(ctx->usb);
+    ctx->usb = NULL;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeUsbReaderRunning
+ * Signature: (J)Z
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeUsbReaderRunning(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    return (ctx && rcm_usb_running(ctx->usb)) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeUsbSend
+ * Signature: (J[B)I
+ *
+ * Queue an OUT command on the native reader. Returns 0 or -1.
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeUsbSend(JNIEnv *env, jclass clazz, jlong handle,
+                                                 jbyteArray data) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->usb || !data) return -1;
 
-    if (ret == 0) {
-        jni_rc_callback(&state, g_ctx);
-        return 1;
+    jsize len = (*env)->GetArrayLength(env, data);
+    if (len <= 0 || len > DUML_MAX_FRAME_LEN) return -1;
+    uint8_t buf[DUML_MAX_FRAME_LEN];
+    (*env)->GetByteArrayRegion(env, data, 0, len, (jbyte *)buf);
+    return rcm_usb_send(ctx->usb, buf, (size_t)len);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStartEvdevReader
+ * Signature: (JI[IF)Z
+ *
+ * Hand the parser to a native evdev reader on `fd`. `abs_codes` (nullable)
+ * overrides the ABS code per stick slot (RCM_EVDEV_* order, -1 unmapped);
+ * `scale` 0 keeps the default. Same ownership rules as the USB reader.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStartEvdevReader(JNIEnv *env, jclass clazz, jlong handle,
+                                                          jint fd, jintArray abs_codes,
+                                                          jfloat scale) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser || reader_owned(ctx)) return JNI_FALSE;
+
+    rcm_evdev_config_t cfg;
+    rcm_evdev_config_init(&cfg, fd);
+    if (abs_codes) {
+        if ((*env)->GetArrayLength(env, abs_codes) < RCM_EVDEV_AXES) return JNI_FALSE;
+        jint codes[RCM_EVDEV_AXES];
+        (*env)->GetIntArrayRegion(env, abs_codes, 0, RCM_EVDEV_AXES, codes);
+        for (int i = 0; i < RCM_EVDEV_AXES; i++)
+            cfg.abs_code[i] = codes[i];
+    }
+    cfg.scale      = scale;
+    cfg.after_feed = reader_after_feed;
+    cfg.userdata   = ctx;
+
+    publish_stats(ctx, true);
+    ctx->evdev = rcm_evdev_start(ctx->parser, &cfg);
+    if (!ctx->evdev) {
+        LOGE("Native evdev reader failed to start");
+        return JNI_FALSE;
+    }
+    LOGD("Native evdev reader started");
+    return JNI_TRUE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStopEvdevReader
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStopEvdevReader(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->evdev) return;
+    rcm_evdev_stop(ctx->evdev);
+    ctx->evdev = NULL;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeEvdevReaderRunning
+ * Signature: (J)Z
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeEvdevReaderRunning(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    return (ctx && rcm_evdev_running(ctx->evdev)) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeAttachStream
+ * Signature: (JLjava/lang/String;)Z
+ *
+ * Connect to a Unix domain socket (leading '@' = abstract namespace) and
+ * feed it from the shared native ingestion loop. Same ownership rules as
+ * the USB reader; callbacks run on the loop thread.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeAttachStream(JNIEnv *env, jclass clazz, jlong handle,
+                                                      jstring path) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->parser || !path || reader_owned(ctx)) return JNI_FALSE;
+
+    const char *cpath = (*env)->GetStringUTFChars(env, path, NULL);
+    if (!cpath) return JNI_FALSE;
+    int fd = rcm_io_connect_unix(cpath);
+    if (fd < 0) LOGE("Failed to connect to %s", cpath);
+    (*env)->ReleaseStringUTFChars(env, path, cpath);
+    if (fd < 0) return JNI_FALSE;
+
+    publish_stats(ctx, true);
+    pthread_mutex_lock(&g_io_lock);
+    if (!g_io)
+        g_io = rcm_io_create();
+    int id = g_io ? rcm_io_add(g_io, fd, ctx->parser, reader_after_feed, ctx) : -1;
+    if (id >= 0) {
+        g_io_users++;
+    } else if (g_io && g_io_users == 0) {
+        rcm_io_destroy(g_io);
+        g_io = NULL;
+    }
+    pthread_mutex_unlock(&g_io_lock);
+
+    if (id < 0) {
+        LOGE("Failed to attach stream to the ingestion loop");
+        close(fd);
+        return JNI_FALSE;
+    }
+    ctx->io_attached = true;
+    ctx->io_id = id;
+    ctx->io_fd = fd;
+    pthread_mutex_lock(&ctx->capture_lock);
+    rcm_io_set_capture(g_io, id, atomic_load(&ctx->capture), RCM_CAPTURE_SRC_STREAM);
+    pthread_mutex_unlock(&ctx->capture_lock);
+    return JNI_TRUE;
+}
+
+/* Detach from the shared loop and close the socket */
+static void detach_stream(jni_ctx_t *ctx) {
+    pthread_mutex_lock(&g_io_lock);
+    rcm_io_remove(g_io, ctx->io_id);
+    if (--g_io_users == 0) {
+        rcm_io_destroy(g_io);
+        g_io = NULL;
     }
-    return 0;
+    pthread_mutex_unlock(&g_io_lock);
+    close(ctx->io_fd);
+    ctx->io_attached = false;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeDetachStream
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeDetachStream(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (ctx && ctx->io_attached)
+        detach_stream(ctx);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStreamAlive
+ * Signature: (J)Z
+ *
+ * False once the peer closed the socket or a read failed.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStreamAlive(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !ctx->io_attached) return JNI_FALSE;
+    return rcm_io_alive(g_io, ctx->io_id) ? JNI_TRUE : JNI_FALSE;
+}
+
+/* Point every ingestion path of `ctx` at `w`; caller holds capture_lock */
+static void route_capture(jni_ctx_t *ctx, rcm_capture_writer_t *w) {
+    if (ctx->usb)
+        rcm_usb_set_capture(ctx->usb, w, RCM_CAPTURE_SRC_USB);
+    if (ctx->io_attached)
+        rcm_io_set_capture(g_io, ctx->io_id, w, RCM_CAPTURE_SRC_STREAM);
+    atomic_store_explicit(&ctx->capture, w, memory_order_relaxed);
+}
+
+/* Detach and finalize the open capture, if any */
+static void stop_capture(jni_ctx_t *ctx) {
+    pthread_mutex_lock(&ctx->capture_lock);
+    rcm_capture_writer_t *w = atomic_load(&ctx->capture);
+    if (w)
+        route_capture(ctx, NULL);
+    pthread_mutex_unlock(&ctx->capture_lock);
+    if (w && rcm_capture_close(w) != 0)
+        LOGE("Capture file incomplete (write error)");
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStartCapture
+ * Signature: (JLjava/lang/String;II)Z
+ *
+ * Record every chunk this instance ingests (Java feeds, the native USB
+ * reader including its OUT commands, an attached stream) into a capture
+ * file at `path`, replacing any capture already open. `source` tags the
+ * chunks fed from Java.
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStartCapture(JNIEnv *env, jclass clazz, jlong handle,
+                                                      jstring path, jint index_interval_ms,
+                                                      jint source) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx || !path || index_interval_ms < 0) return JNI_FALSE;
+
+    const char *cpath = (*env)->GetStringUTFChars(env, path, NULL);
+    if (!cpath) return JNI_FALSE;
+    rcm_capture_writer_t *w = rcm_capture_open(cpath, (uint32_t)index_interval_ms);
+    if (!w) LOGE("Failed to create capture %s", cpath);
+    (*env)->ReleaseStringUTFChars(env, path, cpath);
+    if (!w) return JNI_FALSE;
+
+    stop_capture(ctx);
+    pthread_mutex_lock(&ctx->capture_lock);
+    ctx->capture_source = (uint8_t)source;
+    route_capture(ctx, w);
+    pthread_mutex_unlock(&ctx->capture_lock);
+    return JNI_TRUE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeStopCapture
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeStopCapture(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (ctx)
+        stop_capture(ctx);
 }
 
 /*
  * Class:     space_yasha_rcmonitor_RcMonitor
  * Method:    nativeReset
- * Signature: ()V
+ * Signature: (J)V
  */
 JNIEXPORT void JNICALL
-Java_space_yasha_rcmonitor_RcMonitor_nativeReset(JNIEnv *env, jobject thiz) {
-    if (g_ctx && g_ctx->parser)
-        rcm_reset(g_ctx->parser);
+Java_space_yasha_rcmonitor_RcMonitor_nativeReset(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (ctx && ctx->parser && !reader_owned(ctx))
+        rcm_reset(ctx->parser);
 }
 
 /*
  * Class:     space_yasha_rcmonitor_RcMonitor
  * Method:    nativeDestroy
- * Signature: ()V
+ * Signature: (J)V
  */
 JNIEXPORT void JNICALL
-Java_space_yasha_rcmonitor_RcMonitor_nativeDestroy(JNIEnv *env, jobject thiz) {
-    if (!g_ctx) return;
+Java_space_yasha_rcmonitor_RcMonitor_nativeDestroy(JNIEnv *env, jclass clazz, jlong handle) {
+    jni_ctx_t *ctx = ctx_from_handle(handle);
+    if (!ctx) return;
 
-    rcm_destroy(g_ctx->parser);
+    if (ctx->usb)
+        rcm_usb_stop(ctx->usb);
+    if (ctx->evdev)
+        rcm_evdev_stop(ctx->evdev);
+    if (ctx->io_attached)
+        detach_stream(ctx);
+    stop_capture(ctx);
+    stop_coalesce_timer(ctx);
+    pthread_mutex_destroy(&ctx->capture_lock);
+    pthread_mutex_destroy(&ctx->stats_lock);
+    rcm_destroy(ctx->parser);
+    rcm_history_destroy(ctx->history);
 
-    if (g_ctx->listener_ref)
-        (*env)->DeleteGlobalRef(env, g_ctx->listener_ref);
+    if (ctx->listener_ref)
+        (*env)->DeleteGlobalRef(env, ctx->listener_ref);
+    if (ctx->ring_notify_ref)
+        (*env)->DeleteGlobalRef(env, ctx->ring_notify_ref);
 
-    free(g_ctx);
-    g_ctx = NULL;
+    rcm_shm_destroy(shm_of(ctx));
+    free(ctx->ring);
+    free(ctx);
     LOGD("RC Monitor destroyed");
 }
 
@@ -260,3 +1786,146 @@ Java_space_yasha_rcmonitor_RcMonitor_nativeBuildChannelRequest(JNIEnv *env, jcla
         (*env)->SetByteArrayRegion(env, result, 0, len, (const jbyte *)buf);
     return result;
 }
+
+/*
+ * Class:     space_yasha_rcmonitor_RcMonitor
+ * Method:    nativeBuildCommands
+ * Signature: (IZI)[B
+ *
+ * Build an optional enable command followed by `channelRequests` channel
+ * requests, with seqs counting up from `seq`, back to back in one array
+ * for a single bulk OUT transfer. NULL if nothing was asked for or it
+ * would exceed one transfer (RCM_TX_QUEUE_MAX bytes).
+ */
+JNIEXPORT jbyteArray JNICALL
+Java_space_yasha_rcmonitor_RcMonitor_nativeBuildCommands(JNIEnv *env, jclass clazz, jint seq,
+                                                      jboolean enable, jint channelRequests) {
+    static const uint8_t enable_payload[1] = { 0x01 };
+    rcm_tx_template_t tpl;
+    rcm_tx_queue_t q;
+    rcm_tx_init(&q, (uint16_t)seq);
+    if (enable == JNI_TRUE) {
+        rcm_tx_template_enable(&tpl);
+        if (!rcm_tx_push(&q, &tpl, enable_payload, NULL)) return NULL;
+    }
+    rcm_tx_template_channel_request(&tpl);
+    for (jint i = 0; i < channelRequests; i++)
+        if (!rcm_tx_push(&q, &tpl, NULL, NULL)) return NULL;
+    if (q.len == 0) return NULL;
+
+    jbyteArray result = (*env)->NewByteArray(env, (jsize)q.len);
+    if (result)
+        (*env)->SetByteArrayRegion(env, result, 0, (jsize)q.len, (const jbyte *)q.buf);
+    return result;
+}
+
+/* --- SharedStateRing: consumer side of another process's publisher --- */
+
+static inline rcm_shm_reader_t *shm_reader_from_handle(jlong handle) {
+    return (rcm_shm_reader_t *)(intptr_t)handle;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_SharedStateRing
+ * Method:    nativeOpen
+ * Signature: (I)J
+ *
+ * Map a publisher's fd read-only (the fd may be closed afterwards).
+ * Returns a reader handle, or 0.
+ */
+JNIEXPORT jlong JNICALL
+Java_space_yasha_rcmonitor_SharedStateRing_nativeOpen(JNIEnv *env, jclass clazz, jint fd) {
+    rcm_shm_reader_t *r = calloc(1, sizeof(*r));
+    if (!r) return 0;
+    if (rcm_shm_open(r, fd) != 0) {
+        LOGE("Shared ring open failed: %s", strerror(errno));
+        free(r);
+        return 0;
+    }
+    return (jlong)(intptr_t)r;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_SharedStateRing
+ * Method:    nativeBuffer
+ * Signature: (J)Ljava/nio/ByteBuffer;
+ *
+ * Direct ByteBuffer over the whole read-only mapping. Java must only read
+ * it (it wraps it with asReadOnlyBuffer()); a write would fault.
+ */
+JNIEXPORT jobject JNICALL
+Java_space_yasha_rcmonitor_SharedStateRing_nativeBuffer(JNIEnv *env, jclass clazz, jlong handle) {
+    rcm_shm_reader_t *r = shm_reader_from_handle(handle);
+    if (!r) return NULL;
+    return (*env)->NewDirectByteBuffer(env, (void *)r->base, (jlong)r->size);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_SharedStateRing
+ * Method:    nativeWritten
+ * Signature: (J)J
+ *
+ * Acquire-load of `written`, before Java reads the entries.
+ */
+JNIEXPORT jlong JNICALL
+Java_space_yasha_rcmonitor_SharedStateRing_nativeWritten(JNIEnv *env, jclass clazz, jlong handle) {
+    rcm_shm_reader_t *r = shm_reader_from_handle(handle);
+    return r ? (jlong)rcm_shm_written(r) : 0;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_SharedStateRing
+ * Method:    nativeClaimed
+ * Signature: (J)J
+ *
+ * rcm_shm_claimed(), after Java has read entries with plain ByteBuffer
+ * gets: states below claimed - capacity may have been overwritten during
+ * the reads.
+ */
+JNIEXPORT jlong JNICALL
+Java_space_yasha_rcmonitor_SharedStateRing_nativeClaimed(JNIEnv *env, jclass clazz, jlong handle) {
+    rcm_shm_reader_t *r = shm_reader_from_handle(handle);
+    return r ? (jlong)rcm_shm_claimed(r) : 0;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_SharedStateRing
+ * Method:    nativeWait
+ * Signature: (JJI)I
+ *
+ * rcm_shm_wait() for a consumer that has read up to `read`: 1 when there
+ * are unread states, 0 on timeout, -1 once the publisher has closed the
+ * ring (or on error).
+ */
+JNIEXPORT jint JNICALL
+Java_space_yasha_rcmonitor_SharedStateRing_nativeWait(JNIEnv *env, jclass clazz, jlong handle,
+                                                    jlong read, jint timeoutMs) {
+    rcm_shm_reader_t *r = shm_reader_from_handle(handle);
+    if (!r) return -1;
+    r->read = (uint64_t)read;
+    return rcm_shm_wait(r, timeoutMs);
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_SharedStateRing
+ * Method:    nativeClosed
+ * Signature: (J)Z
+ */
+JNIEXPORT jboolean JNICALL
+Java_space_yasha_rcmonitor_SharedStateRing_nativeClosed(JNIEnv *env, jclass clazz, jlong handle) {
+    rcm_shm_reader_t *r = shm_reader_from_handle(handle);
+    return (!r || rcm_shm_closed(r)) ? JNI_TRUE : JNI_FALSE;
+}
+
+/*
+ * Class:     space_yasha_rcmonitor_SharedStateRing
+ * Method:    nativeClose
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_space_yasha_rcmonitor_SharedStateRing_nativeClose(JNIEnv *env, jclass clazz, jlong handle) {
+    rcm_shm_reader_t *r = shm_reader_from_handle(handle);
+    if (!r) return;
+    rcm_shm_close(r);
+    free(r);
+}
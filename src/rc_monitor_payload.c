@@ -0,0 +1,179 @@
+/*
+ * rc_monitor_payload.c - Batch payload decoding into struct-of-arrays
+ *
+ * rcm_parse_payloads() takes eight payloads per step. Bytes 1..16 of each
+ * payload are loaded as eight little-endian u16 lanes
+ *
+ *   lane 0: b1 | b2 << 8     lane 4: stick_left_v
+ *   lane 1: b3 | b4 << 8     lane 5: stick_left_h
+ *   lane 2: stick_right_h    lane 6: left_wheel
+ *   lane 3: stick_right_v    lane 7: right_wheel
+ *
+ * and the 8x8 block is transposed, leaving one field of all eight payloads
+ * per register: the axes only need the -0x400 centering, and the flags and
+ * wheel delta fall out of a few shifts and masks on lanes 0 and 1 plus a
+ * register of the b0 bytes. rcm_parse_payload_packed() is the reference;
+ * the mapping from payload bits to RCM_PK_* bits is
+ *
+ *   b0 bits 4..6 -> 0..2  pause, gohome, shutter
+ *   b1 bit 0     -> 3     record
+ *   b2 bits 2..4 -> 4..6  custom1..3
+ *   b1 bits 4..6 -> 7..9  5D up, down, left
+ *   b1 bit 3     -> 10    5D right
+ *   b1 bit 7     -> 11    5D center
+ *   b2 bits 0..1 -> 12..13 flight mode
+ *
+ * which on lane 0 (b1 in bits 0..7, b2 in bits 8..15) is
+ *   ((l0 << 3) & 0x388) | ((l0 << 7) & 0x400) | ((l0 << 4) & 0x3800) |
+ *   ((l0 >> 6) & 0x070) | ((b0 >> 4) & 0x7)
+ *
+ * SSE2 is baseline on x86-64 and NEON on arm64 and the armeabi-v7a NDK
+ * ABI, so no runtime dispatch is needed; other targets and the tail of a
+ * batch take the scalar path.
+ */
+
+#include "rc_monitor.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#define RCM_PAYLOAD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define RCM_PAYLOAD_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Scalar decode of payload p into row i */
+static void decode1(const uint8_t *p, const rcm_payload_columns_t *out, size_t i) {
+    rcm_packed_state_t s;
+    rcm_parse_payload_packed(p, RC_PUSH_PAYLOAD_LEN, &s);
+    if (out->stick_right_h)     out->stick_right_h[i]     = s.stick_right_h;
+    if (out->stick_right_v)     out->stick_right_v[i]     = s.stick_right_v;
+    if (out->stick_left_h)      out->stick_left_h[i]      = s.stick_left_h;
+    if (out->stick_left_v)      out->stick_left_v[i]      = s.stick_left_v;
+    if (out->left_wheel)        out->left_wheel[i]        = s.left_wheel;
+    if (out->right_wheel)       out->right_wheel[i]       = s.right_wheel;
+    if (out->right_wheel_delta) out->right_wheel_delta[i] = s.right_wheel_delta;
+    if (out->flags)             out->flags[i]             = s.flags;
+}
+
+#if defined(RCM_PAYLOAD_SSE2)
+
+#define STORE16(field, v) \
+    do { if (out->field) _mm_storeu_si128((__m128i *)(void *)(out->field + i), (v)); } while (0)
+
+/* Payloads p, p + stride, ... p + 7 * stride into rows i..i+7 */
+static void decode8(const uint8_t *p, size_t stride, const rcm_payload_columns_t *out,
+                    size_t i) {
+    __m128i a[8];
+    uint16_t b0[8];
+    for (int k = 0; k < 8; k++) {
+        a[k] = _mm_loadu_si128((const __m128i *)(const void *)(p + (size_t)k * stride + 1));
+        b0[k] = p[(size_t)k * stride];
+    }
+
+    __m128i t0 = _mm_unpacklo_epi16(a[0], a[1]), t1 = _mm_unpackhi_epi16(a[0], a[1]);
+    __m128i t2 = _mm_unpacklo_epi16(a[2], a[3]), t3 = _mm_unpackhi_epi16(a[2], a[3]);
+    __m128i t4 = _mm_unpacklo_epi16(a[4], a[5]), t5 = _mm_unpackhi_epi16(a[4], a[5]);
+    __m128i t6 = _mm_unpacklo_epi16(a[6], a[7]), t7 = _mm_unpackhi_epi16(a[6], a[7]);
+    __m128i u0 = _mm_unpacklo_epi32(t0, t2), u1 = _mm_unpackhi_epi32(t0, t2);
+    __m128i u2 = _mm_unpacklo_epi32(t1, t3), u3 = _mm_unpackhi_epi32(t1, t3);
+    __m128i u4 = _mm_unpacklo_epi32(t4, t6), u5 = _mm_unpackhi_epi32(t4, t6);
+    __m128i u6 = _mm_unpacklo_epi32(t5, t7), u7 = _mm_unpackhi_epi32(t5, t7);
+    __m128i l0 = _mm_unpacklo_epi64(u0, u4), l1 = _mm_unpackhi_epi64(u0, u4);
+
+    const __m128i center = _mm_set1_epi16(0x400);
+    STORE16(stick_right_h, _mm_sub_epi16(_mm_unpacklo_epi64(u1, u5), center));
+    STORE16(stick_right_v, _mm_sub_epi16(_mm_unpackhi_epi64(u1, u5), center));
+    STORE16(stick_left_v,  _mm_sub_epi16(_mm_unpacklo_epi64(u2, u6), center));
+    STORE16(stick_left_h,  _mm_sub_epi16(_mm_unpackhi_epi64(u2, u6), center));
+    STORE16(left_wheel,    _mm_sub_epi16(_mm_unpacklo_epi64(u3, u7), center));
+    STORE16(right_wheel,   _mm_sub_epi16(_mm_unpackhi_epi64(u3, u7), center));
+
+    if (out->flags) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(const void *)b0);
+        __m128i f = _mm_and_si128(_mm_srli_epi16(b, 4), _mm_set1_epi16(0x7));
+        f = _mm_or_si128(f, _mm_and_si128(_mm_slli_epi16(l0, 3), _mm_set1_epi16(0x388)));
+        f = _mm_or_si128(f, _mm_and_si128(_mm_slli_epi16(l0, 7), _mm_set1_epi16(0x400)));
+        f = _mm_or_si128(f, _mm_and_si128(_mm_slli_epi16(l0, 4), _mm_set1_epi16(0x3800)));
+        f = _mm_or_si128(f, _mm_and_si128(_mm_srli_epi16(l0, 6), _mm_set1_epi16(0x70)));
+        STORE16(flags, f);
+    }
+    if (out->right_wheel_delta) {
+        /* b4 is the high byte of lane 1: magnitude in bits 9..13, sign bit 14 */
+        __m128i mag = _mm_and_si128(_mm_srli_epi16(l1, 9), _mm_set1_epi16(0x1F));
+        __m128i neg = _mm_cmpeq_epi16(_mm_and_si128(l1, _mm_set1_epi16(0x4000)),
+                                      _mm_setzero_si128());
+        __m128i d = _mm_sub_epi16(_mm_xor_si128(mag, neg), neg);
+        _mm_storel_epi64((__m128i *)(void *)(out->right_wheel_delta + i),
+                         _mm_packs_epi16(d, d));
+    }
+}
+
+#elif defined(RCM_PAYLOAD_NEON)
+
+#define STORE16(field, v) \
+    do { if (out->field) vst1q_s16(out->field + i, vreinterpretq_s16_u16(v)); } while (0)
+
+static void decode8(const uint8_t *p, size_t stride, const rcm_payload_columns_t *out,
+                    size_t i) {
+    uint16x8_t a[8];
+    uint16_t b0[8];
+    for (int k = 0; k < 8; k++) {
+        a[k] = vreinterpretq_u16_u8(vld1q_u8(p + (size_t)k * stride + 1));
+        b0[k] = p[(size_t)k * stride];
+    }
+
+    /* 16-bit then 32-bit transposes; 64-bit halves are recombined below */
+    uint16x8x2_t t01 = vtrnq_u16(a[0], a[1]), t23 = vtrnq_u16(a[2], a[3]);
+    uint16x8x2_t t45 = vtrnq_u16(a[4], a[5]), t67 = vtrnq_u16(a[6], a[7]);
+    uint32x4x2_t p0 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[0]), vreinterpretq_u32_u16(t23.val[0]));
+    uint32x4x2_t p1 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[1]), vreinterpretq_u32_u16(t23.val[1]));
+    uint32x4x2_t q0 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[0]), vreinterpretq_u32_u16(t67.val[0]));
+    uint32x4x2_t q1 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[1]), vreinterpretq_u32_u16(t67.val[1]));
+#define LANE_LO(x, y) vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(x), vget_low_u32(y)))
+#define LANE_HI(x, y) vreinterpretq_u16_u32(vcombine_u32(vget_high_u32(x), vget_high_u32(y)))
+    uint16x8_t l0 = LANE_LO(p0.val[0], q0.val[0]);
+    uint16x8_t l1 = LANE_LO(p1.val[0], q1.val[0]);
+
+    const uint16x8_t center = vdupq_n_u16(0x400);
+    STORE16(stick_right_h, vsubq_u16(LANE_LO(p0.val[1], q0.val[1]), center));
+    STORE16(stick_right_v, vsubq_u16(LANE_LO(p1.val[1], q1.val[1]), center));
+    STORE16(stick_left_v,  vsubq_u16(LANE_HI(p0.val[0], q0.val[0]), center));
+    STORE16(stick_left_h,  vsubq_u16(LANE_HI(p1.val[0], q1.val[0]), center));
+    STORE16(left_wheel,    vsubq_u16(LANE_HI(p0.val[1], q0.val[1]), center));
+    STORE16(right_wheel,   vsubq_u16(LANE_HI(p1.val[1], q1.val[1]), center));
+#undef LANE_LO
+#undef LANE_HI
+
+    if (out->flags) {
+        uint16x8_t f = vandq_u16(vshrq_n_u16(vld1q_u16(b0), 4), vdupq_n_u16(0x7));
+        f = vorrq_u16(f, vandq_u16(vshlq_n_u16(l0, 3), vdupq_n_u16(0x388)));
+        f = vorrq_u16(f, vandq_u16(vshlq_n_u16(l0, 7), vdupq_n_u16(0x400)));
+        f = vorrq_u16(f, vandq_u16(vshlq_n_u16(l0, 4), vdupq_n_u16(0x3800)));
+        f = vorrq_u16(f, vandq_u16(vshrq_n_u16(l0, 6), vdupq_n_u16(0x70)));
+        vst1q_u16(out->flags + i, f);
+    }
+    if (out->right_wheel_delta) {
+        uint16x8_t mag = vandq_u16(vshrq_n_u16(l1, 9), vdupq_n_u16(0x1F));
+        uint16x8_t neg = vceqq_u16(vandq_u16(l1, vdupq_n_u16(0x4000)), vdupq_n_u16(0));
+        uint16x8_t d = vsubq_u16(veorq_u16(mag, neg), neg);
+        vst1_s8(out->right_wheel_delta + i, vreinterpret_s8_u8(vmovn_u16(d)));
+    }
+}
+
+#endif
+
+int rcm_parse_payloads(const uint8_t *payloads, size_t n, size_t stride,
+                       const rcm_payload_columns_t *out) {
+    if (!out || (!payloads && n) || stride < RC_PUSH_PAYLOAD_LEN)
+        return -1;
+    size_t i = 0;
+#if defined(RCM_PAYLOAD_SSE2) || defined(RCM_PAYLOAD_NEON)
+    for (; i + 8 <= n; i += 8)
+        decode8(payloads + i * stride, stride, out, i);
+#endif
+    for (; i < n; i++)
+        decode1(payloads + i * stride, out, i);
+    return 0;
+}
@@ -0,0 +1,423 @@
+/*
+ * rc_monitor_shm.c - Shared-memory state publisher
+ *
+ * The ring is the same single-counter design as the JNI state ring plus a
+ * second counter, `claimed`, that the publisher bumps (followed by a
+ * release fence) before it overwrites an entry. A reader that saw any byte
+ * of the new entry therefore also sees the claim (fence-to-fence
+ * synchronisation with the reader's acquire fence after its copy), so
+ * re-reading `claimed` after the copy tells exactly which of the copied
+ * entries may be torn, without discarding anything while the publisher is
+ * idle.
+ *
+ * Waiters sleep on the header's futex word, a copy of the low 32 bits of
+ * `written` that only rcm_shm_wake() updates. Consumers cannot register as
+ * waiters in a read-only mapping, so every wake is a FUTEX_WAKE syscall;
+ * rcm_shm_wake() skips it when nothing was published since the last one.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* memfd_create flags, F_ADD_SEALS, SCM_RIGHTS */
+#endif
+
+#include "rc_monitor_shm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC        0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING  0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS        (1024 + 9)
+#define F_SEAL_SEAL        0x0001
+#define F_SEAL_SHRINK      0x0002
+#define F_SEAL_GROW        0x0004
+#endif
+
+#ifdef __ANDROID__
+/* <linux/ashmem.h> is not exported by every NDK */
+#define ASHMEM_NAME_LEN    256
+#define ASHMEM_SET_NAME    _IOW(0x77, 1, char[ASHMEM_NAME_LEN])
+#define ASHMEM_SET_SIZE    _IOW(0x77, 3, size_t)
+#endif
+
+#define SHM_MAGIC          0x514D4352u  /* "RCMQ" */
+#define SHM_ENTRY_LEN      16
+
+typedef struct {
+    uint32_t         magic;
+    uint16_t         version;
+    uint16_t         header_len;
+    uint32_t         capacity;
+    uint32_t         entry_len;
+    _Atomic uint64_t written;
+    _Atomic uint64_t claimed;
+    _Atomic uint32_t futex;
+    uint32_t         pid;
+    _Atomic uint32_t closed;
+    uint8_t          reserved[20];
+} shm_hdr_t;
+
+_Static_assert(sizeof(shm_hdr_t) == RCM_SHM_HEADER_LEN, "shm header layout");
+_Static_assert(offsetof(shm_hdr_t, written) == 16, "shm header layout");
+_Static_assert(sizeof(rcm_packed_state_t) == SHM_ENTRY_LEN, "shm entry layout");
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "written must be lock-free across processes");
+
+struct rcm_shm_publisher {
+    int        fd;
+    shm_hdr_t *hdr;
+    size_t     size;
+    uint32_t   mask;
+    uint64_t   written;   /* producer's copy of hdr->written */
+    uint64_t   woken;     /* written at the last wake */
+};
+
+/* Byte offset of state i */
+static inline size_t entry_off(uint32_t capacity, uint64_t i) {
+    return RCM_SHM_HEADER_LEN + (size_t)(i & (capacity - 1)) * SHM_ENTRY_LEN;
+}
+
+static inline const shm_hdr_t *reader_hdr(const rcm_shm_reader_t *r) {
+    return (const shm_hdr_t *)r->base;
+}
+
+/* Consumers map read-only, so every access goes through a const header */
+static inline uint64_t load_written(const shm_hdr_t *h, memory_order mo) {
+    return atomic_load_explicit((_Atomic uint64_t *)&h->written, mo);
+}
+
+/* After a copy: states below claimed - capacity may have been overwritten */
+static inline uint64_t load_claimed_after_copy(const shm_hdr_t *h) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit((_Atomic uint64_t *)&h->claimed, memory_order_relaxed);
+}
+
+static void futex_wake_all(shm_hdr_t *h) {
+    syscall(SYS_futex, &h->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Anonymous shared memory: memfd (sealed at its size), else ashmem */
+static int shm_alloc(const char *name, size_t size) {
+    int fd = -1;
+#ifdef SYS_memfd_create
+    fd = (int)syscall(SYS_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd >= 0) {
+        if (ftruncate(fd, (off_t)size) != 0) {
+            int e = errno;
+            close(fd);
+            errno = e;
+            return -1;
+        }
+        /* Best effort: consumers then need not fear a SIGBUS from a shrink */
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+        return fd;
+    }
+#endif
+#ifdef __ANDROID__
+    fd = open("/dev/ashmem", O_RDWR | O_CLOEXEC);
+    if (fd >= 0) {
+        char label[ASHMEM_NAME_LEN] = { 0 };
+        strncpy(label, name, sizeof(label) - 1);
+        ioctl(fd, ASHMEM_SET_NAME, label);
+        if (ioctl(fd, ASHMEM_SET_SIZE, size) != 0) {
+            int e = errno;
+            close(fd);
+            errno = e;
+            return -1;
+        }
+    }
+#endif
+    return fd;
+}
+
+rcm_shm_publisher_t *rcm_shm_create(const char *name, unsigned capacity) {
+    uint32_t cap = RCM_SHM_MIN_ENTRIES;
+    while (cap < capacity && cap < RCM_SHM_MAX_ENTRIES)
+        cap <<= 1;
+
+    rcm_shm_publisher_t *pub = calloc(1, sizeof(*pub));
+    if (!pub) return NULL;
+    pub->size = RCM_SHM_HEADER_LEN + (size_t)cap * SHM_ENTRY_LEN;
+    pub->fd = shm_alloc(name ? name : "rcm-states", pub->size);
+    if (pub->fd < 0) {
+        free(pub);
+        return NULL;
+    }
+    void *mem = mmap(NULL, pub->size, PROT_READ | PROT_WRITE, MAP_SHARED, pub->fd, 0);
+    if (mem == MAP_FAILED) {
+        int e = errno;
+        close(pub->fd);
+        free(pub);
+        errno = e;
+        return NULL;
+    }
+
+    shm_hdr_t *h = mem;
+    h->version    = RCM_SHM_VERSION;
+    h->header_len = RCM_SHM_HEADER_LEN;
+    h->capacity   = cap;
+    h->entry_len  = SHM_ENTRY_LEN;
+    h->pid        = (uint32_t)getpid();
+    /* The magic goes last: a consumer that sees it sees a complete header */
+    atomic_thread_fence(memory_order_release);
+    h->magic      = SHM_MAGIC;
+    pub->hdr = h;
+    pub->mask = cap - 1;
+    return pub;
+}
+
+void rcm_shm_destroy(rcm_shm_publisher_t *pub) {
+    if (!pub) return;
+    atomic_store_explicit(&pub->hdr->closed, 1, memory_order_release);
+    atomic_fetch_add_explicit(&pub->hdr->futex, 1, memory_order_release);
+    futex_wake_all(pub->hdr);
+    munmap(pub->hdr, pub->size);
+    close(pub->fd);
+    free(pub);
+}
+
+int rcm_shm_fd(const rcm_shm_publisher_t *pub) {
+    return pub ? pub->fd : -1;
+}
+
+void rcm_shm_publish(rcm_shm_publisher_t *pub, const rcm_packed_state_t *state) {
+    if (!pub || !state) return;
+    /* The claim is visible to anyone who sees the entry change */
+    atomic_store_explicit(&pub->hdr->claimed, pub->written + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy((uint8_t *)pub->hdr + entry_off(pub->mask + 1, pub->written), state, SHM_ENTRY_LEN);
+    pub->written++;
+    atomic_store_explicit(&pub->hdr->written, pub->written, memory_order_release);
+}
+
+void rcm_shm_wake(rcm_shm_publisher_t *pub) {
+    if (!pub || pub->written == pub->woken) return;
+    pub->woken = pub->written;
+    atomic_store_explicit(&pub->hdr->futex, (uint32_t)pub->written, memory_order_release);
+    futex_wake_all(pub->hdr);
+}
+
+void rcm_shm_callback(const rc_state_t *state, void *pub) {
+    rcm_packed_state_t ps;
+    rcm_pack_state(state, &ps);
+    rcm_shm_publish((rcm_shm_publisher_t *)pub, &ps);
+    rcm_shm_wake((rcm_shm_publisher_t *)pub);
+}
+
+int rcm_shm_open(rcm_shm_reader_t *r, int fd) {
+    if (!r || fd < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(r, 0, sizeof(*r));
+
+    const shm_hdr_t *h = mmap(NULL, RCM_SHM_HEADER_LEN, PROT_READ, MAP_SHARED, fd, 0);
+    if (h == MAP_FAILED) return -1;
+    bool ok = h->magic == SHM_MAGIC;
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t cap = h->capacity;
+    ok = ok && h->version == RCM_SHM_VERSION && h->header_len == RCM_SHM_HEADER_LEN &&
+         h->entry_len == SHM_ENTRY_LEN && cap >= RCM_SHM_MIN_ENTRIES &&
+         cap <= RCM_SHM_MAX_ENTRIES && (cap & (cap - 1)) == 0;
+    munmap((void *)h, RCM_SHM_HEADER_LEN);
+    if (!ok) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t size = RCM_SHM_HEADER_LEN + (size_t)cap * SHM_ENTRY_LEN;
+    struct stat st;
+    /* ashmem reports 0; a memfd must really be that large */
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (size_t)st.st_size < size) {
+        errno = EINVAL;
+        return -1;
+    }
+    void *mem = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) return -1;
+
+    r->base = mem;
+    r->size = size;
+    r->capacity = cap;
+    r->read = load_written(mem, memory_order_acquire);
+    return 0;
+}
+
+void rcm_shm_close(rcm_shm_reader_t *r) {
+    if (!r) return;
+    if (r->base) munmap((void *)r->base, r->size);
+    memset(r, 0, sizeof(*r));
+}
+
+uint64_t rcm_shm_written(const rcm_shm_reader_t *r) {
+    if (!r || !r->base) return 0;
+    return load_written(reader_hdr(r), memory_order_acquire);
+}
+
+uint64_t rcm_shm_claimed(const rcm_shm_reader_t *r) {
+    if (!r || !r->base) return 0;
+    return load_claimed_after_copy(reader_hdr(r));
+}
+
+bool rcm_shm_closed(const rcm_shm_reader_t *r) {
+    if (!r || !r->base) return true;
+    return atomic_load_explicit((_Atomic uint32_t *)&reader_hdr(r)->closed,
+                                memory_order_acquire) != 0;
+}
+
+size_t rcm_shm_read(rcm_shm_reader_t *r, rcm_packed_state_t *out, size_t max) {
+    if (!r || !r->base || !out) return 0;
+    const shm_hdr_t *h = reader_hdr(r);
+    uint64_t w = load_written(h, memory_order_acquire);
+    if (w - r->read > r->capacity) {
+        r->lost += w - r->read - r->capacity;
+        r->read = w - r->capacity;
+    }
+    size_t n = (size_t)(w - r->read);
+    if (n > max) n = max;
+    for (size_t i = 0; i < n; i++)
+        memcpy(&out[i], r->base + entry_off(r->capacity, r->read + i), SHM_ENTRY_LEN);
+
+    uint64_t claimed = load_claimed_after_copy(h);
+    size_t bad = 0;
+    if (claimed > r->read + r->capacity) {
+        uint64_t b = claimed - r->capacity - r->read;
+        bad = b < n ? (size_t)b : n;
+    }
+    if (bad)
+        memmove(out, out + bad, (n - bad) * sizeof(*out));
+    r->lost += bad;
+    r->read += n;
+    return n - bad;
+}
+
+int rcm_shm_latest(rcm_shm_reader_t *r, rcm_packed_state_t *out) {
+    if (!r || !r->base || !out) return -1;
+    const shm_hdr_t *h = reader_hdr(r);
+    for (;;) {
+        uint64_t w = load_written(h, memory_order_acquire);
+        if (w == 0) return -1;
+        memcpy(out, r->base + entry_off(r->capacity, w - 1), SHM_ENTRY_LEN);
+        if (load_claimed_after_copy(h) - (w - 1) <= r->capacity) {
+            if (w > r->read) r->read = w;
+            return 0;
+        }
+    }
+}
+
+int rcm_shm_wait(rcm_shm_reader_t *r, int timeout_ms) {
+    if (!r || !r->base) {
+        errno = EINVAL;
+        return -1;
+    }
+    const shm_hdr_t *h = reader_hdr(r);
+    struct timespec deadline = { 0, 0 };
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec  += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    for (;;) {
+        /* Futex word first: a wake after the checks below changes it */
+        uint32_t f = atomic_load_explicit((_Atomic uint32_t *)&h->futex, memory_order_acquire);
+        if (load_written(h, memory_order_acquire) > r->read)
+            return 1;
+        if (rcm_shm_closed(r)) {
+            errno = EPIPE;
+            return -1;
+        }
+
+        struct timespec rel, *tp = NULL;
+        if (timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            rel.tv_sec  = deadline.tv_sec - now.tv_sec;
+            rel.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+            if (rel.tv_nsec < 0) {
+                rel.tv_sec--;
+                rel.tv_nsec += 1000000000L;
+            }
+            if (rel.tv_sec < 0)
+                return 0;
+            tp = &rel;
+        }
+        /* Not FUTEX_PRIVATE: the word is shared between processes */
+        if (syscall(SYS_futex, &h->futex, FUTEX_WAIT, f, tp, NULL, 0) != 0 &&
+            errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+            return -1;
+    }
+}
+
+int rcm_shm_send_fd(int sock, int fd) {
+    char byte = 'F';
+    struct iovec iov = { .iov_base = &byte, .iov_len = 1 };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = ctl.buf, .msg_controllen = sizeof(ctl.buf),
+    };
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type  = SCM_RIGHTS;
+    c->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    return n == 1 ? 0 : -1;
+}
+
+int rcm_shm_recv_fd(int sock) {
+    char byte;
+    struct iovec iov = { .iov_base = &byte, .iov_len = 1 };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct msghdr msg = {
+        .msg_iov = &iov, .msg_iovlen = 1,
+        .msg_control = ctl.buf, .msg_controllen = sizeof(ctl.buf),
+    };
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        if (n == 0) errno = ECONNRESET;
+        return -1;
+    }
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS &&
+            c->cmsg_len >= CMSG_LEN(sizeof(int))) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(c), sizeof(int));
+            return fd;
+        }
+    }
+    errno = EBADMSG;
+    return -1;
+}
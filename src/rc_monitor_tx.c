@@ -0,0 +1,94 @@
+/*
+ * rc_monitor_tx.c - Command templates and the batched transmit queue
+ *
+ * rcm_tx_template_init() lets rcm_build_packet() lay out a frame once, so
+ * the header encoding lives in one place; rcm_tx_write() then only patches
+ * the seq and payload. Bytes 6-10 (seq, attributes, cmd_set, cmd_id) stay
+ * in the per-send CRC: the register is sequential, and folding three fixed
+ * bytes in with rcm_priv_crc16_shift() costs more than a table lookup each.
+ */
+
+#include "rc_monitor_tx.h"
+#include <string.h>
+
+#define TX_SEQ_OFFSET 6
+
+int rcm_tx_template_init(rcm_tx_template_t *t,
+                         uint8_t sender_type, uint8_t sender_index,
+                         uint8_t receiver_type, uint8_t receiver_index,
+                         uint8_t pack_type, uint8_t ack_type, uint8_t encrypt_type,
+                         uint8_t cmd_set, uint8_t cmd_id, size_t payload_len) {
+    static const uint8_t zeros[DUML_MAX_FRAME_LEN];
+    uint8_t frame[DUML_MAX_FRAME_LEN];
+    if (!t || payload_len > DUML_MAX_FRAME_LEN - DUML_HEADER_LEN - DUML_FOOTER_LEN)
+        return -1;
+    if (rcm_build_packet(frame, sizeof(frame), sender_type, sender_index,
+                         receiver_type, receiver_index, 0,
+                         pack_type, ack_type, encrypt_type, cmd_set, cmd_id,
+                         zeros, payload_len) < 0)
+        return -1;
+    memcpy(t->header, frame, DUML_HEADER_LEN);
+    t->payload_len = (uint16_t)payload_len;
+    t->crc_prefix = rcm_crc16_update(DUML_CRC16_SEED, frame, TX_SEQ_OFFSET);
+    return 0;
+}
+
+void rcm_tx_template_enable(rcm_tx_template_t *t) {
+    rcm_tx_template_init(t, DUML_DEV_PC, 0, DUML_DEV_RC, 0,
+                         DUML_PACK_REQUEST, DUML_ACK_AFTER_EXEC, 0,
+                         DUML_CMD_SET_RC, DUML_CMD_RC_ENABLE, 1);
+}
+
+void rcm_tx_template_channel_request(rcm_tx_template_t *t) {
+    rcm_tx_template_init(t, DUML_DEV_PC, 0, DUML_DEV_RC, 0,
+                         DUML_PACK_REQUEST, DUML_ACK_AFTER_EXEC, 0,
+                         DUML_CMD_SET_RC, DUML_CMD_RC_CHANNEL, 0);
+}
+
+int rcm_tx_write(const rcm_tx_template_t *t, uint8_t *out, size_t out_size,
+                 uint16_t seq, const uint8_t *payload) {
+    if (!t || !out) return -1;
+    size_t total = rcm_tx_frame_len(t);
+    if (total > out_size || (t->payload_len && !payload))
+        return -1;
+
+    memcpy(out, t->header, DUML_HEADER_LEN);
+    out[TX_SEQ_OFFSET]     = (uint8_t)(seq & 0xFF);
+    out[TX_SEQ_OFFSET + 1] = (uint8_t)(seq >> 8);
+    if (t->payload_len)
+        memcpy(out + DUML_HEADER_LEN, payload, t->payload_len);
+
+    size_t body = total - DUML_FOOTER_LEN;
+    uint16_t crc = rcm_crc16_update(t->crc_prefix, out + TX_SEQ_OFFSET,
+                                    body - TX_SEQ_OFFSET);
+    out[body]     = (uint8_t)(crc & 0xFF);
+    out[body + 1] = (uint8_t)(crc >> 8);
+    return (int)total;
+}
+
+void rcm_tx_init(rcm_tx_queue_t *q, uint16_t first_seq) {
+    if (!q) return;
+    q->len = 0;
+    q->count = 0;
+    q->seq = first_seq;
+}
+
+const uint8_t *rcm_tx_push(rcm_tx_queue_t *q, const rcm_tx_template_t *t,
+                           const uint8_t *payload, size_t *frame_len) {
+    if (!q) return NULL;
+    uint8_t *frame = q->buf + q->len;
+    int n = rcm_tx_write(t, frame, sizeof(q->buf) - q->len, q->seq, payload);
+    if (n < 0)
+        return NULL;
+    q->seq++;
+    q->len += (size_t)n;
+    q->count++;
+    if (frame_len) *frame_len = (size_t)n;
+    return frame;
+}
+
+void rcm_tx_clear(rcm_tx_queue_t *q) {
+    if (!q) return;
+    q->len = 0;
+    q->count = 0;
+}
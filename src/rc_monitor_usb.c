@@ -0,0 +1,483 @@
+/*
+ * rc_monitor_usb.c - Native asynchronous USB reader over usbdevfs URBs
+ *
+ * One thread owns the parser and the fd. It keeps `urbs` bulk-IN URBs
+ * submitted, sleeps in poll() until the kernel reports a completion
+ * (POLLOUT on a usbdevfs fd), reaps everything that finished, feeds it and
+ * resubmits at once, so the endpoint is never left unarmed between
+ * transfers. OUT commands go through a small locked queue and a wake pipe
+ * and are submitted one at a time from the same loop. The push-timeout
+ * fallback runs off CLOCK_MONOTONIC deadlines that bound the poll timeout.
+ * Built-in commands are tracked in the parser's request table, so their
+ * responses yield RTT samples; pipelined polling keeps poll_inflight channel
+ * requests outstanding and spaces new ones by the smoothed RTT.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* pipe2 */
+#endif
+
+#include "rc_monitor_usb.h"
+#include "rc_monitor_tx.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/usbdevice_fs.h>
+
+/* OUT commands that can wait for submission */
+#define OUT_QUEUE_LEN 8
+
+/* Poll interval and built-in command timeout when poll_interval_ms is 0 */
+#define REQ_TIMEOUT_MS 250
+
+/* Retry period for IN URBs whose resubmission failed */
+#define RESUBMIT_RETRY_MS 10
+
+typedef struct {
+    uint8_t data[DUML_MAX_FRAME_LEN];
+    size_t  len;
+} out_cmd_t;
+
+struct rcm_usb_reader {
+    rcm_parser_t    *parser;
+    rcm_usb_config_t cfg;
+    pthread_t        thread;
+    int              wake[2];          /* pipe: stop / OUT queued */
+    _Atomic bool     stop;
+    _Atomic bool     running;
+
+    /* usbdevfs_urb ends in a flexible array, so each one is its own allocation */
+    struct usbdevfs_urb *in_urb[RCM_USB_MAX_URBS];
+    bool                 in_busy[RCM_USB_MAX_URBS];
+    uint8_t             *in_buf;       /* urbs * urb_len */
+
+    struct usbdevfs_urb *out_urb;
+    bool                 out_busy;
+    uint8_t             out_buf[DUML_MAX_FRAME_LEN];
+
+    pthread_mutex_t     lock;          /* guards out_q* */
+    out_cmd_t           out_q[OUT_QUEUE_LEN];
+    unsigned            out_q_head, out_q_len;
+
+    uint16_t            seq;           /* DUML seq for built-in commands */
+    rcm_tx_template_t   tx_enable;
+    rcm_tx_template_t   tx_channel;
+
+    /* Optional recording; written under capture_lock, checked without it */
+    pthread_mutex_t                 capture_lock;
+    _Atomic(rcm_capture_writer_t *) capture;
+    uint8_t                         capture_source;
+};
+
+#define NS_PER_MS 1000000u
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int submit_in(rcm_usb_reader_t *r, unsigned i) {
+    struct usbdevfs_urb *u = r->in_urb[i];
+    memset(u, 0, sizeof(*u));
+    u->type          = USBDEVFS_URB_TYPE_BULK;
+    u->endpoint      = r->cfg.ep_in;
+    u->buffer        = r->in_buf + (size_t)i * r->cfg.urb_len;
+    u->buffer_length = (int)r->cfg.urb_len;
+    u->usercontext   = (void *)(uintptr_t)i;
+    if (ioctl(r->cfg.fd, USBDEVFS_SUBMITURB, u) != 0)
+        return -1;
+    r->in_busy[i] = true;
+    return 0;
+}
+
+/*
+ * Submit every idle IN URB (one whose resubmission failed transiently).
+ * @return URBs still idle, or -1 once the device is gone
+ */
+static int rearm_idle(rcm_usb_reader_t *r) {
+    int idle = 0;
+    for (unsigned i = 0; i < r->cfg.urbs; i++) {
+        if (r->in_busy[i] || submit_in(r, i) == 0) continue;
+        if (errno == ENODEV || errno == ESHUTDOWN) return -1;
+        idle++;
+    }
+    return idle;
+}
+
+static void capture_chunk(rcm_usb_reader_t *r, uint8_t dir, const uint8_t *data, size_t len) {
+    if (!atomic_load_explicit(&r->capture, memory_order_relaxed))
+        return;
+    pthread_mutex_lock(&r->capture_lock);
+    rcm_capture_writer_t *w = atomic_load_explicit(&r->capture, memory_order_relaxed);
+    if (w)
+        rcm_capture_write(w, 0, r->capture_source, dir, data, len);
+    pthread_mutex_unlock(&r->capture_lock);
+}
+
+/* Queue an OUT command; caller holds r->lock */
+static int enqueue_out_locked(rcm_usb_reader_t *r, const uint8_t *data, size_t len) {
+    if (r->out_q_len == OUT_QUEUE_LEN)
+        return -1;
+    out_cmd_t *c = &r->out_q[(r->out_q_head + r->out_q_len) % OUT_QUEUE_LEN];
+    memcpy(c->data, data, len);
+    c->len = len;
+    r->out_q_len++;
+    return 0;
+}
+
+/* Submit the next queued OUT command if none is in flight */
+static void pump_out(rcm_usb_reader_t *r) {
+    if (r->out_busy)
+        return;
+    pthread_mutex_lock(&r->lock);
+    if (r->out_q_len == 0) {
+        pthread_mutex_unlock(&r->lock);
+        return;
+    }
+    out_cmd_t *c = &r->out_q[r->out_q_head];
+    memcpy(r->out_buf, c->data, c->len);
+    size_t len = c->len;
+    r->out_q_head = (r->out_q_head + 1) % OUT_QUEUE_LEN;
+    r->out_q_len--;
+    pthread_mutex_unlock(&r->lock);
+
+    struct usbdevfs_urb *u = r->out_urb;
+    memset(u, 0, sizeof(*u));
+    u->type          = USBDEVFS_URB_TYPE_BULK;
+    u->endpoint      = r->cfg.ep_out;
+    u->buffer        = r->out_buf;
+    u->buffer_length = (int)len;
+    u->usercontext   = (void *)(uintptr_t)RCM_USB_MAX_URBS;
+    if (ioctl(r->cfg.fd, USBDEVFS_SUBMITURB, u) == 0) {
+        r->out_busy = true;
+        capture_chunk(r, RCM_CAPTURE_OUT, r->out_buf, len);
+    }
+}
+
+/*
+ * Queue the built-in commands in `q` as one OUT transfer and track each,
+ * from the reader thread. Their seqs are consumed only if it was queued.
+ */
+static void send_builtin(rcm_usb_reader_t *r, const rcm_tx_queue_t *q) {
+    if (q->count == 0)
+        return;
+    pthread_mutex_lock(&r->lock);
+    int queued = enqueue_out_locked(r, q->buf, q->len);
+    pthread_mutex_unlock(&r->lock);
+    if (queued != 0)
+        return;
+    r->seq = q->seq;
+
+    uint32_t timeout = (uint32_t)r->cfg.poll_interval_ms;
+    for (size_t off = 0; off < q->len; ) {
+        size_t len = (size_t)((q->buf[off + 1] | (q->buf[off + 2] << 8)) & 0x03FF);
+        rcm_track_request(r->parser, q->buf + off, len, timeout);
+        off += len;
+    }
+}
+
+/* Queue `n` channel requests as one transfer */
+static void send_polls(rcm_usb_reader_t *r, unsigned n) {
+    rcm_tx_queue_t q;
+    rcm_tx_init(&q, r->seq);
+    while (q.count < n && rcm_tx_push(&q, &r->tx_channel, NULL, NULL)) {}
+    send_builtin(r, &q);
+}
+
+/*
+ * Issue channel requests while polling. Fixed mode sends one per
+ * poll_interval_ms; pipelined mode tops the window up to poll_inflight and
+ * paces refills at srtt / poll_inflight, so responses clock new requests out.
+ * Returns the next time it has something to do.
+ */
+static uint64_t poll_requests(rcm_usb_reader_t *r, uint64_t now, uint64_t *next_poll) {
+    const rcm_usb_config_t *cfg = &r->cfg;
+    uint64_t interval = (uint64_t)cfg->poll_interval_ms * NS_PER_MS;
+    if (!cfg->poll_inflight) {
+        if (now >= *next_poll) {
+            send_polls(r, 1);
+            *next_poll = now + interval;
+        }
+        return *next_poll;
+    }
+
+    /*
+     * Until an RTT is known (gap 0) the whole window goes out at once, in
+     * one transfer; after that refills are paced one per gap.
+     */
+    uint64_t gap = rcm_request_rtt_ns(r->parser) / cfg->poll_inflight;
+    unsigned pending = rcm_pending_requests(r->parser);
+    if (pending < cfg->poll_inflight && now >= *next_poll) {
+        send_polls(r, gap ? 1 : cfg->poll_inflight - pending);
+        *next_poll = now + gap;
+    }
+    /* With the window full, wake again in time to expire a lost response */
+    if (rcm_pending_requests(r->parser) >= cfg->poll_inflight)
+        return now + interval;
+    return *next_poll > now ? *next_poll : now;
+}
+
+/* RC pushes the parser has seen, to tell pushes apart from poll responses */
+static uint64_t push_count(const rcm_parser_t *p) {
+    rcm_stats_t st;
+    return rcm_get_stats(p, &st) == 0 ? st.rc_pushes : 0;
+}
+
+/*
+ * Cancel everything still in flight and reap it. Every submitted URB must
+ * be reaped, discarded or not: usbdevfs copies IN data to the user buffer
+ * at reap time, so one left behind could be written into freed memory by
+ * whoever reaps on this fd next.
+ */
+static void drain_urbs(rcm_usb_reader_t *r) {
+    unsigned busy = 0;
+    for (unsigned i = 0; i < r->cfg.urbs; i++) {
+        if (!r->in_busy[i]) continue;
+        ioctl(r->cfg.fd, USBDEVFS_DISCARDURB, r->in_urb[i]); /* EINVAL: already done */
+        busy++;
+    }
+    if (r->out_busy) {
+        ioctl(r->cfg.fd, USBDEVFS_DISCARDURB, r->out_urb);
+        busy++;
+    }
+    while (busy > 0) {
+        struct usbdevfs_urb *u = NULL;
+        if (ioctl(r->cfg.fd, USBDEVFS_REAPURB, &u) != 0) {
+            if (errno == EINTR) continue;
+            break; /* ENODEV: the kernel dropped them with the device */
+        }
+        busy--;
+    }
+}
+
+static void *reader_thread(void *arg) {
+    rcm_usb_reader_t *r = (rcm_usb_reader_t *)arg;
+    const rcm_usb_config_t *cfg = &r->cfg;
+    bool polling_fallback = cfg->ep_out && cfg->push_timeout_ms > 0;
+    uint64_t push_timeout = (uint64_t)cfg->push_timeout_ms * NS_PER_MS;
+
+    /* Handshake in one transfer: enable, plus a first poll if polling is on */
+    if (cfg->ep_out && cfg->send_enable) {
+        static const uint8_t enable_payload[1] = { 0x01 };
+        rcm_tx_queue_t q;
+        rcm_tx_init(&q, r->seq);
+        rcm_tx_push(&q, &r->tx_enable, enable_payload, NULL);
+        if (polling_fallback)
+            rcm_tx_push(&q, &r->tx_channel, NULL, NULL);
+        send_builtin(r, &q);
+    }
+
+    uint64_t last_data = now_ns();
+    uint64_t next_poll = 0, poll_due = 0;
+    uint64_t pushes = 0;
+    bool push_mode = true;
+    int idle = 0;                       /* IN URBs waiting for a resubmit */
+
+    while (!atomic_load_explicit(&r->stop, memory_order_acquire)) {
+        pump_out(r);
+
+        /*
+         * Sleep until a URB completes, a wake, the next fallback deadline,
+         * or the retry of an IN URB that could not be resubmitted
+         */
+        int timeout = -1;
+        if (polling_fallback) {
+            uint64_t now = now_ns();
+            uint64_t due = push_mode ? last_data + push_timeout : poll_due;
+            timeout = due > now ? (int)((due - now + NS_PER_MS - 1) / NS_PER_MS) : 0;
+        }
+        if (idle > 0 && (timeout < 0 || timeout > RESUBMIT_RETRY_MS))
+            timeout = RESUBMIT_RETRY_MS;
+        struct pollfd pfd[2] = {
+            { .fd = cfg->fd,     .events = POLLOUT },
+            { .fd = r->wake[0],  .events = POLLIN  },
+        };
+        if (poll(pfd, 2, timeout) < 0 && errno != EINTR)
+            break;
+        if (pfd[1].revents & POLLIN) {
+            uint8_t drainbuf[64];
+            while (read(r->wake[0], drainbuf, sizeof(drainbuf)) > 0) {}
+        }
+        if (pfd[0].revents & (POLLERR | POLLHUP))
+            break; /* device disconnected */
+
+        /* Reap every completed URB, feed IN data and rearm at once */
+        bool got_data = false, fatal = false;
+        for (;;) {
+            struct usbdevfs_urb *u = NULL;
+            if (ioctl(cfg->fd, USBDEVFS_REAPURBNDELAY, &u) != 0) {
+                if (errno == ENODEV || errno == ESHUTDOWN) fatal = true;
+                break;
+            }
+            unsigned i = (unsigned)(uintptr_t)u->usercontext;
+            if (i == RCM_USB_MAX_URBS) {
+                r->out_busy = false;
+                continue;
+            }
+            r->in_busy[i] = false;
+            if (u->status == 0 && u->actual_length > 0) {
+                rcm_trace_read(r->parser, 0);
+                capture_chunk(r, RCM_CAPTURE_IN, (const uint8_t *)u->buffer,
+                              (size_t)u->actual_length);
+                rcm_feed(r->parser, (const uint8_t *)u->buffer, (size_t)u->actual_length);
+                got_data = true;
+            } else if (u->status == -EPIPE) {
+                unsigned ep = cfg->ep_in;
+                ioctl(cfg->fd, USBDEVFS_CLEAR_HALT, &ep);
+            } else if (u->status == -ENODEV || u->status == -ESHUTDOWN) {
+                fatal = true;
+                break;
+            }
+            if (!atomic_load_explicit(&r->stop, memory_order_relaxed) &&
+                submit_in(r, i) != 0 && (errno == ENODEV || errno == ESHUTDOWN)) {
+                fatal = true;
+                break;
+            }
+        }
+        if (got_data && cfg->after_feed)
+            cfg->after_feed(cfg->userdata);
+        /* A slot whose resubmit failed is retried here on every pass */
+        if (!fatal && !atomic_load_explicit(&r->stop, memory_order_relaxed) &&
+            (idle = rearm_idle(r)) < 0)
+            fatal = true;
+        if (fatal)
+            break;
+        rcm_expire_requests(r->parser);
+
+        if (polling_fallback) {
+            uint64_t now = now_ns();
+            /* While polling, responses are data too: only pushes end it */
+            if (got_data && !push_mode) {
+                uint64_t n = push_count(r->parser);
+                if (n != pushes) push_mode = true;
+                pushes = n;
+            }
+            if (got_data && push_mode) {
+                last_data = now;
+            } else if (push_mode && now - last_data > push_timeout) {
+                push_mode = false;
+                pushes = push_count(r->parser);
+            }
+            if (!push_mode)
+                poll_due = poll_requests(r, now, &next_poll);
+        }
+    }
+
+    drain_urbs(r);
+    atomic_store_explicit(&r->running, false, memory_order_release);
+    return NULL;
+}
+
+static void reader_free(rcm_usb_reader_t *r) {
+    if (r->wake[0] >= 0) close(r->wake[0]);
+    if (r->wake[1] >= 0) close(r->wake[1]);
+    pthread_mutex_destroy(&r->lock);
+    pthread_mutex_destroy(&r->capture_lock);
+    for (unsigned i = 0; i < RCM_USB_MAX_URBS; i++) free(r->in_urb[i]);
+    free(r->out_urb);
+    free(r->in_buf);
+    free(r);
+}
+
+rcm_usb_reader_t *rcm_usb_start(rcm_parser_t *parser, const rcm_usb_config_t *cfg) {
+    if (!parser || !cfg || cfg->fd < 0 || !(cfg->ep_in & 0x80) ||
+        (cfg->ep_out & 0x80) || cfg->urbs > RCM_USB_MAX_URBS ||
+        cfg->poll_inflight > RCM_MAX_PENDING ||
+        cfg->push_timeout_ms < 0 || cfg->poll_interval_ms < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    rcm_usb_reader_t *r = (rcm_usb_reader_t *)calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->parser = parser;
+    r->cfg = *cfg;
+    if (!r->cfg.urbs)    r->cfg.urbs = RCM_USB_DEFAULT_URBS;
+    if (!r->cfg.urb_len) r->cfg.urb_len = RCM_USB_DEFAULT_URB_LEN;
+    if (!r->cfg.poll_interval_ms) r->cfg.poll_interval_ms = REQ_TIMEOUT_MS;
+    r->seq = 1;
+    rcm_tx_template_enable(&r->tx_enable);
+    rcm_tx_template_channel_request(&r->tx_channel);
+    r->wake[0] = r->wake[1] = -1;
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_mutex_init(&r->capture_lock, NULL);
+
+    bool ok = true;
+    for (unsigned i = 0; i < r->cfg.urbs; i++) {
+        r->in_urb[i] = (struct usbdevfs_urb *)calloc(1, sizeof(struct usbdevfs_urb));
+        ok = ok && r->in_urb[i];
+    }
+    r->out_urb = (struct usbdevfs_urb *)calloc(1, sizeof(struct usbdevfs_urb));
+    r->in_buf = (uint8_t *)malloc(r->cfg.urbs * r->cfg.urb_len);
+    if (!ok || !r->out_urb || !r->in_buf ||
+        pipe2(r->wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+        int err = errno ? errno : ENOMEM;
+        reader_free(r);
+        errno = err;
+        return NULL;
+    }
+
+    /* Arm every IN URB before the thread starts so no data is missed */
+    for (unsigned i = 0; i < r->cfg.urbs; i++) {
+        if (submit_in(r, i) != 0) {
+            int err = errno;
+            drain_urbs(r);
+            reader_free(r);
+            errno = err;
+            return NULL;
+        }
+    }
+
+    atomic_store(&r->running, true);
+    int err = pthread_create(&r->thread, NULL, reader_thread, r);
+    if (err != 0) {
+        drain_urbs(r);
+        reader_free(r);
+        errno = err;
+        return NULL;
+    }
+    return r;
+}
+
+int rcm_usb_send(rcm_usb_reader_t *r, const uint8_t *data, size_t len) {
+    if (!r || !data || len == 0 || len > DUML_MAX_FRAME_LEN || !r->cfg.ep_out ||
+        !atomic_load_explicit(&r->running, memory_order_acquire))
+        return -1;
+    pthread_mutex_lock(&r->lock);
+    int ret = enqueue_out_locked(r, data, len);
+    pthread_mutex_unlock(&r->lock);
+    if (ret == 0) {
+        uint8_t b = 1;
+        (void)!write(r->wake[1], &b, 1);
+    }
+    return ret;
+}
+
+void rcm_usb_set_capture(rcm_usb_reader_t *r, rcm_capture_writer_t *w, uint8_t source) {
+    if (!r) return;
+    pthread_mutex_lock(&r->capture_lock);
+    r->capture_source = source;
+    atomic_store_explicit(&r->capture, w, memory_order_relaxed);
+    pthread_mutex_unlock(&r->capture_lock);
+}
+
+bool rcm_usb_running(const rcm_usb_reader_t *r) {
+    return r && atomic_load_explicit(&r->running, memory_order_acquire);
+}
+
+void rcm_usb_stop(rcm_usb_reader_t *r) {
+    if (!r) return;
+    atomic_store_explicit(&r->stop, true, memory_order_release);
+    uint8_t b = 1;
+    (void)!write(r->wake[1], &b, 1);
+    pthread_join(r->thread, NULL);
+    reader_free(r);
+}
@@ -0,0 +1,489 @@
+/*
+ * bench_rc_monitor.c - Parser micro/macro benchmarks with JSON output
+ *
+ * Cases:
+ *   feed     rcm_feed() throughput over generated streams (clean, 1% and
+ *            10% random noise, CRC8-valid false headers claiming a maximum
+ *            length frame before every real frame, runs of SOF bytes) fed
+ *            in chunks of 1, 64, 512 and 4096 bytes
+ *   crc      every supported CRC kernel alone, on a frame header (CRC8),
+ *            an RC push frame and a maximum-length frame (CRC16)
+ *   payload  rcm_parse_payload(), rcm_parse_payload_packed() and the batch
+ *            rcm_parse_payloads() alone
+ *   tx       building a channel request with rcm_build_channel_request()
+ *            against rcm_tx_write() from a template
+ *   latency  per-frame rcm_feed() latency percentiles, one frame (with the
+ *            noise in front of it) per call, timed with the CPU's cycle
+ *            counter (TSC on x86, CNTVCT on arm64, clock_gettime elsewhere)
+ *            converted to ns
+ *
+ * Each feed entry has the decoded and the generated frame count; in the
+ * false_sof stream the last few trail behind a false header that is still
+ * waiting for its claimed length when the stream ends.
+ *
+ * Throughput numbers are the best of -r runs. The JSON document goes to
+ * stdout (or -o file); nothing else is printed on success, so the output
+ * can be diffed or fed to a dashboard as is. On Android the target is built
+ * with the NDK toolchain alongside librc_monitor.so:
+ *
+ *   adb push build/bench_rc_monitor /data/local/tmp/
+ *   adb shell /data/local/tmp/bench_rc_monitor > bench.json
+ *
+ * Usage: ./bench_rc_monitor [-s stream_kb] [-r runs] [-n samples]
+ *                           [-k table|slice8|clmul] [-o out.json]
+ */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* clock_gettime */
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rc_monitor.h"
+#include "rc_monitor_tx.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIMER_NAME "tsc"
+static inline uint64_t ticks(void) { return __rdtsc(); }
+#elif defined(__aarch64__)
+#define TIMER_NAME "cntvct"
+static inline uint64_t ticks(void) {
+    uint64_t v;
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+    return v;
+}
+#else
+#define TIMER_NAME "clock_monotonic"
+static inline uint64_t ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#define DEFAULT_STREAM_KB  4096
+#define DEFAULT_RUNS       3
+#define DEFAULT_SAMPLES    100000
+#define PAYLOAD_SET        4096      /* distinct payloads for the decoder cases */
+
+static const size_t k_chunks[] = { 1, 64, 512, 4096 };
+
+typedef enum { S_CLEAN, S_NOISE1, S_NOISE10, S_FALSE_SOF, S_SOF_FLOOD, S_COUNT } stream_kind_t;
+static const char *const k_stream_names[S_COUNT] = {
+    "clean", "noise_1pct", "noise_10pct", "false_sof", "sof_flood"
+};
+
+typedef struct {
+    uint8_t *data;
+    size_t   len;
+    size_t  *unit_end;   /* end offset of each frame with the noise before it */
+    size_t   units;
+} stream_t;
+
+static unsigned long g_frames;
+static volatile uint32_t g_sink;
+
+static void count_cb(const rc_state_t *s, void *ud) {
+    (void)ud;
+    g_frames++;
+    g_sink += (uint32_t)s->stick_right.horizontal;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rnd(uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1Dull;
+}
+
+/* A plausible RC push payload: centred axes plus noise, random buttons */
+static void random_payload(uint8_t *p, uint64_t *rng) {
+    uint64_t r = rnd(rng);
+    memset(p, 0, RC_PUSH_PAYLOAD_LEN);
+    p[0] = (uint8_t)(r & 0x70);
+    p[1] = (uint8_t)(r >> 8);
+    p[2] = (uint8_t)((r >> 16) & 0x1F);
+    p[4] = (uint8_t)((r >> 24) & 0x7E);
+    for (int i = 5; i < 17; i += 2) {
+        uint16_t v = (uint16_t)(0x400 + (int)(rnd(rng) % 1321) - 660);
+        p[i] = (uint8_t)v;
+        p[i + 1] = (uint8_t)(v >> 8);
+    }
+}
+
+static int stream_gen(stream_t *s, stream_kind_t kind, size_t target, uint64_t seed) {
+    size_t cap = target + 2 * DUML_MAX_FRAME_LEN;
+    s->data = malloc(cap);
+    s->unit_end = malloc((target / 30 + 2) * sizeof(size_t));
+    if (!s->data || !s->unit_end) return -1;
+    s->len = 0;
+    s->units = 0;
+
+    uint64_t rng = seed;
+    double noise_ratio = kind == S_NOISE1 ? 0.01 / 0.99 : kind == S_NOISE10 ? 0.10 / 0.90 : 0;
+    double noise_owed = 0;
+    uint16_t seq = 0;
+    while (s->len + 64 <= target && s->units < target / 30) {
+        uint8_t *out = s->data + s->len;
+        size_t pre = 0;
+        if (kind == S_NOISE1 || kind == S_NOISE10) {
+            /* Random bytes, themselves containing the odd 0x55 */
+            noise_owed += 30 * noise_ratio;
+            for (; noise_owed >= 1; noise_owed -= 1)
+                out[pre++] = (uint8_t)rnd(&rng);
+        } else if (kind == S_FALSE_SOF) {
+            /* Header CRC8 passes, so each costs a full-length CRC16 attempt */
+            out[0] = DUML_SOF;
+            out[1] = (uint8_t)(DUML_MAX_FRAME_LEN & 0xFF);
+            out[2] = (uint8_t)(((DUML_MAX_FRAME_LEN >> 8) & 0x03) | (DUML_VERSION << 2));
+            out[3] = rcm_crc8_update(DUML_CRC8_SEED, out, 3);
+            pre = 4;
+        } else if (kind == S_SOF_FLOOD) {
+            memset(out, DUML_SOF, 3);
+            pre = 3;
+        }
+        uint8_t payload[RC_PUSH_PAYLOAD_LEN];
+        random_payload(payload, &rng);
+        int flen = rcm_build_packet(out + pre, 64, DUML_DEV_RC, 0, DUML_DEV_APP, 0, seq++,
+                                    DUML_PACK_REQUEST, DUML_ACK_NO_ACK, 0,
+                                    DUML_CMD_SET_RC, DUML_CMD_RC_PUSH,
+                                    payload, RC_PUSH_PAYLOAD_LEN);
+        if (flen <= 0) return -1;
+        s->len += pre + (size_t)flen;
+        s->unit_end[s->units++] = s->len;
+    }
+    return 0;
+}
+
+static void stream_free(stream_t *s) {
+    free(s->data);
+    free(s->unit_end);
+}
+
+/* ---------- Cases ---------- */
+
+static void bench_feed(FILE *o, const stream_t *streams, unsigned runs) {
+    fprintf(o, "  \"feed\": [\n");
+    int first = 1;
+    for (int k = 0; k < S_COUNT; k++) {
+        const stream_t *s = &streams[k];
+        for (size_t c = 0; c < sizeof(k_chunks) / sizeof(k_chunks[0]); c++) {
+            size_t chunk = k_chunks[c];
+            uint64_t best = UINT64_MAX;
+            unsigned long frames = 0;
+            for (unsigned r = 0; r < runs; r++) {
+                rcm_parser_t *p = rcm_create(count_cb, NULL);
+                g_frames = 0;
+                uint64_t t0 = now_ns();
+                for (size_t off = 0; off < s->len; off += chunk)
+                    rcm_feed(p, s->data + off, s->len - off < chunk ? s->len - off : chunk);
+                uint64_t dt = now_ns() - t0;
+                if (dt < best) best = dt;
+                frames = g_frames;
+                rcm_destroy(p);
+            }
+            if (best == 0) best = 1;
+            fprintf(o, "%s    {\"stream\": \"%s\", \"chunk\": %zu, \"bytes\": %zu, "
+                       "\"frames\": %lu, \"expected_frames\": %zu, \"ns\": %llu, "
+                       "\"mb_per_s\": %.2f, \"ns_per_frame\": %.2f}",
+                    first ? "" : ",\n", k_stream_names[k], chunk, s->len, frames,
+                    s->units, (unsigned long long)best,
+                    (double)s->len * 1e3 / (double)best,
+                    frames ? (double)best / (double)frames : 0.0);
+            first = 0;
+        }
+    }
+    fprintf(o, "\n  ],\n");
+}
+
+static void bench_crc(FILE *o, unsigned runs) {
+    static const struct { const char *crc; int crc8; size_t len; } cases[] = {
+        { "crc8", 1, 3 }, { "crc16", 0, 28 }, { "crc16", 0, DUML_MAX_FRAME_LEN - 2 },
+    };
+    uint8_t buf[DUML_MAX_FRAME_LEN];
+    uint64_t rng = 7;
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = (uint8_t)rnd(&rng);
+
+    fprintf(o, "  \"crc\": [\n");
+    int first = 1;
+    for (int k = 0; k < RCM_CRC_KERNEL_COUNT; k++) {
+        if (!rcm_crc_kernel_supported((rcm_crc_kernel_t)k)) continue;
+        for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+            size_t len = cases[c].len;
+            unsigned long iters = (unsigned long)((32u << 20) / len);
+            uint64_t best = UINT64_MAX;
+            for (unsigned r = 0; r < runs; r++) {
+                uint16_t crc = 0;
+                uint64_t t0 = now_ns();
+                /* Chained through the seed, so no call can be skipped */
+                if (cases[c].crc8)
+                    for (unsigned long i = 0; i < iters; i++)
+                        crc = rcm_crc8_kernel((rcm_crc_kernel_t)k, (uint8_t)crc, buf, len);
+                else
+                    for (unsigned long i = 0; i < iters; i++)
+                        crc = rcm_crc16_kernel((rcm_crc_kernel_t)k, crc, buf, len);
+                uint64_t dt = now_ns() - t0;
+                g_sink += crc;
+                if (dt < best) best = dt;
+            }
+            if (best == 0) best = 1;
+            fprintf(o, "%s    {\"kernel\": \"%s\", \"crc\": \"%s\", \"len\": %zu, "
+                       "\"ns_per_call\": %.2f, \"mb_per_s\": %.2f}",
+                    first ? "" : ",\n", rcm_crc_kernel_name((rcm_crc_kernel_t)k),
+                    cases[c].crc, len, (double)best / (double)iters,
+                    (double)len * (double)iters * 1e3 / (double)best);
+            first = 0;
+        }
+    }
+    fprintf(o, "\n  ],\n");
+}
+
+static void bench_payload(FILE *o, unsigned runs) {
+    uint8_t *set = malloc(PAYLOAD_SET * RC_PUSH_PAYLOAD_LEN);
+    int16_t *axis = malloc(PAYLOAD_SET * 6 * sizeof(int16_t));
+    int8_t *delta = malloc(PAYLOAD_SET);
+    uint16_t *flags = malloc(PAYLOAD_SET * sizeof(uint16_t));
+    if (!set || !axis || !delta || !flags) {
+        free(set); free(axis); free(delta); free(flags);
+        fprintf(o, "  \"payload\": [],\n");
+        return;
+    }
+    uint64_t rng = 11;
+    for (size_t i = 0; i < PAYLOAD_SET; i++)
+        random_payload(set + i * RC_PUSH_PAYLOAD_LEN, &rng);
+    rcm_payload_columns_t cols = {
+        .stick_right_h = axis,                   .stick_right_v = axis + PAYLOAD_SET,
+        .stick_left_h  = axis + 2 * PAYLOAD_SET, .stick_left_v  = axis + 3 * PAYLOAD_SET,
+        .left_wheel    = axis + 4 * PAYLOAD_SET, .right_wheel   = axis + 5 * PAYLOAD_SET,
+        .right_wheel_delta = delta,              .flags = flags,
+    };
+
+    static const char *const names[] = {
+        "rcm_parse_payload", "rcm_parse_payload_packed", "rcm_parse_payloads"
+    };
+    const unsigned reps = 512;
+    fprintf(o, "  \"payload\": [\n");
+    for (int d = 0; d < 3; d++) {
+        uint64_t best = UINT64_MAX;
+        for (unsigned r = 0; r < runs; r++) {
+            uint64_t t0 = now_ns();
+            for (unsigned rep = 0; rep < reps; rep++) {
+                if (d == 0) {
+                    rc_state_t st;
+                    for (size_t i = 0; i < PAYLOAD_SET; i++) {
+                        rcm_parse_payload(set + i * RC_PUSH_PAYLOAD_LEN, RC_PUSH_PAYLOAD_LEN, &st);
+                        g_sink += (uint32_t)st.stick_left.vertical;
+                    }
+                } else if (d == 1) {
+                    rcm_packed_state_t st;
+                    for (size_t i = 0; i < PAYLOAD_SET; i++) {
+                        rcm_parse_payload_packed(set + i * RC_PUSH_PAYLOAD_LEN,
+                                                 RC_PUSH_PAYLOAD_LEN, &st);
+                        g_sink += st.flags;
+                    }
+                } else {
+                    rcm_parse_payloads(set, PAYLOAD_SET, RC_PUSH_PAYLOAD_LEN, &cols);
+                    g_sink += flags[rep % PAYLOAD_SET];
+                }
+            }
+            uint64_t dt = now_ns() - t0;
+            if (dt < best) best = dt;
+        }
+        double n = (double)reps * PAYLOAD_SET;
+        fprintf(o, "    {\"decoder\": \"%s\", \"payloads\": %.0f, \"ns_per_payload\": %.3f}%s\n",
+                names[d], n, (double)best / n, d < 2 ? "," : "");
+    }
+    fprintf(o, "  ],\n");
+    free(set); free(axis); free(delta); free(flags);
+}
+
+static void bench_tx(FILE *o, unsigned runs) {
+    static const char *const names[] = { "rcm_build_channel_request", "rcm_tx_write" };
+    const unsigned long iters = 1ul << 20;
+    rcm_tx_template_t t;
+    rcm_tx_template_channel_request(&t);
+    uint8_t frame[DUML_HEADER_LEN + DUML_FOOTER_LEN];
+    fprintf(o, "  \"tx\": [\n");
+    for (int d = 0; d < 2; d++) {
+        uint64_t best = UINT64_MAX;
+        for (unsigned r = 0; r < runs; r++) {
+            uint64_t t0 = now_ns();
+            for (unsigned long i = 0; i < iters; i++) {
+                if (d == 0)
+                    rcm_build_channel_request(frame, sizeof(frame), (uint16_t)i);
+                else
+                    rcm_tx_write(&t, frame, sizeof(frame), (uint16_t)i, NULL);
+                g_sink += frame[DUML_HEADER_LEN];
+            }
+            uint64_t dt = now_ns() - t0;
+            if (dt < best) best = dt;
+        }
+        fprintf(o, "    {\"builder\": \"%s\", \"frames\": %lu, \"ns_per_frame\": %.2f}%s\n",
+                names[d], iters, (double)best / (double)iters, d < 1 ? "," : "");
+    }
+    fprintf(o, "  ],\n");
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Ticks per ns of the cycle counter, measured against CLOCK_MONOTONIC */
+static double timer_calibrate(void) {
+    uint64_t n0 = now_ns(), t0 = ticks();
+    while (now_ns() - n0 < 20000000)
+        ;
+    uint64_t n1 = now_ns(), t1 = ticks();
+    return (double)(t1 - t0) / (double)(n1 - n0);
+}
+
+static int bench_latency(FILE *o, const stream_t *streams, size_t samples, double tpn) {
+    uint64_t *lat = malloc(samples * sizeof(uint64_t));
+    if (!lat) return -1;
+
+    /* Back-to-back reads: the floor every sample includes */
+    uint64_t overhead = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t a = ticks(), b = ticks();
+        if (b - a < overhead) overhead = b - a;
+    }
+
+    fprintf(o, "  \"latency\": [\n");
+    for (int k = 0; k < S_COUNT; k++) {
+        const stream_t *s = &streams[k];
+        rcm_parser_t *p = rcm_create(count_cb, NULL);
+        size_t n = 0, u = 0, start = 0;
+        while (n < samples) {
+            size_t end = s->unit_end[u];
+            uint64_t t0 = ticks();
+            rcm_feed(p, s->data + start, end - start);
+            uint64_t t1 = ticks();
+            lat[n++] = t1 - t0;
+            start = end;
+            if (++u == s->units) {   /* wrap around the stream */
+                u = 0;
+                start = 0;
+            }
+        }
+        rcm_destroy(p);
+        qsort(lat, n, sizeof(lat[0]), cmp_u64);
+#define PCT(q) ((double)lat[(size_t)((double)(n - 1) * (q))] / tpn)
+        fprintf(o, "    {\"stream\": \"%s\", \"samples\": %zu, \"unit\": \"ns\", "
+                   "\"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+                   "\"p999\": %.1f, \"max\": %.1f}%s\n",
+                k_stream_names[k], n, PCT(0), PCT(0.5), PCT(0.9), PCT(0.99),
+                PCT(0.999), PCT(1.0), k < S_COUNT - 1 ? "," : "");
+#undef PCT
+    }
+    fprintf(o, "  ],\n");
+    fprintf(o, "  \"timer\": {\"source\": \"%s\", \"ticks_per_ns\": %.4f, "
+               "\"overhead_ticks\": %llu}\n",
+            TIMER_NAME, tpn, (unsigned long long)overhead);
+    free(lat);
+    return 0;
+}
+
+static const char *arch_name(void) {
+#if defined(__x86_64__)
+    return "x86_64";
+#elif defined(__i386__)
+    return "x86";
+#elif defined(__aarch64__)
+    return "arm64";
+#elif defined(__arm__)
+    return "arm";
+#else
+    return "unknown";
+#endif
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [-s stream_kb] [-r runs] [-n samples] [-k kernel] [-o out.json]\n"
+            "  -s  bytes per generated stream, in KB (default %u)\n"
+            "  -r  runs per throughput case, best is reported (default %u)\n"
+            "  -n  latency samples per stream (default %u)\n"
+            "  -k  CRC kernel for the feed and latency cases: table, slice8, clmul\n"
+            "      (default: the automatic choice)\n"
+            "  -o  write the JSON here instead of stdout\n",
+            argv0, DEFAULT_STREAM_KB, DEFAULT_RUNS, DEFAULT_SAMPLES);
+}
+
+int main(int argc, char *argv[]) {
+    size_t stream_kb = DEFAULT_STREAM_KB, samples = DEFAULT_SAMPLES;
+    unsigned runs = DEFAULT_RUNS;
+    const char *kernel = NULL, *out_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:n:k:o:")) != -1) {
+        switch (opt) {
+        case 's': stream_kb = (size_t)strtoul(optarg, NULL, 0); break;
+        case 'r': runs = (unsigned)strtoul(optarg, NULL, 0); break;
+        case 'n': samples = (size_t)strtoul(optarg, NULL, 0); break;
+        case 'k': kernel = optarg; break;
+        case 'o': out_path = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind != argc || stream_kb == 0 || runs == 0 || samples == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (kernel) {
+        int k = 0;
+        while (k < RCM_CRC_KERNEL_COUNT && strcmp(kernel, rcm_crc_kernel_name((rcm_crc_kernel_t)k)))
+            k++;
+        if (k == RCM_CRC_KERNEL_COUNT || rcm_crc_select((rcm_crc_kernel_t)k) != 0) {
+            fprintf(stderr, "CRC kernel %s is not available here\n", kernel);
+            return 1;
+        }
+    }
+
+    stream_t streams[S_COUNT];
+    memset(streams, 0, sizeof(streams));
+    for (int k = 0; k < S_COUNT; k++) {
+        if (stream_gen(&streams[k], (stream_kind_t)k, stream_kb * 1024, 0x9E3779B97F4A7C15ull + (uint64_t)k) != 0) {
+            fprintf(stderr, "out of memory\n");
+            for (int j = 0; j <= k; j++) stream_free(&streams[j]);
+            return 1;
+        }
+    }
+
+    FILE *o = out_path ? fopen(out_path, "w") : stdout;
+    if (!o) {
+        perror(out_path);
+        for (int k = 0; k < S_COUNT; k++) stream_free(&streams[k]);
+        return 1;
+    }
+
+    double tpn = timer_calibrate();
+    fprintf(o, "{\n  \"tool\": \"bench_rc_monitor\",\n  \"format\": 1,\n");
+    fprintf(o, "  \"platform\": {\"arch\": \"%s\", \"crc_kernel\": \"%s\", "
+               "\"stream_bytes\": %zu, \"runs\": %u},\n",
+            arch_name(), rcm_crc_kernel_name(rcm_crc_active_kernel()),
+            stream_kb * 1024, runs);
+    bench_feed(o, streams, runs);
+    bench_crc(o, runs);
+    bench_payload(o, runs);
+    bench_tx(o, runs);
+    int rc = bench_latency(o, streams, samples, tpn);
+    fprintf(o, "}\n");
+
+    if (out_path && fclose(o) != 0) {
+        perror(out_path);
+        rc = -1;
+    }
+    for (int k = 0; k < S_COUNT; k++) stream_free(&streams[k]);
+    return rc == 0 ? 0 : 1;
+}
@@ -1,7 +1,9 @@
 /*
  * fuzz_payload.c - libFuzzer harness for rcm_parse_payload()
  *
- * Exercises the payload decoder with arbitrary data and lengths.
+ * Exercises the payload decoder with arbitrary data and lengths, and checks
+ * rcm_parse_payloads() against rcm_parse_payload_packed() on nine payloads
+ * built from the input (enough for one vector block plus a scalar tail).
  *
  * Build:
  *   cmake .. -DENABLE_FUZZING=ON && make
@@ -13,6 +15,33 @@
 #include "rc_monitor.h"
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
+
+#define BATCH 9
+
+/* Payload k is the input rotated left by k bytes */
+static void check_batch(const uint8_t *data, size_t size) {
+    uint8_t buf[BATCH * RC_PUSH_PAYLOAD_LEN];
+    for (size_t k = 0; k < BATCH; k++)
+        for (size_t j = 0; j < RC_PUSH_PAYLOAD_LEN; j++)
+            buf[k * RC_PUSH_PAYLOAD_LEN + j] = data[(j + k) % size];
+
+    int16_t rh[BATCH], rv[BATCH], lh[BATCH], lv[BATCH], lw[BATCH], rw[BATCH];
+    int8_t delta[BATCH];
+    uint16_t flags[BATCH];
+    rcm_payload_columns_t c = { rh, rv, lh, lv, lw, rw, delta, flags };
+    if (rcm_parse_payloads(buf, BATCH, RC_PUSH_PAYLOAD_LEN, &c) != 0)
+        abort();
+    for (size_t k = 0; k < BATCH; k++) {
+        rcm_packed_state_t s;
+        rcm_parse_payload_packed(buf + k * RC_PUSH_PAYLOAD_LEN, RC_PUSH_PAYLOAD_LEN, &s);
+        if (flags[k] != s.flags || rh[k] != s.stick_right_h ||
+            rv[k] != s.stick_right_v || lh[k] != s.stick_left_h ||
+            lv[k] != s.stick_left_v || lw[k] != s.left_wheel ||
+            rw[k] != s.right_wheel || delta[k] != s.right_wheel_delta)
+            abort();
+    }
+}
 
 int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
     rc_state_t state;
@@ -44,6 +73,8 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
         (void)v;
         volatile int8_t d = state.right_wheel_delta;
         (void)d;
+
+        check_batch(data, size);
     }
     return 0;
 }
@@ -0,0 +1,132 @@
+/*
+ * fuzz_resync.c - libFuzzer harness for the parser's resync cost bound
+ *
+ * Expands the input into an adversarial DUML stream (raw bytes mixed with
+ * CRC8-valid false headers, real RC push frames and real frames with a
+ * corrupted CRC16), feeds it in input-chosen chunk sizes and aborts if the
+ * parser's work counters exceed the per-byte bound documented above
+ * decode_span() in rc_monitor.c. Random bytes almost never form a CRC8-valid
+ * header, so without the expansion the fuzzer would rarely reach resync.
+ *
+ * Build:
+ *   cmake .. -DENABLE_FUZZING=ON && make
+ *
+ * Run with corpus and dictionary:
+ *   ./fuzz_resync corpus_feed -dict=../test/fuzz.dict -max_len=4096
+ */
+
+#include "rc_monitor.h"
+#include "rc_monitor_internal.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STREAM_MAX (64 * 1024)
+
+static rcm_parser_t *g_parser;
+static uint8_t g_stream[STREAM_MAX];
+
+static void fuzz_callback(const rc_state_t *state, void *userdata) {
+    (void)userdata;
+    volatile int16_t v = state->stick_right.horizontal;
+    (void)v;
+}
+
+/*
+ * Each op byte selects what to append:
+ *   00xxxxxx  copy the next x+1 input bytes verbatim
+ *   01xxxxxx  false header; next 2 input bytes give the claimed length
+ *   10xxxxxx  RC push frame; next 17 input bytes are the payload
+ *   11xxxxxx  same, with the CRC16 corrupted
+ */
+static size_t expand(const uint8_t *data, size_t size) {
+    size_t in = 0, out = 0;
+    while (in < size && out + DUML_MAX_FRAME_LEN < STREAM_MAX) {
+        uint8_t op = data[in++];
+        size_t avail = size - in;
+        switch (op >> 6) {
+        case 0: {
+            size_t n = (size_t)(op & 0x3F) + 1;
+            if (n > avail) n = avail;
+            memcpy(g_stream + out, data + in, n);
+            in += n;
+            out += n;
+            break;
+        }
+        case 1: {
+            uint16_t len = DUML_MIN_FRAME_LEN;
+            if (avail >= 2) {
+                len = (uint16_t)(data[in] | (data[in + 1] << 8));
+                len = (uint16_t)(DUML_MIN_FRAME_LEN +
+                                 len % (0x3FF - DUML_MIN_FRAME_LEN + 1));
+                in += 2;
+            }
+            uint8_t *h = g_stream + out;
+            h[0] = DUML_SOF;
+            h[1] = (uint8_t)(len & 0xFF);
+            h[2] = (uint8_t)(((len >> 8) & 0x03) | (DUML_VERSION << 2));
+            h[3] = rcm_crc8_update(DUML_CRC8_SEED, h, 3);
+            out += 4;
+            break;
+        }
+        default: {
+            uint8_t payload[RC_PUSH_PAYLOAD_LEN] = {0};
+            size_t n = avail < sizeof(payload) ? avail : sizeof(payload);
+            memcpy(payload, data + in, n);
+            in += n;
+            int flen = rcm_build_packet(g_stream + out, STREAM_MAX - out,
+                                        DUML_DEV_RC, 0, DUML_DEV_APP, 0, 0,
+                                        DUML_PACK_REQUEST, DUML_ACK_NO_ACK, 0,
+                                        DUML_CMD_SET_RC, DUML_CMD_RC_PUSH,
+                                        payload, sizeof(payload));
+            if (flen <= 0) break;
+            if (op >> 6 == 3)
+                g_stream[out + (size_t)flen - 1] ^= 0x5A;
+            out += (size_t)flen;
+            break;
+        }
+        }
+    }
+    return out;
+}
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+    (void)argc;
+    (void)argv;
+    g_parser = rcm_create(fuzz_callback, NULL);
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 2) return 0;
+
+    /* First two bytes seed the chunk sizes (odd seeds favour tiny chunks so
+     * resync runs through the staging buffer), the rest is the stream */
+    uint32_t seed = (uint32_t)data[0] | ((uint32_t)data[1] << 8);
+    size_t max_chunk = (seed & 1) ? 16 : 2 * DUML_MAX_FRAME_LEN;
+    size_t len = expand(data + 2, size - 2);
+
+    rcm_priv_work_t before, after;
+    rcm_priv_parser_work(g_parser, &before);
+
+    size_t offset = 0;
+    while (offset < len) {
+        seed = seed * 1103515245u + 12345u;
+        size_t chunk = (size_t)((seed >> 16) % max_chunk) + 1;
+        if (chunk > len - offset) chunk = len - offset;
+        rcm_feed(g_parser, g_stream + offset, chunk);
+        offset += chunk;
+    }
+
+    rcm_priv_parser_work(g_parser, &after);
+    uint64_t bytes = after.bytes_in - before.bytes_in;
+    uint64_t calls = after.feed_calls - before.feed_calls;
+    if (after.header_checks - before.header_checks > 2 * bytes + calls ||
+        after.crc16_bytes - before.crc16_bytes > 2 * bytes ||
+        after.copy_bytes - before.copy_bytes > 2 * bytes)
+        abort();
+
+    rcm_reset(g_parser);
+    return 0;
+}
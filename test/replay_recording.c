@@ -0,0 +1,353 @@
+/*
+ * replay_recording.c - Fast and paced replay of capture files
+ *
+ * The file is mmap()ed and walked with rcm_capture_view_next(), so nothing
+ * is copied on the way to the parser.
+ *
+ * Throughput mode (default) feeds every IN chunk to rcm_feed() with no
+ * per-frame output and reports decoded frames/s and MB/s. Chunks (and raw
+ * .bin recordings, which are one big chunk) are fed in spans of at most -s
+ * bytes.
+ *
+ * Columnar mode (-c) decodes the file on all cores with
+ * rcm_decode_capture() and writes the rows as a columnar file
+ * (rc_monitor_decode.h); -n repeats the decode for timing.
+ *
+ * Paced mode (-x) writes the IN chunks, unparsed, to a Unix socket client
+ * or a pty at their recorded timestamps scaled by the speed factor, so a
+ * LocalSocketReader (or any stream reader) sees the field data with its
+ * original timing and chunking.
+ *
+ * Usage:
+ *   ./replay_recording [-n repeat] [-s span] <file>
+ *   ./replay_recording -c out.rcms [-j threads] [-n repeat] <file>
+ *   ./replay_recording -x speed (-u path|@name | -t) [-l] <file.rcap>
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* posix_openpt, cfmakeraw */
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "rc_monitor.h"
+#include "rc_monitor_capture.h"
+#include "rc_monitor_decode.h"
+
+#define DEFAULT_SPAN (1u << 20)
+
+static unsigned long g_frames;
+
+static void count_cb(const rc_state_t *s, void *ud) {
+    (void)s; (void)ud;
+    g_frames++;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [-n repeat] [-s span] <file>\n"
+            "       %s -c out.rcms [-j threads] [-n repeat] <file>\n"
+            "       %s -x speed (-u path|@name | -t) [-l] <file.rcap>\n"
+            "  -n  feed the file this many times (default 1)\n"
+            "  -c  decode in parallel and write a columnar file\n"
+            "  -j  decoder threads (default: online CPUs)\n"
+            "  -s  max bytes per rcm_feed() call (default %u)\n"
+            "  -x  replay at recorded timing, speed x (1 = real time, 0 = flat out)\n"
+            "  -u  listen on a Unix socket (@name: abstract) and serve one client\n"
+            "  -t  create a pty and print its slave path\n"
+            "  -l  loop the capture until the peer goes away\n",
+            argv0, argv0, argv0, DEFAULT_SPAN);
+}
+
+/* ---------- Throughput mode ---------- */
+
+static int run_bench(const rcm_capture_view_t *file, unsigned repeat, size_t span) {
+    rcm_parser_t *p = rcm_create(count_cb, NULL);
+    if (!p) {
+        fprintf(stderr, "rcm_create failed\n");
+        return 1;
+    }
+
+    uint64_t bytes = 0;
+    int got = 0;
+    rcm_capture_chunk_t c = { 0 };
+    uint64_t start = now_ns();
+    for (unsigned i = 0; i < repeat && got >= 0; i++) {
+        rcm_capture_view_t v = *file;
+        while ((got = rcm_capture_view_next(&v, &c)) > 0) {
+            if (c.dir != RCM_CAPTURE_IN) continue;
+            for (size_t off = 0; off < c.len; off += span) {
+                size_t n = c.len - off < span ? c.len - off : span;
+                rcm_feed(p, c.data + off, n);
+            }
+            bytes += c.len;
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+    if (got < 0)
+        fprintf(stderr, "warning: malformed chunk at offset %llu, stopped there\n",
+                (unsigned long long)c.offset);
+
+    rcm_stats_t st;
+    rcm_get_stats(p, &st);
+    double secs = (double)elapsed / 1e9;
+    if (secs <= 0) secs = 1e-9;
+    printf("%lu RC frames (%llu DUML frames) from %.1f MB in %.3f s\n"
+           "%.0f frames/s, %.1f MB/s\n",
+           g_frames, (unsigned long long)st.frames, (double)bytes / 1e6, secs,
+           (double)st.frames / secs, (double)bytes / 1e6 / secs);
+    rcm_destroy(p);
+    return got < 0 ? 1 : 0;
+}
+
+/* ---------- Columnar mode ---------- */
+
+static int run_columns(const void *map, size_t size, const char *out_path,
+                       unsigned threads, unsigned repeat) {
+    rcm_decode_config_t cfg = { .threads = threads };
+    rcm_columns_t cols;
+    int rc = 0;
+    uint64_t start = now_ns();
+    for (unsigned i = 0; i < repeat; i++) {
+        if (i > 0) rcm_columns_free(&cols);
+        rc = rcm_decode_capture(map, size, &cfg, &cols);
+        if (rc < 0) {
+            fprintf(stderr, "rcm_decode_capture failed\n");
+            return 1;
+        }
+    }
+    double secs = (double)(now_ns() - start) / 1e9;
+    if (secs <= 0) secs = 1e-9;
+    if (rc > 0)
+        fprintf(stderr, "warning: capture contains a malformed chunk\n");
+    printf("%zu RC frames from %.1f MB in %.3f s (x%u)\n"
+           "%.0f frames/s, %.1f MB/s\n",
+           cols.count, (double)size / 1e6, secs, repeat,
+           (double)cols.count * repeat / secs, (double)size * repeat / 1e6 / secs);
+
+    if (rcm_columns_write(out_path, &cols) != 0) {
+        perror(out_path);
+        rc = 1;
+    }
+    rcm_columns_free(&cols);
+    return rc != 0;
+}
+
+/* ---------- Paced mode ---------- */
+
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr;
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(addr.sun_path)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, len);
+    socklen_t alen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len + 1);
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0';
+        alen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len);
+    } else {
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (const struct sockaddr *)&addr, alen) != 0 || listen(fd, 1) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    fprintf(stderr, "waiting for a client on %s\n", path);
+    int client = accept(fd, NULL, NULL);
+    int err = errno;
+    close(fd);
+    if (path[0] != '@') unlink(path);
+    errno = err;
+    return client;
+}
+
+static int open_pty(void) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct termios tio;
+    const char *slave;
+    if (grantpt(fd) != 0 || unlockpt(fd) != 0 || !(slave = ptsname(fd)) ||
+        tcgetattr(fd, &tio) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    cfmakeraw(&tio); /* no line discipline: bytes pass through untouched */
+    tcsetattr(fd, TCSANOW, &tio);
+    printf("%s\n", slave);
+    fflush(stdout);
+    return fd;
+}
+
+static int write_all(int fd, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int run_paced(const rcm_capture_view_t *file, int fd, double speed, int loop) {
+    unsigned long chunks = 0;
+    uint64_t bytes = 0, max_late = 0;
+    uint64_t start = now_ns();
+    int got = 0;
+    rcm_capture_chunk_t c = { 0 };
+
+    do {
+        rcm_capture_view_t v = *file;
+        uint64_t first_ns = 0, base = now_ns();
+        while ((got = rcm_capture_view_next(&v, &c)) > 0) {
+            if (c.dir != RCM_CAPTURE_IN) continue;
+            if (!first_ns) first_ns = c.t_ns;
+            uint64_t due = base;
+            if (speed > 0 && c.t_ns > first_ns)
+                due += (uint64_t)((double)(c.t_ns - first_ns) / speed);
+            struct timespec ts = { .tv_sec  = (time_t)(due / 1000000000ull),
+                                   .tv_nsec = (long)(due % 1000000000ull) };
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+                ;
+            if (write_all(fd, c.data, c.len) != 0) {
+                if (errno == EPIPE || errno == ECONNRESET || errno == EIO) {
+                    loop = 0; /* peer went away */
+                    got = 0;
+                    break;
+                }
+                perror("write");
+                return 1;
+            }
+            uint64_t late = now_ns() - due;
+            if (late > max_late) max_late = late;
+            chunks++;
+            bytes += c.len;
+        }
+    } while (loop && got == 0);
+
+    if (got < 0)
+        fprintf(stderr, "warning: malformed chunk at offset %llu, stopped there\n",
+                (unsigned long long)c.offset);
+    printf("%lu chunks, %.1f KB in %.3f s, max lateness %.3f ms\n",
+           chunks, (double)bytes / 1e3, (double)(now_ns() - start) / 1e9,
+           (double)max_late / 1e6);
+    return got < 0 ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned repeat = 1;
+    size_t span = DEFAULT_SPAN;
+    double speed = -1;
+    const char *sock = NULL, *columns = NULL;
+    unsigned threads = 0;
+    int pty = 0, loop = 0, opt;
+
+    while ((opt = getopt(argc, argv, "n:s:c:j:x:u:tl")) != -1) {
+        switch (opt) {
+        case 'n': repeat = (unsigned)strtoul(optarg, NULL, 0); break;
+        case 's': span = (size_t)strtoul(optarg, NULL, 0); break;
+        case 'c': columns = optarg; break;
+        case 'j': threads = (unsigned)strtoul(optarg, NULL, 0); break;
+        case 'x': speed = strtod(optarg, NULL); break;
+        case 'u': sock = optarg; break;
+        case 't': pty = 1; break;
+        case 'l': loop = 1; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    int paced = speed >= 0;
+    if (optind != argc - 1 || repeat == 0 || span == 0 ||
+        paced != (sock != NULL || pty) || (sock && pty) || (paced && columns)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[optind];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = NULL;
+    if (size > 0) {
+        map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("mmap");
+            close(fd);
+            return 1;
+        }
+        madvise(map, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    rcm_capture_view_t v;
+    if (rcm_capture_view_init(&v, map, size) != 0) {
+        fprintf(stderr, "%s: malformed capture header\n", path);
+        if (map) munmap(map, size);
+        return 1;
+    }
+
+    int rc;
+    if (columns) {
+        rc = run_columns(map, size, columns, threads, repeat);
+    } else if (!paced) {
+        rc = run_bench(&v, repeat, span);
+    } else if (v.raw) {
+        fprintf(stderr, "%s: raw recordings have no timestamps to pace by\n", path);
+        rc = 1;
+    } else {
+        signal(SIGPIPE, SIG_IGN);
+        int out = sock ? listen_unix(sock) : open_pty();
+        if (out < 0) {
+            perror(sock ? sock : "pty");
+            rc = 1;
+        } else {
+            rc = run_paced(&v, out, speed, loop);
+            if (pty) {
+                /* Closing the master discards unread output: wait for the
+                 * reader to close the slave first */
+                struct pollfd pfd = { .fd = out, .events = 0 };
+                while (poll(&pfd, 1, -1) < 0 && errno == EINTR)
+                    ;
+            }
+            close(out);
+        }
+    }
+
+    if (map) munmap(map, size);
+    return rc;
+}
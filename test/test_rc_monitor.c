@@ -11,7 +11,26 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "rc_monitor.h"
+#include "rc_monitor_tx.h"
+#include "rc_monitor_history.h"
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <linux/input.h>
+#include "rc_monitor_usb.h"
+#include "rc_monitor_evdev.h"
+#include "rc_monitor_io.h"
+#include "rc_monitor_capture.h"
+#include "rc_monitor_decode.h"
+#include "rc_monitor_shm.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
 
 #define TEST(name) static void name(void)
 #define RUN(name) do { printf("  %-40s", #name); name(); printf("OK\n"); } while(0)
@@ -1537,6 +1556,2516 @@ TEST(test_build_packet_cmd_type_fields) {
     ASSERT_EQ(buf[8], 0xC5);
 }
 
+/* ---- Span-based feeding ---- */
+
+TEST(test_parser_split_at_every_offset) {
+    /* Two back-to-back frames, split into two feeds at every possible point */
+    uint8_t rc_payload[17] = {0};
+    rc_payload[0] = 0x40; /* shutter */
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+
+    uint8_t buf[128];
+    memcpy(buf, frame, (size_t)flen);
+    memcpy(buf + flen, frame, (size_t)flen);
+    size_t total = 2 * (size_t)flen;
+
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    for (size_t split = 0; split <= total; split++) {
+        g_callback_count = 0;
+        rcm_reset(p);
+        int n = rcm_feed(p, buf, split);
+        n += rcm_feed(p, buf + split, total - split);
+        ASSERT_EQ(n, 2);
+        ASSERT_EQ(g_callback_count, 2);
+        ASSERT(g_last_state.shutter == true);
+    }
+    rcm_destroy(p);
+}
+
+TEST(test_parser_straddle_then_inline_frames) {
+    /* A frame completed from the staging buffer followed by whole frames in
+     * the same chunk — all of them must decode, in order */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+
+    uint8_t f_pause[64], f_home[64], f_rec[64];
+    rc_payload[0] = 0x10;
+    int flen = build_rc_push_frame(f_pause, sizeof(f_pause), rc_payload);
+    rc_payload[0] = 0x20;
+    build_rc_push_frame(f_home, sizeof(f_home), rc_payload);
+    rc_payload[0] = 0x00; rc_payload[1] = 0x01;
+    build_rc_push_frame(f_rec, sizeof(f_rec), rc_payload);
+    ASSERT(flen > 0);
+
+    uint8_t buf[256];
+    size_t n = 0;
+    memcpy(buf + n, f_pause, (size_t)flen); n += (size_t)flen;
+    memcpy(buf + n, f_home, (size_t)flen);  n += (size_t)flen;
+    memcpy(buf + n, f_rec, (size_t)flen);   n += (size_t)flen;
+
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    ASSERT_EQ(rcm_feed(p, buf, 7), 0);
+    ASSERT_EQ(rcm_feed(p, buf + 7, n - 7), 3);
+    ASSERT_EQ(g_callback_count, 3);
+    ASSERT(g_last_state.record == true);
+    ASSERT(g_last_state.pause == false);
+    rcm_destroy(p);
+}
+
+TEST(test_parser_chunked_noisy_stream) {
+    /* Garbage containing stray SOF bytes interleaved with frames, fed in
+     * every chunk size from 1 to 64 — result must match a single feed */
+    uint8_t rc_payload[17] = {0};
+    rc_payload[0] = 0x40;
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+
+    static const uint8_t noise[] = { 0x55, 0x13, 0x55, 0x55, 0x00, 0xFF, 0x55 };
+    uint8_t buf[1024];
+    size_t n = 0;
+    for (int i = 0; i < 10; i++) {
+        memcpy(buf + n, noise, sizeof(noise) - (size_t)(i % 4));
+        n += sizeof(noise) - (size_t)(i % 4);
+        memcpy(buf + n, frame, (size_t)flen);
+        n += (size_t)flen;
+    }
+
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    for (size_t chunk = 1; chunk <= 64; chunk++) {
+        g_callback_count = 0;
+        rcm_reset(p);
+        int decoded = 0;
+        for (size_t off = 0; off < n; off += chunk) {
+            size_t len = (n - off < chunk) ? n - off : chunk;
+            decoded += rcm_feed(p, buf + off, len);
+        }
+        ASSERT_EQ(decoded, 10);
+        ASSERT_EQ(g_callback_count, 10);
+    }
+    rcm_destroy(p);
+}
+
+/* ---- CRC engine ---- */
+
+TEST(test_crc_self_test) {
+    ASSERT_EQ(rcm_crc_self_test(), 0);
+}
+
+TEST(test_crc_kernels_match_table) {
+    /* Every supported kernel must be bit-exact with the table kernel for
+     * every frame length and a few misaligned start offsets */
+    static uint8_t buf[DUML_MAX_FRAME_LEN + 8];
+    uint32_t x = 0x12345678u;
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = (uint8_t)(x >> 24);
+    }
+
+    for (int k = 0; k < RCM_CRC_KERNEL_COUNT; k++) {
+        if (!rcm_crc_kernel_supported((rcm_crc_kernel_t)k)) continue;
+        for (size_t off = 0; off < 4; off++) {
+            for (size_t len = 0; len <= DUML_MAX_FRAME_LEN; len++) {
+                ASSERT_EQ(rcm_crc8_kernel((rcm_crc_kernel_t)k, DUML_CRC8_SEED, buf + off, len),
+                          rcm_crc8_kernel(RCM_CRC_KERNEL_TABLE, DUML_CRC8_SEED, buf + off, len));
+                ASSERT_EQ(rcm_crc16_kernel((rcm_crc_kernel_t)k, DUML_CRC16_SEED, buf + off, len),
+                          rcm_crc16_kernel(RCM_CRC_KERNEL_TABLE, DUML_CRC16_SEED, buf + off, len));
+            }
+        }
+    }
+}
+
+TEST(test_crc_update_chains) {
+    /* Splitting the input must not change the result */
+    uint8_t buf[300];
+    for (size_t i = 0; i < sizeof(buf); i++) buf[i] = (uint8_t)(i * 7 + 3);
+
+    uint16_t whole = rcm_crc16_update(DUML_CRC16_SEED, buf, sizeof(buf));
+    uint16_t part = rcm_crc16_update(DUML_CRC16_SEED, buf, 129);
+    part = rcm_crc16_update(part, buf + 129, sizeof(buf) - 129);
+    ASSERT_EQ(part, whole);
+
+    uint8_t whole8 = rcm_crc8_update(DUML_CRC8_SEED, buf, sizeof(buf));
+    uint8_t part8 = rcm_crc8_update(DUML_CRC8_SEED, buf, 3);
+    part8 = rcm_crc8_update(part8, buf + 3, sizeof(buf) - 3);
+    ASSERT_EQ(part8, whole8);
+
+    ASSERT_EQ(rcm_crc16_update(0xBEEF, NULL, 10), 0xBEEF);
+}
+
+TEST(test_crc_select_parser_roundtrip) {
+    /* Build + parse must work with every kernel forced */
+    rcm_crc_kernel_t saved = rcm_crc_active_kernel();
+    ASSERT(rcm_crc_kernel_supported(RCM_CRC_KERNEL_TABLE));
+    ASSERT_EQ(rcm_crc_select(RCM_CRC_KERNEL_COUNT), -1);
+    ASSERT(strcmp(rcm_crc_kernel_name(RCM_CRC_KERNEL_COUNT), "unknown") == 0);
+
+    uint8_t rc_payload[17] = {0};
+    rc_payload[0] = 0x40;
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+
+    for (int k = 0; k < RCM_CRC_KERNEL_COUNT; k++) {
+        if (rcm_crc_select((rcm_crc_kernel_t)k) != 0) continue;
+        ASSERT_EQ(rcm_crc_active_kernel(), (rcm_crc_kernel_t)k);
+
+        uint8_t frame[64];
+        int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+        ASSERT(flen > 0);
+
+        g_callback_count = 0;
+        rcm_parser_t *p = rcm_create(test_callback, NULL);
+        ASSERT_EQ(rcm_feed(p, frame, (size_t)flen), 1);
+        ASSERT_EQ(g_callback_count, 1);
+        ASSERT(g_last_state.shutter == true);
+        rcm_destroy(p);
+    }
+
+    ASSERT_EQ(rcm_crc_select(saved), 0);
+}
+
+/* ---- Resync after false headers ---- */
+
+/* Write a CRC8-valid DUML header at `out` claiming a frame of `frame_len` */
+static void write_false_header(uint8_t *out, uint16_t frame_len) {
+    out[0] = 0x55;
+    out[1] = (uint8_t)(frame_len & 0xFF);
+    out[2] = (uint8_t)(((frame_len >> 8) & 0x03) | (1 << 2));
+    out[3] = rcm_crc8_update(DUML_CRC8_SEED, out, 3);
+}
+
+TEST(test_parser_resync_inside_false_frame) {
+    /* A false header claiming 300 bytes hides three real frames; they used
+     * to be discarded with the false frame when its CRC16 failed */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+
+    uint8_t buf[400];
+    memset(buf, 0xAA, sizeof(buf));
+    write_false_header(buf, 300);
+    size_t n = 10;
+    for (int i = 0; i < 3; i++) {
+        memcpy(buf + n, frame, (size_t)flen);
+        n += (size_t)flen + 7;
+    }
+
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    ASSERT_EQ(rcm_feed(p, buf, sizeof(buf)), 3);
+    ASSERT_EQ(g_callback_count, 3);
+    rcm_destroy(p);
+}
+
+TEST(test_parser_resync_nested_false_headers) {
+    /* False headers inside false frames, with real frames between and after
+     * them, must all resolve the same way at every split point. Frames behind
+     * a false header are held back until its claimed length has arrived. */
+    uint8_t rc_payload[17] = {0};
+    rc_payload[0] = 0x40; /* shutter */
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+
+    uint8_t buf[1100];
+    memset(buf, 0x00, sizeof(buf));
+    write_false_header(buf, 200);
+    write_false_header(buf + 5, 400);
+    memcpy(buf + 20, frame, (size_t)flen);
+    write_false_header(buf + 60, 1000);
+    write_false_header(buf + 100, 150);
+    memcpy(buf + 120, frame, (size_t)flen);
+    memcpy(buf + 190, frame, (size_t)flen); /* straddles the first region end */
+    memcpy(buf + 500, frame, (size_t)flen);
+    memcpy(buf + 1060, frame, (size_t)flen); /* just after the longest region */
+    size_t total = 1060 + (size_t)flen;
+
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    for (size_t split = 0; split <= total; split += 3) {
+        g_callback_count = 0;
+        rcm_reset(p);
+        int n = rcm_feed(p, buf, split);
+        n += rcm_feed(p, buf + split, total - split);
+        ASSERT_EQ(n, 5);
+        ASSERT_EQ(g_callback_count, 5);
+    }
+
+    /* Byte at a time through the staging buffer */
+    g_callback_count = 0;
+    rcm_reset(p);
+    int n = 0;
+    for (size_t i = 0; i < total; i++)
+        n += rcm_feed(p, buf + i, 1);
+    ASSERT_EQ(n, 5);
+    ASSERT_EQ(g_callback_count, 5);
+    rcm_destroy(p);
+}
+
+/* ---- Batch output ---- */
+
+TEST(test_feed_batch_fills_entries) {
+    /* Three frames in one read go to the array, not the callback */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+
+    uint8_t buf[256];
+    size_t n = 0;
+    int flen = 0;
+    for (int i = 0; i < 3; i++) {
+        rc_payload[0] = (uint8_t)(0x10 << i); /* pause, gohome, shutter */
+        buf[n++] = 0xAA;
+        flen = rcm_build_packet(buf + n, sizeof(buf) - n,
+                                DUML_DEV_RC, 0, DUML_DEV_APP, 0, (uint16_t)(100 + i),
+                                DUML_PACK_REQUEST, DUML_ACK_NO_ACK, 0,
+                                DUML_CMD_SET_RC, DUML_CMD_RC_PUSH,
+                                rc_payload, sizeof(rc_payload));
+        ASSERT(flen > 0);
+        n += (size_t)flen;
+    }
+
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_batch_entry_t out[8];
+    ASSERT_EQ(rcm_feed_batch(p, buf, n, out, 8), 3);
+    ASSERT_EQ(g_callback_count, 0);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(out[i].seq, (uint32_t)(i + 1));
+        ASSERT_EQ(out[i].duml_seq, 100 + i);
+        ASSERT_EQ(out[i].offset, 1 + i * (flen + 1));
+    }
+    ASSERT(out[0].state.pause == true);
+    ASSERT(out[1].state.gohome == true);
+    ASSERT(out[2].state.shutter == true);
+    ASSERT(out[2].state.pause == false);
+    rcm_destroy(p);
+}
+
+TEST(test_feed_batch_straddled_offset_negative) {
+    /* A frame completed from the staging buffer reports where its SOF was,
+     * relative to the start of the current call's data */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_batch_entry_t out[4];
+    ASSERT_EQ(rcm_feed_batch(p, frame, 10, out, 4), 0);
+    ASSERT_EQ(rcm_feed_batch(p, frame + 10, (size_t)flen - 10, out, 4), 1);
+    ASSERT_EQ(out[0].offset, -10);
+    ASSERT_EQ(out[0].seq, 1);
+    rcm_destroy(p);
+}
+
+TEST(test_feed_batch_overflow_to_callback) {
+    /* Entries beyond max_out fall back to the callback, in order */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+
+    uint8_t buf[320];
+    for (int i = 0; i < 5; i++)
+        memcpy(buf + i * flen, frame, (size_t)flen);
+
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_batch_entry_t out[2];
+    ASSERT_EQ(rcm_feed_batch(p, buf, 5 * (size_t)flen, out, 2), 2);
+    ASSERT_EQ(g_callback_count, 3);
+    ASSERT_EQ(out[1].seq, 2);
+
+    /* NULL array: everything goes to the callback; plain rcm_feed unaffected */
+    ASSERT_EQ(rcm_feed_batch(p, buf, (size_t)flen, NULL, 4), 0);
+    ASSERT_EQ(g_callback_count, 4);
+    ASSERT_EQ(rcm_feed(p, buf, (size_t)flen), 1);
+    ASSERT_EQ(g_callback_count, 5);
+    ASSERT_EQ(rcm_feed_batch(NULL, buf, (size_t)flen, out, 2), 0);
+    ASSERT_EQ(rcm_feed_batch(p, NULL, 10, out, 2), 0);
+    rcm_destroy(p);
+}
+
+/* ---- Frame handlers ---- */
+
+static rcm_frame_view_t g_last_view;
+static int g_view_count = 0;
+
+static int test_view_handler(const rcm_frame_view_t *v, void *userdata) {
+    g_last_view = *v;
+    g_view_count++;
+    return userdata ? *(int *)userdata : 0;
+}
+
+TEST(test_handler_receives_ack_view) {
+    /* An ACK to the enable command reaches a registered handler with its
+     * header decoded and the payload pointing into the input buffer */
+    uint8_t ack_payload[] = { 0x00 };
+    uint8_t buf[64];
+    buf[0] = 0x11;
+    int flen = rcm_build_packet(buf + 1, sizeof(buf) - 1,
+                                DUML_DEV_RC, 2, DUML_DEV_PC, 1, 0x1234,
+                                DUML_PACK_RESPONSE, DUML_ACK_NO_ACK, 3,
+                                DUML_CMD_SET_RC, DUML_CMD_RC_ENABLE,
+                                ack_payload, sizeof(ack_payload));
+    ASSERT(flen > 0);
+
+    g_callback_count = 0;
+    g_view_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    ASSERT_EQ(rcm_register_handler(p, DUML_CMD_SET_RC, DUML_CMD_RC_ENABLE,
+                                   test_view_handler, NULL), 0);
+    ASSERT_EQ(rcm_feed(p, buf, (size_t)flen + 1), 0);
+    ASSERT_EQ(g_view_count, 1);
+    ASSERT_EQ(g_callback_count, 0);
+    ASSERT(g_last_view.frame == buf + 1);
+    ASSERT_EQ(g_last_view.frame_len, flen);
+    ASSERT_EQ(g_last_view.version, DUML_VERSION);
+    ASSERT_EQ(g_last_view.sender_type, DUML_DEV_RC);
+    ASSERT_EQ(g_last_view.sender_index, 2);
+    ASSERT_EQ(g_last_view.receiver_type, DUML_DEV_PC);
+    ASSERT_EQ(g_last_view.receiver_index, 1);
+    ASSERT_EQ(g_last_view.seq, 0x1234);
+    ASSERT_EQ(g_last_view.pack_type, DUML_PACK_RESPONSE);
+    ASSERT_EQ(g_last_view.ack_type, DUML_ACK_NO_ACK);
+    ASSERT_EQ(g_last_view.encrypt_type, 3);
+    ASSERT_EQ(g_last_view.cmd_set, DUML_CMD_SET_RC);
+    ASSERT_EQ(g_last_view.cmd_id, DUML_CMD_RC_ENABLE);
+    ASSERT(g_last_view.payload == buf + 1 + DUML_HEADER_LEN);
+    ASSERT_EQ(g_last_view.payload_len, 1);
+    ASSERT_EQ(g_last_view.stream_offset, 1);
+    rcm_destroy(p);
+}
+
+TEST(test_handler_override_and_unregister_rc_push) {
+    /* Replacing the RC push handler takes pushes away from the callback and
+     * the handler's return value becomes rcm_feed()'s count */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+
+    int ret = 7;
+    g_callback_count = 0;
+    g_view_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    ASSERT_EQ(rcm_register_handler(p, DUML_CMD_SET_RC, DUML_CMD_RC_PUSH,
+                                   test_view_handler, &ret), 0);
+    ASSERT_EQ(rcm_feed(p, frame, (size_t)flen), 7);
+    ASSERT_EQ(g_view_count, 1);
+    ASSERT_EQ(g_callback_count, 0);
+    ASSERT_EQ(g_last_view.payload_len, RC_PUSH_PAYLOAD_LEN);
+
+    ASSERT_EQ(rcm_register_handler(p, DUML_CMD_SET_RC, DUML_CMD_RC_PUSH, NULL, NULL), 0);
+    ASSERT_EQ(rcm_feed(p, frame, (size_t)flen), 0);
+    ASSERT_EQ(g_view_count, 1);
+    ASSERT_EQ(g_callback_count, 0);
+
+    ASSERT_EQ(rcm_register_handler(NULL, 0, 0, test_view_handler, NULL), -1);
+    rcm_destroy(p);
+}
+
+TEST(test_default_handler_gets_unclaimed_frames) {
+    /* Frames with no handler go to the default handler; RC pushes still
+     * reach the callback through the built-in handler */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t buf[128];
+    int n1 = build_rc_push_frame(buf, sizeof(buf), rc_payload);
+    ASSERT(n1 > 0);
+    int n2 = rcm_build_channel_request(buf + n1, sizeof(buf) - (size_t)n1, 9);
+    ASSERT(n2 > 0);
+
+    g_callback_count = 0;
+    g_view_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_default_handler(p, test_view_handler, NULL);
+    ASSERT_EQ(rcm_feed(p, buf, (size_t)(n1 + n2)), 1);
+    ASSERT_EQ(g_callback_count, 1);
+    ASSERT_EQ(g_view_count, 1);
+    ASSERT_EQ(g_last_view.cmd_id, DUML_CMD_RC_CHANNEL);
+    ASSERT_EQ(g_last_view.seq, 9);
+    ASSERT_EQ(g_last_view.stream_offset, (uint64_t)n1);
+
+    rcm_set_default_handler(p, NULL, NULL);
+    ASSERT_EQ(rcm_feed(p, buf + n1, (size_t)n2), 0);
+    ASSERT_EQ(g_view_count, 1);
+    rcm_set_default_handler(NULL, test_view_handler, NULL); /* no crash */
+    rcm_destroy(p);
+}
+
+/* ---- Change detection ---- */
+
+static int g_change_count = 0;
+static uint32_t g_last_changed = 0;
+
+static void test_change_callback(const rc_state_t *state, uint32_t changed, void *userdata) {
+    (void)userdata;
+    g_last_state = *state;
+    g_last_changed = changed;
+    g_change_count++;
+}
+
+/* Feed one RC push built from `payload`; returns rcm_feed()'s result */
+static int feed_push(rcm_parser_t *p, const uint8_t *payload) {
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), payload);
+    if (flen <= 0) return -1;
+    return rcm_feed(p, frame, (size_t)flen);
+}
+
+TEST(test_change_detect_suppresses_repeats) {
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+
+    g_change_count = 0;
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_change_detect(p, true, 0, test_change_callback);
+
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+    ASSERT_EQ(g_last_changed, RCM_CHANGED_ALL);
+    for (int i = 0; i < 10; i++)
+        ASSERT_EQ(feed_push(p, rc_payload), 0);
+    ASSERT_EQ(g_change_count, 1);
+
+    rc_payload[0] = 0x10; /* pause */
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+    ASSERT_EQ(g_last_changed, RCM_CHANGED_PAUSE);
+    ASSERT(g_last_state.pause == true);
+
+    rc_payload[1] = 0x10; /* 5D up */
+    rc_payload[2] = 0x02; /* tripod */
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+    ASSERT_EQ(g_last_changed, RCM_CHANGED_FIVE_D | RCM_CHANGED_FLIGHT_MODE);
+    ASSERT_EQ(g_callback_count, 0); /* change callback replaces the plain one */
+
+    /* A reset delivers the next push in full */
+    rcm_reset(p);
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+    ASSERT_EQ(g_last_changed, RCM_CHANGED_ALL);
+
+    /* Disabling delivers everything to the plain callback again */
+    rcm_set_change_detect(p, false, 0, NULL);
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+    ASSERT_EQ(g_callback_count, 2);
+    ASSERT_EQ(g_change_count, 4);
+    rcm_destroy(p);
+}
+
+TEST(test_change_detect_axis_deadband) {
+    /* Small moves are swallowed, but drift is measured from the last
+     * delivered value so it eventually fires */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+
+    g_change_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_change_detect(p, true, 10, test_change_callback);
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+
+    rc_payload[5] = 6; /* stick_right.horizontal = +6 */
+    ASSERT_EQ(feed_push(p, rc_payload), 0);
+    rc_payload[5] = 10;
+    ASSERT_EQ(feed_push(p, rc_payload), 0);
+    rc_payload[5] = 11;
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+    ASSERT_EQ(g_last_changed, RCM_CHANGED_STICK_RH);
+    ASSERT_EQ(g_last_state.stick_right.horizontal, 11);
+
+    /* Negative direction, on the left wheel */
+    rc_payload[13] = 0xF0; rc_payload[14] = 0x03; /* -16 */
+    ASSERT_EQ(feed_push(p, rc_payload), 1);
+    ASSERT_EQ(g_last_changed, RCM_CHANGED_LEFT_WHEEL);
+    ASSERT_EQ(g_change_count, 3);
+    rcm_destroy(p);
+}
+
+TEST(test_change_detect_wheel_delta_and_batch) {
+    /* A turning right wheel repeats identical packets with a non-zero delta;
+     * each one is a movement and must be delivered */
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    rc_payload[4] = (1 << 6) | (3 << 1); /* delta +3 */
+
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+    uint8_t buf[256];
+    for (int i = 0; i < 4; i++)
+        memcpy(buf + i * flen, frame, (size_t)flen);
+
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_change_detect(p, true, 0, NULL);
+    rcm_batch_entry_t out[8];
+    ASSERT_EQ(rcm_feed_batch(p, buf, 4 * (size_t)flen, out, 8), 4);
+    ASSERT_EQ(out[0].changed, RCM_CHANGED_ALL);
+    ASSERT_EQ(out[1].changed, RCM_CHANGED_WHEEL_DELTA);
+    ASSERT_EQ(out[3].state.right_wheel_delta, 3);
+
+    /* Wheel stops: one delivery for the delta returning to zero, then quiet */
+    rc_payload[4] = 0;
+    flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    for (int i = 0; i < 3; i++)
+        memcpy(buf + i * flen, frame, (size_t)flen);
+    ASSERT_EQ(rcm_feed_batch(p, buf, 3 * (size_t)flen, out, 8), 1);
+    ASSERT_EQ(out[0].changed, RCM_CHANGED_WHEEL_DELTA);
+    ASSERT_EQ(out[0].seq, 5);
+    rcm_destroy(p);
+}
+
+/* ---- Packed state ---- */
+
+TEST(test_packed_state_size) {
+    ASSERT_EQ(sizeof(rcm_packed_state_t), 16);
+    ASSERT(sizeof(rcm_packed_state_t) < sizeof(rc_state_t));
+}
+
+TEST(test_packed_matches_parse_payload) {
+    /* Packing the decoded state and decoding straight to packed agree, and
+     * unpacking restores the decoded state, for pseudo-random payloads */
+    uint32_t x = 0xC0FFEEu;
+    for (int iter = 0; iter < 2000; iter++) {
+        uint8_t payload[17];
+        for (int i = 0; i < 17; i++) {
+            x = x * 1103515245u + 12345u;
+            payload[i] = (uint8_t)(x >> 16);
+        }
+
+        rc_state_t st, back;
+        rcm_packed_state_t a, b;
+        ASSERT_EQ(rcm_parse_payload(payload, sizeof(payload), &st), 0);
+        ASSERT_EQ(rcm_parse_payload_packed(payload, sizeof(payload), &b), 0);
+        rcm_pack_state(&st, &a);
+        ASSERT(memcmp(&a, &b, sizeof(a)) == 0);
+
+        rcm_unpack_state(&a, &back);
+        ASSERT(memcmp(&st, &back, sizeof(st)) == 0);
+    }
+    rcm_packed_state_t ps;
+    uint8_t short_payload[16] = {0};
+    ASSERT_EQ(rcm_parse_payload_packed(short_payload, sizeof(short_payload), &ps), -1);
+    ASSERT_EQ(rcm_parse_payload_packed(NULL, 17, &ps), -1);
+}
+
+/* One payload of rcm_parse_payloads() output against the scalar decoder */
+static void assert_payload_row(const uint8_t *payload, const rcm_payload_columns_t *c,
+                               size_t i) {
+    rcm_packed_state_t s;
+    ASSERT_EQ(rcm_parse_payload_packed(payload, RC_PUSH_PAYLOAD_LEN, &s), 0);
+    ASSERT_EQ(c->flags[i], s.flags);
+    ASSERT_EQ(c->stick_right_h[i], s.stick_right_h);
+    ASSERT_EQ(c->stick_right_v[i], s.stick_right_v);
+    ASSERT_EQ(c->stick_left_h[i], s.stick_left_h);
+    ASSERT_EQ(c->stick_left_v[i], s.stick_left_v);
+    ASSERT_EQ(c->left_wheel[i], s.left_wheel);
+    ASSERT_EQ(c->right_wheel[i], s.right_wheel);
+    ASSERT_EQ(c->right_wheel_delta[i], s.right_wheel_delta);
+}
+
+TEST(test_parse_payloads_matches_scalar) {
+    enum { N = 67, STRIDE = 24 };
+    static uint8_t buf[N * STRIDE];
+    static int16_t rh[N], rv[N], lh[N], lv[N], lw[N], rw[N];
+    static int8_t delta[N];
+    static uint16_t flags[N];
+    rcm_payload_columns_t c = { rh, rv, lh, lv, lw, rw, delta, flags };
+
+    /* Every value of each bitfield byte, in both the vector and tail paths */
+    for (int byte = 0; byte < 5; byte++) {
+        for (int v = 0; v < 256; v += N) {
+            memset(buf, 0, sizeof(buf));
+            for (int i = 0; i < N; i++)
+                buf[i * RC_PUSH_PAYLOAD_LEN + byte] = (uint8_t)(v + i);
+            ASSERT_EQ(rcm_parse_payloads(buf, N, RC_PUSH_PAYLOAD_LEN, &c), 0);
+            for (int i = 0; i < N; i++)
+                assert_payload_row(buf + i * RC_PUSH_PAYLOAD_LEN, &c, (size_t)i);
+        }
+    }
+
+    /* Pseudo-random payloads, contiguous and strided, every batch length */
+    uint32_t x = 0xBADC0DEu;
+    for (int iter = 0; iter < 40; iter++) {
+        for (size_t i = 0; i < sizeof(buf); i++) {
+            x = x * 1103515245u + 12345u;
+            buf[i] = (uint8_t)(x >> 16);
+        }
+        size_t stride = iter & 1 ? STRIDE : RC_PUSH_PAYLOAD_LEN;
+        size_t n = (size_t)iter % 20 + (iter > 20 ? N - 20 : 0);
+        ASSERT_EQ(rcm_parse_payloads(buf, n, stride, &c), 0);
+        for (size_t i = 0; i < n; i++)
+            assert_payload_row(buf + i * stride, &c, i);
+    }
+
+    /* NULL columns are skipped */
+    memset(rh, 0x5A, sizeof(rh));
+    rcm_payload_columns_t only_flags = { 0 };
+    only_flags.flags = flags;
+    ASSERT_EQ(rcm_parse_payloads(buf, N, RC_PUSH_PAYLOAD_LEN, &only_flags), 0);
+    ASSERT_EQ((uint16_t)rh[N - 1], 0x5A5A);
+
+    ASSERT_EQ(rcm_parse_payloads(buf, 1, 16, &c), -1);
+    ASSERT_EQ(rcm_parse_payloads(NULL, 1, 17, &c), -1);
+    ASSERT_EQ(rcm_parse_payloads(buf, 1, 17, NULL), -1);
+    ASSERT_EQ(rcm_parse_payloads(NULL, 0, 17, &c), 0);
+}
+
+TEST(test_packed_accessors) {
+    uint8_t payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { payload[i] = 0x00; payload[i+1] = 0x04; }
+    payload[0] = 0x40;        /* shutter */
+    payload[1] = 0x80 | 0x08; /* 5D center + right */
+    payload[2] = 0x02;        /* tripod */
+
+    rcm_packed_state_t ps;
+    ASSERT_EQ(rcm_parse_payload_packed(payload, sizeof(payload), &ps), 0);
+    ASSERT(rcm_packed_pressed(&ps, RCM_PK_SHUTTER));
+    ASSERT(rcm_packed_pressed(&ps, RCM_PK_FIVE_D_CENTER | RCM_PK_FIVE_D_RIGHT));
+    ASSERT(!rcm_packed_pressed(&ps, RCM_PK_SHUTTER | RCM_PK_PAUSE));
+    ASSERT_EQ(rcm_packed_flight_mode(&ps), RC_MODE_TRIPOD);
+    ASSERT_EQ(ps.flags & ~(RCM_PK_BUTTON_MASK | RCM_PK_MODE_MASK), 0);
+    ASSERT_EQ(ps.reserved, 0);
+}
+
+TEST(test_feed_batch_packed) {
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    rc_payload[1] = 0x01; /* record */
+    rc_payload[9] = 0x10; /* stick_left.vertical = +16 */
+
+    uint8_t frame[64];
+    int flen = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(flen > 0);
+    uint8_t buf[128];
+    memcpy(buf, frame, (size_t)flen);
+    memcpy(buf + flen, frame, (size_t)flen);
+
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_packed_state_t out[1];
+    ASSERT_EQ(rcm_feed_batch_packed(p, buf, 2 * (size_t)flen, out, 1), 1);
+    ASSERT_EQ(g_callback_count, 1); /* overflow went to the callback */
+    ASSERT(rcm_packed_pressed(&out[0], RCM_PK_RECORD));
+    ASSERT_EQ(out[0].stick_left_v, 16);
+    ASSERT_EQ(rcm_feed_batch_packed(p, buf, (size_t)flen, NULL, 4), 0);
+    ASSERT_EQ(g_callback_count, 2);
+    rcm_destroy(p);
+}
+
+/* ---- Statistics ---- */
+
+/*
+ * Stream with one of each: garbage, a too-short length, a bad CRC8, an RC
+ * push, a non-RC frame and an RC push with a bad CRC16. Returns its length
+ * and the bytes that belong to valid frames.
+ */
+static size_t build_stats_stream(uint8_t *buf, size_t size, size_t *frame_bytes) {
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t ack[] = { 0x00 };
+    size_t n = 0;
+
+    memset(buf + n, 0xA5, 5);                      /* garbage, no SOF */
+    n += 5;
+    buf[n++] = 0x55; buf[n++] = 0x05; buf[n++] = 0x04; buf[n++] = 0x00;
+    write_false_header(buf + n, 28);               /* then break its CRC8 */
+    buf[n + 3] ^= 0x01;
+    n += 4;
+
+    int a = build_rc_push_frame(buf + n, size - n, rc_payload);
+    n += (size_t)a;
+    int b = rcm_build_packet(buf + n, size - n, DUML_DEV_RC, 0, DUML_DEV_APP, 0,
+                             0x0002, DUML_PACK_RESPONSE, DUML_ACK_NO_ACK, 0,
+                             DUML_CMD_SET_RC, DUML_CMD_RC_ENABLE, ack, sizeof(ack));
+    n += (size_t)b;
+    int c = build_rc_push_frame(buf + n, size - n, rc_payload);
+    buf[n + (size_t)c - 1] ^= 0xFF;
+    n += (size_t)c;
+
+    *frame_bytes = (size_t)(a + b);
+    return n;
+}
+
+TEST(test_stats_counts_each_outcome) {
+    uint8_t buf[256];
+    size_t frame_bytes;
+    size_t n = build_stats_stream(buf, sizeof(buf), &frame_bytes);
+
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_stats_t st;
+    ASSERT_EQ(rcm_get_stats(p, &st), 0);
+    ASSERT_EQ(st.bytes_in, 0);
+    ASSERT_EQ(st.last_push_age_ns, UINT64_MAX);
+
+    ASSERT_EQ(rcm_feed(p, buf, n), 1);
+    ASSERT_EQ(rcm_get_stats(p, &st), 0);
+    ASSERT_EQ(st.bytes_in, n);
+    ASSERT_EQ(st.frames, 2);
+    ASSERT_EQ(st.frames_by_cmd_set[DUML_CMD_SET_RC], 2);
+    ASSERT_EQ(st.length_errors, 1);
+    ASSERT_EQ(st.crc8_failures, 1);
+    ASSERT_EQ(st.crc16_failures, 1);
+    ASSERT_EQ(st.rc_pushes, 1);
+    ASSERT_EQ(st.batch_overflows, 0);
+    ASSERT_EQ(st.bytes_discarded, n - frame_bytes);
+    ASSERT(st.last_push_age_ns < UINT64_MAX);
+
+    ASSERT_EQ(rcm_get_stats(NULL, &st), -1);
+    ASSERT_EQ(rcm_get_stats(p, NULL), -1);
+    rcm_destroy(p);
+}
+
+TEST(test_stats_independent_of_chunking) {
+    uint8_t buf[256];
+    size_t frame_bytes;
+    size_t n = build_stats_stream(buf, sizeof(buf), &frame_bytes);
+
+    rcm_parser_t *whole = rcm_create(test_callback, NULL);
+    rcm_parser_t *bytes = rcm_create(test_callback, NULL);
+    rcm_feed(whole, buf, n);
+    for (size_t i = 0; i < n; i++)
+        rcm_feed(bytes, buf + i, 1);
+
+    rcm_stats_t a, b;
+    rcm_get_stats(whole, &a);
+    rcm_get_stats(bytes, &b);
+    ASSERT_EQ(a.bytes_discarded, b.bytes_discarded);
+    ASSERT_EQ(a.frames, b.frames);
+    ASSERT_EQ(a.crc8_failures, b.crc8_failures);
+    ASSERT_EQ(a.crc16_failures, b.crc16_failures);
+    ASSERT_EQ(a.length_errors, b.length_errors);
+    ASSERT(memcmp(a.frames_by_cmd_set, b.frames_by_cmd_set,
+                  sizeof(a.frames_by_cmd_set)) == 0);
+
+    uint64_t calls = 0;
+    for (int i = 0; i < RCM_FEED_HIST_BUCKETS; i++)
+        calls += b.feed_hist[i];
+#ifdef RCM_FEED_HISTOGRAM
+    ASSERT(b.feed_hist_enabled);
+    ASSERT_EQ(calls, n);
+#else
+    ASSERT(!b.feed_hist_enabled);
+    ASSERT_EQ(calls, 0);
+#endif
+    rcm_destroy(whole);
+    rcm_destroy(bytes);
+}
+
+TEST(test_stats_reset_and_overflow) {
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t buf[128];
+    int flen = build_rc_push_frame(buf, sizeof(buf), rc_payload);
+    ASSERT(flen > 0);
+    memcpy(buf + flen, buf, (size_t)flen);
+
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_batch_entry_t out[1];
+    ASSERT_EQ(rcm_feed_batch(p, buf, 2 * (size_t)flen, out, 1), 1);
+
+    rcm_stats_t st;
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.rc_pushes, 2);
+    ASSERT_EQ(st.batch_overflows, 1);
+
+    /* Staged bytes dropped by rcm_reset() count as discarded */
+    rcm_reset_stats(p);
+    rcm_feed(p, buf, 10);
+    rcm_reset(p);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.bytes_in, 10);
+    ASSERT_EQ(st.bytes_discarded, 10);
+    ASSERT_EQ(st.rc_pushes, 0);
+    ASSERT_EQ(st.batch_overflows, 0);
+    ASSERT(st.last_push_age_ns < UINT64_MAX); /* survives rcm_reset_stats() */
+    rcm_destroy(p);
+}
+
+/* ---- Header layout lock-in ---- */
+
+/*
+ * RC push with cmd_set/cmd_id moved one byte later than v1 (bytes 10-11),
+ * as some v2/v3 headers have it: the v1 slots carry cmd_set 0x00.
+ */
+static int build_alt_push_frame(uint8_t *out, size_t out_size, const uint8_t *rc_payload) {
+    uint8_t body[1 + RC_PUSH_PAYLOAD_LEN];
+    body[0] = DUML_CMD_RC_PUSH;
+    memcpy(body + 1, rc_payload, RC_PUSH_PAYLOAD_LEN);
+    return rcm_build_packet(out, out_size, DUML_DEV_RC, 0, DUML_DEV_APP, 0, 0x0001,
+                            DUML_PACK_REQUEST, DUML_ACK_NO_ACK, 0,
+                            0x00, DUML_CMD_SET_RC, body, sizeof(body));
+}
+
+TEST(test_layout_lock_and_fallback) {
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t v1[64], alt[64];
+    int v1_len = build_rc_push_frame(v1, sizeof(v1), rc_payload);
+    int alt_len = build_alt_push_frame(alt, sizeof(alt), rc_payload);
+    ASSERT(v1_len > 0 && alt_len > 0);
+
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_stats_t st;
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_NONE);
+    ASSERT_EQ(st.layout_cmd_offset, 0);
+
+    /* Scanning: the alt layout decodes, and a layout switch restarts the count */
+    rcm_set_layout_lock(p, 3, 2);
+    ASSERT_EQ(rcm_feed(p, alt, (size_t)alt_len), 1);
+    ASSERT_EQ(rcm_feed(p, v1, (size_t)v1_len), 1);
+    ASSERT_EQ(rcm_feed(p, v1, (size_t)v1_len), 1);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_NONE);
+    ASSERT_EQ(rcm_feed(p, v1, (size_t)v1_len), 1);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_V1);
+    ASSERT_EQ(st.layout_cmd_offset, 9);
+    ASSERT_EQ(st.layout_locks, 1);
+
+    /* Locked on v1: the alt push is a miss, and the second one drops the lock */
+    ASSERT_EQ(rcm_feed(p, alt, (size_t)alt_len), 0);
+    ASSERT_EQ(rcm_feed(p, v1, (size_t)v1_len), 1);   /* hit resets the misses */
+    ASSERT_EQ(rcm_feed(p, alt, (size_t)alt_len), 0);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_V1);
+    ASSERT_EQ(rcm_feed(p, alt, (size_t)alt_len), 0);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_NONE);
+    ASSERT_EQ(st.layout_fallbacks, 1);
+
+    /* Back to scanning, then locked on the alt offset */
+    for (int i = 0; i < 3; i++)
+        ASSERT_EQ(rcm_feed(p, alt, (size_t)alt_len), 1);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_ALT);
+    ASSERT_EQ(st.layout_cmd_offset, 10);
+    ASSERT_EQ(st.layout_locks, 2);
+    ASSERT_EQ(rcm_feed(p, v1, (size_t)v1_len), 1);   /* claimed by the handler */
+
+    /* The lock is state, not a counter; rcm_reset() drops it */
+    rcm_reset_stats(p);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_ALT);
+    ASSERT_EQ(st.layout_locks, 0);
+    rcm_reset(p);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_NONE);
+
+    /* confirm_frames 0 never locks */
+    rcm_set_layout_lock(p, 0, 0);
+    for (int i = 0; i < 20; i++)
+        ASSERT_EQ(rcm_feed(p, v1, (size_t)v1_len), 1);
+    ASSERT_EQ(rcm_feed(p, alt, (size_t)alt_len), 1);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.layout, RCM_LAYOUT_NONE);
+    rcm_set_layout_lock(NULL, 1, 1);
+    rcm_destroy(p);
+}
+
+/* ---- Latency tracing ---- */
+
+#define TRACE_MAX 32
+
+typedef struct {
+    unsigned n;
+    unsigned ev[TRACE_MAX];
+    uint64_t t[TRACE_MAX];
+    uint64_t arg[TRACE_MAX];
+    unsigned at_callback;   /* events recorded when the state callback ran */
+} trace_log_t;
+
+static void trace_record(unsigned event, uint64_t t_ns, uint64_t arg, void *userdata) {
+    trace_log_t *log = (trace_log_t *)userdata;
+    if (log->n < TRACE_MAX) {
+        log->ev[log->n] = event;
+        log->t[log->n] = t_ns;
+        log->arg[log->n] = arg;
+    }
+    log->n++;
+}
+
+static void trace_callback(const rc_state_t *state, void *userdata) {
+    trace_log_t *log = (trace_log_t *)userdata;
+    log->at_callback = log->n;
+    (void)state;
+}
+
+TEST(test_trace_hook_events) {
+    uint8_t rc_payload[17] = {0};
+    for (int i = 5; i < 17; i += 2) { rc_payload[i] = 0x00; rc_payload[i+1] = 0x04; }
+    uint8_t frame[64];
+    int len = build_rc_push_frame(frame, sizeof(frame), rc_payload);
+    ASSERT(len > 10);
+
+    trace_log_t log;
+    memset(&log, 0, sizeof(log));
+    rcm_parser_t *p = rcm_create(trace_callback, &log);
+
+    /* No hook: nothing is reported */
+    rcm_trace_read(p, 0);
+    ASSERT_EQ(rcm_feed(p, frame, (size_t)len), 1);
+    ASSERT_EQ(log.n, 0);
+
+    /* A push split over two feeds, after a stamped read */
+    rcm_set_trace_hook(p, trace_record, &log);
+    rcm_trace_read(p, 1234);
+    ASSERT_EQ(rcm_feed(p, frame, 10), 0);
+    ASSERT_EQ(rcm_feed(p, frame + 10, (size_t)len - 10), 1);
+    ASSERT_EQ(log.n, 7);
+    static const unsigned want[7] = {
+        RCM_TRACE_READ, RCM_TRACE_FEED_BEGIN, RCM_TRACE_FEED_END,
+        RCM_TRACE_FEED_BEGIN, RCM_TRACE_FRAME, RCM_TRACE_CALLBACK_END,
+        RCM_TRACE_FEED_END,
+    };
+    for (int i = 0; i < 7; i++)
+        ASSERT_EQ(log.ev[i], want[i]);
+    ASSERT_EQ(log.t[0], 1234);
+    ASSERT_EQ(log.arg[1], 10);
+    ASSERT_EQ(log.arg[2], 0);
+    ASSERT_EQ(log.arg[3], (uint64_t)len - 10);
+    ASSERT_EQ(log.arg[4], (uint64_t)len);   /* SOF of the second frame fed */
+    ASSERT_EQ(log.arg[5], 2);               /* second push */
+    ASSERT_EQ(log.arg[6], 1);
+    for (int i = 2; i < 7; i++)
+        ASSERT(log.t[i] >= log.t[i - 1] && log.t[i] != 0);
+    ASSERT_EQ(log.at_callback, 5);          /* between FRAME and CALLBACK_END */
+
+    /* Suppressed by change detection: FRAME without CALLBACK_END */
+    rcm_set_change_detect(p, true, 0, NULL);
+    ASSERT_EQ(rcm_feed(p, frame, (size_t)len), 1);
+    log.n = 0;
+    ASSERT_EQ(rcm_feed(p, frame, (size_t)len), 0);
+    ASSERT_EQ(log.n, 3);
+    ASSERT_EQ(log.ev[1], RCM_TRACE_FRAME);
+    ASSERT_EQ(log.ev[2], RCM_TRACE_FEED_END);
+    rcm_set_change_detect(p, false, 0, NULL);
+
+    /* Direct payloads and batch entries are traced too */
+    log.n = 0;
+    ASSERT_EQ(rcm_feed_payload(p, rc_payload, sizeof(rc_payload)), 1);
+    ASSERT_EQ(log.n, 4);
+    ASSERT_EQ(log.ev[0], RCM_TRACE_FEED_BEGIN);
+    ASSERT_EQ(log.arg[0], 17);
+    ASSERT_EQ(log.ev[2], RCM_TRACE_CALLBACK_END);
+    ASSERT_EQ(log.ev[3], RCM_TRACE_FEED_END);
+    ASSERT_EQ(log.arg[3], 1);
+
+    uint8_t two[128];
+    memcpy(two, frame, (size_t)len);
+    memcpy(two + len, frame, (size_t)len);
+    rcm_batch_entry_t out[2];
+    log.n = 0;
+    ASSERT_EQ(rcm_feed_batch(p, two, 2 * (size_t)len, out, 2), 2);
+    ASSERT_EQ(log.n, 6);
+    ASSERT_EQ(log.ev[2], RCM_TRACE_CALLBACK_END);
+    ASSERT_EQ(log.arg[2], out[0].seq);
+    ASSERT_EQ(log.ev[4], RCM_TRACE_CALLBACK_END);
+    ASSERT_EQ(log.arg[4], out[1].seq);
+
+    /* Removing the hook stops the events; NULL parsers are ignored */
+    rcm_set_trace_hook(p, NULL, NULL);
+    log.n = 0;
+    rcm_trace_read(p, 0);
+    ASSERT_EQ(rcm_feed(p, frame, (size_t)len), 1);
+    ASSERT_EQ(log.n, 0);
+    rcm_set_trace_hook(NULL, trace_record, &log);
+    rcm_trace_read(NULL, 0);
+    rcm_destroy(p);
+}
+
+/* ---- Latest-state mailbox ---- */
+
+/* RC push payload with all six axes set to `v` */
+static void fill_axes(uint8_t *payload, int v) {
+    memset(payload, 0, RC_PUSH_PAYLOAD_LEN);
+    for (int i = 5; i < 17; i += 2) {
+        uint16_t raw = (uint16_t)(0x400 + v);
+        payload[i] = (uint8_t)(raw & 0xFF);
+        payload[i+1] = (uint8_t)(raw >> 8);
+    }
+}
+
+TEST(test_snapshot_latest_state) {
+    uint8_t payload[17];
+    rc_state_t st;
+    uint32_t seq = 0;
+
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    ASSERT_EQ(rcm_snapshot(p, &st, &seq), -1);
+    ASSERT_EQ(rcm_snapshot(NULL, &st, &seq), -1);
+    ASSERT_EQ(rcm_snapshot(p, NULL, &seq), -1);
+
+    fill_axes(payload, 100);
+    payload[0] = 0x40; /* shutter */
+    ASSERT_EQ(feed_push(p, payload), 1);
+    ASSERT_EQ(rcm_snapshot(p, &st, &seq), 0);
+    ASSERT_EQ(seq, 1);
+    ASSERT(st.shutter);
+    ASSERT_EQ(st.stick_left.vertical, 100);
+
+    fill_axes(payload, -200);
+    ASSERT_EQ(feed_push(p, payload), 1);
+    rcm_packed_state_t ps;
+    ASSERT_EQ(rcm_snapshot_packed(p, &ps, NULL), 0);
+    ASSERT_EQ(ps.stick_right_h, -200);
+    ASSERT(!rcm_packed_pressed(&ps, RCM_PK_SHUTTER));
+    rcm_destroy(p);
+}
+
+TEST(test_snapshot_ignores_change_suppression) {
+    uint8_t payload[17];
+    rc_state_t st;
+    uint32_t seq = 0;
+
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_change_detect(p, true, 10, NULL);
+    fill_axes(payload, 0);
+    ASSERT_EQ(feed_push(p, payload), 1);
+
+    /* Within the deadband: callback suppressed, mailbox still updated */
+    fill_axes(payload, 5);
+    ASSERT_EQ(feed_push(p, payload), 0);
+    ASSERT_EQ(rcm_snapshot(p, &st, &seq), 0);
+    ASSERT_EQ(seq, 2);
+    ASSERT_EQ(st.right_wheel, 5);
+
+    /* Byte-identical repeat is not republished */
+    ASSERT_EQ(feed_push(p, payload), 0);
+    ASSERT_EQ(rcm_snapshot(p, &st, &seq), 0);
+    ASSERT_EQ(seq, 2);
+    rcm_destroy(p);
+}
+
+typedef struct {
+    rcm_parser_t *p;
+    atomic_bool  *done;
+    int           torn;
+    int           backwards;
+    long          reads;
+} snapshot_reader_t;
+
+static void *snapshot_reader(void *arg) {
+    snapshot_reader_t *r = (snapshot_reader_t *)arg;
+    uint32_t last = 0;
+    while (!atomic_load(r->done)) {
+        rcm_packed_state_t ps;
+        uint32_t seq;
+        if (rcm_snapshot_packed(r->p, &ps, &seq) != 0)
+            continue;
+        if (ps.stick_right_h != ps.stick_right_v ||
+            ps.stick_right_h != ps.stick_left_h ||
+            ps.stick_right_h != ps.stick_left_v ||
+            ps.stick_right_h != ps.left_wheel ||
+            ps.stick_right_h != ps.right_wheel)
+            r->torn++;
+        if (seq < last)
+            r->backwards++;
+        last = seq;
+        r->reads++;
+    }
+    return NULL;
+}
+
+TEST(test_snapshot_concurrent_readers) {
+    /* Readers must never see a mix of two publishes */
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    atomic_bool done = false;
+    snapshot_reader_t readers[2];
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        readers[i] = (snapshot_reader_t){ p, &done, 0, 0, 0 };
+        ASSERT_EQ(pthread_create(&threads[i], NULL, snapshot_reader, &readers[i]), 0);
+    }
+
+    uint8_t payload[17];
+    for (int i = 0; i < 50000; i++) {
+        fill_axes(payload, (i % 1321) - 660);
+        feed_push(p, payload);
+    }
+    atomic_store(&done, true);
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+        ASSERT_EQ(readers[i].torn, 0);
+        ASSERT_EQ(readers[i].backwards, 0);
+    }
+
+    uint32_t seq;
+    rcm_packed_state_t ps;
+    ASSERT_EQ(rcm_snapshot_packed(p, &ps, &seq), 0);
+    ASSERT_EQ(seq, 50000);
+    rcm_destroy(p);
+}
+
+/* ---- Coalesced delivery ---- */
+
+TEST(test_coalesced_take) {
+    uint8_t payload[17];
+    rcm_packed_state_t out;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+
+    /* Nothing published yet, and coalescing off: plain latest state */
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 0);
+    fill_axes(payload, 10);
+    payload[0] = 0x40;                     /* shutter down */
+    ASSERT_EQ(feed_push(p, payload), 1);
+    payload[0] = 0;
+    ASSERT_EQ(feed_push(p, payload), 1);
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 2);
+    ASSERT_EQ(out.flags & RCM_PK_SHUTTER, 0);
+
+    /* A tap between two ticks survives; axes are latest-wins */
+    rcm_set_coalesce(p, true);
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 0);   /* enabling marks all as taken */
+    fill_axes(payload, 100);
+    payload[0] = 0x40;
+    ASSERT_EQ(feed_push(p, payload), 1);
+    fill_axes(payload, -200);
+    payload[2] = 0x01;                     /* flight mode 1 */
+    ASSERT_EQ(feed_push(p, payload), 1);
+    memset(&out, 0xAA, sizeof(out));
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 2);
+    ASSERT(rcm_packed_pressed(&out, RCM_PK_SHUTTER));
+    ASSERT_EQ(rcm_packed_flight_mode(&out), 1);
+    ASSERT_EQ(out.stick_right_h, -200);
+    ASSERT_EQ(out.left_wheel, -200);
+    ASSERT_EQ(out.right_wheel_delta, 0);
+
+    /* Released since: the next tick shows it up; no new push, no take */
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 0);
+    ASSERT(rcm_packed_pressed(&out, RCM_PK_SHUTTER));   /* untouched */
+    fill_axes(payload, 0);
+    ASSERT_EQ(feed_push(p, payload), 1);
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 1);
+    ASSERT_EQ(out.flags & RCM_PK_BUTTON_MASK, 0);
+
+    /* Wheel deltas add up across pushes and saturate */
+    for (int i = 0; i < 3; i++) {
+        payload[4] = (uint8_t)((5 << 1) | 0x40);   /* +5 (sign bit set = positive) */
+        ASSERT_EQ(feed_push(p, payload), 1);
+    }
+    payload[4] = (uint8_t)(2 << 1);                 /* -2 */
+    ASSERT_EQ(feed_push(p, payload), 1);
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 4);
+    ASSERT_EQ(out.right_wheel_delta, 13);
+    payload[4] = (uint8_t)((31 << 1) | 0x40);
+    for (int i = 0; i < 6; i++)
+        ASSERT_EQ(feed_push(p, payload), 1);
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 6);
+    ASSERT_EQ(out.right_wheel_delta, 127);
+
+    /* Disabling stops the accumulation */
+    rcm_set_coalesce(p, false);
+    payload[4] = 0;
+    payload[0] = 0x10;                     /* pause */
+    ASSERT_EQ(feed_push(p, payload), 1);
+    payload[0] = 0;
+    ASSERT_EQ(feed_push(p, payload), 1);
+    ASSERT_EQ(rcm_take_coalesced(p, &out), 2);
+    ASSERT_EQ(out.flags & RCM_PK_BUTTON_MASK, 0);
+
+    ASSERT_EQ(rcm_take_coalesced(NULL, &out), -1);
+    ASSERT_EQ(rcm_take_coalesced(p, NULL), -1);
+    rcm_set_coalesce(NULL, true);
+    rcm_destroy(p);
+}
+
+/* ---- Motion history ---- */
+
+static rcm_packed_state_t hist_sample(int v, uint16_t flags, int8_t wheel) {
+    rcm_packed_state_t ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.flags = flags;
+    ps.stick_right_h = (int16_t)(10 * v);
+    ps.stick_right_v = (int16_t)-v;
+    ps.stick_left_h = ps.stick_left_v = ps.left_wheel = ps.right_wheel = (int16_t)v;
+    ps.right_wheel_delta = wheel;
+    return ps;
+}
+
+TEST(test_history_window_stats) {
+    const uint64_t ms = 1000000;
+    rcm_history_t *h = rcm_history_create(20, 100 * ms);
+    ASSERT(h != NULL);
+    rcm_history_stats_t st;
+    ASSERT_EQ(rcm_history_query(h, &st), -1);
+    ASSERT_EQ(rcm_history_pressed_within(h, RCM_PK_BUTTON_MASK, 100), 0);
+
+    /* One sample every 10 ms; shutter tapped at sample 3 */
+    for (int i = 0; i <= 14; i++) {
+        rcm_packed_state_t ps = hist_sample(i, i == 3 ? RCM_PK_SHUTTER : 0, i == 7 ? 3 : 0);
+        rcm_history_push(h, &ps, (uint64_t)i * 10 * ms);
+    }
+    /* Window at 140 ms: samples 5..14 (sample 4 is exactly 100 ms old) */
+    ASSERT_EQ(rcm_history_query(h, &st), 0);
+    ASSERT_EQ(st.samples, 15u);
+    ASSERT_EQ(st.count, 10u);
+    ASSERT_EQ(st.t_ns, 140 * ms);
+    ASSERT_EQ(st.span_ns, 90 * ms);
+    ASSERT_EQ(st.mean_q8[RCM_HIST_STICK_RIGHT_H], 95 * 256);
+    ASSERT_EQ(st.mean_q8[RCM_HIST_STICK_RIGHT_V], -(19 * 128));
+    ASSERT_EQ(st.velocity[RCM_HIST_STICK_RIGHT_H], 1000);
+    ASSERT_EQ(st.velocity[RCM_HIST_STICK_RIGHT_V], -100);
+    ASSERT_EQ(st.min[RCM_HIST_STICK_RIGHT_H], 50);
+    ASSERT_EQ(st.max[RCM_HIST_STICK_RIGHT_H], 140);
+    ASSERT_EQ(st.min[RCM_HIST_STICK_RIGHT_V], -14);
+    ASSERT_EQ(st.max[RCM_HIST_RIGHT_WHEEL], 14);
+    ASSERT_EQ(st.latest.stick_right_h, 140);
+    ASSERT_EQ(st.wheel_delta, 3);
+    ASSERT_EQ(st.pressed, 0);                  /* press and release left the window */
+    ASSERT_EQ(st.released, 0);
+
+    /* The press edge is still remembered by sample count */
+    ASSERT_EQ(rcm_history_pressed_within(h, RCM_PK_SHUTTER, 12), RCM_PK_SHUTTER);
+    ASSERT_EQ(rcm_history_pressed_within(h, RCM_PK_SHUTTER, 11), 0);
+    ASSERT_EQ(rcm_history_pressed_within(h, RCM_PK_PAUSE, 100), 0);
+
+    /* A dip, then a press held: min follows, edges show up */
+    rcm_packed_state_t dip = hist_sample(-3, RCM_PK_PAUSE, 0);
+    rcm_history_push(h, &dip, 150 * ms);
+    rcm_packed_state_t held = hist_sample(20, RCM_PK_PAUSE, 0);
+    rcm_history_push(h, &held, 160 * ms);
+    ASSERT_EQ(rcm_history_query(h, &st), 0);
+    ASSERT_EQ(st.count, 10u);
+    ASSERT_EQ(st.min[RCM_HIST_STICK_RIGHT_H], -30);
+    ASSERT_EQ(st.max[RCM_HIST_STICK_RIGHT_H], 200);
+    ASSERT_EQ(st.pressed, RCM_PK_PAUSE);
+    ASSERT_EQ(st.wheel_delta, 3);              /* sample 7 is 90 ms old */
+    ASSERT_EQ(rcm_history_pressed_within(h, RCM_PK_PAUSE | RCM_PK_SHUTTER, 2), RCM_PK_PAUSE);
+    ASSERT_EQ(rcm_history_pressed_within(h, RCM_PK_PAUSE, 1), 0);
+
+    /* The dip stays the minimum until it ages out, 100 ms later */
+    for (int i = 0; i < 8; i++) {
+        rcm_packed_state_t ps = hist_sample(30, 0, 0);
+        rcm_history_push(h, &ps, (uint64_t)(170 + 10 * i) * ms);
+    }
+    ASSERT_EQ(rcm_history_query(h, &st), 0);
+    ASSERT_EQ(st.min[RCM_HIST_STICK_RIGHT_H], -30);
+    ASSERT_EQ(st.wheel_delta, 0);
+    ASSERT_EQ(st.released, RCM_PK_PAUSE);
+    rcm_packed_state_t ps = hist_sample(30, 0, 0);
+    rcm_history_push(h, &ps, 250 * ms);
+    ASSERT_EQ(rcm_history_query(h, &st), 0);
+    ASSERT_EQ(st.min[RCM_HIST_STICK_RIGHT_H], 200);
+    ASSERT_EQ(st.pressed, 0);
+
+    rcm_history_clear(h);
+    ASSERT_EQ(rcm_history_query(h, &st), -1);
+    ASSERT_EQ(rcm_history_pressed_within(h, RCM_PK_PAUSE, 100), 0);
+    rcm_history_destroy(h);
+
+    /* No time window: the last `capacity` samples, at any spacing */
+    h = rcm_history_create(16, 0);
+    for (int i = 0; i < 40; i++) {
+        ps = hist_sample(i, 0, 1);
+        rcm_history_push(h, &ps, 0);
+    }
+    ASSERT_EQ(rcm_history_query(h, &st), 0);
+    ASSERT_EQ(st.count, 16u);
+    ASSERT_EQ(st.min[RCM_HIST_LEFT_WHEEL], 24);
+    ASSERT_EQ(st.mean_q8[RCM_HIST_LEFT_WHEEL], (24 + 39) * 128);
+    ASSERT_EQ(st.velocity[RCM_HIST_LEFT_WHEEL], 0);      /* no span */
+    ASSERT_EQ(st.wheel_delta, 16);
+
+    ASSERT_EQ(rcm_history_query(NULL, &st), -1);
+    ASSERT_EQ(rcm_history_query(h, NULL), -1);
+    ASSERT_EQ(rcm_history_pressed_within(NULL, RCM_PK_PAUSE, 1), 0);
+    rcm_history_push(NULL, &ps, 0);
+    rcm_history_destroy(h);
+    rcm_history_destroy(NULL);
+}
+
+TEST(test_history_attached_to_parser) {
+    uint8_t payload[17];
+    rcm_history_stats_t st;
+    rcm_history_t *h = rcm_history_create(64, 0);
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_change_detect(p, true, 0, NULL);
+    rcm_set_history(p, h);
+
+    /* Repeats are recorded even though the callback skips them */
+    fill_axes(payload, 50);
+    for (int i = 0; i < 5; i++)
+        feed_push(p, payload);
+    ASSERT_EQ(g_callback_count, 1);
+    ASSERT_EQ(rcm_history_query(h, &st), 0);
+    ASSERT_EQ(st.count, 5u);
+    ASSERT_EQ(st.mean_q8[RCM_HIST_STICK_LEFT_V], 50 * 256);
+    ASSERT(st.t_ns != 0 && st.span_ns > 0);
+
+    fill_axes(payload, -50);
+    payload[0] = 0x40;                         /* shutter */
+    feed_push(p, payload);
+    ASSERT_EQ(rcm_history_query(h, &st), 0);
+    ASSERT_EQ(st.count, 6u);
+    ASSERT_EQ(st.min[RCM_HIST_STICK_RIGHT_H], -50);
+    ASSERT_EQ(st.max[RCM_HIST_STICK_RIGHT_H], 50);
+    ASSERT_EQ(st.pressed, RCM_PK_SHUTTER);
+    ASSERT_EQ(rcm_history_pressed_within(h, RCM_PK_SHUTTER, 1), RCM_PK_SHUTTER);
+
+    /* Detached: no more samples */
+    rcm_set_history(p, NULL);
+    feed_push(p, payload);
+    ASSERT_EQ(rcm_history_query(h, &st), 0);
+    ASSERT_EQ(st.samples, 6u);
+    rcm_set_history(NULL, h);
+
+    rcm_destroy(p);
+    rcm_history_destroy(h);
+}
+
+/* ---- Transmit queue ---- */
+
+typedef struct {
+    int      frames;
+    uint16_t seq[8];
+    uint8_t  cmd_id[8];
+} tx_seen_t;
+
+static int tx_record(const rcm_frame_view_t *v, void *userdata) {
+    tx_seen_t *seen = (tx_seen_t *)userdata;
+    if (seen->frames < 8) {
+        seen->seq[seen->frames] = v->seq;
+        seen->cmd_id[seen->frames] = v->cmd_id;
+    }
+    seen->frames++;
+    return 0;
+}
+
+TEST(test_tx_templates_match_builder) {
+    uint8_t want[DUML_MAX_FRAME_LEN], got[DUML_MAX_FRAME_LEN];
+    const uint8_t one = 0x01;
+    rcm_tx_template_t en, ch, big;
+    rcm_tx_template_enable(&en);
+    rcm_tx_template_channel_request(&ch);
+
+    static const uint16_t seqs[] = { 0, 1, 0x00FF, 0x1234, 0xFFFF };
+    for (size_t i = 0; i < sizeof(seqs) / sizeof(seqs[0]); i++) {
+        int n = rcm_build_enable_cmd(want, sizeof(want), seqs[i]);
+        ASSERT_EQ(rcm_tx_write(&en, got, sizeof(got), seqs[i], &one), n);
+        ASSERT(memcmp(want, got, (size_t)n) == 0);
+        n = rcm_build_channel_request(want, sizeof(want), seqs[i]);
+        ASSERT_EQ(rcm_tx_write(&ch, got, sizeof(got), seqs[i], NULL), n);
+        ASSERT(memcmp(want, got, (size_t)n) == 0);
+    }
+
+    /* Arbitrary fields and a long payload */
+    uint8_t payload[300];
+    for (size_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t)(i * 7 + 3);
+    ASSERT_EQ(rcm_tx_template_init(&big, DUML_DEV_APP, 2, DUML_DEV_RC, 1,
+                                   DUML_PACK_RESPONSE, DUML_ACK_NO_ACK, 3,
+                                   0x42, 0x17, sizeof(payload)), 0);
+    int n = rcm_build_packet(want, sizeof(want), DUML_DEV_APP, 2, DUML_DEV_RC, 1, 0xBEEF,
+                             DUML_PACK_RESPONSE, DUML_ACK_NO_ACK, 3, 0x42, 0x17,
+                             payload, sizeof(payload));
+    ASSERT_EQ((size_t)n, rcm_tx_frame_len(&big));
+    ASSERT_EQ(rcm_tx_write(&big, got, sizeof(got), 0xBEEF, payload), n);
+    ASSERT(memcmp(want, got, (size_t)n) == 0);
+
+    /* Errors */
+    ASSERT_EQ(rcm_tx_write(&big, got, (size_t)n - 1, 0, payload), -1);
+    ASSERT_EQ(rcm_tx_write(&big, got, sizeof(got), 0, NULL), -1);
+    ASSERT_EQ(rcm_tx_write(NULL, got, sizeof(got), 0, NULL), -1);
+    ASSERT_EQ(rcm_tx_template_init(&big, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                   DUML_MAX_FRAME_LEN - DUML_HEADER_LEN - DUML_FOOTER_LEN + 1), -1);
+    ASSERT_EQ(rcm_tx_template_init(NULL, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0), -1);
+}
+
+TEST(test_tx_queue_batches_frames) {
+    const uint8_t one = 0x01;
+    rcm_tx_template_t en, ch;
+    rcm_tx_template_enable(&en);
+    rcm_tx_template_channel_request(&ch);
+
+    /* A handshake plus a poll burst in one buffer, seqs wrapping */
+    rcm_tx_queue_t q;
+    rcm_tx_init(&q, 0xFFFE);
+    size_t len = 0;
+    const uint8_t *f = rcm_tx_push(&q, &en, &one, &len);
+    ASSERT(f == q.buf && len == 14);
+    for (int i = 0; i < 3; i++)
+        ASSERT(rcm_tx_push(&q, &ch, NULL, NULL) != NULL);
+    ASSERT_EQ(q.count, 4);
+    ASSERT_EQ(q.len, 14 + 3 * 13);
+    ASSERT_EQ(q.seq, 2);
+
+    tx_seen_t seen;
+    memset(&seen, 0, sizeof(seen));
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_default_handler(p, tx_record, &seen);
+    rcm_feed(p, q.buf, q.len);
+    ASSERT_EQ(seen.frames, 4);
+    static const uint16_t want_seq[4] = { 0xFFFE, 0xFFFF, 0, 1 };
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(seen.seq[i], want_seq[i]);
+        ASSERT_EQ(seen.cmd_id[i], i == 0 ? DUML_CMD_RC_ENABLE : DUML_CMD_RC_CHANNEL);
+    }
+    rcm_stats_t st;
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.bytes_discarded, 0);
+
+    /* Full: the frame is refused and its seq not consumed */
+    rcm_tx_clear(&q);
+    ASSERT_EQ(q.len, 0);
+    ASSERT_EQ(q.seq, 2);
+    unsigned fit = RCM_TX_QUEUE_MAX / 13;
+    for (unsigned i = 0; i < fit; i++)
+        ASSERT(rcm_tx_push(&q, &ch, NULL, NULL) != NULL);
+    ASSERT(rcm_tx_push(&q, &ch, NULL, NULL) == NULL);
+    ASSERT_EQ(q.count, fit);
+    ASSERT_EQ(q.seq, (uint16_t)(2 + fit));
+    ASSERT(rcm_tx_push(NULL, &ch, NULL, NULL) == NULL);
+    rcm_destroy(p);
+}
+
+/* ---- Request tracking ---- */
+
+static int      g_resp_count;
+static int      g_timeout_count;
+static uint16_t g_resp_seq;
+static uint64_t g_resp_rtt;
+
+static void test_response_cb(uint16_t seq, const rcm_frame_view_t *resp,
+                             uint64_t rtt_ns, void *userdata) {
+    (void)userdata;
+    if (resp) {
+        ASSERT_EQ(resp->seq, seq);
+        g_resp_count++;
+    } else {
+        g_timeout_count++;
+    }
+    g_resp_seq = seq;
+    g_resp_rtt = rtt_ns;
+}
+
+/* An RC -> PC response to a channel request with the given seq */
+static int build_channel_response(uint8_t *out, size_t size, uint16_t seq,
+                                  uint8_t pack_type) {
+    uint8_t payload[] = { 0x00 };
+    return rcm_build_packet(out, size, DUML_DEV_RC, 0, DUML_DEV_PC, 0, seq,
+                            pack_type, DUML_ACK_NO_ACK, 0,
+                            DUML_CMD_SET_RC, DUML_CMD_RC_CHANNEL,
+                            payload, sizeof(payload));
+}
+
+TEST(test_request_matched_by_response) {
+    g_resp_count = g_timeout_count = 0;
+    g_view_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_response_callback(p, test_response_cb, NULL);
+    ASSERT_EQ(rcm_register_handler(p, DUML_CMD_SET_RC, DUML_CMD_RC_CHANNEL,
+                                   test_view_handler, NULL), 0);
+
+    uint8_t req[32], resp[32];
+    int rlen = rcm_build_channel_request(req, sizeof(req), 7);
+    ASSERT_EQ(rcm_track_request(p, req, (size_t)rlen, 1000), 0);
+    ASSERT_EQ(rcm_pending_requests(p), 1);
+    ASSERT_EQ(rcm_request_rtt_ns(p), 0);
+
+    /* Wrong seq, and a request with the right seq: neither completes it */
+    int n = build_channel_response(resp, sizeof(resp), 8, DUML_PACK_RESPONSE);
+    rcm_feed(p, resp, (size_t)n);
+    n = build_channel_response(resp, sizeof(resp), 7, DUML_PACK_REQUEST);
+    rcm_feed(p, resp, (size_t)n);
+    ASSERT_EQ(g_resp_count, 0);
+    ASSERT_EQ(rcm_pending_requests(p), 1);
+
+    n = build_channel_response(resp, sizeof(resp), 7, DUML_PACK_RESPONSE);
+    rcm_feed(p, resp, (size_t)n);
+    ASSERT_EQ(g_resp_count, 1);
+    ASSERT_EQ(g_resp_seq, 7);
+    ASSERT(g_resp_rtt > 0);
+    ASSERT_EQ(rcm_pending_requests(p), 0);
+    ASSERT_EQ(g_view_count, 3); /* still dispatched to the handler */
+
+    /* A duplicate response has nothing left to match */
+    rcm_feed(p, resp, (size_t)n);
+    ASSERT_EQ(g_resp_count, 1);
+
+    rcm_stats_t st;
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.requests_tracked, 1);
+    ASSERT_EQ(st.responses_matched, 1);
+    ASSERT_EQ(st.request_timeouts, 0);
+    ASSERT_EQ(st.rtt_last_ns, g_resp_rtt);
+    ASSERT_EQ(st.rtt_min_ns, g_resp_rtt);
+    ASSERT_EQ(st.rtt_max_ns, g_resp_rtt);
+    ASSERT_EQ(st.rtt_smoothed_ns, g_resp_rtt);
+    ASSERT_EQ(rcm_request_rtt_ns(p), g_resp_rtt);
+
+    /* The smoothed RTT survives a stats reset */
+    rcm_reset_stats(p);
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.responses_matched, 0);
+    ASSERT_EQ(st.rtt_smoothed_ns, g_resp_rtt);
+    rcm_destroy(p);
+}
+
+TEST(test_request_timeout_and_slots) {
+    g_resp_count = g_timeout_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_set_response_callback(p, test_response_cb, NULL);
+
+    uint8_t req[32];
+    int rlen = rcm_build_channel_request(req, sizeof(req), 3);
+    ASSERT_EQ(rcm_expire_requests(p), 0);
+    ASSERT_EQ(rcm_track_request(p, req, (size_t)rlen, 0), 0);
+
+    /* seq + RCM_MAX_PENDING maps to the same slot while 3 is pending */
+    uint8_t other[32];
+    int olen = rcm_build_channel_request(other, sizeof(other), 3 + RCM_MAX_PENDING);
+    ASSERT_EQ(rcm_track_request(p, other, (size_t)olen, 0), -1);
+    /* Re-tracking the same seq just restarts it */
+    ASSERT_EQ(rcm_track_request(p, req, (size_t)rlen, 0), 0);
+    ASSERT_EQ(rcm_pending_requests(p), 1);
+
+    ASSERT_EQ(rcm_expire_requests(p), 1);
+    ASSERT_EQ(g_timeout_count, 1);
+    ASSERT_EQ(g_resp_seq, 3);
+    ASSERT_EQ(rcm_pending_requests(p), 0);
+    ASSERT_EQ(rcm_track_request(p, other, (size_t)olen, 1000), 0);
+    ASSERT_EQ(rcm_expire_requests(p), 0);
+
+    /* A late response to the expired request is not matched */
+    uint8_t resp[32];
+    int n = build_channel_response(resp, sizeof(resp), 3, DUML_PACK_RESPONSE);
+    rcm_feed(p, resp, (size_t)n);
+    ASSERT_EQ(g_resp_count, 0);
+
+    rcm_stats_t st;
+    rcm_get_stats(p, &st);
+    ASSERT_EQ(st.requests_tracked, 3);
+    ASSERT_EQ(st.request_timeouts, 1);
+    ASSERT_EQ(st.rtt_min_ns, 0);
+
+    ASSERT_EQ(rcm_track_request(p, req, DUML_MIN_FRAME_LEN - 1, 0), -1);
+    ASSERT_EQ(rcm_track_request(NULL, req, (size_t)rlen, 0), -1);
+    ASSERT_EQ(rcm_expire_requests(NULL), 0);
+    ASSERT_EQ(rcm_pending_requests(NULL), 0);
+    rcm_destroy(p);
+}
+
+/* ---- Native USB reader ---- */
+
+#ifdef __linux__
+TEST(test_usb_start_rejects_bad_config) {
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_usb_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.fd = 0;
+    cfg.ep_in = 0x81;
+    cfg.ep_out = 0x01;
+
+    rcm_usb_config_t bad = cfg;
+    bad.fd = -1;
+    errno = 0;
+    assert(rcm_usb_start(p, &bad) == NULL && errno == EINVAL);
+
+    bad = cfg;
+    bad.ep_in = 0x01; /* OUT address */
+    errno = 0;
+    assert(rcm_usb_start(p, &bad) == NULL && errno == EINVAL);
+
+    bad = cfg;
+    bad.ep_out = 0x82; /* IN address */
+    errno = 0;
+    assert(rcm_usb_start(p, &bad) == NULL && errno == EINVAL);
+
+    bad = cfg;
+    bad.urbs = RCM_USB_MAX_URBS + 1;
+    errno = 0;
+    assert(rcm_usb_start(p, &bad) == NULL && errno == EINVAL);
+
+    bad = cfg;
+    bad.poll_inflight = RCM_MAX_PENDING + 1;
+    errno = 0;
+    assert(rcm_usb_start(p, &bad) == NULL && errno == EINVAL);
+
+    assert(rcm_usb_start(NULL, &cfg) == NULL);
+    assert(rcm_usb_start(p, NULL) == NULL);
+    assert(!rcm_usb_running(NULL));
+    assert(rcm_usb_send(NULL, (const uint8_t *)"x", 1) == -1);
+    rcm_usb_stop(NULL);
+    rcm_destroy(p);
+}
+
+TEST(test_usb_start_fails_on_non_usb_fd) {
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    int fds[2];
+    assert(pipe(fds) == 0);
+
+    rcm_usb_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.fd = fds[0];
+    cfg.ep_in = 0x81;
+    errno = 0;
+    assert(rcm_usb_start(p, &cfg) == NULL);
+    assert(errno != 0); /* SUBMITURB on a pipe: ENOTTY */
+
+    /* The parser is handed back untouched */
+    uint8_t payload[17] = {0};
+    uint8_t frame[64];
+    int len = build_rc_push_frame(frame, sizeof(frame), payload);
+    g_callback_count = 0;
+    assert(rcm_feed(p, frame, (size_t)len) == 1);
+    assert(g_callback_count == 1);
+
+    close(fds[0]);
+    close(fds[1]);
+    rcm_destroy(p);
+}
+
+/* ---- Native evdev reader ---- */
+
+static void put_event(struct input_event *ev, uint16_t type, uint16_t code, int32_t value) {
+    memset(ev, 0, sizeof(*ev));
+    ev->type = type;
+    ev->code = code;
+    ev->value = value;
+}
+
+/* Wait until the reader thread has published `want` states */
+static bool wait_for_publishes(const rcm_parser_t *p, uint32_t want, rc_state_t *s) {
+    for (int i = 0; i < 2000; i++) {
+        uint32_t seq = 0;
+        if (rcm_snapshot(p, s, &seq) == 0 && seq >= want)
+            return seq == want;
+        nanosleep(&(struct timespec){ .tv_nsec = 1000000 }, NULL);
+    }
+    return false;
+}
+
+TEST(test_evdev_one_state_per_syn_report) {
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    int fds[2];
+    assert(pipe(fds) == 0);
+
+    rcm_evdev_config_t cfg;
+    rcm_evdev_config_init(&cfg, fds[0]);
+    cfg.scale = 1.0f;
+    rcm_evdev_reader_t *r = rcm_evdev_start(p, &cfg);
+    assert(r != NULL && rcm_evdev_running(r));
+
+    /* Two reports in one write: only the axes in force at each SYN count */
+    struct input_event ev[8];
+    put_event(&ev[0], EV_ABS, ABS_X, 100);
+    put_event(&ev[1], EV_ABS, ABS_Y, -200);
+    put_event(&ev[2], EV_ABS, ABS_X, 150);
+    put_event(&ev[3], EV_SYN, SYN_REPORT, 0);
+    put_event(&ev[4], EV_ABS, ABS_Z, 300);
+    put_event(&ev[5], EV_ABS, ABS_RZ, -400);
+    put_event(&ev[6], EV_ABS, ABS_HAT0X, 1);   /* unmapped */
+    put_event(&ev[7], EV_SYN, SYN_REPORT, 0);
+    assert(write(fds[1], ev, sizeof(ev)) == (ssize_t)sizeof(ev));
+
+    rc_state_t s;
+    assert(wait_for_publishes(p, 2, &s));
+    assert(s.stick_right.horizontal == 150);
+    assert(s.stick_right.vertical == -200);
+    assert(s.stick_left.vertical == 300);
+    assert(s.stick_left.horizontal == -400);
+    assert(s.left_wheel == 0 && s.right_wheel == 0);
+    assert(!s.shutter && !s.record && s.right_wheel_delta == 0);
+
+    rcm_evdev_stop(r);
+    rcm_stats_t st;
+    assert(rcm_get_stats(p, &st) == 0 && st.rc_pushes == 2);
+    close(fds[0]);
+    close(fds[1]);
+    rcm_destroy(p);
+}
+
+TEST(test_evdev_syn_dropped_and_eof) {
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    int fds[2];
+    assert(pipe(fds) == 0);
+
+    rcm_evdev_config_t cfg;
+    rcm_evdev_config_init(&cfg, fds[0]);
+    cfg.scale = 2.0f;
+    cfg.abs_code[RCM_EVDEV_LEFT_V] = -1;
+    rcm_evdev_reader_t *r = rcm_evdev_start(p, &cfg);
+    assert(r != NULL);
+
+    /* Events inside a SYN_DROPPED gap are discarded up to the next report */
+    struct input_event ev[6];
+    put_event(&ev[0], EV_ABS, ABS_X, 10);
+    put_event(&ev[1], EV_ABS, ABS_Z, 99);      /* slot unmapped */
+    put_event(&ev[2], EV_SYN, SYN_REPORT, 0);
+    put_event(&ev[3], EV_SYN, SYN_DROPPED, 0);
+    put_event(&ev[4], EV_ABS, ABS_X, 500);
+    put_event(&ev[5], EV_SYN, SYN_REPORT, 0);
+    assert(write(fds[1], ev, sizeof(ev)) == (ssize_t)sizeof(ev));
+
+    rc_state_t s;
+    assert(wait_for_publishes(p, 2, &s));
+    assert(s.stick_right.horizontal == 20);    /* EVIOCGABS fails on a pipe */
+    assert(s.stick_left.vertical == 0);
+
+    /* Writer gone: the loop ends on its own */
+    close(fds[1]);
+    for (int i = 0; i < 2000 && rcm_evdev_running(r); i++)
+        nanosleep(&(struct timespec){ .tv_nsec = 1000000 }, NULL);
+    assert(!rcm_evdev_running(r));
+    rcm_evdev_stop(r);
+
+    errno = 0;
+    cfg.fd = -1;
+    assert(rcm_evdev_start(p, &cfg) == NULL && errno == EINVAL);
+    rcm_evdev_config_init(&cfg, fds[0]);
+    cfg.abs_code[0] = ABS_CNT;
+    assert(rcm_evdev_start(p, &cfg) == NULL && errno == EINVAL);
+    assert(!rcm_evdev_running(NULL));
+    rcm_evdev_stop(NULL);
+
+    close(fds[0]);
+    rcm_destroy(p);
+}
+
+TEST(test_feed_payload_goes_through_parser) {
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    uint8_t payload[17] = {0};
+    fill_axes(payload, 0x400);
+
+    assert(rcm_feed_payload(p, payload, 16) == -1);
+    assert(rcm_feed_payload(NULL, payload, 17) == -1);
+    assert(rcm_feed_payload(p, payload, 17) == 1);
+    assert(g_callback_count == 1);
+
+    /* Change detection and the mailbox apply as for framed pushes */
+    rcm_set_change_detect(p, true, 0, NULL);
+    assert(rcm_feed_payload(p, payload, 17) == 1);
+    assert(rcm_feed_payload(p, payload, 17) == 0);
+    uint32_t seq = 0;
+    rc_state_t s;
+    assert(rcm_snapshot(p, &s, &seq) == 0 && seq == 2); /* identical raw bytes skip the publish */
+
+    rcm_stats_t st;
+    rcm_get_stats(p, &st);
+    assert(st.rc_pushes == 3 && st.frames == 0 && st.bytes_in == 0);
+    assert(st.last_push_age_ns != UINT64_MAX);
+    rcm_destroy(p);
+}
+
+/* ---- Native stream ingestion loop ---- */
+
+/* Write `n` RC push frames with right stick H = 1..n into `fd` */
+static void write_push_frames(int fd, int n) {
+    uint8_t payload[17];
+    uint8_t frame[64];
+    for (int i = 1; i <= n; i++) {
+        fill_axes(payload, i);
+        int len = build_rc_push_frame(frame, sizeof(frame), payload);
+        assert(write(fd, frame, (size_t)len) == len);
+    }
+}
+
+static void count_after_feed(void *userdata) {
+    atomic_fetch_add((_Atomic int *)userdata, 1);
+}
+
+TEST(test_io_loop_serves_several_sources) {
+    rcm_io_loop_t *loop = rcm_io_create();
+    assert(loop != NULL);
+    rcm_parser_t *pa = rcm_create(test_callback, NULL);
+    rcm_parser_t *pb = rcm_create(test_callback, NULL);
+    int a[2], b[2];
+    assert(pipe(a) == 0 && pipe(b) == 0);
+    _Atomic int flushes = 0;
+
+    int ia = rcm_io_add(loop, a[0], pa, count_after_feed, &flushes);
+    int ib = rcm_io_add(loop, b[0], pb, NULL, NULL);
+    assert(ia >= 0 && ib >= 0 && ia != ib);
+    assert(rcm_io_alive(loop, ia) && rcm_io_alive(loop, ib));
+
+    /* More than one read() worth for A, a split frame for B */
+    write_push_frames(a[1], 1000);
+    uint8_t payload[17], frame[64];
+    fill_axes(payload, 77);
+    int len = build_rc_push_frame(frame, sizeof(frame), payload);
+    assert(write(b[1], frame, 5) == 5);
+    nanosleep(&(struct timespec){ .tv_nsec = 5000000 }, NULL);
+    assert(write(b[1], frame + 5, (size_t)len - 5) == len - 5);
+
+    rc_state_t s;
+    assert(wait_for_publishes(pa, 1000, &s));
+    assert(s.stick_right.horizontal == 1000);
+    assert(wait_for_publishes(pb, 1, &s));
+    assert(s.stick_right.horizontal == 77);
+    assert(atomic_load(&flushes) >= 1);
+
+    /* Removed: no more feeding; EOF: not alive, still attached */
+    rcm_io_remove(loop, ib);
+    assert(!rcm_io_alive(loop, ib));
+    write_push_frames(b[1], 3);
+    close(a[1]);
+    for (int i = 0; i < 2000 && rcm_io_alive(loop, ia); i++)
+        nanosleep(&(struct timespec){ .tv_nsec = 1000000 }, NULL);
+    assert(!rcm_io_alive(loop, ia));
+    rcm_io_remove(loop, ia);
+
+    uint32_t seq = 0;
+    assert(rcm_snapshot(pb, &s, &seq) == 0 && seq == 1);
+
+    rcm_io_destroy(loop);
+    close(a[0]);
+    close(b[0]);
+    close(b[1]);
+    rcm_destroy(pa);
+    rcm_destroy(pb);
+}
+
+TEST(test_io_connect_unix_abstract) {
+    char name[64];
+    snprintf(name, sizeof(name), "@rcm_test_%d", (int)getpid());
+    int srv = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(srv >= 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path + 1, name + 1, strlen(name) - 1);
+    socklen_t alen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(name));
+    assert(bind(srv, (struct sockaddr *)&addr, alen) == 0);
+    assert(listen(srv, 1) == 0);
+
+    int fd = rcm_io_connect_unix(name);
+    assert(fd >= 0);
+    int peer = accept(srv, NULL, NULL);
+    assert(peer >= 0);
+
+    rcm_io_loop_t *loop = rcm_io_create();
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    int id = rcm_io_add(loop, fd, p, NULL, NULL);
+    assert(id >= 0);
+    write_push_frames(peer, 10);
+
+    rc_state_t s;
+    assert(wait_for_publishes(p, 10, &s));
+    close(peer);
+    for (int i = 0; i < 2000 && rcm_io_alive(loop, id); i++)
+        nanosleep(&(struct timespec){ .tv_nsec = 1000000 }, NULL);
+    assert(!rcm_io_alive(loop, id));
+
+    errno = 0;
+    assert(rcm_io_connect_unix("") == -1 && errno == EINVAL);
+    assert(rcm_io_connect_unix(NULL) == -1);
+    assert(rcm_io_add(loop, -1, p, NULL, NULL) == -1 && errno == EINVAL);
+    assert(!rcm_io_alive(loop, RCM_IO_MAX_SOURCES));
+    rcm_io_remove(loop, id);
+    rcm_io_destroy(loop);
+    rcm_io_destroy(NULL);
+
+    close(fd);
+    close(srv);
+    rcm_destroy(p);
+}
+
+/* ---- Capture files ---- */
+
+#define CAP_T0 1000000000ull  /* first chunk at 1 s */
+#define CAP_STEP 10000000ull  /* 10 ms apart */
+
+static void temp_path(char *out, size_t size) {
+    snprintf(out, size, "/tmp/rcm_test_XXXXXX");
+    int fd = mkstemp(out);
+    assert(fd >= 0);
+    close(fd);
+}
+
+/* 50 IN pushes 10 ms apart with an OUT command after the first */
+static void write_test_capture(const char *path) {
+    rcm_capture_writer_t *w = rcm_capture_open(path, 100);
+    ASSERT(w != NULL);
+    for (int i = 0; i < 50; i++) {
+        uint8_t payload[RC_PUSH_PAYLOAD_LEN], frame[64];
+        fill_axes(payload, i);
+        int n = build_rc_push_frame(frame, sizeof(frame), payload);
+        ASSERT_EQ(rcm_capture_write(w, CAP_T0 + (uint64_t)i * CAP_STEP, RCM_CAPTURE_SRC_USB,
+                                    RCM_CAPTURE_IN, frame, (size_t)n), 0);
+        if (i == 0) {
+            uint8_t cmd[32];
+            int m = rcm_build_enable_cmd(cmd, sizeof(cmd), 1);
+            ASSERT_EQ(rcm_capture_write(w, CAP_T0 + 1, RCM_CAPTURE_SRC_USB,
+                                        RCM_CAPTURE_OUT, cmd, (size_t)m), 0);
+        }
+    }
+    ASSERT_EQ(rcm_capture_close(w), 0);
+}
+
+TEST(test_capture_roundtrip_and_seek) {
+    char path[64];
+    temp_path(path, sizeof(path));
+    write_test_capture(path);
+
+    rcm_capture_reader_t *r = rcm_capture_reader_open(path);
+    ASSERT(r != NULL);
+    ASSERT(!rcm_capture_is_raw(r));
+    ASSERT_EQ(rcm_capture_index_count(r), 5); /* one per 100 ms window */
+
+    g_callback_count = 0;
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    rcm_capture_chunk_t c;
+    int in = 0, out = 0;
+    uint64_t prev = 0;
+    while (rcm_capture_next(r, &c) == 1) {
+        ASSERT(c.t_ns >= prev);
+        ASSERT_EQ(c.offset % 8, 0);
+        ASSERT_EQ(c.source, RCM_CAPTURE_SRC_USB);
+        prev = c.t_ns;
+        if (c.dir == RCM_CAPTURE_OUT) {
+            ASSERT_EQ(c.len, 14);
+            out++;
+            continue;
+        }
+        ASSERT_EQ(c.t_ns, CAP_T0 + (uint64_t)in * CAP_STEP);
+        rcm_feed(p, c.data, c.len);
+        in++;
+    }
+    ASSERT_EQ(in, 50);
+    ASSERT_EQ(out, 1);
+    ASSERT_EQ(g_callback_count, 50);
+
+    /* Seek lands on the first chunk at or after the target */
+    ASSERT_EQ(rcm_capture_seek(r, CAP_T0 + 255 * 1000000ull), 0);
+    ASSERT_EQ(rcm_capture_next(r, &c), 1);
+    ASSERT_EQ(c.t_ns, CAP_T0 + 26 * CAP_STEP);
+    ASSERT_EQ(rcm_capture_seek(r, 0), 0);
+    ASSERT_EQ(rcm_capture_next(r, &c), 1);
+    ASSERT_EQ(c.t_ns, CAP_T0);
+    ASSERT_EQ(rcm_capture_seek(r, CAP_T0 + 50 * CAP_STEP), 1);
+    ASSERT_EQ(rcm_capture_next(r, &c), 0);
+
+    rcm_destroy(p);
+    rcm_capture_reader_close(r);
+    unlink(path);
+}
+
+TEST(test_capture_truncated_and_raw) {
+    char path[64];
+    temp_path(path, sizeof(path));
+    write_test_capture(path);
+
+    /* Cut off the index and half of the last chunk, as after a crash */
+    FILE *fp = fopen(path, "rb");
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    ASSERT_EQ(truncate(path, size - 16 * 5 - 16 - 20), 0);
+
+    rcm_capture_reader_t *r = rcm_capture_reader_open(path);
+    ASSERT(r != NULL);
+    ASSERT_EQ(rcm_capture_index_count(r), 0);
+    rcm_capture_chunk_t c;
+    int chunks = 0, got;
+    while ((got = rcm_capture_next(r, &c)) == 1) chunks++;
+    ASSERT_EQ(got, -1);
+    ASSERT_EQ(chunks, 50); /* 49 pushes + the OUT command */
+
+    /* Without an index, seeking scans the chunk headers */
+    ASSERT_EQ(rcm_capture_seek(r, CAP_T0 + 30 * CAP_STEP), 0);
+    ASSERT_EQ(rcm_capture_next(r, &c), 1);
+    ASSERT_EQ(c.t_ns, CAP_T0 + 30 * CAP_STEP);
+    rcm_capture_reader_close(r);
+
+    /* A legacy raw recording is plain DUML, returned as IN chunks */
+    uint8_t raw[2 * 64];
+    uint8_t payload[RC_PUSH_PAYLOAD_LEN];
+    fill_axes(payload, 5);
+    int n = build_rc_push_frame(raw, 64, payload);
+    memcpy(raw + n, raw, (size_t)n);
+    fp = fopen(path, "wb");
+    ASSERT_EQ(fwrite(raw, 1, (size_t)(2 * n), fp), (size_t)(2 * n));
+    fclose(fp);
+
+    r = rcm_capture_reader_open(path);
+    ASSERT(r != NULL);
+    ASSERT(rcm_capture_is_raw(r));
+    ASSERT_EQ(rcm_capture_next(r, &c), 1);
+    ASSERT_EQ(c.len, (size_t)(2 * n));
+    ASSERT_EQ(c.dir, RCM_CAPTURE_IN);
+    ASSERT_EQ(memcmp(c.data, raw, c.len), 0);
+    ASSERT_EQ(rcm_capture_next(r, &c), 0);
+    ASSERT_EQ(rcm_capture_seek(r, 0), -1);
+    rcm_capture_reader_close(r);
+    unlink(path);
+}
+
+TEST(test_capture_view_matches_reader) {
+    char path[64];
+    temp_path(path, sizeof(path));
+    write_test_capture(path);
+
+    FILE *fp = fopen(path, "rb");
+    fseek(fp, 0, SEEK_END);
+    size_t size = (size_t)ftell(fp);
+    rewind(fp);
+    uint8_t *buf = malloc(size);
+    ASSERT_EQ(fread(buf, 1, size, fp), size);
+    fclose(fp);
+
+    rcm_capture_view_t v;
+    ASSERT_EQ(rcm_capture_view_init(&v, buf, size), 0);
+    ASSERT(!v.raw);
+    ASSERT_EQ(v.index_len, 5);
+    uint64_t t, off;
+    ASSERT_EQ(rcm_capture_view_index(&v, 1, &t, &off), 0);
+    ASSERT_EQ(t, CAP_T0 + 10 * CAP_STEP);
+    ASSERT_EQ(rcm_capture_view_index(&v, 5, &t, &off), -1);
+
+    /* Same chunks, in place, as the FILE reader returns */
+    rcm_capture_reader_t *r = rcm_capture_reader_open(path);
+    rcm_capture_chunk_t a, b;
+    int chunks = 0;
+    while (rcm_capture_next(r, &a) == 1) {
+        ASSERT_EQ(rcm_capture_view_next(&v, &b), 1);
+        ASSERT_EQ(b.offset, a.offset);
+        ASSERT_EQ(b.t_ns, a.t_ns);
+        ASSERT_EQ(b.dir, a.dir);
+        ASSERT_EQ(b.len, a.len);
+        ASSERT(b.data == buf + b.offset + RCM_CAPTURE_CHUNK_HDR_LEN);
+        ASSERT_EQ(memcmp(a.data, b.data, a.len), 0);
+        chunks++;
+    }
+    ASSERT_EQ(chunks, 51);
+    ASSERT_EQ(rcm_capture_view_next(&v, &b), 0);
+    rcm_capture_reader_close(r);
+
+    ASSERT_EQ(rcm_capture_view_seek(&v, CAP_T0 + 255 * 1000000ull), 0);
+    ASSERT_EQ(rcm_capture_view_next(&v, &b), 1);
+    ASSERT_EQ(b.t_ns, CAP_T0 + 26 * CAP_STEP);
+    ASSERT_EQ(rcm_capture_view_seek(&v, CAP_T0 + 50 * CAP_STEP), 1);
+
+    /* A truncated buffer ends in -1; a bad header length is rejected */
+    ASSERT_EQ(rcm_capture_view_init(&v, buf, size - 16 * 5 - 16 - 20), 0);
+    ASSERT_EQ(v.index_len, 0);
+    int got;
+    chunks = 0;
+    while ((got = rcm_capture_view_next(&v, &b)) == 1) chunks++;
+    ASSERT_EQ(got, -1);
+    ASSERT_EQ(chunks, 50);
+    buf[7] = 0xFF; /* header_len past the end */
+    ASSERT_EQ(rcm_capture_view_init(&v, buf, size), -1);
+
+    /* Raw recordings come back as one span */
+    ASSERT_EQ(rcm_capture_view_init(&v, buf + RCM_CAPTURE_HEADER_LEN, 100), 0);
+    ASSERT(v.raw);
+    ASSERT_EQ(rcm_capture_view_next(&v, &b), 1);
+    ASSERT_EQ(b.len, 100);
+    ASSERT_EQ(rcm_capture_view_next(&v, &b), 0);
+    ASSERT_EQ(rcm_capture_view_init(&v, NULL, 0), 0);
+    ASSERT_EQ(rcm_capture_view_next(&v, &b), 0);
+    ASSERT_EQ(rcm_capture_view_init(NULL, buf, size), -1);
+
+    free(buf);
+    unlink(path);
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void write_file(const char *path, const uint8_t *buf, size_t len) {
+    FILE *fp = fopen(path, "wb");
+    ASSERT(fp != NULL);
+    ASSERT_EQ(fwrite(buf, 1, len, fp), len);
+    fclose(fp);
+}
+
+TEST(test_capture_corrupt_trailer_and_index) {
+    char path[64];
+    temp_path(path, sizeof(path));
+    write_test_capture(path);
+    FILE *fp = fopen(path, "rb");
+    fseek(fp, 0, SEEK_END);
+    size_t size = (size_t)ftell(fp);
+    rewind(fp);
+    uint8_t *buf = malloc(size);
+    ASSERT_EQ(fread(buf, 1, size, fp), size);
+    fclose(fp);
+
+    /* A trailer whose start + count * 16 wraps to the file size is ignored */
+    uint8_t small[64];
+    memset(small, 0, sizeof(small));
+    memcpy(small, buf, RCM_CAPTURE_HEADER_LEN);
+    uint8_t *tr = small + sizeof(small) - RCM_CAPTURE_TRAILER_LEN;
+    put_le64(tr, (uint64_t)(sizeof(small) - RCM_CAPTURE_TRAILER_LEN) -
+                 0xFFFFFFFFull * RCM_CAPTURE_INDEX_ENTRY_LEN);
+    memset(tr + 8, 0xFF, 4);
+    memcpy(tr + 12, "RCMI", 4);
+    rcm_capture_view_t v;
+    ASSERT_EQ(rcm_capture_view_init(&v, small, sizeof(small)), 0);
+    ASSERT_EQ(v.index_len, 0);
+    ASSERT_EQ(v.data_end, sizeof(small));
+    ASSERT_EQ(rcm_capture_view_seek(&v, CAP_T0), -1); /* zero chunks run into the trailer */
+    write_file(path, small, sizeof(small));
+    rcm_capture_reader_t *r = rcm_capture_reader_open(path);
+    ASSERT(r != NULL);
+    ASSERT_EQ(rcm_capture_index_count(r), 0);
+    rcm_capture_reader_close(r);
+
+    /* Index entries pointing outside the chunk area fail the seek */
+    ASSERT_EQ(rcm_capture_view_init(&v, buf, size), 0);
+    ASSERT_EQ(v.index_len, 5);
+    uint8_t *entry = buf + v.data_end + 2 * RCM_CAPTURE_INDEX_ENTRY_LEN;
+    put_le64(entry + 8, (uint64_t)size * 2);
+    put_le64(entry + RCM_CAPTURE_INDEX_ENTRY_LEN + 8, 3);
+    ASSERT_EQ(rcm_capture_view_seek(&v, CAP_T0 + 25 * CAP_STEP), -1);
+    ASSERT_EQ(rcm_capture_view_seek(&v, CAP_T0 + 35 * CAP_STEP), -1);
+    ASSERT_EQ(rcm_capture_view_seek(&v, CAP_T0 + 15 * CAP_STEP), 0);
+    write_file(path, buf, size);
+    r = rcm_capture_reader_open(path);
+    ASSERT(r != NULL);
+    ASSERT_EQ(rcm_capture_seek(r, CAP_T0 + 25 * CAP_STEP), -1);
+    ASSERT_EQ(rcm_capture_seek(r, CAP_T0 + 35 * CAP_STEP), -1);
+    ASSERT_EQ(rcm_capture_seek(r, CAP_T0 + 15 * CAP_STEP), 0);
+    rcm_capture_reader_close(r);
+
+    /* The parallel decoder skips them as split points */
+    rcm_decode_config_t cfg = { 2, 64 };
+    rcm_columns_t c;
+    ASSERT_EQ(rcm_decode_capture(buf, size, &cfg, &c), 0);
+    ASSERT_EQ(c.count, 50);
+    rcm_columns_free(&c);
+
+    free(buf);
+    unlink(path);
+}
+
+/* ---- Parallel decode ---- */
+
+typedef struct {
+    rcm_packed_state_t *rows;
+    uint64_t           *t_ns;   /* of the chunk holding each row's SOF */
+    size_t              count;
+} ref_rows_t;
+
+/*
+ * Pseudo-random DUML stream: RC pushes, non-RC frames, garbage with stray
+ * SOFs and truncated pushes. Returns its length.
+ */
+static size_t build_noisy_stream(uint8_t *out, size_t cap, uint32_t x) {
+    size_t n = 0;
+    while (n + 64 + 16 <= cap) {
+        x = x * 1103515245u + 12345u;
+        unsigned kind = (x >> 16) % 10;
+        uint8_t payload[32], frame[64];
+        for (int i = 0; i < 32; i++) {
+            x = x * 1103515245u + 12345u;
+            payload[i] = (uint8_t)(x >> 16);
+        }
+        if (kind < 6) {
+            n += (size_t)build_rc_push_frame(out + n, cap - n, payload);
+        } else if (kind == 6) {
+            n += (size_t)rcm_build_packet(out + n, cap - n, DUML_DEV_RC, 0, DUML_DEV_APP, 0,
+                                          7, DUML_PACK_REQUEST, DUML_ACK_NO_ACK, 0,
+                                          0x00, 0x0E, payload, payload[0] % 24);
+        } else if (kind == 7) {
+            int m = build_rc_push_frame(frame, sizeof(frame), payload);
+            size_t cut = 1 + payload[1] % (size_t)(m - 1);
+            memcpy(out + n, frame, cut);
+            n += cut;
+        } else {
+            size_t len = 1 + payload[2] % 16;
+            for (size_t i = 0; i < len; i++)
+                out[n + i] = (payload[3 + i] & 3) == 0 ? DUML_SOF : payload[3 + i];
+            n += len;
+        }
+    }
+    return n;
+}
+
+static void assert_columns_match(const rcm_columns_t *c, const ref_rows_t *ref,
+                                 bool check_t) {
+    ASSERT_EQ(c->count, ref->count);
+    for (size_t i = 0; i < ref->count; i++) {
+        const rcm_packed_state_t *s = &ref->rows[i];
+        ASSERT_EQ(c->flags[i], s->flags);
+        ASSERT_EQ(c->stick_right_h[i], s->stick_right_h);
+        ASSERT_EQ(c->stick_right_v[i], s->stick_right_v);
+        ASSERT_EQ(c->stick_left_h[i], s->stick_left_h);
+        ASSERT_EQ(c->stick_left_v[i], s->stick_left_v);
+        ASSERT_EQ(c->left_wheel[i], s->left_wheel);
+        ASSERT_EQ(c->right_wheel[i], s->right_wheel);
+        ASSERT_EQ(c->right_wheel_delta[i], s->right_wheel_delta);
+        ASSERT_EQ(c->t_ns[i], check_t ? ref->t_ns[i] : 0);
+    }
+}
+
+TEST(test_decode_matches_sequential_parser) {
+    enum { STREAM = 64 * 1024 };
+    uint8_t *stream = malloc(STREAM);
+    size_t len = build_noisy_stream(stream, STREAM, 0x5EEDu);
+
+    /* Record it in random-sized chunks 100 us apart, index every 1 ms */
+    char path[64];
+    temp_path(path, sizeof(path));
+    rcm_capture_writer_t *w = rcm_capture_open(path, 1);
+    ASSERT(w != NULL);
+    ref_rows_t ref = { malloc(STREAM / 13 * sizeof(rcm_packed_state_t)),
+                       malloc(STREAM / 13 * sizeof(uint64_t)), 0 };
+    uint64_t *chunk_t = malloc(len * sizeof(uint64_t)); /* per stream byte */
+    rcm_batch_entry_t batch[64];
+    rcm_parser_t *p = rcm_create(test_callback, NULL);
+    uint32_t x = 99;
+    uint64_t t = CAP_T0;
+    for (size_t off = 0; off < len; ) {
+        x = x * 1103515245u + 12345u;
+        size_t n = 1 + (x >> 16) % 300;
+        if (n > len - off) n = len - off;
+        ASSERT_EQ(rcm_capture_write(w, t, RCM_CAPTURE_SRC_USB, RCM_CAPTURE_IN,
+                                    stream + off, n), 0);
+        if ((x >> 8) % 7 == 0) /* interleaved OUT chunks are skipped */
+            ASSERT_EQ(rcm_capture_write(w, t, RCM_CAPTURE_SRC_USB, RCM_CAPTURE_OUT,
+                                        stream, 20), 0);
+        for (size_t i = 0; i < n; i++)
+            chunk_t[off + i] = t;
+        int got = rcm_feed_batch(p, stream + off, n, batch, 64);
+        for (int i = 0; i < got; i++) {
+            ref.t_ns[ref.count] = chunk_t[(int64_t)off + batch[i].offset];
+            rcm_pack_state(&batch[i].state, &ref.rows[ref.count++]);
+        }
+        off += n;
+        t += 100000;
+    }
+    ASSERT_EQ(rcm_capture_close(w), 0);
+    rcm_destroy(p);
+    ASSERT(ref.count > 500);
+
+    FILE *fp = fopen(path, "rb");
+    fseek(fp, 0, SEEK_END);
+    size_t size = (size_t)ftell(fp);
+    rewind(fp);
+    uint8_t *buf = malloc(size);
+    ASSERT_EQ(fread(buf, 1, size, fp), size);
+    fclose(fp);
+
+    /* Indexed and unindexed, many small segments, one and several threads */
+    rcm_capture_view_t v;
+    ASSERT_EQ(rcm_capture_view_init(&v, buf, size), 0);
+    ASSERT(v.index_len > 20);
+    size_t sizes[2] = { size, v.data_end };
+    for (int unindexed = 0; unindexed < 2; unindexed++) {
+        for (unsigned threads = 1; threads <= 4; threads += 3) {
+            rcm_decode_config_t cfg = { threads, 512 };
+            rcm_columns_t c;
+            ASSERT_EQ(rcm_decode_capture(buf, sizes[unindexed], &cfg, &c), 0);
+            assert_columns_match(&c, &ref, true);
+            rcm_columns_free(&c);
+        }
+    }
+
+    /* A raw recording splits at arbitrary offsets and resyncs */
+    for (size_t seg = 97; seg <= 4096; seg *= 6) {
+        rcm_decode_config_t cfg = { 3, seg };
+        rcm_columns_t c;
+        ASSERT_EQ(rcm_decode_capture(stream, len, &cfg, &c), 0);
+        assert_columns_match(&c, &ref, false);
+        rcm_columns_free(&c);
+    }
+
+    /* Cut mid-capture: rows up to the bad chunk, then 1 */
+    rcm_columns_t c;
+    ASSERT_EQ(rcm_decode_capture(buf, v.data_end - 5, NULL, &c), 1);
+    ASSERT(c.count > 0 && c.count <= ref.count);
+    rcm_columns_free(&c);
+    ASSERT_EQ(rcm_decode_capture(NULL, 10, NULL, &c), -1);
+
+    free(buf);
+    free(ref.rows);
+    free(ref.t_ns);
+    free(chunk_t);
+    free(stream);
+    unlink(path);
+}
+
+TEST(test_columns_file_roundtrip) {
+    uint8_t stream[4096];
+    size_t len = build_noisy_stream(stream, sizeof(stream), 7);
+    rcm_columns_t c, m;
+    ASSERT_EQ(rcm_decode_capture(stream, len, NULL, &c), 0);
+    ASSERT(c.count > 0);
+    ASSERT_EQ((uintptr_t)c.t_ns % RCM_COLUMNS_ALIGN, (uintptr_t)c.block % RCM_COLUMNS_ALIGN);
+
+    char path[64];
+    temp_path(path, sizeof(path));
+    ASSERT_EQ(rcm_columns_write(path, &c), 0);
+    ASSERT_EQ(rcm_columns_map(path, &m), 0);
+    ASSERT(m.mapped);
+    ASSERT_EQ(m.count, c.count);
+    ASSERT_EQ(m.block_len, c.block_len);
+    ASSERT_EQ(memcmp(m.block, c.block, c.block_len), 0);
+    ASSERT_EQ(m.stick_left_v[c.count - 1], c.stick_left_v[c.count - 1]);
+    ASSERT_EQ(m.flags[0], c.flags[0]);
+    rcm_columns_free(&m);
+    ASSERT(m.block == NULL);
+
+    /* A row count past the end of the file is rejected */
+    uint8_t *hdr = (uint8_t *)c.block;
+    hdr[16] = 0xFF;
+    hdr[17] = 0xFF;
+    ASSERT_EQ(rcm_columns_write(path, &c), 0);
+    errno = 0;
+    ASSERT_EQ(rcm_columns_map(path, &m), -1);
+    ASSERT_EQ(errno, EINVAL);
+
+    rcm_columns_free(&c);
+    rcm_columns_free(NULL);
+    unlink(path);
+}
+/* ---- Shared-memory publisher ---- */
+
+static rcm_packed_state_t shm_state(int v) {
+    rcm_packed_state_t ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.stick_right_h = (int16_t)v;
+    ps.flags = RCM_PK_PAUSE;
+    return ps;
+}
+
+TEST(test_shm_publish_read_and_overrun) {
+    rcm_shm_publisher_t *pub = rcm_shm_create("rcm-test", 20);
+    ASSERT(pub != NULL);
+
+    /* The consumer gets its fd over a socket, like a peer process would */
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    ASSERT_EQ(rcm_shm_send_fd(sv[0], rcm_shm_fd(pub)), 0);
+    int fd = rcm_shm_recv_fd(sv[1]);
+    ASSERT(fd >= 0);
+    rcm_shm_reader_t r;
+    ASSERT_EQ(rcm_shm_open(&r, fd), 0);
+    close(fd);
+    ASSERT_EQ(r.capacity, 32u);
+    ASSERT(!rcm_shm_closed(&r));
+
+    rcm_packed_state_t out[64];
+    ASSERT_EQ(rcm_shm_read(&r, out, 64), 0u);
+    ASSERT_EQ(rcm_shm_latest(&r, out), -1);
+    ASSERT_EQ(rcm_shm_wait(&r, 0), 0);
+
+    /* Through the parser callback */
+    rcm_parser_t *p = rcm_create(rcm_shm_callback, pub);
+    uint8_t payload[17], frame[64];
+    for (int i = 1; i <= 5; i++) {
+        fill_axes(payload, i);
+        int len = build_rc_push_frame(frame, sizeof(frame), payload);
+        rcm_feed(p, frame, (size_t)len);
+    }
+    ASSERT_EQ(rcm_shm_written(&r), 5u);
+    ASSERT_EQ(rcm_shm_claimed(&r), 5u);
+    ASSERT_EQ(rcm_shm_wait(&r, 0), 1);
+    ASSERT_EQ(rcm_shm_read(&r, out, 3), 3u);
+    ASSERT_EQ(out[0].stick_right_h, 1);
+    ASSERT_EQ(out[2].stick_right_h, 3);
+    ASSERT_EQ(rcm_shm_read(&r, out, 64), 2u);
+    ASSERT_EQ(out[1].stick_right_h, 5);
+    ASSERT_EQ(r.lost, 0u);
+
+    /* A consumer that falls behind skips to the oldest retained state */
+    for (int i = 0; i < 40; i++) {
+        rcm_packed_state_t ps = shm_state(100 + i);
+        rcm_shm_publish(pub, &ps);
+    }
+    ASSERT_EQ(rcm_shm_read(&r, out, 64), 32u);
+    ASSERT_EQ(r.lost, 8u);
+    ASSERT_EQ(out[0].stick_right_h, 108);
+    ASSERT_EQ(out[31].stick_right_h, 139);
+
+    /* latest() skips without counting a loss */
+    for (int i = 0; i < 3; i++) {
+        rcm_packed_state_t ps = shm_state(200 + i);
+        rcm_shm_publish(pub, &ps);
+    }
+    ASSERT_EQ(rcm_shm_latest(&r, out), 0);
+    ASSERT_EQ(out[0].stick_right_h, 202);
+    ASSERT_EQ(out[0].flags, RCM_PK_PAUSE);
+    ASSERT_EQ(rcm_shm_read(&r, out, 64), 0u);
+    ASSERT_EQ(r.lost, 8u);
+
+    /* Not a ring */
+    int pfd[2];
+    ASSERT_EQ(pipe(pfd), 0);
+    rcm_shm_reader_t bad;
+    ASSERT_EQ(rcm_shm_open(&bad, pfd[0]), -1);
+    ASSERT_EQ(rcm_shm_open(&bad, -1), -1);
+    ASSERT_EQ(errno, EINVAL);
+    close(pfd[0]);
+    close(pfd[1]);
+
+    rcm_destroy(p);
+    rcm_shm_destroy(pub);
+    ASSERT(rcm_shm_closed(&r));
+    errno = 0;
+    ASSERT_EQ(rcm_shm_wait(&r, 1000), -1);
+    ASSERT_EQ(errno, EPIPE);
+    rcm_shm_close(&r);
+    rcm_shm_close(NULL);
+    rcm_shm_destroy(NULL);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+TEST(test_shm_wait_across_processes) {
+    rcm_shm_publisher_t *pub = rcm_shm_create(NULL, 64);
+    ASSERT(pub != NULL);
+    int ready[2];
+    ASSERT_EQ(pipe(ready), 0);
+
+    pid_t pid = fork();
+    ASSERT(pid >= 0);
+    if (pid == 0) {
+        /* Consumer: count states until the publisher closes the ring */
+        rcm_shm_reader_t r;
+        if (rcm_shm_open(&r, rcm_shm_fd(pub)) != 0) _exit(100);
+        if (write(ready[1], "r", 1) != 1) _exit(101);
+        int n = 0, sum = 0;
+        rcm_packed_state_t out[8];
+        while (rcm_shm_wait(&r, 5000) == 1) {
+            size_t got = rcm_shm_read(&r, out, 8);
+            for (size_t i = 0; i < got; i++) sum += out[i].stick_right_h;
+            n += (int)got;
+        }
+        bool ok = errno == EPIPE && r.lost == 0 && sum == 50 * 51 / 2;
+        _exit(ok ? n : 102);
+    }
+
+    char c;
+    ASSERT_EQ(read(ready[0], &c, 1), 1);
+    for (int i = 1; i <= 50; i++) {
+        rcm_packed_state_t ps = shm_state(i);
+        rcm_shm_publish(pub, &ps);
+        if (i % 5 == 0) {
+            rcm_shm_wake(pub);
+            nanosleep(&(struct timespec){ .tv_nsec = 1000000 }, NULL);
+        }
+    }
+    rcm_shm_destroy(pub);
+
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 50);
+    close(ready[0]);
+    close(ready[1]);
+}
+#endif
+
 /* ---- Main ---- */
 
 int main(void) {
@@ -1629,6 +4158,101 @@ int main(void) {
     /* Packet builder field encoding */
     RUN(test_build_packet_cmd_type_fields);
 
+    /* Span-based feeding */
+    RUN(test_parser_split_at_every_offset);
+    RUN(test_parser_straddle_then_inline_frames);
+    RUN(test_parser_chunked_noisy_stream);
+
+    /* CRC engine */
+    RUN(test_crc_self_test);
+    RUN(test_crc_kernels_match_table);
+    RUN(test_crc_update_chains);
+    RUN(test_crc_select_parser_roundtrip);
+
+    /* Resync after false headers */
+    RUN(test_parser_resync_inside_false_frame);
+    RUN(test_parser_resync_nested_false_headers);
+
+    /* Batch output */
+    RUN(test_feed_batch_fills_entries);
+    RUN(test_feed_batch_straddled_offset_negative);
+    RUN(test_feed_batch_overflow_to_callback);
+
+    /* Frame handlers */
+    RUN(test_handler_receives_ack_view);
+    RUN(test_handler_override_and_unregister_rc_push);
+    RUN(test_default_handler_gets_unclaimed_frames);
+
+    /* Change detection */
+    RUN(test_change_detect_suppresses_repeats);
+    RUN(test_change_detect_axis_deadband);
+    RUN(test_change_detect_wheel_delta_and_batch);
+
+    /* Packed state */
+    RUN(test_packed_state_size);
+    RUN(test_packed_matches_parse_payload);
+    RUN(test_parse_payloads_matches_scalar);
+    RUN(test_packed_accessors);
+    RUN(test_feed_batch_packed);
+
+    /* Statistics */
+    RUN(test_stats_counts_each_outcome);
+    RUN(test_stats_independent_of_chunking);
+    RUN(test_stats_reset_and_overflow);
+    RUN(test_layout_lock_and_fallback);
+
+    /* Latency tracing */
+    RUN(test_trace_hook_events);
+
+    /* Latest-state mailbox */
+    RUN(test_snapshot_latest_state);
+    RUN(test_snapshot_ignores_change_suppression);
+    RUN(test_snapshot_concurrent_readers);
+
+    /* Coalesced delivery */
+    RUN(test_coalesced_take);
+
+    /* Motion history */
+    RUN(test_history_window_stats);
+    RUN(test_history_attached_to_parser);
+
+    /* Transmit queue */
+    RUN(test_tx_templates_match_builder);
+    RUN(test_tx_queue_batches_frames);
+
+    /* Request tracking */
+    RUN(test_request_matched_by_response);
+    RUN(test_request_timeout_and_slots);
+
+#ifdef __linux__
+    /* Native USB reader */
+    RUN(test_usb_start_rejects_bad_config);
+    RUN(test_usb_start_fails_on_non_usb_fd);
+
+    /* Native evdev reader */
+    RUN(test_evdev_one_state_per_syn_report);
+    RUN(test_evdev_syn_dropped_and_eof);
+    RUN(test_feed_payload_goes_through_parser);
+
+    /* Native stream ingestion loop */
+    RUN(test_io_loop_serves_several_sources);
+    RUN(test_io_connect_unix_abstract);
+
+    /* Capture files */
+    RUN(test_capture_roundtrip_and_seek);
+    RUN(test_capture_truncated_and_raw);
+    RUN(test_capture_view_matches_reader);
+    RUN(test_capture_corrupt_trailer_and_index);
+
+    /* Parallel decode */
+    RUN(test_decode_matches_sequential_parser);
+    RUN(test_columns_file_roundtrip);
+
+    /* Shared-memory publisher */
+    RUN(test_shm_publish_read_and_overrun);
+    RUN(test_shm_wait_across_processes);
+#endif
+
     printf("\nAll tests passed.\n");
     return 0;
 }
@@ -1,12 +1,17 @@
 /*
- * verify_recording.c - Feed a recorded .bin file back through rcm_feed()
- * and report how many valid RC push frames are decoded.
+ * verify_recording.c - Feed a recording back through rcm_feed() and report
+ * how many valid RC push frames are decoded.
  *
- * Usage: ./verify_recording <recording.bin>
+ * Reads capture files (rc_monitor_capture.h) and legacy raw .bin
+ * recordings. For captures only IN chunks are fed; the summary adds the
+ * OUT chunk count and the recorded time span.
+ *
+ * Usage: ./verify_recording <recording.rcap|recording.bin>
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include "rc_monitor.h"
+#include "rc_monitor_capture.h"
 
 static int g_count;
 static rc_state_t g_last;
@@ -28,24 +33,45 @@ static void cb(const rc_state_t *s, void *ud) {
 
 int main(int argc, char *argv[]) {
     if (argc != 2) {
-        fprintf(stderr, "Usage: %s <recording.bin>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <recording.rcap|recording.bin>\n", argv[0]);
         return 1;
     }
 
-    FILE *fp = fopen(argv[1], "rb");
-    if (!fp) { perror("fopen"); return 1; }
+    rcm_capture_reader_t *r = rcm_capture_reader_open(argv[1]);
+    if (!r) { perror("rcm_capture_reader_open"); return 1; }
 
     rcm_parser_t *p = rcm_create(cb, NULL);
-    if (!p) { fprintf(stderr, "rcm_create failed\n"); fclose(fp); return 1; }
+    if (!p) {
+        fprintf(stderr, "rcm_create failed\n");
+        rcm_capture_reader_close(r);
+        return 1;
+    }
 
-    uint8_t buf[4096];
-    size_t n;
-    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
-        rcm_feed(p, buf, n);
+    rcm_capture_chunk_t c = { 0 };
+    unsigned long chunks_in = 0, chunks_out = 0;
+    uint64_t first_ns = 0, last_ns = 0;
+    int got;
+    while ((got = rcm_capture_next(r, &c)) > 0) {
+        if (!first_ns) first_ns = c.t_ns;
+        last_ns = c.t_ns;
+        if (c.dir != RCM_CAPTURE_IN) {
+            chunks_out++;
+            continue;
+        }
+        chunks_in++;
+        rcm_feed(p, c.data, c.len);
+    }
+    if (got < 0)
+        fprintf(stderr, "warning: malformed chunk at offset %llu, stopped there\n",
+                (unsigned long long)c.offset);
 
     printf("\nDecoded %d RC push frames from %s\n", g_count, argv[1]);
+    if (!rcm_capture_is_raw(r))
+        printf("Capture: %lu IN / %lu OUT chunks over %.3f s, %zu index entries\n",
+               chunks_in, chunks_out, (double)(last_ns - first_ns) / 1e9,
+               rcm_capture_index_count(r));
 
     rcm_destroy(p);
-    fclose(fp);
-    return 0;
+    rcm_capture_reader_close(r);
+    return got < 0 ? 1 : 0;
 }